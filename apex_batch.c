@@ -0,0 +1,793 @@
+/*
+ * apex_batch.c
+ * Contains the batched functional model. The instances of a block step in
+ * lockstep while they are at the same PC, the ones at the lowest PC first,
+ * masking out the rest; an instance left on its own steps in scalar code.
+ * A block is as wide as the vector registers this file is compiled for
+ * (SSE2 by default, BATCH_ARCH in the Makefile selects wider ones).
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_cpu.h"
+#include "apex_batch.h"
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/* Instances in a block, the words of one vector register */
+#ifndef BATCH_LANES
+#if defined(__AVX512F__)
+#define BATCH_LANES 16
+#define BATCH_ISA "AVX-512"
+#elif defined(__AVX2__)
+#define BATCH_LANES 8
+#define BATCH_ISA "AVX2"
+#elif defined(__SSE2__)
+#define BATCH_LANES 4
+#define BATCH_ISA "SSE2"
+#else
+#define BATCH_LANES 4
+#endif
+#endif
+#ifndef BATCH_ISA
+#define BATCH_ISA "generic vectors"
+#endif
+
+typedef int32_t batch_vec __attribute__((vector_size(BATCH_LANES * sizeof(int32_t))));
+
+/*
+ * BATCH_LANES instances, word i of every vector belonging to instance i.
+ * Lanes without an instance are created halted. The timing is that of an
+ * in-order core issuing at most one instruction a cycle, once its operands
+ * are ready, and is meant for comparing data sets rather than pipelines.
+ */
+typedef struct batch_block
+{
+    batch_vec pc;
+    batch_vec status;           /* BATCH_* */
+    batch_vec ccr;              /* Result of the last flag setter, -1/0/1 after a CMP */
+    batch_vec regs[ARCHITECTURAL_REGISTERS_SIZE];
+    batch_vec vregs[VECTOR_REGISTERS_SIZE][MAX_VECTOR_LENGTH];
+    batch_vec insns;
+    batch_vec cycles;           /* Cycle the last instruction issued in */
+    batch_vec ready[ARCHITECTURAL_REGISTERS_SIZE];  /* Cycle each value can be read */
+    batch_vec vready[VECTOR_REGISTERS_SIZE];
+    batch_vec ccr_ready;
+    batch_vec lane;             /* Word i is i */
+    int32_t memory[DATA_MEMORY_SIZE][BATCH_LANES];
+}batch_block;
+
+/* Vector of x in every lane */
+#define VBROADCAST(x) ((batch_vec){0} + (x))
+/* Lanes of a where mask is -1, of b where it is 0 */
+#define VSELECT(mask, a, b) (((a) & (mask)) | ((b) & ~(mask)))
+#define VMAX(a, b) VSELECT((a) > (b), (a), (b))
+
+static const char *const status_names[] = {"running", "halted", "fault", "limit"};
+
+/* A block of the CPU's initial state in every lane, all lanes halted */
+static batch_block *
+block_create(const APEX_CPU *cpu)
+{
+    const APEX_Thread *t = &cpu->thread[0];
+    batch_block *blk = aligned_alloc(sizeof(batch_vec), sizeof(batch_block));
+
+    if (!blk)
+    {
+        return NULL;
+    }
+    memset(blk, 0, sizeof(batch_block));
+    blk->pc = VBROADCAST(t->pc);
+    blk->status = VBROADCAST(BATCH_HALTED);
+    for (int l = 0; l < BATCH_LANES; l++)
+    {
+        blk->lane[l] = l;
+    }
+    for (int r = 0; r < ARCHITECTURAL_REGISTERS_SIZE; r++)
+    {
+        blk->regs[r] = VBROADCAST(t->arf.architectural_register_file[r].value);
+    }
+    for (int v = 0; v < VECTOR_REGISTERS_SIZE; v++)
+    {
+        for (int i = 0; i < MAX_VECTOR_LENGTH; i++)
+        {
+            blk->vregs[v][i] = VBROADCAST(t->varf[v][i]);
+        }
+    }
+    for (int a = 0; a < DATA_MEMORY_SIZE; a++)
+    {
+        for (int l = 0; l < BATCH_LANES; l++)
+        {
+            blk->memory[a][l] = cpu->data_memory[a];
+        }
+    }
+    return blk;
+}
+
+/* Applies one "R<n>=<value>" or "M<address>=<value>" entry to a lane, -1 if it is neither */
+static int
+set_initial(batch_block *blk, int lane, const char *entry)
+{
+    char kind, extra;
+    int index, value;
+
+    if (strcmp(entry, "-") == 0)
+    {
+        return 0;
+    }
+    if (sscanf(entry, "%c%d=%d%c", &kind, &index, &value, &extra) != 3)
+    {
+        return -1;
+    }
+    if (kind == 'R' && index >= 0 && index < ARCHITECTURAL_REGISTERS_SIZE)
+    {
+        blk->regs[index][lane] = value;
+        return 0;
+    }
+    if (kind == 'M' && index >= 0 && index < DATA_MEMORY_SIZE)
+    {
+        blk->memory[index][lane] = value;
+        return 0;
+    }
+    return -1;
+}
+
+/* Adds an instance, starting a block when the last one is full. Returns its lane, -1 if out of memory */
+static int
+add_instance(apex_batch *batch, const APEX_CPU *cpu)
+{
+    int lane = batch->instances % BATCH_LANES;
+
+    if (lane == 0)
+    {
+        batch_block **blocks = realloc(batch->blocks, (batch->num_blocks + 1) * sizeof(batch_block *));
+
+        if (!blocks)
+        {
+            return -1;
+        }
+        batch->blocks = blocks;
+        blocks[batch->num_blocks] = block_create(cpu);
+        if (!blocks[batch->num_blocks])
+        {
+            return -1;
+        }
+        batch->num_blocks++;
+    }
+    batch->blocks[batch->num_blocks - 1]->status[lane] = BATCH_RUNNING;
+    batch->instances++;
+    return lane;
+}
+
+/*
+ * Creates one instance of the CPU's program for each line of data_file.
+ * A line lists the entries R<n>=<value> and M<address>=<value> that
+ * replace the CPU's initial registers and data memory, or is "-" for none;
+ * '#' starts a comment. Returns NULL if the file cannot be read, has an
+ * invalid entry or no instance.
+ */
+apex_batch *
+batch_create(const APEX_CPU *cpu, const char *data_file)
+{
+    apex_batch *batch = calloc(1, sizeof(apex_batch));
+    char line[4096];
+    int line_no = 0;
+    FILE *fp;
+
+    if (!batch)
+    {
+        return NULL;
+    }
+    batch->code = cpu->thread[0].code_memory;
+    batch->code_size = cpu->thread[0].code_memory_size;
+    batch->vector_length = cpu->vector_length;
+    batch->memory_latency = cpu->memory_latency;
+
+    fp = fopen(data_file, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open data sets %s\n", data_file);
+        free(batch);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        char *entry;
+        int lane;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0';
+        entry = strtok(line, " \t\r");
+        if (!entry)
+        {
+            continue;
+        }
+        lane = add_instance(batch, cpu);
+        if (lane < 0)
+        {
+            fprintf(stderr, "APEX_Error: Out of memory for %d instances\n", batch->instances + 1);
+            fclose(fp);
+            batch_destroy(batch);
+            return NULL;
+        }
+        for (; entry; entry = strtok(NULL, " \t\r"))
+        {
+            if (set_initial(batch->blocks[batch->num_blocks - 1], lane, entry) != 0)
+            {
+                fprintf(stderr, "APEX_Error: %s:%d: invalid data set entry %s\n", data_file, line_no,
+                        entry);
+                fclose(fp);
+                batch_destroy(batch);
+                return NULL;
+            }
+        }
+    }
+    fclose(fp);
+    if (batch->instances == 0)
+    {
+        fprintf(stderr, "APEX_Error: %s has no data sets\n", data_file);
+        batch_destroy(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+/* Instruction at pc, NULL if pc is outside the program */
+static const APEX_Instruction *
+fetch(const apex_batch *batch, int pc)
+{
+    int index = (pc - 4000) / 4;
+
+    if (pc < 4000 || (pc - 4000) % 4 != 0 || index >= batch->code_size)
+    {
+        return NULL;
+    }
+    return &batch->code[index];
+}
+
+/* Cycle the instruction issues in, once the lane's operands are ready */
+static int
+lane_issue_cycle(const batch_block *blk, int lane, const APEX_Instruction *insn,
+                 const opcode_info *info)
+{
+    int issue = blk->cycles[lane] + 1;
+    int ready;
+
+    if (info->operands & OPERAND_RS1)
+    {
+        ready = (info->vector & OPERAND_RS1) ? blk->vready[insn->rs1][lane] : blk->ready[insn->rs1][lane];
+        issue = ready > issue ? ready : issue;
+    }
+    if (info->operands & OPERAND_RS2)
+    {
+        ready = (info->vector & OPERAND_RS2) ? blk->vready[insn->rs2][lane] : blk->ready[insn->rs2][lane];
+        issue = ready > issue ? ready : issue;
+    }
+    if (info->control == CONTROL_CONDITIONAL && blk->ccr_ready[lane] > issue)
+    {
+        issue = blk->ccr_ready[lane];
+    }
+    return issue;
+}
+
+/* Executes the instruction at the lane's PC for that lane alone */
+static void
+step_lane(apex_batch *batch, batch_block *blk, int lane)
+{
+    int pc = blk->pc[lane];
+    const APEX_Instruction *insn = fetch(batch, pc);
+    const opcode_info *info;
+    int next_pc = pc + 4;
+    int rs1, rs2, result = 0, address, issue, done;
+    int vl = batch->vector_length;
+
+    batch->scalar_steps++;
+    if (!insn)
+    {
+        blk->status[lane] = BATCH_FAULT;
+        return;
+    }
+    info = opcode_info_of(insn->opcode);
+    rs1 = blk->regs[insn->rs1][lane];
+    rs2 = blk->regs[insn->rs2][lane];
+    issue = lane_issue_cycle(blk, lane, insn, info);
+    done = issue + info->latency + (info->memory != MEMORY_NONE ? batch->memory_latency : 0);
+
+    switch (insn->opcode)
+    {
+        case OPCODE_ADD:
+            result = rs1 + rs2;
+            break;
+        case OPCODE_SUB:
+            result = rs1 - rs2;
+            break;
+        case OPCODE_MUL:
+            result = rs1 * rs2;
+            break;
+        case OPCODE_DIV:
+            //INT_MIN / -1 wraps instead of trapping the host
+            result = rs2 == 0 ? 0 : rs2 == -1 ? (int)(0u - (unsigned)rs1) : rs1 / rs2;
+            break;
+        case OPCODE_AND:
+            result = rs1 & rs2;
+            break;
+        case OPCODE_OR:
+            result = rs1 | rs2;
+            break;
+        case OPCODE_XOR:
+            result = rs1 ^ rs2;
+            break;
+        case OPCODE_MOVC:
+            result = insn->imm;
+            break;
+        case OPCODE_ADDL:
+            result = rs1 + insn->imm;
+            break;
+        case OPCODE_SUBL:
+            result = rs1 - insn->imm;
+            break;
+        case OPCODE_LOAD:
+            address = rs1 + insn->imm;
+            if (address < 0 || address >= DATA_MEMORY_SIZE)
+            {
+                blk->status[lane] = BATCH_FAULT;
+                return;
+            }
+            result = blk->memory[address][lane];
+            break;
+        case OPCODE_STORE:
+            address = rs2 + insn->imm;
+            if (address < 0 || address >= DATA_MEMORY_SIZE)
+            {
+                blk->status[lane] = BATCH_FAULT;
+                return;
+            }
+            blk->memory[address][lane] = rs1;
+            break;
+        case OPCODE_CMP:
+            result = (rs1 == rs2) ? 0 : (rs1 > rs2) ? 1 : -1;
+            break;
+        case OPCODE_BZ:
+            next_pc = (blk->ccr[lane] == 0) ? pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BNZ:
+            next_pc = (blk->ccr[lane] != 0) ? pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BP:
+            next_pc = (blk->ccr[lane] > 0) ? pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BNP:
+            next_pc = (blk->ccr[lane] < 0) ? pc + insn->imm : next_pc;
+            break;
+        case OPCODE_JUMP:
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_JALR:
+            result = pc + 4;
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_RET:
+            next_pc = rs1;
+            break;
+        case OPCODE_HALT:
+            blk->status[lane] = BATCH_HALTED;
+            break;
+        case OPCODE_VADD:
+        case OPCODE_VSUB:
+        case OPCODE_VMUL:
+            for (int i = 0; i < vl; i++)
+            {
+                int a = blk->vregs[insn->rs1][i][lane], b = blk->vregs[insn->rs2][i][lane];
+
+                blk->vregs[insn->rd][i][lane] = insn->opcode == OPCODE_VADD ? a + b :
+                                                insn->opcode == OPCODE_VSUB ? a - b : a * b;
+            }
+            break;
+        case OPCODE_VLOAD:
+            address = rs1 + insn->imm;
+            if (address < 0 || address > DATA_MEMORY_SIZE - vl)
+            {
+                blk->status[lane] = BATCH_FAULT;
+                return;
+            }
+            for (int i = 0; i < vl; i++)
+            {
+                blk->vregs[insn->rd][i][lane] = blk->memory[address + i][lane];
+            }
+            break;
+        case OPCODE_VSTORE:
+            address = rs2 + insn->imm;
+            if (address < 0 || address > DATA_MEMORY_SIZE - vl)
+            {
+                blk->status[lane] = BATCH_FAULT;
+                return;
+            }
+            for (int i = 0; i < vl; i++)
+            {
+                blk->memory[address + i][lane] = blk->vregs[insn->rs1][i][lane];
+            }
+            break;
+        default:
+            blk->status[lane] = BATCH_FAULT;
+            return;
+    }
+
+    if (has_vector_destination(insn->opcode))
+    {
+        blk->vready[insn->rd][lane] = done;
+    }
+    else if (info->operands & OPERAND_RD)
+    {
+        blk->regs[insn->rd][lane] = result;
+        blk->ready[insn->rd][lane] = done;
+    }
+    if (info->sets_flags)
+    {
+        blk->ccr[lane] = result;
+        blk->ccr_ready[lane] = done;
+    }
+    blk->cycles[lane] = issue + (next_pc != pc + 4 ? BATCH_TAKEN_PENALTY : 0);
+    blk->pc[lane] = next_pc;
+    if (++blk->insns[lane] >= BATCH_INSN_LIMIT && blk->status[lane] == BATCH_RUNNING)
+    {
+        blk->status[lane] = BATCH_LIMIT;
+    }
+}
+
+/*
+ * Faults the lanes of mask whose access of span words at address leaves
+ * data memory and takes them out of mask. Vectors are passed by pointer,
+ * their calling convention depends on the instruction set.
+ */
+static inline __attribute__((always_inline)) void
+check_addresses(batch_block *blk, batch_vec *mask, const batch_vec *address, int span)
+{
+    batch_vec bad = *mask & ((*address < 0) | (*address > DATA_MEMORY_SIZE - span));
+
+    blk->status = VSELECT(bad, VBROADCAST(BATCH_FAULT), blk->status);
+    *mask &= ~bad;
+}
+
+/* Sets the lanes of mask in out to their word at address, with a gather where there is one */
+static inline __attribute__((always_inline)) void
+gather(const batch_block *blk, const batch_vec *mask, const batch_vec *address, batch_vec *out)
+{
+    //memory[a][l] is word a * BATCH_LANES + l of the block's memory
+    batch_vec index = *address * BATCH_LANES + blk->lane;
+
+#if defined(__AVX512F__) && BATCH_LANES == 16
+    *out = (batch_vec)_mm512_mask_i32gather_epi32((__m512i)*out,
+                                                  _mm512_test_epi32_mask((__m512i)*mask, (__m512i)*mask),
+                                                  (__m512i)index, blk->memory, sizeof(int32_t));
+#elif defined(__AVX2__) && BATCH_LANES == 8
+    *out = (batch_vec)_mm256_mask_i32gather_epi32((__m256i)*out, (const int *)blk->memory, (__m256i)index,
+                                                  (__m256i)*mask, sizeof(int32_t));
+#else
+    for (int l = 0; l < BATCH_LANES; l++)
+    {
+        if ((*mask)[l])
+        {
+            (*out)[l] = ((const int32_t *)blk->memory)[index[l]];
+        }
+    }
+#endif
+}
+
+/* Writes the lanes of mask in data to their word at address, AVX2 has no scatter */
+static inline __attribute__((always_inline)) void
+scatter(batch_block *blk, const batch_vec *mask, const batch_vec *address, const batch_vec *data)
+{
+    batch_vec index = *address * BATCH_LANES + blk->lane;
+
+#if defined(__AVX512F__) && BATCH_LANES == 16
+    _mm512_mask_i32scatter_epi32(blk->memory, _mm512_test_epi32_mask((__m512i)*mask, (__m512i)*mask),
+                                 (__m512i)index, (__m512i)*data, sizeof(int32_t));
+#else
+    for (int l = 0; l < BATCH_LANES; l++)
+    {
+        if ((*mask)[l])
+        {
+            ((int32_t *)blk->memory)[index[l]] = (*data)[l];
+        }
+    }
+#endif
+}
+
+/* Executes the instruction at pc for the lanes of active, all of them at pc */
+static inline __attribute__((always_inline)) void
+step_vector(apex_batch *batch, batch_block *blk, int pc, const batch_vec *active)
+{
+    const APEX_Instruction *insn = fetch(batch, pc);
+    const opcode_info *info;
+    batch_vec mask = *active;
+    batch_vec rs1, rs2, result = {0}, address, issue, done, next_pc, divisor;
+    int vl = batch->vector_length;
+
+    batch->vector_steps++;
+    if (!insn)
+    {
+        blk->status = VSELECT(mask, VBROADCAST(BATCH_FAULT), blk->status);
+        return;
+    }
+    info = opcode_info_of(insn->opcode);
+    rs1 = blk->regs[insn->rs1];
+    rs2 = blk->regs[insn->rs2];
+    issue = blk->cycles + 1;
+    if (info->operands & OPERAND_RS1)
+    {
+        issue = VMAX(issue, (info->vector & OPERAND_RS1) ? blk->vready[insn->rs1] : blk->ready[insn->rs1]);
+    }
+    if (info->operands & OPERAND_RS2)
+    {
+        issue = VMAX(issue, (info->vector & OPERAND_RS2) ? blk->vready[insn->rs2] : blk->ready[insn->rs2]);
+    }
+    if (info->control == CONTROL_CONDITIONAL)
+    {
+        issue = VMAX(issue, blk->ccr_ready);
+    }
+    done = issue + (info->latency + (info->memory != MEMORY_NONE ? batch->memory_latency : 0));
+    next_pc = VBROADCAST(pc + 4);
+
+    switch (insn->opcode)
+    {
+        case OPCODE_ADD:
+            result = rs1 + rs2;
+            break;
+        case OPCODE_SUB:
+            result = rs1 - rs2;
+            break;
+        case OPCODE_MUL:
+            result = rs1 * rs2;
+            break;
+        case OPCODE_DIV:
+            //every lane divides, those not dividing by a safe divisor divide by 1
+            divisor = VSELECT((rs2 == 0) | (rs2 == -1), VBROADCAST(1), rs2);
+            result = VSELECT(rs2 == -1, VBROADCAST(0) - rs1, rs1 / divisor) & ~(rs2 == 0);
+            break;
+        case OPCODE_AND:
+            result = rs1 & rs2;
+            break;
+        case OPCODE_OR:
+            result = rs1 | rs2;
+            break;
+        case OPCODE_XOR:
+            result = rs1 ^ rs2;
+            break;
+        case OPCODE_MOVC:
+            result = VBROADCAST(insn->imm);
+            break;
+        case OPCODE_ADDL:
+            result = rs1 + insn->imm;
+            break;
+        case OPCODE_SUBL:
+            result = rs1 - insn->imm;
+            break;
+        case OPCODE_LOAD:
+            address = rs1 + insn->imm;
+            check_addresses(blk, &mask, &address, 1);
+            gather(blk, &mask, &address, &result);
+            break;
+        case OPCODE_STORE:
+            address = rs2 + insn->imm;
+            check_addresses(blk, &mask, &address, 1);
+            scatter(blk, &mask, &address, &rs1);
+            break;
+        case OPCODE_CMP:
+            //comparisons are -1 where true
+            result = (rs1 < rs2) - (rs1 > rs2);
+            break;
+        case OPCODE_BZ:
+            next_pc = VSELECT(blk->ccr == 0, VBROADCAST(pc + insn->imm), next_pc);
+            break;
+        case OPCODE_BNZ:
+            next_pc = VSELECT(blk->ccr != 0, VBROADCAST(pc + insn->imm), next_pc);
+            break;
+        case OPCODE_BP:
+            next_pc = VSELECT(blk->ccr > 0, VBROADCAST(pc + insn->imm), next_pc);
+            break;
+        case OPCODE_BNP:
+            next_pc = VSELECT(blk->ccr < 0, VBROADCAST(pc + insn->imm), next_pc);
+            break;
+        case OPCODE_JUMP:
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_JALR:
+            result = VBROADCAST(pc + 4);
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_RET:
+            next_pc = rs1;
+            break;
+        case OPCODE_HALT:
+            blk->status = VSELECT(mask, VBROADCAST(BATCH_HALTED), blk->status);
+            break;
+        case OPCODE_VADD:
+        case OPCODE_VSUB:
+        case OPCODE_VMUL:
+            for (int i = 0; i < vl; i++)
+            {
+                batch_vec a = blk->vregs[insn->rs1][i], b = blk->vregs[insn->rs2][i];
+                batch_vec lanes = insn->opcode == OPCODE_VADD ? a + b :
+                                  insn->opcode == OPCODE_VSUB ? a - b : a * b;
+
+                blk->vregs[insn->rd][i] = VSELECT(mask, lanes, blk->vregs[insn->rd][i]);
+            }
+            break;
+        case OPCODE_VLOAD:
+            address = rs1 + insn->imm;
+            check_addresses(blk, &mask, &address, vl);
+            for (int i = 0; i < vl; i++)
+            {
+                gather(blk, &mask, &address, &blk->vregs[insn->rd][i]);
+                address += 1;
+            }
+            break;
+        case OPCODE_VSTORE:
+            address = rs2 + insn->imm;
+            check_addresses(blk, &mask, &address, vl);
+            for (int i = 0; i < vl; i++)
+            {
+                scatter(blk, &mask, &address, &blk->vregs[insn->rs1][i]);
+                address += 1;
+            }
+            break;
+        default:
+            blk->status = VSELECT(mask, VBROADCAST(BATCH_FAULT), blk->status);
+            return;
+    }
+
+    if (has_vector_destination(insn->opcode))
+    {
+        blk->vready[insn->rd] = VSELECT(mask, done, blk->vready[insn->rd]);
+    }
+    else if (info->operands & OPERAND_RD)
+    {
+        blk->regs[insn->rd] = VSELECT(mask, result, blk->regs[insn->rd]);
+        blk->ready[insn->rd] = VSELECT(mask, done, blk->ready[insn->rd]);
+    }
+    if (info->sets_flags)
+    {
+        blk->ccr = VSELECT(mask, result, blk->ccr);
+        blk->ccr_ready = VSELECT(mask, done, blk->ccr_ready);
+    }
+    blk->cycles = VSELECT(mask, issue + ((next_pc != pc + 4) & BATCH_TAKEN_PENALTY), blk->cycles);
+    blk->pc = VSELECT(mask, next_pc, blk->pc);
+    blk->insns -= mask;
+    blk->status = VSELECT(mask & (blk->insns >= BATCH_INSN_LIMIT) & (blk->status == BATCH_RUNNING),
+                          VBROADCAST(BATCH_LIMIT), blk->status);
+}
+
+/* Runs a block until none of its instances is left running */
+static void
+run_block(apex_batch *batch, batch_block *blk)
+{
+    for (;;)
+    {
+        batch_vec pcs = VSELECT(blk->status == BATCH_RUNNING, blk->pc, VBROADCAST(INT_MAX));
+        batch_vec mask, first, last;
+        int pc = INT_MAX, first_lane = INT_MAX, last_lane = -1;
+
+        //the lanes furthest behind go first, so diverged paths meet again where they join;
+        //only min and max reductions, which stay in vector registers
+        for (int l = 0; l < BATCH_LANES; l++)
+        {
+            pc = pcs[l] < pc ? pcs[l] : pc;
+        }
+        if (pc == INT_MAX)
+        {
+            return;
+        }
+        mask = pcs == pc;
+        first = VSELECT(mask, blk->lane, VBROADCAST(INT_MAX));
+        last = VSELECT(mask, blk->lane, VBROADCAST(-1));
+        for (int l = 0; l < BATCH_LANES; l++)
+        {
+            first_lane = first[l] < first_lane ? first[l] : first_lane;
+            last_lane = last[l] > last_lane ? last[l] : last_lane;
+        }
+        if (first_lane == last_lane)
+        {
+            batch_vec others = VSELECT(mask, VBROADCAST(INT_MAX), pcs);
+            int next_pc = INT_MAX;
+
+            //the others wait while it runs alone, until it catches up with them
+            for (int l = 0; l < BATCH_LANES; l++)
+            {
+                next_pc = others[l] < next_pc ? others[l] : next_pc;
+            }
+            do
+            {
+                step_lane(batch, blk, first_lane);
+            } while (blk->status[first_lane] == BATCH_RUNNING && blk->pc[first_lane] < next_pc);
+        }
+        else
+        {
+            step_vector(batch, blk, pc, &mask);
+        }
+    }
+}
+
+void
+batch_run(apex_batch *batch)
+{
+    for (int b = 0; b < batch->num_blocks; b++)
+    {
+        run_block(batch, batch->blocks[b]);
+    }
+}
+
+/* One CSV row per instance: how it stopped, its counts and its registers */
+void
+batch_write_results(const apex_batch *batch, FILE *fp)
+{
+    fprintf(fp, "instance,status,cycles,instructions");
+    for (int r = 0; r < ARCHITECTURAL_REGISTERS_SIZE; r++)
+    {
+        fprintf(fp, ",R%d", r);
+    }
+    fprintf(fp, "\n");
+    for (int i = 0; i < batch->instances; i++)
+    {
+        const batch_block *blk = batch->blocks[i / BATCH_LANES];
+        int l = i % BATCH_LANES;
+
+        fprintf(fp, "%d,%s,%d,%d", i, status_names[blk->status[l]], blk->cycles[l], blk->insns[l]);
+        for (int r = 0; r < ARCHITECTURAL_REGISTERS_SIZE; r++)
+        {
+            fprintf(fp, ",%d", blk->regs[r][l]);
+        }
+        fprintf(fp, "\n");
+    }
+}
+
+void
+batch_print(const apex_batch *batch, double seconds, FILE *fp)
+{
+    unsigned long long insns = 0, steps = batch->vector_steps + batch->scalar_steps;
+    int count[BATCH_LIMIT + 1] = {0};
+    int min_cycles = INT_MAX, max_cycles = 0;
+    double cycles = 0.0;
+
+    for (int i = 0; i < batch->instances; i++)
+    {
+        const batch_block *blk = batch->blocks[i / BATCH_LANES];
+        int l = i % BATCH_LANES;
+
+        count[blk->status[l]]++;
+        insns += blk->insns[l];
+        cycles += blk->cycles[l];
+        min_cycles = blk->cycles[l] < min_cycles ? blk->cycles[l] : min_cycles;
+        max_cycles = blk->cycles[l] > max_cycles ? blk->cycles[l] : max_cycles;
+    }
+    fprintf(fp, "APEX_Batch: %d instances in %d blocks of %d lanes, %s\n", batch->instances,
+            batch->num_blocks, BATCH_LANES, BATCH_ISA);
+    fprintf(fp, "APEX_Batch: %d %s, %d %s, %d %s\n", count[BATCH_HALTED], status_names[BATCH_HALTED],
+            count[BATCH_FAULT], status_names[BATCH_FAULT], count[BATCH_LIMIT], status_names[BATCH_LIMIT]);
+    fprintf(fp, "APEX_Batch: Instructions = %llu, cycles min %d mean %.1f max %d\n", insns, min_cycles,
+            cycles / batch->instances, max_cycles);
+    fprintf(fp, "APEX_Batch: Steps = %llu, %.1f instructions a step, %llu for one lane alone\n", steps,
+            steps ? (double)insns / steps : 0.0, batch->scalar_steps);
+    fprintf(fp, "APEX_Batch: Host time = %.3f s, %.1f MIPS\n", seconds,
+            seconds > 0.0 ? insns / seconds / 1e6 : 0.0);
+}
+
+void
+batch_destroy(apex_batch *batch)
+{
+    if (!batch)
+    {
+        return;
+    }
+    for (int b = 0; b < batch->num_blocks; b++)
+    {
+        free(batch->blocks[b]);
+    }
+    free(batch->blocks);
+    free(batch);
+}
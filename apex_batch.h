@@ -0,0 +1,60 @@
+/*
+ * apex_batch.h
+ * Contains the batched functional model declarations. One program is run
+ * for many instances, each from its own initial data, with the instances
+ * laid out in structure-of-arrays form so one SIMD operation advances
+ * several of them (--batch).
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_BATCH_
+#define _XXYZ_APEX_BATCH_
+
+#include <stdio.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////BATCHED FUNCTIONAL MODEL//////////////////////////
+
+/* Instructions an instance may execute before it is stopped */
+#ifndef BATCH_INSN_LIMIT
+#define BATCH_INSN_LIMIT 10000000
+#endif
+
+/* Issue cycles lost after a taken branch or jump, the refetch */
+#ifndef BATCH_TAKEN_PENALTY
+#define BATCH_TAKEN_PENALTY 2
+#endif
+
+/* State of an instance */
+#define BATCH_RUNNING 0
+#define BATCH_HALTED 1
+#define BATCH_FAULT 2               /* Address outside data memory or PC outside the program */
+#define BATCH_LIMIT 3               /* Stopped after BATCH_INSN_LIMIT instructions */
+
+struct APEX_CPU;
+struct APEX_Instruction;
+struct batch_block;
+
+typedef struct apex_batch
+{
+    const struct APEX_Instruction *code;
+    int code_size;
+    int vector_length;
+    int memory_latency;
+    int instances;
+    int num_blocks;
+    struct batch_block **blocks;    /* Instances in structure-of-arrays form, see apex_batch.c */
+    unsigned long long vector_steps;    /* Instructions stepped for several lanes at once */
+    unsigned long long scalar_steps;    /* Instructions stepped for a lane on its own */
+}apex_batch;
+
+apex_batch *batch_create(const struct APEX_CPU *cpu, const char *data_file);
+void batch_run(apex_batch *batch);
+void batch_write_results(const apex_batch *batch, FILE *fp);
+void batch_print(const apex_batch *batch, double seconds, FILE *fp);
+void batch_destroy(apex_batch *batch);
+#endif
@@ -0,0 +1,45 @@
+#!/bin/sh
+#
+# apex_bench.sh
+# Runs the synthetic workloads from apex_workload_gen through apex_sim and
+# reports simulated cycles, IPC and host throughput. Used by make bench.
+#
+# Author:
+# State University of New York at Binghamton
+
+SIM=${SIM:-./apex_sim}
+GEN=${GEN:-./apex_workload_gen}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# name|generator arguments
+WORKLOADS="
+chain|chain -n 20000 -w 16
+alu|alu -n 20000 -w 16 -k 4
+loop|loop -n 2000 -w 100
+pointer|pointer -n 20000 -w 8 -p 64 -s 3
+stride|stride -n 5000 -w 4 -s 16
+call|call -n 20000 -d 0 -w 8
+"
+
+printf "%-10s %12s %12s %8s %10s %10s\n" workload cycles insns IPC host_sec KIPS
+echo "$WORKLOADS" | while IFS='|' read name args; do
+    [ -z "$name" ] && continue
+    $GEN $args -o "$DIR/$name.asm" || exit 1
+    start=$(date +%s%N)
+    result=$($SIM "$DIR/$name.asm" </dev/null 2>/dev/null | grep "Simulation Complete")
+    end=$(date +%s%N)
+    if [ -z "$result" ]; then
+        echo "$name: simulation did not complete" >&2
+        exit 1
+    fi
+    echo "$result" | awk -v name="$name" -v ns=$((end - start)) '{
+        for (i = 1; i <= NF; i++) {
+            if ($i == "cycles") cycles = $(i + 2);
+            if ($i == "instructions") insns = $(i + 2);
+        }
+        sec = ns / 1e9;
+        printf "%-10s %12d %12d %8.3f %10.3f %10.1f\n", name, cycles, insns,
+               (cycles ? insns / cycles : 0), sec, (sec > 0 ? insns / sec / 1000 : 0);
+    }'
+done
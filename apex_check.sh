@@ -0,0 +1,121 @@
+#!/bin/sh
+#
+# apex_check.sh
+# Golden regression suite. Runs every program under every configuration,
+# several at a time, and compares the cycles, committed instructions,
+# registers and data memory (--dump-state) with the files in golden/.
+# Each run is timed too, and one taking more than CHECK_SLOWDOWN (a whole
+# number) times its golden host time fails. Used by make check;
+# apex_check.sh -u (make golden) writes the golden files from the current
+# simulator instead.
+#
+# Author:
+# State University of New York at Binghamton
+
+SIM=${SIM:-./apex_sim}
+GEN=${GEN:-./apex_workload_gen}
+GOLDEN=${GOLDEN:-golden}
+JOBS=${JOBS:-$(nproc 2>/dev/null || echo 2)}
+CHECK_SLOWDOWN=${CHECK_SLOWDOWN:-2}
+# shorter runs are too noisy to time
+CHECK_MIN_MS=${CHECK_MIN_MS:-50}
+
+# runs one program: apex_check.sh -r <output_dir> <name> <program> [options]
+if [ "$1" = "-r" ]; then
+    out=$2 name=$3 prog=$4
+    shift 4
+    start=$(date +%s%N)
+    $SIM "$prog" "$@" --dump-state="$out/$name.state" </dev/null >"$out/$name.log" 2>&1
+    end=$(date +%s%N)
+    echo $(( (end - start) / 1000000 )) >"$out/$name.ms"
+    exit 0
+fi
+
+update=0
+[ "$1" = "-u" ] && update=1
+
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# name|generator arguments, besides the programs in the repository
+WORKLOADS="
+chain|chain -n 4000 -w 16
+alu|alu -n 4000 -w 16 -k 4
+loop|loop -n 400 -w 100
+pointer|pointer -n 4000 -w 8 -p 64 -s 3
+stride|stride -n 1000 -w 4 -s 16
+call|call -n 1000 -d 3 -w 8
+vadd|vadd -n 50 -w 256 -k 4
+sadd|sadd -n 20 -w 256
+"
+
+# name|options: the defaults, every optional mechanism off, more of them on, and
+# loads scheduled for a shorter latency than memory's so they replay on one core
+CONFIGS="
+default|
+base|--no-rename-elim --no-load-spec --no-uop-cache --no-ftq
+wide|--fusion=all --icache-latency=10 --iq=split
+replay|--mem-latency=10 --load-spec-latency=1
+"
+
+for prog in input case1 case2 case3 divide; do
+    cp "$prog.asm" "$DIR/$prog.asm" || exit 1
+done
+echo "$WORKLOADS" | while IFS='|' read name args; do
+    [ -z "$name" ] && continue
+    $GEN $args -o "$DIR/$name.asm" || exit 1
+done || exit 1
+
+mkdir -p "$DIR/out"
+for prog in input case1 case2 case3 divide $(echo "$WORKLOADS" | cut -d'|' -f1); do
+    echo "$CONFIGS" | while IFS='|' read config opts; do
+        [ -z "$config" ] && continue
+        #xargs -L would join a line ending in a blank to the next
+        echo "-r $DIR/out $prog.$config $DIR/$prog.asm${opts:+ $opts}"
+    done
+done >"$DIR/runs"
+xargs -P "$JOBS" -L 1 sh "$0" <"$DIR/runs"
+
+if [ $update -eq 1 ]; then
+    mkdir -p "$GOLDEN"
+    rm -f "$GOLDEN"/*.state "$GOLDEN/host_ms"
+    for f in "$DIR"/out/*.state; do
+        name=$(basename "$f" .state)
+        cp "$f" "$GOLDEN/$name.state"
+        echo "$name $(cat "$DIR/out/$name.ms")" >>"$GOLDEN/host_ms"
+    done
+    echo "Wrote $(ls "$GOLDEN"/*.state | wc -l) golden results to $GOLDEN"
+    exit 0
+fi
+
+failed=0
+printf "%-18s %10s %12s %8s %10s\n" run cycles insns host_ms golden_ms
+while read line; do
+    name=$(echo "$line" | cut -d' ' -f3)
+    state="$DIR/out/$name.state"
+    ms=$(cat "$DIR/out/$name.ms")
+    golden_ms=$(grep "^$name " "$GOLDEN/host_ms" 2>/dev/null | cut -d' ' -f2)
+    result=ok
+    if [ ! -f "$GOLDEN/$name.state" ]; then
+        result="FAIL (no golden result)"
+    elif [ ! -s "$state" ]; then
+        result="FAIL (no state, see below)"
+        sed 's/^/    /' "$DIR/out/$name.log" | tail -5
+    elif ! cmp -s "$state" "$GOLDEN/$name.state"; then
+        result="FAIL (deviates from golden)"
+        diff "$GOLDEN/$name.state" "$state" | head -10 | sed 's/^/    /'
+    elif [ -n "$golden_ms" ] && [ "$golden_ms" -ge "$CHECK_MIN_MS" ] &&
+         [ "$ms" -gt $(( golden_ms * CHECK_SLOWDOWN )) ]; then
+        result="FAIL (over ${CHECK_SLOWDOWN}x slower)"
+    fi
+    [ "$result" = ok ] || failed=$((failed + 1))
+    printf "%-18s %10s %12s %8s %10s  %s\n" "$name" \
+        "$(sed -n 's/^cycles //p' "$state" 2>/dev/null)" \
+        "$(sed -n 's/^instructions //p' "$state" 2>/dev/null)" "$ms" "${golden_ms:--}" "$result"
+done <"$DIR/runs"
+
+if [ $failed -ne 0 ]; then
+    echo "$failed of $(wc -l <"$DIR/runs") runs failed"
+    exit 1
+fi
+echo "All $(wc -l <"$DIR/runs") runs match"
@@ -0,0 +1,204 @@
+/*
+ * apex_coherence.c
+ * Contains the MESI directory and L1 caches shared by the cores of a
+ * multicore APEX system
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "apex_coherence.h"
+
+/*
+ * The caches model timing and traffic only: values always live in data[],
+ * which is read and written under the line's directory lock. A core holds a
+ * line when its L1 slot has the line's tag and its bit is set in the
+ * directory; the MESI state follows from the sharer count and the dirty bit.
+ */
+
+/* Counters of another core can be updated concurrently from its thread */
+#define COHERENCE_COUNT(mem, core, counter, n) \
+    __atomic_fetch_add(&(mem)->stats[core].counter, (n), __ATOMIC_RELAXED)
+
+#define CORE_BIT(core) (1u << (core))
+
+static pthread_mutex_t *
+line_lock(apex_shared_memory *mem, int line)
+{
+    return &mem->locks[line % COHERENCE_LOCKS];
+}
+
+static int
+single_sharer(uint32_t sharers)
+{
+    return __builtin_ctz(sharers);
+}
+
+apex_shared_memory *shared_memory_create(int num_cores, int miss_latency){
+    apex_shared_memory *mem;
+
+    if(num_cores<1 || num_cores>MAX_CORES){
+        return NULL;
+    }
+    mem=calloc(1, sizeof(apex_shared_memory));
+    if(!mem){
+        return NULL;
+    }
+    mem->num_cores=num_cores;
+    memset(mem->l1_tag, 0xff, sizeof(mem->l1_tag));
+    for(int i=0;i<COHERENCE_LOCKS;i++){
+        pthread_mutex_init(&mem->locks[i], NULL);
+    }
+    mem->hit_latency=L1_HIT_LATENCY;
+    mem->miss_latency=miss_latency;
+    mem->transfer_latency=COHERENCE_TRANSFER_LATENCY;
+    return mem;
+}
+
+void shared_memory_destroy(apex_shared_memory *mem){
+    if(!mem){
+        return;
+    }
+    for(int i=0;i<COHERENCE_LOCKS;i++){
+        pthread_mutex_destroy(&mem->locks[i]);
+    }
+    free(mem);
+}
+
+/* Drops whatever line the core holds in slot, writing it back if modified */
+static void
+evict_slot(apex_shared_memory *mem, int core, int slot)
+{
+    int line=mem->l1_tag[core][slot];
+    directory_entry *d;
+
+    if(line<0){
+        return;
+    }
+    d=&mem->directory[line];
+    pthread_mutex_lock(line_lock(mem, line));
+    if(d->sharers & CORE_BIT(core)){
+        if(d->dirty){
+            d->dirty=0;
+            COHERENCE_COUNT(mem, core, writebacks, 1);
+            COHERENCE_COUNT(mem, core, messages, 1);
+        }
+        d->sharers&=~CORE_BIT(core);
+    }
+    pthread_mutex_unlock(line_lock(mem, line));
+    mem->l1_tag[core][slot]=-1;
+}
+
+/* Makes room for line in the core's L1 and returns its slot */
+static int
+l1_slot(apex_shared_memory *mem, int core, int line)
+{
+    int slot=line%L1_NUM_LINES;
+
+    if(mem->l1_tag[core][slot]!=line){
+        evict_slot(mem, core, slot);
+        mem->l1_tag[core][slot]=line;
+    }
+    return slot;
+}
+
+/* Returns the cycles the load takes */
+int shared_memory_load(apex_shared_memory *mem, int core, int address, int *value){
+    int line=address/L1_LINE_WORDS;
+    directory_entry *d=&mem->directory[line];
+    int latency;
+
+    l1_slot(mem, core, line);
+    pthread_mutex_lock(line_lock(mem, line));
+    if(d->sharers & CORE_BIT(core)){
+        COHERENCE_COUNT(mem, core, l1_hits, 1);
+        latency=mem->hit_latency;
+    }
+    else{
+        COHERENCE_COUNT(mem, core, l1_misses, 1);
+        //read request and data reply
+        COHERENCE_COUNT(mem, core, messages, 2);
+        latency=mem->miss_latency;
+        if(d->dirty){
+            //the M owner supplies the line and keeps it in S
+            int owner=single_sharer(d->sharers);
+
+            COHERENCE_COUNT(mem, owner, writebacks, 1);
+            COHERENCE_COUNT(mem, owner, messages, 2);
+            COHERENCE_COUNT(mem, core, cache_to_cache, 1);
+            d->dirty=0;
+            latency=mem->transfer_latency;
+        }
+        d->sharers|=CORE_BIT(core);
+    }
+    *value=mem->data[address];
+    pthread_mutex_unlock(line_lock(mem, line));
+    return latency;
+}
+
+/* Returns the cycles the store takes */
+int shared_memory_store(apex_shared_memory *mem, int core, int address, int value){
+    int line=address/L1_LINE_WORDS;
+    directory_entry *d=&mem->directory[line];
+    uint32_t others;
+    int latency;
+
+    l1_slot(mem, core, line);
+    pthread_mutex_lock(line_lock(mem, line));
+    others=d->sharers & ~CORE_BIT(core);
+    if(d->sharers==CORE_BIT(core)){
+        //E or M, E turns into M silently
+        COHERENCE_COUNT(mem, core, l1_hits, 1);
+        latency=mem->hit_latency;
+    }
+    else if(d->sharers & CORE_BIT(core)){
+        //S, every other copy is invalidated before the write
+        COHERENCE_COUNT(mem, core, l1_hits, 1);
+        COHERENCE_COUNT(mem, core, upgrades, 1);
+        COHERENCE_COUNT(mem, core, messages, 1);
+        latency=mem->transfer_latency;
+    }
+    else{
+        COHERENCE_COUNT(mem, core, l1_misses, 1);
+        COHERENCE_COUNT(mem, core, messages, 2);
+        latency=mem->miss_latency;
+        if(d->dirty){
+            COHERENCE_COUNT(mem, core, cache_to_cache, 1);
+            latency=mem->transfer_latency;
+        }
+    }
+    for(int c=0;others;c++){
+        if(others & CORE_BIT(c)){
+            //invalidation and its acknowledgement
+            COHERENCE_COUNT(mem, core, invalidations_sent, 1);
+            COHERENCE_COUNT(mem, c, invalidations_received, 1);
+            COHERENCE_COUNT(mem, core, messages, 2);
+            others&=~CORE_BIT(c);
+        }
+    }
+    d->sharers=CORE_BIT(core);
+    d->dirty=1;
+    mem->data[address]=value;
+    pthread_mutex_unlock(line_lock(mem, line));
+    return latency;
+}
+
+/* MESI state of the line holding address in the core's L1 */
+int shared_memory_state(apex_shared_memory *mem, int core, int address){
+    int line=address/L1_LINE_WORDS;
+    directory_entry *d=&mem->directory[line];
+    int state=MESI_INVALID;
+
+    pthread_mutex_lock(line_lock(mem, line));
+    if(mem->l1_tag[core][line%L1_NUM_LINES]==line && (d->sharers & CORE_BIT(core))){
+        if(d->sharers!=CORE_BIT(core)){
+            state=MESI_SHARED;
+        }
+        else{
+            state=d->dirty ? MESI_MODIFIED : MESI_EXCLUSIVE;
+        }
+    }
+    pthread_mutex_unlock(line_lock(mem, line));
+    return state;
+}
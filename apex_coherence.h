@@ -0,0 +1,75 @@
+/*
+ * apex_coherence.h
+ * Contains the shared data memory of a multicore APEX system: per-core L1
+ * caches kept coherent by a MESI directory
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_COHERENCE_
+#define _XXYZ_APEX_COHERENCE_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+#ifndef _XXYZ_APEX_STATS_
+#include "apex_stats.h"
+#endif
+
+////////////////////////COHERENT SHARED MEMORY////////////////////////////
+
+/* MESI state of a line in one core's L1 */
+#define MESI_INVALID 0
+#define MESI_SHARED 1
+#define MESI_EXCLUSIVE 2
+#define MESI_MODIFIED 3
+
+#define L1_NUM_LINES (L1_SIZE_WORDS / L1_LINE_WORDS)
+#define MEMORY_NUM_LINES (DATA_MEMORY_SIZE / L1_LINE_WORDS)
+
+/* Directory entries are guarded by striped locks, line % COHERENCE_LOCKS */
+#define COHERENCE_LOCKS 64
+
+/* Directory entry of one memory line */
+typedef struct directory_entry
+{
+    uint32_t sharers;   /* Bit per core holding the line */
+    int dirty;          /* The single sharer has modified the line */
+}directory_entry;
+
+/* Coherence counters of one core, updated by other cores' threads too */
+typedef struct coherence_stats
+{
+    counter_t l1_hits;
+    counter_t l1_misses;
+    counter_t upgrades;               /* S -> M on a store hit */
+    counter_t cache_to_cache;         /* Misses served by another core's M copy */
+    counter_t invalidations_sent;
+    counter_t invalidations_received;
+    counter_t writebacks;             /* M lines written back on eviction or downgrade */
+    counter_t messages;               /* Requests, replies, invalidations and acks */
+}coherence_stats;
+
+typedef struct apex_shared_memory
+{
+    int num_cores;
+    int data[DATA_MEMORY_SIZE];
+    directory_entry directory[MEMORY_NUM_LINES];
+    int l1_tag[MAX_CORES][L1_NUM_LINES];     /* Line held in each L1 slot, -1 if none */
+    coherence_stats stats[MAX_CORES];
+    pthread_mutex_t locks[COHERENCE_LOCKS];
+    int hit_latency;
+    int miss_latency;
+    int transfer_latency;
+}apex_shared_memory;
+
+apex_shared_memory *shared_memory_create(int num_cores, int miss_latency);
+void shared_memory_destroy(apex_shared_memory *mem);
+int shared_memory_load(apex_shared_memory *mem, int core, int address, int *value);
+int shared_memory_store(apex_shared_memory *mem, int core, int address, int value);
+int shared_memory_state(apex_shared_memory *mem, int core, int address);
+#endif
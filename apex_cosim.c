@@ -0,0 +1,410 @@
+/*
+ * apex_cosim.c
+ * Contains the lockstep co-simulation checker: a functional model of the
+ * APEX ISA that replays the program on its own thread and compares every
+ * instruction the core commits against it.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_cpu.h"
+#include "apex_cosim.h"
+
+/* Records the first divergence, always returns FALSE */
+static int
+diverge(apex_cosim *cs, const cosim_thread *gt, const cosim_record *rec, const char *fmt, ...)
+{
+    int index = (gt->pc - 4000) / 4;
+    const char *mnemonic = NULL;
+    int len;
+    va_list ap;
+
+    if (gt->pc >= 4000 && index < gt->code_size)
+    {
+        mnemonic = get_opcode_str(gt->code[index].opcode);
+    }
+    len = snprintf(cs->report, sizeof(cs->report),
+                   "APEX_Cosim: Divergence at instruction %llu, thread %d, cycle %d, I[%d] %s: ",
+                   cs->checked + 1, rec->thread, rec->cycle, index, mnemonic ? mnemonic : "?");
+    va_start(ap, fmt);
+    vsnprintf(cs->report + len, sizeof(cs->report) - len, fmt, ap);
+    va_end(ap);
+    return FALSE;
+}
+
+/* Checks a data memory address, the core has no bounds checks of its own */
+static int
+memory_address_valid(apex_cosim *cs, const cosim_thread *gt, const cosim_record *rec, int address)
+{
+    if (address < 0 || address >= DATA_MEMORY_SIZE)
+    {
+        return diverge(cs, gt, rec, "address %d is outside data memory", address);
+    }
+    return TRUE;
+}
+
+/* Checks that every lane of a vector access is in data memory */
+static int
+vector_address_valid(apex_cosim *cs, const cosim_thread *gt, const cosim_record *rec, int address)
+{
+    return memory_address_valid(cs, gt, rec, address) &&
+           memory_address_valid(cs, gt, rec, address + cs->vector_length - 1);
+}
+
+/* Executes a vector instruction, writing the lanes it produces to lanes */
+static int
+step_vector(apex_cosim *cs, cosim_thread *gt, const cosim_record *rec,
+            const struct APEX_Instruction *insn, int compare, int lanes[MAX_VECTOR_LENGTH])
+{
+    const int *v1 = gt->vregs[insn->rs1];
+    const int *v2 = gt->vregs[insn->rs2];
+    int address;
+
+    for (int i = 0; i < cs->vector_length; i++)
+    {
+        switch (insn->opcode)
+        {
+            case OPCODE_VADD:
+                lanes[i] = v1[i] + v2[i];
+                break;
+            case OPCODE_VSUB:
+                lanes[i] = v1[i] - v2[i];
+                break;
+            case OPCODE_VMUL:
+                lanes[i] = v1[i] * v2[i];
+                break;
+        }
+    }
+    if (insn->opcode == OPCODE_VLOAD)
+    {
+        address = gt->regs[insn->rs1] + insn->imm;
+        if (!vector_address_valid(cs, gt, rec, address))
+        {
+            return FALSE;
+        }
+        for (int i = 0; i < cs->vector_length; i++)
+        {
+            lanes[i] = cs->trust_loads ? rec->lanes[i] : cs->memory[address + i];
+        }
+    }
+    else if (insn->opcode == OPCODE_VSTORE)
+    {
+        address = gt->regs[insn->rs2] + insn->imm;
+        if (!vector_address_valid(cs, gt, rec, address))
+        {
+            return FALSE;
+        }
+        if (compare && rec->mem_address != address)
+        {
+            return diverge(cs, gt, rec, "vector store to %d, core wrote %d", address, rec->mem_address);
+        }
+        for (int i = 0; i < cs->vector_length; i++)
+        {
+            if (compare && rec->lanes[i] != v1[i])
+            {
+                return diverge(cs, gt, rec, "MEM[%d] = %d, core wrote %d", address + i, v1[i],
+                               rec->lanes[i]);
+            }
+            cs->memory[address + i] = v1[i];
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Executes the instruction at the model's PC. When compare is set it is
+ * the instruction rec reports, and its effects are compared; the first
+ * instruction of a fused pair is only executed.
+ */
+static int
+step(apex_cosim *cs, cosim_thread *gt, const cosim_record *rec, int compare)
+{
+    const struct APEX_Instruction *insn;
+    const opcode_info *info;
+    int index = (gt->pc - 4000) / 4;
+    int next_pc = gt->pc + 4;
+    int rs1, rs2, result = 0, address;
+
+    if (gt->pc < 4000 || (gt->pc - 4000) % 4 != 0 || index >= gt->code_size)
+    {
+        return diverge(cs, gt, rec, "PC %d is outside the program", gt->pc);
+    }
+    insn = &gt->code[index];
+    info = opcode_info_of(insn->opcode);
+    if (compare && rec->opcode != insn->opcode)
+    {
+        return diverge(cs, gt, rec, "core committed %s", get_opcode_str(rec->opcode));
+    }
+    rs1 = gt->regs[insn->rs1];
+    rs2 = gt->regs[insn->rs2];
+
+    if (info->vector)
+    {
+        int lanes[MAX_VECTOR_LENGTH] = {0};
+
+        if (!step_vector(cs, gt, rec, insn, compare, lanes))
+        {
+            return FALSE;
+        }
+        if (has_vector_destination(insn->opcode))
+        {
+            if (compare && (rec->rd != insn->rd ||
+                            memcmp(rec->lanes, lanes, sizeof(lanes[0]) * cs->vector_length) != 0))
+            {
+                for (int i = 0; i < cs->vector_length; i++)
+                {
+                    if (rec->lanes[i] != lanes[i])
+                    {
+                        return diverge(cs, gt, rec, "V%d[%d] = %d, core wrote V%d[%d] = %d", insn->rd, i,
+                                       lanes[i], rec->rd, i, rec->lanes[i]);
+                    }
+                }
+                return diverge(cs, gt, rec, "V%d written, core wrote V%d", insn->rd, rec->rd);
+            }
+            memcpy(gt->vregs[insn->rd], lanes, sizeof(gt->vregs[insn->rd]));
+        }
+        gt->pc = next_pc;
+        cs->checked++;
+        return TRUE;
+    }
+
+    switch (insn->opcode)
+    {
+        case OPCODE_ADD:
+            result = rs1 + rs2;
+            break;
+        case OPCODE_SUB:
+            result = rs1 - rs2;
+            break;
+        case OPCODE_MUL:
+            result = rs1 * rs2;
+            break;
+        case OPCODE_DIV:
+            //INT_MIN / -1 wraps instead of trapping the host
+            result = rs2 == 0 ? 0 : rs2 == -1 ? (int)(0u - (unsigned)rs1) : rs1 / rs2;
+            break;
+        case OPCODE_AND:
+            result = rs1 & rs2;
+            break;
+        case OPCODE_OR:
+            result = rs1 | rs2;
+            break;
+        case OPCODE_XOR:
+            result = rs1 ^ rs2;
+            break;
+        case OPCODE_MOVC:
+            result = insn->imm;
+            break;
+        case OPCODE_ADDL:
+            result = rs1 + insn->imm;
+            break;
+        case OPCODE_SUBL:
+            result = rs1 - insn->imm;
+            break;
+        case OPCODE_LOAD:
+            address = rs1 + insn->imm;
+            if (!memory_address_valid(cs, gt, rec, address))
+            {
+                return FALSE;
+            }
+            //another thread's store may land between the load and its commit
+            result = cs->trust_loads ? rec->value : cs->memory[address];
+            break;
+        case OPCODE_STORE:
+            address = rs2 + insn->imm;
+            if (!memory_address_valid(cs, gt, rec, address))
+            {
+                return FALSE;
+            }
+            if (rec->mem_address != address || rec->store_data != rs1)
+            {
+                return diverge(cs, gt, rec, "MEM[%d] = %d, core wrote MEM[%d] = %d", address, rs1,
+                               rec->mem_address, rec->store_data);
+            }
+            cs->memory[address] = rs1;
+            break;
+        case OPCODE_CMP:
+            gt->ccr = (rs1 == rs2) ? 0 : (rs1 > rs2) ? 1 : -1;
+            break;
+        case OPCODE_BZ:
+            next_pc = (gt->ccr == 0) ? gt->pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BNZ:
+            next_pc = (gt->ccr != 0) ? gt->pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BP:
+            next_pc = (gt->ccr > 0) ? gt->pc + insn->imm : next_pc;
+            break;
+        case OPCODE_BNP:
+            next_pc = (gt->ccr < 0) ? gt->pc + insn->imm : next_pc;
+            break;
+        case OPCODE_JUMP:
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_JALR:
+            result = gt->pc + 4;
+            next_pc = rs1 + insn->imm;
+            break;
+        case OPCODE_RET:
+            next_pc = rs1;
+            break;
+        case OPCODE_HALT:
+            gt->halted = TRUE;
+            break;
+        default:
+            return diverge(cs, gt, rec, "the model does not implement this opcode");
+    }
+
+    if (info->operands & OPERAND_RD)
+    {
+        if (compare && (rec->rd != insn->rd || rec->value != result))
+        {
+            return diverge(cs, gt, rec, "R%d = %d, core wrote R%d = %d", insn->rd, result, rec->rd,
+                           rec->value);
+        }
+        gt->regs[insn->rd] = result;
+    }
+    if (info->sets_flags && insn->opcode != OPCODE_CMP)
+    {
+        gt->ccr = result;
+    }
+    gt->pc = next_pc;
+    cs->checked++;
+    return TRUE;
+}
+
+/* Replays one commit record, FALSE at a divergence */
+static int
+check_record(apex_cosim *cs, const cosim_record *rec)
+{
+    cosim_thread *gt = &cs->thread[rec->thread];
+
+    if (gt->halted)
+    {
+        return diverge(cs, gt, rec, "core committed PC %d after HALT", rec->pc);
+    }
+    if (rec->fusion != FUSE_NONE)
+    {
+        if (gt->pc != rec->pc - 4)
+        {
+            return diverge(cs, gt, rec, "next PC is %d, core committed a fused pair at %d", gt->pc,
+                           rec->pc - 4);
+        }
+        if (!step(cs, gt, rec, FALSE))
+        {
+            return FALSE;
+        }
+    }
+    if (gt->pc != rec->pc)
+    {
+        return diverge(cs, gt, rec, "next PC is %d, core committed PC %d", gt->pc, rec->pc);
+    }
+    return step(cs, gt, rec, TRUE);
+}
+
+/* Consumes commit records until the core is done or the first divergence */
+static void *
+checker_thread(void *arg)
+{
+    apex_cosim *cs = arg;
+    cosim_queue *q = &cs->queue;
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+    for (;;)
+    {
+        if (head == q->tail_cache)
+        {
+            int done = atomic_load_explicit(&cs->done, memory_order_acquire);
+
+            q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+            if (head == q->tail_cache)
+            {
+                if (done)
+                {
+                    return NULL;
+                }
+                sched_yield();
+                continue;
+            }
+        }
+        if (!check_record(cs, &q->ring[head & (COSIM_QUEUE_SIZE - 1)]))
+        {
+            atomic_store_explicit(&cs->diverged, TRUE, memory_order_release);
+            return NULL;
+        }
+        head++;
+        atomic_store_explicit(&q->head, head, memory_order_release);
+    }
+}
+
+/*
+ * Starts a checker from the CPU's current architectural state. The CPU's
+ * code memory must outlive the checker. Returns NULL on failure.
+ */
+apex_cosim *
+cosim_start(const APEX_CPU *cpu)
+{
+    apex_cosim *cs = aligned_alloc(COSIM_CACHE_LINE, sizeof(apex_cosim));
+
+    if (!cs)
+    {
+        return NULL;
+    }
+    memset(cs, 0, sizeof(apex_cosim));
+    cs->num_threads = cpu->num_threads;
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        const APEX_Thread *t = &cpu->thread[i];
+        cosim_thread *gt = &cs->thread[i];
+
+        gt->code = t->code_memory;
+        gt->code_size = t->code_memory_size;
+        gt->pc = t->pc;
+        for (int r = 0; r < ARCHITECTURAL_REGISTERS_SIZE; r++)
+        {
+            gt->regs[r] = t->arf.architectural_register_file[r].value;
+        }
+        memcpy(gt->vregs, t->varf, sizeof(gt->vregs));
+    }
+    memcpy(cs->memory, cpu->data_memory, sizeof(cs->memory));
+    cs->trust_loads = cpu->num_threads > 1;
+    cs->vector_length = cpu->vector_length;
+    if (pthread_create(&cs->checker, NULL, checker_thread, cs) != 0)
+    {
+        free(cs);
+        return NULL;
+    }
+    cs->running = TRUE;
+    return cs;
+}
+
+/*
+ * Tells the checker the core has stopped committing and waits for it to
+ * check what is left. Returns TRUE if it found a divergence.
+ */
+int
+cosim_finish(apex_cosim *cs)
+{
+    if (cs->running)
+    {
+        atomic_store_explicit(&cs->done, TRUE, memory_order_release);
+        pthread_join(cs->checker, NULL);
+        cs->running = FALSE;
+    }
+    return cosim_diverged(cs);
+}
+
+void
+cosim_destroy(apex_cosim *cs)
+{
+    if (!cs)
+    {
+        return;
+    }
+    cosim_finish(cs);
+    free(cs);
+}
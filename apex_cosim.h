@@ -0,0 +1,124 @@
+/*
+ * apex_cosim.h
+ * Contains the lockstep co-simulation checker declarations. Every committed
+ * instruction is sent to a functional model of the ISA running on its own
+ * thread, which stops the run at the first architectural divergence.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_COSIM_
+#define _XXYZ_APEX_COSIM_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////CO-SIMULATION/////////////////////////////////////
+
+_Static_assert((COSIM_QUEUE_SIZE & (COSIM_QUEUE_SIZE - 1)) == 0, "COSIM_QUEUE_SIZE must be a power of two");
+
+#define COSIM_CACHE_LINE 64
+#define COSIM_REPORT_SIZE 512
+
+struct APEX_CPU;
+struct APEX_Instruction;
+
+/* One committed instruction, a fused pair is one record */
+typedef struct cosim_record
+{
+    int thread;
+    int cycle;                  /* Clock cycle of the commit */
+    int pc;                     /* PC of the (second) instruction */
+    int opcode;
+    int fusion;                 /* FUSE_* pair retired with it */
+    int rd;
+    int value;                  /* Value written to rd */
+    int mem_address;            /* STORE: address written */
+    int store_data;             /* STORE: value written */
+    int lanes[MAX_VECTOR_LENGTH];   /* Vector register written, or VSTORE data */
+}cosim_record;
+
+/*
+ * Single-producer/single-consumer ring. Each side keeps a private copy of
+ * the other side's index and only rereads the shared one when the copy says
+ * the ring is full (producer) or empty (consumer).
+ */
+typedef struct cosim_queue
+{
+    _Alignas(COSIM_CACHE_LINE) atomic_uint tail;    /* Written by the core */
+    unsigned int head_cache;
+    _Alignas(COSIM_CACHE_LINE) atomic_uint head;    /* Written by the checker */
+    unsigned int tail_cache;
+    _Alignas(COSIM_CACHE_LINE) cosim_record ring[COSIM_QUEUE_SIZE];
+}cosim_queue;
+
+/* Architectural state of one thread in the functional model */
+typedef struct cosim_thread
+{
+    const struct APEX_Instruction *code;
+    int code_size;
+    int pc;
+    int regs[ARCHITECTURAL_REGISTERS_SIZE];
+    int vregs[VECTOR_REGISTERS_SIZE][MAX_VECTOR_LENGTH];
+    int ccr;                    /* Result of the last flag setter, -1/0/1 after a CMP */
+    int halted;
+}cosim_thread;
+
+typedef struct apex_cosim
+{
+    cosim_queue queue;
+    atomic_int diverged;        /* Set by the checker at the first divergence */
+    atomic_int done;            /* Set by the core once nothing more will be committed */
+    pthread_t checker;
+    int running;
+
+    /* Functional model, only touched by the checker thread */
+    cosim_thread thread[SMT_MAX_THREADS];
+    int num_threads;
+    int memory[DATA_MEMORY_SIZE];
+    int trust_loads;            /* Threads share memory: take loaded values from the core */
+    int vector_length;
+    unsigned long long checked; /* Records that matched */
+    char report[COSIM_REPORT_SIZE];
+}apex_cosim;
+
+apex_cosim *cosim_start(const struct APEX_CPU *cpu);
+int cosim_finish(apex_cosim *cs);
+void cosim_destroy(apex_cosim *cs);
+
+static inline int
+cosim_diverged(apex_cosim *cs)
+{
+    return atomic_load_explicit(&cs->diverged, memory_order_relaxed);
+}
+
+/* Hands one commit to the checker, waits while the ring is full */
+static inline void
+cosim_commit(apex_cosim *cs, const cosim_record *rec)
+{
+    cosim_queue *q = &cs->queue;
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+    while (tail - q->head_cache == COSIM_QUEUE_SIZE)
+    {
+        q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+        if (tail - q->head_cache < COSIM_QUEUE_SIZE)
+        {
+            break;
+        }
+        //the checker stops reading at a divergence
+        if (cosim_diverged(cs))
+        {
+            return;
+        }
+        sched_yield();
+    }
+    q->ring[tail & (COSIM_QUEUE_SIZE - 1)] = *rec;
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+#endif
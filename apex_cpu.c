@@ -5,6 +5,8 @@
  * Author:
  * State University of New York at Binghamton
  */
+#include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +14,29 @@
 #include "apex_macros.h"
 #include "physical_register.h"
 #include  "issue_queue.h"
+#include "apex_debugger.h"
+
+/* Records a lifecycle event for the instruction held in a pipeline latch */
+#define TRACE_STAGE(cpu, stage, event)                                      \
+    do                                                                      \
+    {                                                                       \
+        if ((cpu)->trace)                                                   \
+        {                                                                   \
+            trace_event((cpu)->trace, (stage)->seq, (cpu)->clock,           \
+                        (stage)->pc, event, (stage)->opcode);               \
+        }                                                                   \
+    } while (0)
+
+/* Records a lifecycle event for the instruction held in a ROB entry */
+#define TRACE_ROB(cpu, entry, event)                                        \
+    do                                                                      \
+    {                                                                       \
+        if ((cpu)->trace)                                                   \
+        {                                                                   \
+            trace_event((cpu)->trace, (entry)->seq, (cpu)->clock,           \
+                        (entry)->pc_value, event, (entry)->opcode);         \
+        }                                                                   \
+    } while (0)
 
 /* Converts the PC(4000 series) into array index for code memory
  *
@@ -23,91 +48,37 @@ get_code_memory_index_from_pc(const int pc)
     return (pc - 4000) / 4;
 }
 
+/* BTB entry of the instruction at pc, a trace's PCs may lie past the table */
+static int
+btb_index_of(const int pc)
+{
+    return (int)((unsigned)(pc - 4000) / 4 % BTB_SIZE);
+}
+
 
 static void
 print_instruction(const CPU_Stage *stage)
 {
-    switch (stage->opcode)
-    {
-        case OPCODE_ADD:
-        case OPCODE_SUB:
-        case OPCODE_MUL:
-        case OPCODE_AND:
-        case OPCODE_OR:
-        case OPCODE_XOR:
-        {
-            printf("%s,R%d,R%d,R%d ", stage->opcode_str, stage->rd, stage->rs1,
-                   stage->rs2);
-            break;
-        }
-        case OPCODE_ADDL:
-        {
-            printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-                   stage->imm);
-            break;
-        }
-        case OPCODE_SUBL:
-        {
-            printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-                   stage->imm);
-            break;
-        }
-
-        case OPCODE_MOVC:
-        {
-            printf("%s,R%d,#%d ", stage->opcode_str, stage->rd, stage->imm);
-            break;
-        }
-
-        
-        case OPCODE_LOAD:
-        {
-            printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-                   stage->imm);
-            break;
-        }
+    const opcode_info *info = opcode_info_of(stage->opcode);
 
-        case OPCODE_STORE:
-        {
-            printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rs2, stage->rs1,
-                   stage->imm);
-            break;
-        }
-
-        case OPCODE_BZ:
-        case OPCODE_BNZ:
-        case OPCODE_BP:
-        case OPCODE_BNP:
-        {
-            printf("%s,#%d ", stage->opcode_str, stage->imm);
-            break;
-        }
-        case OPCODE_JUMP:
-        {
-            printf("%s,R%d,#%d ", stage->opcode_str, stage->rs1, stage->imm);
-            break;
-        }
-        case OPCODE_JALR:
-        {
-            printf("%s,R%d,R%d,#%d ", stage->opcode_str, stage->rd, stage->rs1,
-                   stage->imm);
-        }
-        case OPCODE_RET:
-        {
-            printf("%s,R%d", stage->opcode_str, stage->rs1);
-            break;
-        }
-        case OPCODE_CMP:
-        {
-            printf("%s,R%d,R%d ", stage->opcode_str, stage->rs1, stage->rs2);
-            break;
-        }
-        case OPCODE_HALT:
-        {
-            printf("%s", stage->opcode_str);
-            break;
-        }
+    printf("%s", info->mnemonic);
+    if (info->operands & OPERAND_RD)
+    {
+        printf(",%c%d", (info->vector & OPERAND_RD) ? 'V' : 'R', stage->rd);
     }
+    if (info->operands & OPERAND_RS1)
+    {
+        printf(",%c%d", (info->vector & OPERAND_RS1) ? 'V' : 'R', stage->rs1);
+    }
+    if (info->operands & OPERAND_RS2)
+    {
+        printf(",%c%d", (info->vector & OPERAND_RS2) ? 'V' : 'R', stage->rs2);
+    }
+    if (info->operands & OPERAND_IMM)
+    {
+        printf(",#%d", stage->imm);
+    }
+    printf(" ");
 }
 
 /* Debug function which prints the CPU stage content
@@ -133,22 +104,32 @@ static void
 print_reg_file(const APEX_CPU *cpu)
 {
     int i,ph;
+    const APEX_Thread *t = &cpu->thread[0];
 
-    printf("----------\n%s\n----------\n", "ARCHITECTURAL Registers:");
-
-    for (int i = 0; i < ARCHITECTURAL_REGISTERS_SIZE / 2; ++i)
+    for (int n = 0; n < cpu->num_threads; n++)
     {
-        printf("R%-3d[%-3d] ", i, cpu->arf.architectural_register_file[i].value);
-    }
+        t = &cpu->thread[n];
+        if (cpu->num_threads > 1)
+        {
+            printf("----------\nThread %d\n", n);
+        }
 
-    printf("\n");
+        printf("----------\n%s\n----------\n", "ARCHITECTURAL Registers:");
 
-    for (i = (ARCHITECTURAL_REGISTERS_SIZE / 2); i <= ARCHITECTURAL_REGISTERS_SIZE; ++i)
-    {
-        printf("R%-3d[%-3d] ", i,cpu->arf.architectural_register_file[i].value);
-    }
+        for (int i = 0; i < ARCHITECTURAL_REGISTERS_SIZE / 2; ++i)
+        {
+            printf("R%-3d[%-3d] ", i, t->arf.architectural_register_file[i].value);
+        }
 
-    printf("\n");
+        printf("\n");
+
+        for (i = (ARCHITECTURAL_REGISTERS_SIZE / 2); i <= ARCHITECTURAL_REGISTERS_SIZE; ++i)
+        {
+            printf("R%-3d[%-3d] ", i,t->arf.architectural_register_file[i].value);
+        }
+
+        printf("\n");
+    }
 
     printf("----------\n%s\n----------\n", "PHYSICAL Registers:");
 
@@ -167,297 +148,685 @@ print_reg_file(const APEX_CPU *cpu)
     printf("\n");
 
     //rename table CCR
+    t = &cpu->thread[0];
 
-    if(cpu->rnt.rename_table[16].register_source==1)
+    if(t->rnt.rename_table[16].register_source==1)
     {
-        if(cpu->prf.physical_register[cpu->rnt.rename_table[16].mapped_to_physical_register].reg_valid){
-            printf("%d", cpu->prf.physical_register[cpu->rnt.rename_table[16].mapped_to_physical_register].reg_value);
+        if(cpu->prf.physical_register[t->rnt.rename_table[16].mapped_to_physical_register].reg_valid){
+            printf("%d", cpu->prf.physical_register[t->rnt.rename_table[16].mapped_to_physical_register].reg_value);
         }
         else{
-            printf("%d", cpu->arf.architectural_register_file[cpu->arf.architectural_register_file[16].value].value);
+            printf("%d", t->arf.architectural_register_file[t->arf.architectural_register_file[16].value].value);
         }
     }
 
 }
 
-/*
- * Fetch Stage of APEX Pipeline
- *
- * Note: You are free to edit this function according to your implementation
- */
+/* Prints the vector registers, only for programs that use them */
 static void
-APEX_fetch(APEX_CPU *cpu)
+print_vector_reg_file(const APEX_CPU *cpu)
 {
-    APEX_Instruction *current_ins;
+    int uses_vectors = FALSE;
 
-    if (cpu->fetch.has_insn)
+    for (int n = 0; n < cpu->num_threads; n++)
     {
-
-        printf("pc->value=%d\n",cpu->pc);
-        /* This fetches new branch target instruction from next cycle */
-        if (cpu->fetch_from_next_cycle == TRUE)
+        for (int i = 0; i < cpu->thread[n].code_memory_size; i++)
         {
-            cpu->fetch_from_next_cycle = FALSE;
-
-            /* Skip this cycle*/
-            return;
+            uses_vectors |= opcode_info_of(cpu->thread[n].code_memory[i].opcode)->vector != 0;
         }
-
-        if(cpu->decode_rename.is_stage_stalled==1){
-            return;
+    }
+    if (!uses_vectors)
+    {
+        return;
+    }
+    printf("\n----------\n%s\n----------\n", "VECTOR Registers:");
+    for (int n = 0; n < cpu->num_threads; n++)
+    {
+        if (cpu->num_threads > 1)
+        {
+            printf("Thread %d\n", n);
         }
-
-
-        /* Store current PC in fetch latch */
-        cpu->fetch.pc = cpu->pc;
-
-        /* Index into code memory using this pc and copy all instruction fields
-         * into fetch latch  */
-        current_ins = &cpu->code_memory[get_code_memory_index_from_pc(cpu->pc)];
-        strcpy(cpu->fetch.opcode_str, current_ins->opcode_str);
-        cpu->fetch.opcode = current_ins->opcode;
-        cpu->fetch.rd = current_ins->rd;
-        cpu->fetch.rs1 = current_ins->rs1;
-        cpu->fetch.rs2 = current_ins->rs2;
-        cpu->fetch.imm = current_ins->imm;
-
-        /* Update PC for next instruction */
-        cpu->pc += 4;
-
-        /* Copy data from fetch latch to decode latch*/
-        cpu->decode_rename = cpu->fetch;
-
-        if (ENABLE_DEBUG_MESSAGES)
+        for (int i = 0; i < VECTOR_REGISTERS_SIZE; i++)
         {
-            print_stage_content("Fetch", &cpu->fetch);
-            // printf("has isn: %d\n", cpu->fetch.has_insn);
+            printf("V%d [", i);
+            for (int j = 0; j < cpu->vector_length; j++)
+            {
+                printf(j ? " %d" : "%d", cpu->thread[n].varf[i][j]);
+            }
+            printf("]\n");
         }
+    }
+}
 
-        /* Stop fetching new instructions if HALT is fetched */
-        if (cpu->fetch.opcode == OPCODE_HALT)
+/* A record names only registers that exist and a PC of the code memory's series */
+static int
+itrace_record_is_valid(const apex_itrace_record *rec)
+{
+    const opcode_info *info = opcode_info_of(rec->opcode);
+    const int regs[3] = {rec->rd, rec->rs1, rec->rs2};
+
+    if (!info->mnemonic || rec->pc < 4000 || rec->pc % 4 != 0 || rec->next_pc % 4 != 0)
+    {
+        return FALSE;
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        int bit = OPERAND_RD << i;
+        int limit = (info->vector & bit) ? VECTOR_REGISTERS_SIZE : ARCHITECTURAL_REGISTERS_SIZE;
+
+        if ((info->operands & bit) && regs[i] >= limit)
         {
-            cpu->fetch.has_insn = FALSE;
+            return FALSE;
         }
     }
+    return TRUE;
 }
-//// first ROB---> LSQ--->Issue_queue/////
+
 /*
- * Decode Stage of APEX Pipeline
- *
- * Note: You are free to edit this function according to your implementation
+ * Fetch from an instruction trace: the next record instead of the
+ * instruction at the PC. The end of the trace, or a record that is not an
+ * APEX instruction, ends the program with a HALT.
  */
 static void
-APEX_decode_rename(APEX_CPU *cpu)
+fetch_from_trace(APEX_CPU *cpu, APEX_Thread *t)
 {
-    if (cpu->decode_rename.has_insn )
-    {
+    apex_itrace_record rec;
+    int status = itrace_next(cpu->itrace_in, &rec);
 
-        if(cpu->rename_dispatch.is_stage_stalled==1){
-            cpu->decode_rename.is_stage_stalled=1;
-            return;
+    if (status <= 0)
+    {
+        if (status < 0)
+        {
+            fprintf(stderr, "APEX_Error: Unable to read instruction trace %s\n", cpu->itrace_file);
         }
-        cpu->decode_rename.is_stage_stalled=0;
-
-        cpu->decode_rename.is_physical_register_required=0;
-        cpu->decode_rename.is_src1_register_required=0;
-        cpu->decode_rename.is_src2_register_required=0;
-        cpu->decode_rename.is_memory_insn=0;
-
-        int btb_index=(cpu->decode_rename.pc-4000)/4;
-        if(cpu->btb[btb_index].is_valid==1){
-            printf("Predicting for I[%d]\n",btb_index);
-            if(cpu->rename_dispatch.opcode==OPCODE_JUMP ||
-                cpu->rename_dispatch.opcode==OPCODE_JALR ||
-                cpu->rename_dispatch.opcode==OPCODE_RET){
-                    cpu->pc=cpu->btb[btb_index].target_address;
-                    cpu->btb[btb_index].predicted_pc=cpu->btb[btb_index].target_address;
-                    cpu->btb[btb_index].is_predicted=1;
+        memset(&rec, 0, sizeof(rec));
+        rec.opcode = OPCODE_HALT;
+        rec.pc = t->pc;
+    }
+    else if (!itrace_record_is_valid(&rec))
+    {
+        fprintf(stderr, "APEX_Error: Invalid record %llu in instruction trace %s\n",
+                cpu->itrace_in->records, cpu->itrace_file);
+        memset(&rec, 0, sizeof(rec));
+        rec.opcode = OPCODE_HALT;
+        rec.pc = t->pc;
+    }
+    t->fetch.pc = rec.pc;
+    t->fetch.opcode = rec.opcode;
+    t->fetch.rd = rec.rd;
+    t->fetch.rs1 = rec.rs1;
+    t->fetch.rs2 = rec.rs2;
+    t->fetch.imm = rec.imm;
+    t->fetch.trace_next_pc = rec.next_pc;
+    t->fetch.trace_address = rec.mem_address;
+    t->fetch.trace_mispredicted = FALSE;
+    t->pc = rec.pc;
+}
+
+/* Points fetch at the BTB's prediction for the instruction at pc */
+static void predict_next_pc(APEX_CPU *cpu, APEX_Thread *t, int pc){
+        int btb_index=btb_index_of(pc);
+        cpu->stats.activity[ACT_BTB_LOOKUP]++;
+        if(t->btb[btb_index].is_valid==1){
+            APEX_DEBUG("Predicting for I[%d]\n",btb_index);
+            if(opcode_info_of(t->rename_dispatch.opcode)->control==CONTROL_UNCONDITIONAL){
+                    t->pc=t->btb[btb_index].target_address;
+                    t->btb[btb_index].predicted_pc=t->btb[btb_index].target_address;
+                    t->btb[btb_index].is_predicted=1;
                 }
                 else{
-                   if(cpu->btb[btb_index].is_taken==1){
-                        cpu->pc=cpu->btb[btb_index].target_address;
-                        cpu->btb[btb_index].predicted_pc=cpu->btb[btb_index].target_address;
-                        cpu->btb[btb_index].is_predicted=1;
+                   if(t->btb[btb_index].is_taken==1){
+                        t->pc=t->btb[btb_index].target_address;
+                        t->btb[btb_index].predicted_pc=t->btb[btb_index].target_address;
+                        t->btb[btb_index].is_predicted=1;
                     }
                     else{
-                        cpu->pc=cpu->pc+4;
-                        cpu->btb[btb_index].predicted_pc=cpu->pc;
-                        cpu->btb[btb_index].is_predicted=1;
+                        t->pc=t->pc+4;
+                        t->btb[btb_index].predicted_pc=t->pc;
+                        t->btb[btb_index].is_predicted=1;
                     }
                 }
         }
+}
 
+//a trace's records are the fetch targets, it runs on the coupled front end
+static int ftq_enabled(const APEX_CPU *cpu){
+    return cpu->decoupled_front_end && !cpu->itrace_in;
+}
 
+/* Takes the instruction at the FTQ head, the PC moves on to the one fetch takes next */
+static void ftq_consume(APEX_Thread *t){
+    ftq_entry *head=&t->ftq[t->ftq_head];
 
-        /* Read operands from register file based on the instruction type */
-        switch (cpu->decode_rename.opcode)
-        {
-            case OPCODE_ADD:
-            case OPCODE_MUL:
-            case OPCODE_DIV:
-            case OPCODE_AND:
-            case OPCODE_OR:
-            case OPCODE_XOR:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.is_src2_register_required=1;
-                cpu->decode_rename.fu=INT_FU;  
-                if(cpu->decode_rename.opcode==OPCODE_MUL || cpu->decode_rename.opcode==OPCODE_DIV){
-                    cpu->decode_rename.fu=MUL_FU;      
-                }
-                break;
-            }
-            case OPCODE_SUB:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.is_src2_register_required=1;
-                cpu->decode_rename.fu=INT_FU;
-
-            }
-            case OPCODE_ADDL:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;  
-                cpu->decode_rename.fu=INT_FU;        
-                break;
-            }
-            case OPCODE_SUBL:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=INT_FU;
-                break;
-            }
-
-            case OPCODE_LOAD:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.is_memory_insn=1;
-                cpu->decode_rename.fu=INT_FU;
-                cpu->decode_rename.memory_instruction_type=LOAD_INS;
-                break;
-            }
-            case OPCODE_STORE:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.is_src2_register_required=1;
-                cpu->decode_rename.is_memory_insn=1;
-                cpu->decode_rename.fu=INT_FU;
-                cpu->decode_rename.memory_instruction_type=STORE_INS;
-                break;
-            }
-
-            case OPCODE_BZ:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-
-            case OPCODE_BNZ:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-            
-            case OPCODE_BP:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-
-            case OPCODE_BNP:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-            case OPCODE_CMP:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.is_src2_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-             case OPCODE_JUMP:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-            case OPCODE_JALR:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
+    if(head->pc!=head->end){
+        head->pc+=4;
+        t->pc=head->pc;
+        return;
+    }
+    t->ftq_head=(t->ftq_head+1)%FTQ_SIZE;
+    t->ftq_count--;
+    t->pc=t->ftq_count ? t->ftq[t->ftq_head].pc : t->bpu_pc;
+}
 
-            case OPCODE_MOVC:
-            {
-                cpu->decode_rename.is_physical_register_required=1;
-                cpu->decode_rename.fu=INT_FU;
+/* Drops the queued blocks once fetch is redirected, prediction restarts at the PC */
+static void ftq_redirect(APEX_Thread *t){
+    t->ftq_head=0;
+    t->ftq_count=0;
+    t->bpu_pc=t->pc;
+}
 
-                break;
-            }
-            case OPCODE_RET:
-            {
-                cpu->decode_rename.is_src1_register_required=1;
-                cpu->decode_rename.fu=BRANCH_FU;
-                break;
-            }
-            case OPCODE_HALT:
-            {
-                cpu->decode_rename.fu=INT_FU;
-                break;
-            }
-        }
-        //checking the resources (availabilty of free physical register, iq entry and lsq entry)
-    
-        // int temp_iq_index=issue_buffer_available_index(&cpu->iq);
-        // if(temp_iq_index!=-1)
-        //     cpu->decode_rename.issue_queue_index=temp_iq_index;
-        // else
-        //     cpu->decode_rename.is_stage_stalled=1;
-        
-        // //check rob availabolity
+/* PC fetch takes after the FTQ head, -1 if it is not predicted yet */
+static int ftq_pc_after_head(const APEX_Thread *t){
+    const ftq_entry *head=&t->ftq[t->ftq_head];
 
-        // //check lsq availability if it is memry instruction
+    if(t->ftq_count==0){
+        return -1;
+    }
+    if(head->pc!=head->end){
+        return head->pc+4;
+    }
+    return t->ftq_count>1 ? t->ftq[(t->ftq_head+1)%FTQ_SIZE].pc : -1;
+}
 
+static int icache_line_of(int pc){
+    return (pc-4000)/4/ICACHE_LINE_SIZE;
+}
 
+/* Starts filling the line of pc, FALSE if it is there or on its way already */
+static int icache_fill(APEX_CPU *cpu, APEX_Thread *t, int pc){
+    int line=icache_line_of(pc);
+    int slot=line%ICACHE_LINES;
 
+    if(t->icache_tag[slot]==line){
+        return FALSE;
+    }
+    t->icache_tag[slot]=line;
+    t->icache_ready[slot]=cpu->clock+cpu->icache_latency;
+    return TRUE;
+}
 
+/* TRUE when fetch can read pc this cycle, a miss starts the fill */
+static int icache_hit(APEX_CPU *cpu, APEX_Thread *t, int pc){
+    if(!cpu->icache_latency){
+        return TRUE;
+    }
+    if(icache_fill(cpu, t, pc)){
+        cpu->stats.icache_misses++;
+    }
+    return cpu->clock>=t->icache_ready[icache_line_of(pc)%ICACHE_LINES];
+}
 
+static int uop_cache_index_of(int pc){
+    return ((pc-4000)/4)%UOP_CACHE_SIZE;
+}
 
-        /* Copy data from decode latch to execute latch*/
-        cpu->rename_dispatch = cpu->decode_rename;
-        cpu->decode_rename.has_insn = FALSE;
+/*
+ * Sends the instruction at the PC from the micro-op cache straight to
+ * rename, predicting its successor as decode would. Returns FALSE on a miss,
+ * when fetch reads the code memory instead.
+ */
+static int
+uop_cache_deliver(APEX_CPU *cpu, APEX_Thread *t)
+{
+    uop_cache_entry *entry = &t->uop_cache[uop_cache_index_of(t->pc)];
+    int front_end_empty;
 
-        if (ENABLE_DEBUG_MESSAGES)
+    if (!cpu->uop_cache || cpu->itrace_in || !entry->valid || entry->pc != t->pc)
+    {
+        return FALSE;
+    }
+    //the second instruction of a fused pair must be predicted as well
+    if (ftq_enabled(cpu) && entry->uop.fusion != FUSE_NONE && ftq_pc_after_head(t) != t->pc + 4)
+    {
+        return FALSE;
+    }
+    //rename takes it next cycle, as it would a fetched instruction decoded then
+    if (t->decode_rename.has_insn || t->rename_dispatch.has_insn)
+    {
+        return TRUE;
+    }
+    front_end_empty = !t->queue_entry.has_insn;
+    t->rename_dispatch = entry->uop;
+    if (ftq_enabled(cpu))
+    {
+        ftq_consume(t);
+        if (entry->uop.fusion != FUSE_NONE)
         {
-            print_stage_content("Decode_Rename", &cpu->decode_rename);
+            ftq_consume(t);
         }
+        t->rename_dispatch.predicted_pc = t->pc;
+    }
+    else
+    {
+        t->pc = entry->uop.pc + 4;
+        predict_next_pc(cpu, t, entry->uop.pc);
+    }
+    t->rename_dispatch.has_insn = TRUE;
+    t->rename_dispatch.is_stage_stalled = 0;
+    t->rename_dispatch.seq = cpu->next_seq++;
+    t->rename_dispatch.thread = t->id;
+    cpu->stats.thread_fetched[t->id] += (entry->uop.fusion != FUSE_NONE) ? 2 : 1;
+    cpu->stats.uop_cache_hits += (entry->uop.fusion != FUSE_NONE) ? 2 : 1;
+    //a fetched instruction would have reached rename a cycle later
+    if (front_end_empty)
+    {
+        cpu->stats.uop_cache_bubbles++;
+    }
+    TRACE_STAGE(cpu, &t->rename_dispatch, TRACE_FETCH);
+    TRACE_STAGE(cpu, &t->rename_dispatch, TRACE_DECODE);
+
+    if (entry->uop.opcode == OPCODE_HALT)
+    {
+        t->fetch.has_insn = FALSE;
     }
+    return TRUE;
 }
 
+/*
+ * Branch prediction unit of the decoupled front end. Every cycle it queues
+ * the next fetch block, from bpu_pc to the first branch the BTB predicts
+ * taken or to the end of the instruction cache line, and prefetches that
+ * line. It goes on while fetch is stalled, until the FTQ is full.
+ */
 static void
-
-APEX_rename_dispatch(APEX_CPU *cpu)
+APEX_predict(APEX_CPU *cpu, APEX_Thread *t)
 {
-    //check availabity of iq_entry
-    if(cpu->rename_dispatch.has_insn){
-        cpu->rename_dispatch.is_stage_stalled=0;
-        // if(cpu->rename_dispatch.opcode==OPCODE_RET){
-        //     if(cpu->rnt.rename_table[cpu->rename_dispatch.rs1].register_source){
-        //         if(cpu->prf.physical_register [cpu->rnt.rename_table[cpu->rename_dispatch.rs1].mapped_to_physical_register].reg_valid){
-        //             cpu->pc= cpu->prf.physical_register [cpu->rnt.rename_table[cpu->rename_dispatch.rs1].mapped_to_physical_register].reg_value;
-                    
-        //             cpu->rename_dispatch.is_stage_stalled=0;
+    ftq_entry *block;
+    int last, pc;
+
+    if (!ftq_enabled(cpu) || !t->fetch.has_insn || t->ftq_count == FTQ_SIZE ||
+        get_code_memory_index_from_pc(t->bpu_pc) >= t->code_memory_size)
+    {
+        return;
+    }
+    block = &t->ftq[(t->ftq_head + t->ftq_count) % FTQ_SIZE];
+    last = 4000 + ((icache_line_of(t->bpu_pc) + 1) * ICACHE_LINE_SIZE - 1) * 4;
+    if (get_code_memory_index_from_pc(last) >= t->code_memory_size)
+    {
+        last = 4000 + (t->code_memory_size - 1) * 4;
+    }
+    block->pc = t->bpu_pc;
+    block->end = last;
+    block->next_pc = last + 4;
+    //the BTB is read for the whole block at once
+    cpu->stats.activity[ACT_BTB_LOOKUP]++;
+    for (pc = block->pc; pc <= last; pc += 4)
+    {
+        const btb_entry *entry = &t->btb[btb_index_of(pc)];
+
+        if (entry->is_valid && entry->pc_value == pc && entry->is_taken == 1)
+        {
+            block->end = pc;
+            block->next_pc = entry->target_address;
+            break;
+        }
+    }
+    t->bpu_pc = block->next_pc;
+    t->ftq_count++;
+    cpu->stats.ftq_blocks++;
+    if (cpu->icache_latency && icache_fill(cpu, t, block->pc))
+    {
+        cpu->stats.icache_prefetches++;
+    }
+}
+
+/*
+ * Fetch Stage of APEX Pipeline
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+static void
+APEX_fetch(APEX_CPU *cpu, APEX_Thread *t)
+{
+    APEX_Instruction *current_ins;
+
+    if (t->fetch.has_insn)
+    {
+
+        APEX_DEBUG("pc->value=%d\n",t->pc);
+        /* This fetches new branch target instruction from next cycle */
+        if (t->fetch_from_next_cycle == TRUE)
+        {
+            t->fetch_from_next_cycle = FALSE;
+
+            /* Skip this cycle*/
+            return;
+        }
+
+        if(t->decode_rename.is_stage_stalled==1){
+            stats_record_stall(&cpu->stats, STALL_STAGE_FETCH, STALL_NEXT_STAGE_STALLED);
+            return;
+        }
+
+        //a trace has no wrong path to fetch, so a misprediction stops fetch until it resolves
+        if(t->trace_blocked){
+            stats_record_stall(&cpu->stats, STALL_STAGE_FETCH, STALL_BRANCH_UNRESOLVED);
+            return;
+        }
+
+        //the prediction unit has not reached this far
+        if (ftq_enabled(cpu) && t->ftq_count == 0)
+        {
+            return;
+        }
+
+        if (uop_cache_deliver(cpu, t))
+        {
+            return;
+        }
+
+        if (!cpu->itrace_in && !icache_hit(cpu, t, t->pc))
+        {
+            stats_record_stall(&cpu->stats, STALL_STAGE_FETCH, STALL_ICACHE_MISS);
+            return;
+        }
+
+        if (cpu->itrace_in)
+        {
+            fetch_from_trace(cpu, t);
+        }
+        else
+        {
+            /* Store current PC in fetch latch */
+            t->fetch.pc = t->pc;
+
+            /* Index into code memory using this pc and copy all instruction fields
+             * into fetch latch  */
+            current_ins = &t->code_memory[get_code_memory_index_from_pc(t->pc)];
+            t->fetch.opcode = current_ins->opcode;
+            t->fetch.rd = current_ins->rd;
+            t->fetch.rs1 = current_ins->rs1;
+            t->fetch.rs2 = current_ins->rs2;
+            t->fetch.imm = current_ins->imm;
+        }
+        t->fetch.seq = cpu->next_seq++;
+        t->fetch.thread = t->id;
+        cpu->stats.thread_fetched[t->id]++;
+        TRACE_STAGE(cpu, &t->fetch, TRACE_FETCH);
+
+        /* Update PC for next instruction */
+        if (ftq_enabled(cpu))
+        {
+            ftq_consume(t);
+            t->fetch.predicted_pc = t->pc;
+        }
+        else
+        {
+            t->pc += 4;
+        }
+
+        /* Copy data from fetch latch to decode latch*/
+        t->decode_rename = t->fetch;
+
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Fetch", &t->fetch);
+            // printf("has isn: %d\n", cpu->fetch.has_insn);
+        }
+
+        /* Stop fetching new instructions if HALT is fetched */
+        if (t->fetch.opcode == OPCODE_HALT)
+        {
+            t->fetch.has_insn = FALSE;
+        }
+    }
+}
+/*
+ * TRUE when no branch can read the CCR set by the instruction before pc:
+ * straight-line code from pc writes the CCR again before any conditional
+ * branch. Control transfers end the search with FALSE.
+ */
+static int
+ccr_dead_from(const APEX_Thread *t, int pc)
+{
+    for (int i = get_code_memory_index_from_pc(pc); i < t->code_memory_size; i++)
+    {
+        const opcode_info *info = opcode_info_of(t->code_memory[i].opcode);
+
+        if (info->sets_flags || info->control == CONTROL_HALT)
+        {
+            return TRUE;
+        }
+        if (info->control != CONTROL_NONE)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * Macro-op fusion. When the instruction in decode and the one fetch takes
+ * next form an enabled pair, decode reads the second one itself and the
+ * pair goes on as a single micro-op: the second instruction, with the first
+ * folded into its operands. Returns the FUSE_* kind of the pair.
+ */
+static int
+fuse_with_next(APEX_CPU *cpu, APEX_Thread *t)
+{
+    CPU_Stage *first = &t->decode_rename;
+    int index = get_code_memory_index_from_pc(first->pc) + 1;
+    const APEX_Instruction *next;
+    int fusion = FUSE_NONE;
+
+    //a trace has no code memory to read the next instruction from
+    if (!cpu->fusion_pairs || cpu->itrace_in || !t->fetch.has_insn || t->pc != first->pc + 4 ||
+        index >= t->code_memory_size || (ftq_enabled(cpu) && t->ftq_count == 0))
+    {
+        return FUSE_NONE;
+    }
+    next = &t->code_memory[index];
+    switch (first->opcode)
+    {
+        case OPCODE_CMP:
+        {
+            if (is_conditional_branch(next->opcode))
+            {
+                fusion = FUSE_CMP_BRANCH;
+            }
+            break;
+        }
+        case OPCODE_MOVC:
+        {
+            //the constant must only feed the ADD, which overwrites it
+            if (next->opcode == OPCODE_ADD && next->rd == first->rd &&
+                (next->rs1 == first->rd) != (next->rs2 == first->rd))
+            {
+                fusion = FUSE_MOVC_ADD;
+            }
+            break;
+        }
+        case OPCODE_ADDL:
+        {
+            //the address must only feed the LOAD, and the ADDL's CCR nothing
+            if (next->opcode == OPCODE_LOAD && next->rs1 == first->rd && next->rd == first->rd &&
+                ccr_dead_from(t, first->pc + 8))
+            {
+                fusion = FUSE_ADDL_LOAD;
+            }
+            break;
+        }
+    }
+    if (!(fusion & cpu->fusion_pairs))
+    {
+        return FUSE_NONE;
+    }
+
+    switch (fusion)
+    {
+        case FUSE_CMP_BRANCH:
+            //the branch compares the CMP's sources itself
+            first->imm = next->imm;
+            break;
+        case FUSE_MOVC_ADD:
+            //ADD Rd,Rs,#imm
+            first->rs1 = (next->rs1 == first->rd) ? next->rs2 : next->rs1;
+            break;
+        case FUSE_ADDL_LOAD:
+            first->imm += next->imm;
+            break;
+    }
+    first->opcode = next->opcode;
+    first->pc = t->pc;
+    first->fusion = fusion;
+    cpu->stats.thread_fetched[t->id]++;
+    APEX_DEBUG("Fused I[%d] into I[%d]\n", index - 1, index);
+    if (ftq_enabled(cpu))
+    {
+        ftq_consume(t);
+        first->predicted_pc = t->pc;
+    }
+    else
+    {
+        t->pc += 4;
+    }
+    return fusion;
+}
+
+/* Keeps the decoded instruction in the micro-op cache when it is in the loop being captured */
+static void uop_cache_fill(APEX_CPU *cpu, APEX_Thread *t){
+    //a fused pair is fetched at the PC of its first instruction
+    int pc=t->decode_rename.fusion!=FUSE_NONE ? t->decode_rename.pc-4 : t->decode_rename.pc;
+    uop_cache_entry *entry=&t->uop_cache[uop_cache_index_of(pc)];
+
+    if(!cpu->uop_cache || cpu->itrace_in || t->loop_end==0 || pc<t->loop_start || pc>t->loop_end){
+        return;
+    }
+    if(entry->valid && entry->pc==pc){
+        return;
+    }
+    entry->valid=1;
+    entry->pc=pc;
+    entry->uop=t->decode_rename;
+    cpu->stats.uop_cache_fills++;
+}
+
+/*
+ * Loop stream detector, run for each resolved branch: a taken backward
+ * branch whose body fits in the micro-op cache is the loop decode captures
+ * from then on.
+ */
+static void uop_cache_detect_loop(APEX_CPU *cpu, APEX_Thread *t, const CPU_Stage *branch){
+    int start=branch->pc_value_to_be_taken;
+
+    if(!cpu->uop_cache || cpu->itrace_in ||
+       opcode_info_of(branch->opcode)->control!=CONTROL_CONDITIONAL){
+        return;
+    }
+    if(start>=branch->pc || (branch->pc-start)/4+1>UOP_CACHE_SIZE){
+        return;
+    }
+    if(t->loop_start!=start || t->loop_end!=branch->pc){
+        t->loop_start=start;
+        t->loop_end=branch->pc;
+        cpu->stats.uop_cache_loops++;
+    }
+}
+
+//// first ROB---> LSQ--->Issue_queue/////
+/*
+ * Decode Stage of APEX Pipeline
+ *
+ * Note: You are free to edit this function according to your implementation
+ */
+static void
+APEX_decode_rename(APEX_CPU *cpu, APEX_Thread *t)
+{
+    if (t->decode_rename.has_insn )
+    {
+
+        if(t->rename_dispatch.is_stage_stalled==1){
+            t->decode_rename.is_stage_stalled=1;
+            stats_record_stall(&cpu->stats, STALL_STAGE_DECODE_RENAME, STALL_NEXT_STAGE_STALLED);
+            return;
+        }
+        t->decode_rename.is_stage_stalled=0;
+
+        t->decode_rename.is_physical_register_required=0;
+        t->decode_rename.is_src1_register_required=0;
+        t->decode_rename.is_src2_register_required=0;
+        t->decode_rename.is_memory_insn=0;
+        t->decode_rename.fusion=fuse_with_next(cpu, t);
+        //a decoupled front end predicted it before fetch
+        if(!ftq_enabled(cpu)){
+            predict_next_pc(cpu, t, t->decode_rename.pc);
+        }
+        //RET always redirects fetch at dispatch, see APEX_queue_entry_addition
+        if(cpu->itrace_in && is_branch_instruction(t->decode_rename.opcode)){
+            t->decode_rename.trace_mispredicted=t->decode_rename.opcode==OPCODE_RET ||
+                                                t->pc!=t->decode_rename.trace_next_pc;
+            t->trace_blocked=t->decode_rename.trace_mispredicted;
+        }
+
+
+
+        /* Read operands from register file based on the instruction type */
+        const opcode_info *info = opcode_info_of(t->decode_rename.opcode);
+        //vector operands are renamed separately, see rename_vector_source
+        int scalar_operands = info->operands & ~info->vector;
+
+        t->decode_rename.vector_operands=info->vector;
+        t->decode_rename.is_physical_register_required=(scalar_operands & OPERAND_RD) ? 1 : 0;
+        //a conditional branch reads the CCR as its source
+        t->decode_rename.is_src1_register_required=
+            ((scalar_operands & OPERAND_RS1) || info->control==CONTROL_CONDITIONAL) ? 1 : 0;
+        t->decode_rename.is_src2_register_required=(scalar_operands & OPERAND_RS2) ? 1 : 0;
+        t->decode_rename.fu=info->fu;
+        if(info->memory!=MEMORY_NONE){
+            t->decode_rename.is_memory_insn=1;
+            t->decode_rename.memory_instruction_type=info->memory;
+        }
+        //a fused CMP's second source, the folded MOVC's constant is the immediate
+        if(t->decode_rename.fusion==FUSE_CMP_BRANCH){
+            t->decode_rename.is_src2_register_required=1;
+        }
+        else if(t->decode_rename.fusion==FUSE_MOVC_ADD){
+            t->decode_rename.is_src2_register_required=0;
+        }
+        //checking the resources (availabilty of free physical register, iq entry and lsq entry)
+    
+        // int temp_iq_index=issue_buffer_available_index(&cpu->iq);
+        // if(temp_iq_index!=-1)
+        //     cpu->decode_rename.issue_queue_index=temp_iq_index;
+        // else
+        //     cpu->decode_rename.is_stage_stalled=1;
+        
+        // //check rob availabolity
+
+        // //check lsq availability if it is memry instruction
+
+
+
+
+
+
+        uop_cache_fill(cpu, t);
+
+        /* Copy data from decode latch to execute latch*/
+        TRACE_STAGE(cpu, &t->decode_rename, TRACE_DECODE);
+        t->rename_dispatch = t->decode_rename;
+        t->decode_rename.has_insn = FALSE;
+
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Decode_Rename", &t->decode_rename);
+        }
+    }
+}
+
+static void
+
+APEX_rename_dispatch(APEX_CPU *cpu, APEX_Thread *t)
+{
+    //check availabity of iq_entry
+    if(t->rename_dispatch.has_insn){
+        t->rename_dispatch.is_stage_stalled=0;
+        // if(cpu->rename_dispatch.opcode==OPCODE_RET){
+        //     if(cpu->rnt.rename_table[cpu->rename_dispatch.rs1].register_source){
+        //         if(cpu->prf.physical_register [cpu->rnt.rename_table[cpu->rename_dispatch.rs1].mapped_to_physical_register].reg_valid){
+        //             cpu->pc= cpu->prf.physical_register [cpu->rnt.rename_table[cpu->rename_dispatch.rs1].mapped_to_physical_register].reg_value;
+                    
+        //             cpu->rename_dispatch.is_stage_stalled=0;
         //         }
         //         else{
         //             cpu->rename_dispatch.is_stage_stalled=1;
@@ -470,313 +839,603 @@ APEX_rename_dispatch(APEX_CPU *cpu)
             
         // }
 
+        //stall while queue entry addition is still holding its instruction
+        if(t->queue_entry.has_insn){
+            t->rename_dispatch.is_stage_stalled=1;
+            stats_record_stall(&cpu->stats, STALL_STAGE_RENAME_DISPATCH, STALL_NEXT_STAGE_STALLED);
+            return;
+        }
+
         //check insn and stall if branch is unresolved
-        if(is_branch_instruction(cpu->rename_dispatch.opcode) && cpu->is_branch_unresolved==1){
-            cpu->rename_dispatch.is_stage_stalled=1;
+        if(is_branch_instruction(t->rename_dispatch.opcode) && t->is_branch_unresolved==1){
+            t->rename_dispatch.is_stage_stalled=1;
+            stats_record_stall(&cpu->stats, STALL_STAGE_RENAME_DISPATCH, STALL_BRANCH_UNRESOLVED);
             return;
         }
 
-        if(cpu->rename_dispatch.opcode==OPCODE_JUMP ||
-            cpu->rename_dispatch.opcode==OPCODE_JALR ||
-            cpu->rename_dispatch.opcode==OPCODE_BZ ||
-            cpu->rename_dispatch.opcode==OPCODE_BNZ ||
-            cpu->rename_dispatch.opcode==OPCODE_BP ||
-            cpu->rename_dispatch.opcode==OPCODE_BNP ||
-            cpu->rename_dispatch.opcode==OPCODE_RET){
+        if(is_branch_instruction(t->rename_dispatch.opcode)){
 
-                cpu->is_branch_unresolved=1;
-                printf("BRANCH UNRESOLVED\n");
+                t->is_branch_unresolved=1;
+                APEX_DEBUG("BRANCH UNRESOLVED\n");
 
-                int btb_index=(cpu->rename_dispatch.pc-4000)/4;
+                int btb_index=btb_index_of(t->rename_dispatch.pc);
                 //create btb entry if not existing
-                if(cpu->btb[btb_index].is_valid==0){
-                    cpu->btb[btb_index].is_valid=1;
-                    printf("BTB entry created for  I[%d]\n",btb_index);
-                    cpu->btb[btb_index].is_predicted=0;
-                    if(cpu->rename_dispatch.opcode==OPCODE_JUMP ||
-                        cpu->rename_dispatch.opcode==OPCODE_JALR ||
-                        cpu->rename_dispatch.opcode==OPCODE_RET){
-                            cpu->btb[btb_index].is_taken=1;
+                if(t->btb[btb_index].is_valid==0){
+                    cpu->stats.activity[ACT_BTB_UPDATE]++;
+                    t->btb[btb_index].is_valid=1;
+                    t->btb[btb_index].pc_value=t->rename_dispatch.pc;
+                    APEX_DEBUG("BTB entry created for  I[%d]\n",btb_index);
+                    t->btb[btb_index].is_predicted=0;
+                    if(opcode_info_of(t->rename_dispatch.opcode)->control==CONTROL_UNCONDITIONAL){
+                            t->btb[btb_index].is_taken=1;
                             
                     }
                     else{
-                        cpu->btb[btb_index].is_taken=-1;
+                        t->btb[btb_index].is_taken=-1;
                     }
                 }
                 //if existing, check if taken or not and update pc accordingly
 
             }
 
-        cpu->queue_entry=cpu->rename_dispatch;
-        cpu->rename_dispatch.has_insn = FALSE;
+        TRACE_STAGE(cpu, &t->rename_dispatch, TRACE_RENAME);
+        t->queue_entry=t->rename_dispatch;
+        t->rename_dispatch.has_insn = FALSE;
         if (ENABLE_DEBUG_MESSAGES)
         {
-            print_stage_content("Rename_Dispatch", &cpu->rename_dispatch);
+            print_stage_content("Rename_Dispatch", &t->rename_dispatch);
         }
     }
 }
 
 
-static void APEX_queue_entry_addition(APEX_CPU *cpu)
+/*
+ * A thread takes a ROB or LSQ entry only if its own queue has room and, with
+ * several threads, the partitioning allows it: a static share of the entries
+ * or whatever all the threads together have not taken yet.
+ */
+static int thread_queue_has_room(const APEX_CPU *cpu, int partition, int used, int total_used, int size){
+    if(cpu->num_threads==1){
+        return TRUE;
+    }
+    if(partition==PARTITION_STATIC){
+        return used<size/cpu->num_threads;
+    }
+    return total_used<size;
+}
+
+static int rob_index_available(APEX_CPU *cpu, APEX_Thread *t){
+    int total_used=0;
+
+    if(reorder_buffer_available(&t->rob)==-1){
+        return -1;
+    }
+    for(int i=0;i<cpu->num_threads;i++){
+        total_used+=rob_occupancy(&cpu->thread[i].rob);
+    }
+    //the last ROB entry is never used
+    if(!thread_queue_has_room(cpu, cpu->rob_partition, rob_occupancy(&t->rob), total_used, ROB_SIZE-1)){
+        return -1;
+    }
+    return t->rob.tail;
+}
+
+static int thread_lsq_index_available(APEX_CPU *cpu, APEX_Thread *t){
+    int total_used=0;
+
+    if(lsq_index_available(&t->lsq)==-1){
+        return -1;
+    }
+    for(int i=0;i<cpu->num_threads;i++){
+        total_used+=lsq_occupancy(&cpu->thread[i].lsq);
+    }
+    if(!thread_queue_has_room(cpu, cpu->lsq_partition, lsq_occupancy(&t->lsq), total_used, LSQ_SIZE)){
+        return -1;
+    }
+    return t->lsq.tail;
+}
+
+/*
+ * MOVC and the move idiom ADDL/SUBL Rd,Rs,#0 need no FU. The value of a MOVC
+ * or of a move from a committed register is known at rename; any other move
+ * maps Rd onto its source's physical register.
+ */
+static int
+rename_resolution(APEX_CPU *cpu, const APEX_Thread *t, int *value)
+{
+    const CPU_Stage *stage = &t->queue_entry;
+    const rename_table_content *src = &t->rnt.rename_table[stage->rs1];
+
+    if (!cpu->rename_elimination || stage->fusion != FUSE_NONE)
+    {
+        return RENAME_EXECUTE;
+    }
+    if (stage->opcode == OPCODE_MOVC)
+    {
+        *value = stage->imm;
+        return RENAME_VALUE;
+    }
+    if ((stage->opcode != OPCODE_ADDL && stage->opcode != OPCODE_SUBL) || stage->imm != 0)
+    {
+        return RENAME_EXECUTE;
+    }
+    if (!src->register_source)
+    {
+        *value = t->arf.architectural_register_file[stage->rs1].value;
+        return RENAME_VALUE;
+    }
+    //a mapping left behind by a flush may name a register that is already free
+    if (src->mapped_to_physical_register < 0 || src->mapped_to_physical_register >= PHYSICAL_REGISTERS_SIZE ||
+        check_free_physical_register(cpu, src->mapped_to_physical_register))
+    {
+        return RENAME_EXECUTE;
+    }
+    return RENAME_SHARE;
+}
+
+/* Puts an instruction resolved at rename into the ROB as completed */
+static void
+complete_at_rename(APEX_CPU *cpu, APEX_Thread *t, int resolution, int value)
+{
+    CPU_Stage *stage = &t->queue_entry;
+    physical_register_content *reg = &cpu->prf.physical_register[stage->phy_rd];
+
+    if (resolution == RENAME_VALUE)
+    {
+        cpu->stats.activity[ACT_PRF_WRITE]++;
+        reg->reg_value = value;
+        reg->positive_flag = (value > 0) ? 1 : 0;
+        reg->zero_flag = (value == 0) ? 1 : 0;
+        reg->reg_valid = 1;
+        cpu->stats.rename_values++;
+    }
+    else
+    {
+        cpu->stats.rename_moves++;
+    }
+    stage->temp_rob_entry.pc_value = stage->pc;
+    stage->temp_rob_entry.destination_address = stage->rd;
+    stage->temp_rob_entry.physical_register = stage->phy_rd;
+    stage->temp_rob_entry.status_bit = 1;
+    stage->temp_rob_entry.store_value_valid = 0;
+    stage->temp_rob_entry.opcode = stage->opcode;
+    stage->temp_rob_entry.insn_type = INT_FU;
+    stage->temp_rob_entry.result_value = value;
+    stage->temp_rob_entry.seq = stage->seq;
+    stage->temp_rob_entry.fusion = FUSE_NONE;
+    reorder_buffer_entry_addition_to_queue(&t->rob, &stage->temp_rob_entry);
+    cpu->stats.activity[ACT_ROB_WRITE]++;
+    t->refilling = FALSE;
+    APEX_DEBUG("Resolved at rename: I[%d]\n", (stage->pc - 4000) / 4);
+    TRACE_STAGE(cpu, stage, TRACE_DISPATCH);
+    TRACE_STAGE(cpu, stage, TRACE_COMPLETE);
+    stage->has_insn = FALSE;
+}
+
+static vector_register_content *
+vector_register(APEX_CPU *cpu, int tag)
+{
+    return &cpu->vrf.vector_register[tag - VECTOR_TAG_BASE];
+}
+
+/*
+ * Reads a vector source at dispatch: the lanes of a committed or already
+ * written register are captured, otherwise the tag is waited on.
+ */
+static void
+rename_vector_source(APEX_CPU *cpu, const APEX_Thread *t, int vreg, int *tag, int *ready, int *lanes)
+{
+    const rename_table_content *map = &t->vrt[vreg];
+    const vector_register_content *reg;
+
+    cpu->stats.activity[ACT_RENAME_READ]++;
+    if (!map->register_source)
+    {
+        memcpy(lanes, t->varf[vreg], sizeof(t->varf[vreg]));
+        *tag = NO_PHYSICAL_REGISTER;
+        *ready = 1;
+        return;
+    }
+    *tag = map->mapped_to_physical_register;
+    reg = vector_register(cpu, *tag);
+    *ready = reg->reg_valid;
+    if (*ready)
+    {
+        cpu->stats.activity[ACT_PRF_READ] += cpu->vector_length;
+        memcpy(lanes, reg->lanes, sizeof(reg->lanes));
+    }
+}
+
+/* Maps the vector destination onto a free vector register, whose tag goes in phy_rd */
+static void
+rename_vector_destination(APEX_CPU *cpu, APEX_Thread *t)
+{
+    CPU_Stage *stage = &t->queue_entry;
+    int tag = pop_free_vector_register(&cpu->vrf);
+
+    cpu->stats.activity[ACT_RENAME_WRITE]++;
+    vector_register(cpu, tag)->reg_valid = 0;
+    t->vrt[stage->rd].mapped_to_physical_register = tag;
+    t->vrt[stage->rd].register_source = 1;
+    t->vmri[stage->rd] = tag;
+    stage->phy_rd = tag;
+    APEX_DEBUG("Vector Reg Allocation: +VP[%d]\n", tag - VECTOR_TAG_BASE);
+    APEX_DEBUG("VRT change V[%d]=VP[%d]\n", stage->rd, tag - VECTOR_TAG_BASE);
+}
+
+/*
+ * A RET has read its target: what was fetched after it is dropped. A
+ * trace fetched nothing after it, fetch resumes at the trace's next record.
+ */
+static void redirect_return(APEX_CPU *cpu, APEX_Thread *t){
+    if(cpu->itrace_in){
+        t->pc=t->queue_entry.trace_next_pc;
+        t->trace_blocked=FALSE;
+        return;
+    }
+    squash_front_end_latches(cpu, t);
+    t->decode_rename.has_insn=FALSE;
+    t->rename_dispatch.has_insn=FALSE;
+    ftq_redirect(t);
+}
+
+static void APEX_queue_entry_addition(APEX_CPU *cpu, APEX_Thread *t)
 {
-if(cpu->queue_entry.has_insn){
-    if(cpu->queue_entry.opcode==OPCODE_RET){
+if(t->queue_entry.has_insn){
+    if(t->queue_entry.opcode==OPCODE_RET){
         //cpu->rename_dispatch.is_stage_stalled=1;
-        if(reorder_buffer_available(&cpu->rob) ==-1){
-            cpu->rename_dispatch.is_stage_stalled=1;
+        if(rob_index_available(cpu, t) ==-1){
+            t->rename_dispatch.is_stage_stalled=1;
+            stats_record_stall(&cpu->stats, STALL_STAGE_QUEUE_ENTRY, STALL_ROB_FULL);
             return;
         }
         else{
-            if(cpu->rnt.rename_table[cpu->queue_entry.rs1].register_source){
-                if(cpu->prf.physical_register [cpu->rnt.rename_table[cpu->queue_entry.rs1].mapped_to_physical_register].reg_valid){
-                    cpu->pc= cpu->prf.physical_register [cpu->rnt.rename_table[cpu->queue_entry.rs1].mapped_to_physical_register].reg_value;
-                    cpu->decode_rename.has_insn=FALSE;
-                    cpu->rename_dispatch.has_insn=FALSE;
-                    cpu->queue_entry.is_stage_stalled=0;
+            cpu->stats.activity[ACT_RENAME_READ]++;
+            if(t->rnt.rename_table[t->queue_entry.rs1].register_source){
+                if(cpu->prf.physical_register [t->rnt.rename_table[t->queue_entry.rs1].mapped_to_physical_register].reg_valid){
+                    cpu->stats.activity[ACT_PRF_READ]++;
+                    t->pc= cpu->prf.physical_register [t->rnt.rename_table[t->queue_entry.rs1].mapped_to_physical_register].reg_value;
+                    redirect_return(cpu, t);
+                    t->queue_entry.is_stage_stalled=0;
                 }
                 else{
-                    cpu->queue_entry.is_stage_stalled=1;
-                    cpu->rename_dispatch.is_stage_stalled=1;
+                    t->queue_entry.is_stage_stalled=1;
+                    t->rename_dispatch.is_stage_stalled=1;
+                    stats_record_stall(&cpu->stats, STALL_STAGE_QUEUE_ENTRY, STALL_RET_WAIT);
                     return;
                 }
             }
             else{
-                cpu->pc= cpu->arf.architectural_register_file[cpu->queue_entry.rs1].value;
-                cpu->decode_rename.has_insn=FALSE;
-                cpu->rename_dispatch.has_insn=FALSE;
-                int index=(cpu->queue_entry.pc-4000)/4;
-                cpu->btb[index].target_address=cpu->pc;
-                cpu->btb[index].is_taken=1;
+                t->pc= t->arf.architectural_register_file[t->queue_entry.rs1].value;
+                redirect_return(cpu, t);
+                int index=btb_index_of(t->queue_entry.pc);
+                cpu->stats.activity[ACT_BTB_UPDATE]++;
+                t->btb[index].target_address=t->pc;
+                t->btb[index].is_taken=1;
 
             }
-             printf("RETURNED TO PC: %d\n",cpu->pc);
+             APEX_DEBUG("RETURNED TO PC: %d\n",t->pc);
+            t->queue_entry.is_stage_stalled=0;
+            t->rename_dispatch.is_stage_stalled=0;
+            t->decode_rename.is_stage_stalled=0;
             
 
         //provide rob_entry and return
-            cpu->queue_entry.temp_rob_entry.pc_value=cpu->queue_entry.pc;
-            cpu->queue_entry.temp_rob_entry.destination_address=cpu->queue_entry.rd;
+            t->queue_entry.temp_rob_entry.pc_value=t->queue_entry.pc;
+            t->queue_entry.temp_rob_entry.destination_address=t->queue_entry.rd;
             //check if physical register is corectly populated
-            cpu->queue_entry.temp_rob_entry.physical_register=cpu->queue_entry.phy_rd;
-            cpu->queue_entry.temp_rob_entry.status_bit=1;
-            cpu->queue_entry.temp_rob_entry.store_value_valid=0;
-            cpu->queue_entry.temp_rob_entry.opcode=cpu->queue_entry.opcode;
-            cpu->queue_entry.temp_rob_entry.insn_type=BRANCH_FU;
-            reorder_buffer_entry_addition_to_queue(&cpu->rob,&cpu->queue_entry.temp_rob_entry);
-            cpu->queue_entry.has_insn=FALSE;
-            cpu->is_branch_unresolved=0;
+            t->queue_entry.temp_rob_entry.physical_register=t->queue_entry.phy_rd;
+            t->queue_entry.temp_rob_entry.status_bit=1;
+            t->queue_entry.temp_rob_entry.store_value_valid=0;
+            t->queue_entry.temp_rob_entry.opcode=t->queue_entry.opcode;
+            t->queue_entry.temp_rob_entry.insn_type=BRANCH_FU;
+            t->queue_entry.temp_rob_entry.seq=t->queue_entry.seq;
+            t->queue_entry.temp_rob_entry.fusion=FUSE_NONE;
+            reorder_buffer_entry_addition_to_queue(&t->rob,&t->queue_entry.temp_rob_entry);
+            cpu->stats.activity[ACT_ROB_WRITE]++;
+            t->refilling=FALSE;
+            TRACE_STAGE(cpu, &t->queue_entry, TRACE_DISPATCH);
+            t->queue_entry.has_insn=FALSE;
+            t->is_branch_unresolved=0;
             return;
         }
             
     }
 
-    cpu->queue_entry.rs1_ready=1;
-        cpu->queue_entry.rs2_ready=1;
-        if(cpu->queue_entry.is_src1_register_required){
-            int temp_physcial_src1=100;
+        int value=0;
+        int resolution=rename_resolution(cpu, t, &value);
+        //checking the resources (availabilty of rob entry, iq entry, lsq entry and free physical register)
+        //steer to the queue of the instruction's FU class
+        int temp_iq_index=issue_buffer_index_available(&cpu->iq, t->queue_entry.fu);
+        int temp_lsq_index=100;
+        if(t->queue_entry.is_memory_insn){
+            temp_lsq_index=thread_lsq_index_available(cpu, t);
+        }
+        int temp_rob_index=rob_index_available(cpu, t);
+        int stall_reason=-1;
+        if(temp_rob_index==-1)
+            stall_reason=STALL_ROB_FULL;
+        else if(temp_iq_index==-1 && resolution==RENAME_EXECUTE)
+            stall_reason=STALL_IQ_FULL;
+        else if(temp_lsq_index==-1)
+            stall_reason=STALL_LSQ_FULL;
+        else if(t->queue_entry.is_physical_register_required && resolution!=RENAME_SHARE && cpu->free_prf_list.free_count==0)
+            stall_reason=STALL_NO_FREE_PHY_REG;
+        else if(has_vector_destination(t->queue_entry.opcode) && cpu->vrf.free_count==0)
+            stall_reason=STALL_NO_FREE_PHY_REG;
+        if(stall_reason==STALL_IQ_FULL){
+            cpu->stats.iq_queue_full[cpu->iq.config.queue_of_fu[t->queue_entry.fu]]++;
+        }
+        if(stall_reason!=-1){
+            //hold the instruction here until the resource is freed
+            t->queue_entry.is_stage_stalled=1;
+            t->rename_dispatch.is_stage_stalled=1;
+            stats_record_stall(&cpu->stats, STALL_STAGE_QUEUE_ENTRY, stall_reason);
+            return;
+        }
+        t->queue_entry.is_stage_stalled=0;
+        t->rename_dispatch.is_stage_stalled=0;
+
+    t->queue_entry.rs1_ready=1;
+        t->queue_entry.rs2_ready=1;
+        if(t->queue_entry.is_src1_register_required){
+            int temp_physcial_src1=NO_PHYSICAL_REGISTER;
+            cpu->stats.activity[ACT_RENAME_READ]++;
             //if need to reaad the content from physical register
-            if(cpu->rnt.rename_table[cpu->queue_entry.rs1].register_source){
-                temp_physcial_src1=cpu->rnt.rename_table[cpu->queue_entry.rs1].mapped_to_physical_register;
+            if(t->rnt.rename_table[t->queue_entry.rs1].register_source){
+                temp_physcial_src1=t->rnt.rename_table[t->queue_entry.rs1].mapped_to_physical_register;
                 //if physical register content is valid then read the value 
                 if(cpu->prf.physical_register[temp_physcial_src1].reg_valid){
-                    cpu->queue_entry.rs1_value=cpu->prf.physical_register[temp_physcial_src1].reg_value;
-                    cpu->queue_entry.phy_rs1=temp_physcial_src1;
-                    cpu->queue_entry.rs1_ready=1;
+                    cpu->stats.activity[ACT_PRF_READ]++;
+                    t->queue_entry.rs1_value=cpu->prf.physical_register[temp_physcial_src1].reg_value;
+                    t->queue_entry.phy_rs1=temp_physcial_src1;
+                    t->queue_entry.rs1_ready=1;
                 }
                 //if physical register content is invalid  then read the prf  from which it  need to be read  
                 else{
-                    cpu->queue_entry.phy_rs1=temp_physcial_src1;
-                    cpu->queue_entry.rs1_ready=0;
+                    t->queue_entry.phy_rs1=temp_physcial_src1;
+                    t->queue_entry.rs1_ready=0;
                 }
             }
             //read from architectural register 
             else{
-                 cpu->queue_entry.rs1_value= cpu->arf.architectural_register_file[cpu->queue_entry.rs1].value;
-                 cpu->queue_entry.rs1_ready=1;
+                 t->queue_entry.rs1_value= t->arf.architectural_register_file[t->queue_entry.rs1].value;
+                 t->queue_entry.rs1_ready=1;
             }
-            if (cpu->queue_entry.opcode == OPCODE_JUMP || cpu->queue_entry.opcode == OPCODE_JALR || cpu->queue_entry.opcode == OPCODE_RET)
+            if (opcode_info_of(t->queue_entry.opcode)->control == CONTROL_UNCONDITIONAL)
             {
-                create_mri_backup(cpu);
-                create_rename_table_backup(cpu);
-                create_btb_backup(cpu);
+                create_mri_backup(t);
+                create_rename_table_backup(t);
+                create_btb_backup(t);
             }
             //if opcode is bz or bnz or bp or bnp then check the condition
-            if (cpu->queue_entry.opcode == OPCODE_BZ || cpu->queue_entry.opcode == OPCODE_BNZ || cpu->queue_entry.opcode == OPCODE_BP || cpu->queue_entry.opcode == OPCODE_BNP)
+            if (is_conditional_branch(t->queue_entry.opcode) &&
+                t->queue_entry.fusion != FUSE_CMP_BRANCH)
             {
                 //create a backup of mri and rnt
-                create_mri_backup(cpu);
-                create_rename_table_backup(cpu);
-                create_btb_backup(cpu);
+                create_mri_backup(t);
+                create_rename_table_backup(t);
+                create_btb_backup(t);
                 //read the rename table last entry
-                if(cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source){
-                    temp_physcial_src1=cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register;
+                cpu->stats.activity[ACT_RENAME_READ]++;
+                if(t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source){
+                    temp_physcial_src1=t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register;
                     //if physical register content is valid then read the value 
                     if(cpu->prf.physical_register[temp_physcial_src1].reg_valid){
-                        cpu->queue_entry.rs1_value=cpu->prf.physical_register[temp_physcial_src1].reg_value;
-                        cpu->queue_entry.phy_rs1=temp_physcial_src1;
-                        cpu->queue_entry.rs1_ready=1;
+                        cpu->stats.activity[ACT_PRF_READ]++;
+                        t->queue_entry.rs1_value=cpu->prf.physical_register[temp_physcial_src1].reg_value;
+                        t->queue_entry.phy_rs1=temp_physcial_src1;
+                        t->queue_entry.rs1_ready=1;
                     }
                     else{
-                        cpu->queue_entry.phy_rs1=temp_physcial_src1;
-                        cpu->queue_entry.rs1_ready=0;
+                        t->queue_entry.phy_rs1=temp_physcial_src1;
+                        t->queue_entry.rs1_ready=0;
                     }
                 }
                 else{
-                        cpu->queue_entry.rs1_value=  cpu->arf.architectural_register_file[cpu->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].value].value;
-                        cpu->queue_entry.rs1_ready=1;
+                        t->queue_entry.rs1_value=  t->arf.architectural_register_file[t->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].value].value;
+                        t->queue_entry.rs1_ready=1;
                     }
             }
 
         }
 
-        if(cpu->queue_entry.is_src2_register_required){
-            int temp_physcial_src2=100;
-            if(cpu->rnt.rename_table[cpu->queue_entry.rs2].register_source){
-                temp_physcial_src2=cpu->rnt.rename_table[cpu->queue_entry.rs2].mapped_to_physical_register;
+        if(t->queue_entry.is_src2_register_required){
+            int temp_physcial_src2=NO_PHYSICAL_REGISTER;
+            cpu->stats.activity[ACT_RENAME_READ]++;
+            if(t->rnt.rename_table[t->queue_entry.rs2].register_source){
+                temp_physcial_src2=t->rnt.rename_table[t->queue_entry.rs2].mapped_to_physical_register;
                 if(cpu->prf.physical_register[temp_physcial_src2].reg_valid){
-                    cpu->queue_entry.rs2_value=cpu->prf.physical_register[temp_physcial_src2].reg_value;
-                    cpu->queue_entry.phy_rs2=temp_physcial_src2;
-                    cpu->queue_entry.rs2_ready=1;
+                    cpu->stats.activity[ACT_PRF_READ]++;
+                    t->queue_entry.rs2_value=cpu->prf.physical_register[temp_physcial_src2].reg_value;
+                    t->queue_entry.phy_rs2=temp_physcial_src2;
+                    t->queue_entry.rs2_ready=1;
                 }
                 else{
-                    cpu->queue_entry.phy_rs2=temp_physcial_src2;
-                    cpu->queue_entry.rs2_ready=0;
+                    t->queue_entry.phy_rs2=temp_physcial_src2;
+                    t->queue_entry.rs2_ready=0;
                 }
             }
             else{
-                 cpu->queue_entry.rs2_value= cpu->arf.architectural_register_file[cpu->queue_entry.rs2].value;
-                 cpu->queue_entry.rs2_ready=1;
+                 t->queue_entry.rs2_value= t->arf.architectural_register_file[t->queue_entry.rs2].value;
+                 t->queue_entry.rs2_ready=1;
             }
         }
+        if(t->queue_entry.vector_operands & OPERAND_RS1){
+            rename_vector_source(cpu, t, t->queue_entry.rs1, &t->queue_entry.phy_rs1,
+                                 &t->queue_entry.rs1_ready, t->queue_entry.rs1_lanes);
+        }
+        if(t->queue_entry.vector_operands & OPERAND_RS2){
+            rename_vector_source(cpu, t, t->queue_entry.rs2, &t->queue_entry.phy_rs2,
+                                 &t->queue_entry.rs2_ready, t->queue_entry.rs2_lanes);
+        }
 
-        cpu->queue_entry.phy_rd=100;//default value is set to 100 for phy_rd
+        t->queue_entry.phy_rd=NO_PHYSICAL_REGISTER;//default value for instructions without a destination
         //ccr update for cmp , assigned to last physical register
-        if (cpu->queue_entry.opcode==OPCODE_CMP){
-             cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register= PHYSICAL_REGISTERS_SIZE;
-             cpu->prf.physical_register[PHYSICAL_REGISTERS_SIZE].reg_valid=0;
-             cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=1;
-             printf("MRP CCR=P%d\n", cpu->mri[ARCHITECTURAL_REGISTERS_SIZE]);
-             cpu->queue_entry.phy_rd = PHYSICAL_REGISTERS_SIZE;
-             cpu->queue_entry.rd=ARCHITECTURAL_REGISTERS_SIZE;
+        if (t->queue_entry.opcode==OPCODE_CMP || t->queue_entry.fusion==FUSE_CMP_BRANCH){
+             cpu->stats.activity[ACT_RENAME_WRITE]++;
+             t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register= PHYSICAL_REGISTERS_SIZE+t->id;
+             cpu->prf.physical_register[PHYSICAL_REGISTERS_SIZE+t->id].reg_valid=0;
+             t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=1;
+             //an older flag setter must not retire the CCR mapping away from the CMP
+             t->mri[ARCHITECTURAL_REGISTERS_SIZE]=PHYSICAL_REGISTERS_SIZE+t->id;
+             APEX_DEBUG("MRP CCR=P%d\n", t->mri[ARCHITECTURAL_REGISTERS_SIZE]);
+             t->queue_entry.phy_rd = PHYSICAL_REGISTERS_SIZE+t->id;
+             t->queue_entry.rd=ARCHITECTURAL_REGISTERS_SIZE;
+        }
+        //a fused branch checkpoints after its CMP has renamed the CCR
+        if (t->queue_entry.fusion==FUSE_CMP_BRANCH){
+            create_mri_backup(t);
+            create_rename_table_backup(t);
+            create_btb_backup(t);
         }
 
-        if(cpu->queue_entry.is_physical_register_required){
-            int temp_rd=pop_free_physical_registers(&cpu->free_prf_q);
+        if(t->queue_entry.is_physical_register_required){
+            int temp_rd;
+            if(resolution==RENAME_SHARE){
+                temp_rd=t->queue_entry.phy_rs1;
+                share_physical_register(&cpu->free_prf_list,temp_rd);
+            }
+            else{
+                temp_rd=pop_free_physical_registers(&cpu->free_prf_list);
+            }
             if( temp_rd!= -1){
-                cpu->queue_entry.phy_rd =temp_rd;
-                cpu->rnt.rename_table[cpu->queue_entry.rd].mapped_to_physical_register=temp_rd;
-                cpu->rnt.rename_table[cpu->queue_entry.rd].register_source=1;
-                cpu->prf.physical_register[temp_rd].reg_valid=0;
-                cpu->mri[cpu->queue_entry.rd]=temp_rd;
+                t->queue_entry.phy_rd =temp_rd;
+                cpu->stats.activity[ACT_RENAME_WRITE]++;
+                t->rnt.rename_table[t->queue_entry.rd].mapped_to_physical_register=temp_rd;
+                t->rnt.rename_table[t->queue_entry.rd].register_source=1;
+                if(resolution!=RENAME_SHARE){
+                    cpu->prf.physical_register[temp_rd].reg_valid=0;
+                }
+                t->mri[t->queue_entry.rd]=temp_rd;
                 //if insn is add sub addl subl mul 
-                if( cpu->queue_entry.opcode==OPCODE_ADD || 
-                    cpu->queue_entry.opcode==OPCODE_ADDL || 
-                    cpu->queue_entry.opcode==OPCODE_SUB || 
-                    cpu->queue_entry.opcode==OPCODE_SUBL || 
-                    cpu->queue_entry.opcode==OPCODE_MUL){
-                       cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register=temp_rd;
-                       cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=1;
-                       cpu->mri[ARCHITECTURAL_REGISTERS_SIZE]=temp_rd;
-                       printf("MRP CCR=P%d\n", cpu->mri[ARCHITECTURAL_REGISTERS_SIZE]);
+                if(opcode_info_of(t->queue_entry.opcode)->sets_flags){
+                       cpu->stats.activity[ACT_RENAME_WRITE]++;
+                       t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register=temp_rd;
+                       t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=1;
+                       t->mri[ARCHITECTURAL_REGISTERS_SIZE]=temp_rd;
+                       APEX_DEBUG("MRP CCR=P%d\n", t->mri[ARCHITECTURAL_REGISTERS_SIZE]);
                     }
-                printf("Physical Reg Allocation: +P[%d]\n",cpu->queue_entry.phy_rd);
-                printf("RNT change R[%d]=p[%d]\n", cpu->queue_entry.rd,cpu->queue_entry.phy_rd);
+                APEX_DEBUG("Physical Reg Allocation: +P[%d]\n",t->queue_entry.phy_rd);
+                APEX_DEBUG("RNT change R[%d]=p[%d]\n", t->queue_entry.rd,t->queue_entry.phy_rd);
             }
-            else  //setting the stalling variable to 1 if no free physical register available
-                cpu->queue_entry.is_stage_stalled=1;
+        }
+        if(has_vector_destination(t->queue_entry.opcode)){
+            rename_vector_destination(cpu, t);
         }
 
+        if(resolution!=RENAME_EXECUTE){
+            complete_at_rename(cpu, t, resolution, value);
+            return;
+        }
 
+        //rob entry, lsq entry and iq entry are available
+        t->queue_entry.temp_iq_entry.dest_tag=t->queue_entry.phy_rd;
+        t->queue_entry.temp_iq_entry.src1_tag=t->queue_entry.phy_rs1;
+        t->queue_entry.temp_iq_entry.src2_tag=t->queue_entry.phy_rs2;
+        t->queue_entry.temp_iq_entry.src1_valid=t->queue_entry.rs1_ready;
+        t->queue_entry.temp_iq_entry.src2_valid=t->queue_entry.rs2_ready;
+        t->queue_entry.temp_iq_entry.src1_value=t->queue_entry.rs1_value;
+        t->queue_entry.temp_iq_entry.src2_value=t->queue_entry.rs2_value;
+        t->queue_entry.temp_iq_entry.FU=t->queue_entry.fu;
+        t->queue_entry.temp_iq_entry.immediate_literal=t->queue_entry.imm;
+        t->queue_entry.temp_iq_entry.is_allocated=1;
+        t->queue_entry.temp_iq_entry.rob_index=temp_rob_index;
+        t->queue_entry.temp_iq_entry.lsq_index=temp_lsq_index;
+        t->queue_entry.temp_iq_entry.opcode=t->queue_entry.opcode;
+        t->queue_entry.temp_iq_entry.pc_value=t->queue_entry.pc;
+        t->queue_entry.temp_iq_entry.counter=0;
+        t->queue_entry.temp_iq_entry.seq=t->queue_entry.seq;
+        t->queue_entry.temp_iq_entry.thread=t->id;
+        t->queue_entry.temp_iq_entry.fusion=t->queue_entry.fusion;
+        memcpy(t->queue_entry.temp_iq_entry.src1_lanes, t->queue_entry.rs1_lanes, sizeof(t->queue_entry.rs1_lanes));
+        memcpy(t->queue_entry.temp_iq_entry.src2_lanes, t->queue_entry.rs2_lanes, sizeof(t->queue_entry.rs2_lanes));
+        //the FU only computes a VSTORE's address, its data goes to the LSQ
+        if(t->queue_entry.opcode==OPCODE_VSTORE){
+            t->queue_entry.temp_iq_entry.src1_valid=1;
+        }
+        t->queue_entry.issue_queue_index=temp_iq_index;
+        t->queue_entry.temp_rob_entry.insn_type=t->queue_entry.fu;
+
+        if(temp_lsq_index!=100 && temp_lsq_index != -1){
+            t->queue_entry.temp_lsq_entry.allocate=1;
+            t->queue_entry.temp_lsq_entry.instruction_type=t->queue_entry.memory_instruction_type;
+            t->queue_entry.temp_lsq_entry.address_valid=0;
+            t->queue_entry.temp_lsq_entry.data_ready=0;
+            t->queue_entry.temp_lsq_entry.OPCODE=t->queue_entry.opcode;
+            t->queue_entry.temp_lsq_entry.data_ready=t->queue_entry.rs1_ready;
+            t->queue_entry.temp_lsq_entry.value_to_be_stored=t->queue_entry.rs1_value;
+            t->queue_entry.temp_lsq_entry.src1_store=t->queue_entry.phy_rs1;
+            memcpy(t->queue_entry.temp_lsq_entry.store_lanes, t->queue_entry.rs1_lanes, sizeof(t->queue_entry.rs1_lanes));
+            t->queue_entry.temp_rob_entry.insn_type=3;
+            t->queue_entry.temp_lsq_entry.pc_value=t->queue_entry.pc;
+            t->queue_entry.temp_lsq_entry.phy_destination_address_for_load=t->queue_entry.phy_rd;
+            t->queue_entry.temp_lsq_entry.destination_address_for_load=t->queue_entry.rd;
+            t->queue_entry.temp_lsq_entry.dispatch_cycle=cpu->clock;
+            t->queue_entry.temp_lsq_entry.seq=t->queue_entry.seq;
+        }
         
-            int temp_iq_index=issue_buffer_index_available(&cpu->iq);
-        //printf("%d",temp_iq_index);
-        int temp_lsq_index=100;
-        if(cpu->queue_entry.is_memory_insn){
-            temp_lsq_index=lsq_index_available(&cpu->lsq);
-        }
-        int temp_rob_index=reorder_buffer_available(&cpu->rob);
-        if(temp_iq_index!=-1 && temp_lsq_index!=-1 && temp_rob_index!=-1){
-           //temp lsq entry , rob entry and iq entry are available
-            cpu->queue_entry.temp_iq_entry.dest_tag=cpu->queue_entry.phy_rd;
-            cpu->queue_entry.temp_iq_entry.src1_tag=cpu->queue_entry.phy_rs1;
-            cpu->queue_entry.temp_iq_entry.src2_tag=cpu->queue_entry.phy_rs2;
-            cpu->queue_entry.temp_iq_entry.src1_valid=cpu->queue_entry.rs1_ready;
-            cpu->queue_entry.temp_iq_entry.src2_valid=cpu->queue_entry.rs2_ready;
-            cpu->queue_entry.temp_iq_entry.src1_value=cpu->queue_entry.rs1_value;
-            cpu->queue_entry.temp_iq_entry.src2_value=cpu->queue_entry.rs2_value;
-            cpu->queue_entry.temp_iq_entry.FU=cpu->queue_entry.fu;
-            cpu->queue_entry.temp_iq_entry.immediate_literal=cpu->queue_entry.imm;
-            cpu->queue_entry.temp_iq_entry.is_allocated=1;
-            cpu->queue_entry.temp_iq_entry.rob_index=temp_rob_index;
-            cpu->queue_entry.temp_iq_entry.lsq_index=temp_lsq_index;
-            cpu->queue_entry.temp_iq_entry.opcode=cpu->queue_entry.opcode;
-            cpu->queue_entry.temp_iq_entry.pc_value=cpu->queue_entry.pc;
-            cpu->queue_entry.temp_iq_entry.counter=0;
-            cpu->queue_entry.issue_queue_index=temp_iq_index;
-            cpu->queue_entry.temp_rob_entry.insn_type=cpu->queue_entry.fu;
-
-            if(temp_lsq_index!=100 && temp_lsq_index != -1){
-                cpu->queue_entry.temp_lsq_entry.allocate=1;
-                cpu->queue_entry.temp_lsq_entry.instruction_type=cpu->queue_entry.memory_instruction_type;
-                cpu->queue_entry.temp_lsq_entry.address_valid=0;
-                cpu->queue_entry.temp_lsq_entry.data_ready=0;
-                cpu->queue_entry.temp_lsq_entry.OPCODE=cpu->queue_entry.opcode;
-                cpu->queue_entry.temp_lsq_entry.data_ready=cpu->queue_entry.rs1_ready;
-                cpu->queue_entry.temp_lsq_entry.value_to_be_stored=cpu->queue_entry.rs1_value;
-                cpu->queue_entry.temp_lsq_entry.src1_store=cpu->queue_entry.phy_rs1;
-                cpu->queue_entry.temp_rob_entry.insn_type=3;
-                cpu->queue_entry.temp_lsq_entry.pc_value=cpu->queue_entry.pc;
-                cpu->queue_entry.temp_lsq_entry.phy_destination_address_for_load=cpu->queue_entry.phy_rd;
-                cpu->queue_entry.temp_lsq_entry.destination_address_for_load=cpu->queue_entry.rd;
-            }
-            
-            //check the pc value later
-            cpu->queue_entry.temp_rob_entry.pc_value=cpu->queue_entry.pc;
-            cpu->queue_entry.temp_rob_entry.destination_address=cpu->queue_entry.rd;
-            //check if physical register is corectly populated
-            cpu->queue_entry.temp_rob_entry.physical_register=cpu->queue_entry.phy_rd;
-            cpu->queue_entry.temp_rob_entry.status_bit=0;
-            cpu->queue_entry.temp_rob_entry.store_value_valid=0;
-            cpu->queue_entry.temp_rob_entry.opcode=cpu->queue_entry.opcode;
+        //check the pc value later
+        t->queue_entry.temp_rob_entry.pc_value=t->queue_entry.pc;
+        t->queue_entry.temp_rob_entry.destination_address=t->queue_entry.rd;
+        //check if physical register is corectly populated
+        t->queue_entry.temp_rob_entry.physical_register=t->queue_entry.phy_rd;
+        t->queue_entry.temp_rob_entry.status_bit=0;
+        t->queue_entry.temp_rob_entry.store_value_valid=0;
+        t->queue_entry.temp_rob_entry.opcode=t->queue_entry.opcode;
+        t->queue_entry.temp_rob_entry.seq=t->queue_entry.seq;
+        t->queue_entry.temp_rob_entry.fusion=t->queue_entry.fusion;
+        t->queue_entry.temp_rob_entry.mem_address=t->queue_entry.trace_address;
+        t->queue_entry.temp_rob_entry.trace_next_pc=t->queue_entry.trace_next_pc;
+        t->queue_entry.temp_rob_entry.trace_mispredicted=t->queue_entry.trace_mispredicted;
+        t->queue_entry.temp_rob_entry.predicted_pc=t->queue_entry.predicted_pc;
 
-            //
-        }
-        else{
-            cpu->rename_dispatch.is_stage_stalled=1;
-        } 
         //print_iq_indexes(&cpu->iq);
     int rob_index,lsq_index;
     lsq_index=100;
-        rob_index= reorder_buffer_entry_addition_to_queue(&cpu->rob,&cpu->queue_entry.temp_rob_entry);
-        if(cpu->queue_entry.is_memory_insn){
-            cpu->queue_entry.temp_lsq_entry.rob_index=rob_index;
-            lsq_index=lsq_entry_addition_to_queue(&cpu->lsq,&cpu->queue_entry.temp_lsq_entry);
+        rob_index= reorder_buffer_entry_addition_to_queue(&t->rob,&t->queue_entry.temp_rob_entry);
+        cpu->stats.activity[ACT_ROB_WRITE]++;
+        t->refilling=FALSE;
+        if(t->queue_entry.is_memory_insn){
+            t->queue_entry.temp_lsq_entry.rob_index=rob_index;
+            lsq_index=lsq_entry_addition_to_queue(&t->lsq,&t->queue_entry.temp_lsq_entry);
+            cpu->stats.activity[ACT_LSQ_WRITE]++;
         }
-        cpu->queue_entry.temp_iq_entry.rob_index=rob_index;
-        cpu->queue_entry.temp_iq_entry.lsq_index=lsq_index;
-        iq_entry_addition(&cpu->iq,&cpu->queue_entry.temp_iq_entry,cpu->queue_entry.issue_queue_index);
+        t->queue_entry.temp_iq_entry.rob_index=rob_index;
+        t->queue_entry.temp_iq_entry.lsq_index=lsq_index;
+        iq_entry_addition(&cpu->iq,&t->queue_entry.temp_iq_entry,t->queue_entry.issue_queue_index);
+        cpu->stats.activity[ACT_IQ_WRITE]++;
 
-        printf("IQ + I[%d]\n", (cpu->queue_entry.pc-4000)/4);
+        APEX_DEBUG("IQ + I[%d]\n", (t->queue_entry.pc-4000)/4);
+        TRACE_STAGE(cpu, &t->queue_entry, TRACE_DISPATCH);
 
         //print_rob_entries(&cpu->rob);
         //cpu->process_iq=cpu->queue_entry;
         //printf("%d",cpu->int_fu.imm);
-        cpu->queue_entry.has_insn = FALSE;
+        t->queue_entry.has_insn = FALSE;
     
-    if(cpu->queue_entry.opcode==OPCODE_JALR){
-            create_mri_backup(cpu);
-            create_rename_table_backup(cpu);
+    if(t->queue_entry.opcode==OPCODE_JALR){
+            create_mri_backup(t);
+            create_rename_table_backup(t);
 
     }
         
     //print_iq_entries(&cpu->iq);
     if (ENABLE_DEBUG_MESSAGES)
         {
-            print_stage_content("All queue entry", &cpu->queue_entry);
+            print_stage_content("All queue entry", &t->queue_entry);
         }
     }
 }
 
 void push_information_to_fu(APEX_CPU *cpu, int index, int fu){
+    cpu->stats.activity[ACT_IQ_SELECT]++;
+    //issued on a load that missed: the issue slot is lost and the entry waits for the data
+    if(iq_replay_speculative(&cpu->iq, index)){
+        cpu->stats.load_replays++;
+        APEX_DEBUG("IQ - I[%d] replayed\n", (cpu->iq.issue_queue[index].pc_value-4000)/4);
+        return;
+    }
     switch (fu)
     {
     //addition fu
@@ -791,6 +1450,9 @@ void push_information_to_fu(APEX_CPU *cpu, int index, int fu){
         cpu->int_fu.imm=cpu->iq.issue_queue[index].immediate_literal;
         cpu->iq.issue_queue[index].is_allocated=0;
         cpu->int_fu.pc=cpu->iq.issue_queue[index].pc_value;
+        cpu->int_fu.seq=cpu->iq.issue_queue[index].seq;
+        cpu->int_fu.thread=cpu->iq.issue_queue[index].thread;
+        cpu->int_fu.fusion=cpu->iq.issue_queue[index].fusion;
         break;
     //multiplication fu
     case MUL_FU:
@@ -803,6 +1465,9 @@ void push_information_to_fu(APEX_CPU *cpu, int index, int fu){
         cpu->mul1_fu.has_insn=1;
         cpu->iq.issue_queue[index].is_allocated=0;
         cpu->mul1_fu.pc=cpu->iq.issue_queue[index].pc_value;
+        cpu->mul1_fu.seq=cpu->iq.issue_queue[index].seq;
+        cpu->mul1_fu.thread=cpu->iq.issue_queue[index].thread;
+        cpu->mul1_fu.fusion=cpu->iq.issue_queue[index].fusion;
 
         break;
     //branch fu
@@ -817,36 +1482,121 @@ void push_information_to_fu(APEX_CPU *cpu, int index, int fu){
         cpu->bu_fu.has_insn=1;
         cpu->iq.issue_queue[index].is_allocated=0;
         cpu->bu_fu.pc=cpu->iq.issue_queue[index].pc_value;
+        cpu->bu_fu.seq=cpu->iq.issue_queue[index].seq;
+        cpu->bu_fu.thread=cpu->iq.issue_queue[index].thread;
+        cpu->bu_fu.fusion=cpu->iq.issue_queue[index].fusion;
+        break;
+    //divider
+    case DIV_FU:
+        cpu->div_fu.rs1_value=cpu->iq.issue_queue[index].src1_value;
+        cpu->div_fu.rs2_value=cpu->iq.issue_queue[index].src2_value;
+        cpu->div_fu.phy_rd=cpu->iq.issue_queue[index].dest_tag;
+        cpu->div_fu.rob_index=cpu->iq.issue_queue[index].rob_index;
+        cpu->div_fu.opcode=cpu->iq.issue_queue[index].opcode;
+        cpu->div_fu.cycles=0;
+        cpu->div_fu.has_insn=1;
+        cpu->iq.issue_queue[index].is_allocated=0;
+        cpu->div_fu.pc=cpu->iq.issue_queue[index].pc_value;
+        cpu->div_fu.seq=cpu->iq.issue_queue[index].seq;
+        cpu->div_fu.thread=cpu->iq.issue_queue[index].thread;
+        cpu->div_fu.fusion=cpu->iq.issue_queue[index].fusion;
+        break;
+    //vector fu
+    case VEC_FU:
+        memcpy(cpu->vec_fu.rs1_lanes, cpu->iq.issue_queue[index].src1_lanes, sizeof(cpu->vec_fu.rs1_lanes));
+        memcpy(cpu->vec_fu.rs2_lanes, cpu->iq.issue_queue[index].src2_lanes, sizeof(cpu->vec_fu.rs2_lanes));
+        cpu->vec_fu.phy_rd=cpu->iq.issue_queue[index].dest_tag;
+        cpu->vec_fu.rob_index=cpu->iq.issue_queue[index].rob_index;
+        cpu->vec_fu.opcode=cpu->iq.issue_queue[index].opcode;
+        cpu->vec_fu.cycles=0;
+        cpu->vec_fu.has_insn=1;
+        cpu->iq.issue_queue[index].is_allocated=0;
+        cpu->vec_fu.pc=cpu->iq.issue_queue[index].pc_value;
+        cpu->vec_fu.seq=cpu->iq.issue_queue[index].seq;
+        cpu->vec_fu.thread=cpu->iq.issue_queue[index].thread;
+        cpu->vec_fu.fusion=cpu->iq.issue_queue[index].fusion;
         break;
     default:
         break;
     }
-    printf("IQ - I[%d]\n", (cpu->iq.issue_queue[index].pc_value-4000)/4);
+    APEX_DEBUG("IQ - I[%d]\n", (cpu->iq.issue_queue[index].pc_value-4000)/4);
+    if(cpu->trace){
+        trace_event(cpu->trace, cpu->iq.issue_queue[index].seq, cpu->clock,
+                    cpu->iq.issue_queue[index].pc_value, TRACE_ISSUE, cpu->iq.issue_queue[index].opcode);
+    }
+
+}
+
+//CMP: the CCR value is 0 when equal, 1 when rs1 is greater and -1 otherwise
+static void compare_operands(CPU_Stage *stage){
+    if(stage->rs1_value==stage->rs2_value){
+        stage->zero_flag=1;
+        stage->result_buffer=0;
+    }
+    else if(stage->rs1_value>stage->rs2_value){
+        stage->positive_flag=1;
+        stage->zero_flag=0;
+        stage->result_buffer=1;
+    }
+    else{
+        stage->positive_flag=0;
+        stage->zero_flag=0;
+        stage->result_buffer=-1;
+    }
+}
 
+/*
+ * Running a trace the operands are not the program's, so the branch takes
+ * the trace's outcome; it was mispredicted if decode stopped fetch for it.
+ */
+static void
+trace_branch_outcome(APEX_CPU *cpu, APEX_Thread *t, int btb_index)
+{
+    const reorder_buffer_entry *entry = &t->rob.reorder_buffer_queue[cpu->bu_fu.rob_index];
+
+    cpu->bu_fu.pc_value_to_be_taken = entry->trace_next_pc;
+    cpu->bu_fu.need_to_flush = entry->trace_mispredicted;
+    t->btb[btb_index].is_taken = !is_conditional_branch(cpu->bu_fu.opcode) ||
+                                 entry->trace_next_pc != cpu->bu_fu.pc + 4;
+    t->btb[btb_index].target_address = entry->trace_next_pc;
 }
 
 void APEX_bu_fu(APEX_CPU *cpu){
     if(cpu->bu_fu.has_insn){
-        int btb_index = (cpu->bu_fu.pc-4000)/4;
-        int predicted = cpu->btb[btb_index].is_predicted;
-        int predicted_pc = cpu->btb[btb_index].predicted_pc;
+        APEX_Thread *t = &cpu->thread[cpu->bu_fu.thread];
+        int btb_index = btb_index_of(cpu->bu_fu.pc);
+        int predicted = t->btb[btb_index].is_predicted;
+        int predicted_pc = t->btb[btb_index].predicted_pc;
+
+        //a decoupled front end's prediction travels with the instruction
+        if(ftq_enabled(cpu)){
+            predicted=1;
+            predicted_pc=t->rob.reorder_buffer_queue[cpu->bu_fu.rob_index].predicted_pc;
+        }
 
 
         cpu->bu_fu.need_to_flush=0;
+        cpu->stats.activity[ACT_BRANCH_OP]++;
+        cpu->stats.activity[ACT_BTB_UPDATE]++;
+        //a fused CMP compares first, the branch then tests the result
+        if(cpu->bu_fu.fusion==FUSE_CMP_BRANCH){
+            compare_operands(&cpu->bu_fu);
+            cpu->bu_fu.rs1_value=cpu->bu_fu.result_buffer;
+        }
         switch (cpu->bu_fu.opcode)
         {
             case OPCODE_BZ:
                 if(cpu->bu_fu.rs1_value==0){
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+cpu->bu_fu.imm;
                     cpu->bu_fu.need_to_flush=1;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
                 else{
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+4;
                     cpu->bu_fu.need_to_flush=0;
-                    cpu->btb[btb_index].is_taken=0;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=0;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
 
                 if(predicted==1){
@@ -863,14 +1613,14 @@ void APEX_bu_fu(APEX_CPU *cpu){
                 if(cpu->bu_fu.rs1_value!=0){
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+cpu->bu_fu.imm;
                     cpu->bu_fu.need_to_flush=1;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
                 else{
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+4;
                     cpu->bu_fu.need_to_flush=0;
-                    cpu->btb[btb_index].is_taken=0;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=0;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
 
                 if(predicted==1){
@@ -887,14 +1637,14 @@ void APEX_bu_fu(APEX_CPU *cpu){
                 if(cpu->bu_fu.rs1_value>0){
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+cpu->bu_fu.imm;
                     cpu->bu_fu.need_to_flush=1;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
                 else{
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+4;
                     cpu->bu_fu.need_to_flush=0;
-                    cpu->btb[btb_index].is_taken=0;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=0;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
 
                 if(predicted==1){
@@ -912,14 +1662,14 @@ void APEX_bu_fu(APEX_CPU *cpu){
                 if(cpu->bu_fu.rs1_value<0){
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+cpu->bu_fu.imm;
                     cpu->bu_fu.need_to_flush=1;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
                 else{
                     cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.pc+4;
                     cpu->bu_fu.need_to_flush=0;
-                    cpu->btb[btb_index].is_taken=0;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=0;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 }
 
                 if(predicted==1){
@@ -937,8 +1687,8 @@ void APEX_bu_fu(APEX_CPU *cpu){
             {
                 cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.rs1_value+cpu->bu_fu.imm;
                 cpu->bu_fu.need_to_flush=1;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
 
                 if(predicted==1){
                     if(cpu->bu_fu.pc_value_to_be_taken==predicted_pc){
@@ -958,8 +1708,8 @@ void APEX_bu_fu(APEX_CPU *cpu){
             {
                 cpu->bu_fu.result_buffer=cpu->bu_fu.pc+4;
                 cpu->bu_fu.pc_value_to_be_taken=cpu->bu_fu.rs1_value+cpu->bu_fu.imm;
-                    cpu->btb[btb_index].is_taken=1;
-                    cpu->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
+                    t->btb[btb_index].is_taken=1;
+                    t->btb[btb_index].target_address=cpu->bu_fu.pc_value_to_be_taken;
                 cpu->bu_fu.need_to_flush=1;
                 if(predicted==1){
                     if(cpu->bu_fu.pc_value_to_be_taken==predicted_pc){
@@ -974,25 +1724,22 @@ void APEX_bu_fu(APEX_CPU *cpu){
             }
             case OPCODE_CMP:
             {
-                if(cpu->bu_fu.rs1_value==cpu->bu_fu.rs2_value){
-                    cpu->bu_fu.zero_flag=1;
-                    cpu->bu_fu.result_buffer=0;
-                }
-                else if(cpu->bu_fu.rs1_value>cpu->bu_fu.rs2_value){
-                    cpu->bu_fu.positive_flag=1;
-                    cpu->bu_fu.zero_flag=0;
-                    cpu->bu_fu.result_buffer=1;
-                }
-                else{
-                        cpu->bu_fu.positive_flag=0;
-                        cpu->bu_fu.zero_flag=0;
-                        cpu->bu_fu.result_buffer=-1;
-                }
+                compare_operands(&cpu->bu_fu);
                 break;
             }
             default:
                 break;
         }
+        if(cpu->itrace_in && is_branch_instruction(cpu->bu_fu.opcode)){
+            trace_branch_outcome(cpu, t, btb_index);
+        }
+        TRACE_STAGE(cpu, &cpu->bu_fu, TRACE_COMPLETE);
+        if(is_branch_instruction(cpu->bu_fu.opcode)){
+            cpu->stats.branches_resolved++;
+            if(cpu->bu_fu.need_to_flush){
+                cpu->stats.branch_mispredictions++;
+            }
+        }
         if (ENABLE_DEBUG_MESSAGES)
         {
                 print_stage_content("BU FU", &cpu->bu_fu);
@@ -1006,14 +1753,24 @@ void APEX_bu_fu(APEX_CPU *cpu){
 
 void APEX_bu_fwd(APEX_CPU *cpu){
     if(cpu->bu_fwd.has_insn){
-        if(cpu->bu_fwd.need_to_flush){
-            flush_instructions(cpu,cpu->bu_fwd.rob_index);
-            cpu->pc=cpu->bu_fwd.pc_value_to_be_taken;
-            cpu->fetch.has_insn=TRUE;
+        APEX_Thread *t = &cpu->thread[cpu->bu_fwd.thread];
+
+        //nothing was fetched past a mispredicted branch of a trace
+        if(cpu->bu_fwd.need_to_flush && cpu->itrace_in){
+            cpu->stats.flushes++;
+            t->refilling=TRUE;
+            t->trace_blocked=FALSE;
+        }
+        else if(cpu->bu_fwd.need_to_flush){
+            flush_instructions(cpu, t, cpu->bu_fwd.rob_index);
+            t->pc=cpu->bu_fwd.pc_value_to_be_taken;
+            t->fetch.has_insn=TRUE;
+            ftq_redirect(t);
         }
+        uop_cache_detect_loop(cpu, t, &cpu->bu_fwd);
 
         if(cpu->bu_fwd.opcode!=OPCODE_CMP){
-            cpu->is_branch_unresolved=0;
+            t->is_branch_unresolved=0;
         }
         cpu->branch_writeback=cpu->bu_fwd;
         cpu->bu_fwd.has_insn=FALSE;
@@ -1026,44 +1783,27 @@ void APEX_bu_fwd(APEX_CPU *cpu){
 
 void APEX_branch_writeback(APEX_CPU *cpu){
     if(cpu->branch_writeback.has_insn){
-        if(cpu->branch_writeback.opcode==OPCODE_JALR || cpu->branch_writeback.opcode==OPCODE_CMP){
+        APEX_Thread *t = &cpu->thread[cpu->branch_writeback.thread];
+
+        if(cpu->branch_writeback.opcode==OPCODE_JALR || cpu->branch_writeback.opcode==OPCODE_CMP ||
+           cpu->branch_writeback.fusion==FUSE_CMP_BRANCH){
             cpu->prf.physical_register[cpu->branch_writeback.phy_rd].reg_value=cpu->branch_writeback.result_buffer;
+            cpu->stats.activity[ACT_PRF_WRITE]++;
             cpu->prf.physical_register[cpu->branch_writeback.phy_rd].reg_valid=1;
-            printf("PRF updated for P[%d]\n",cpu->branch_writeback.phy_rd);
-
-            for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
-            if(cpu->iq.issue_queue[i].is_allocated==1){
-                if(!cpu->iq.issue_queue[i].src1_valid){
-                    if(cpu->iq.issue_queue[i].src1_tag==cpu->branch_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src1_value=cpu->branch_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src1_valid=1;
-                    }
-                }
-                if(!cpu->iq.issue_queue[i].src2_valid){
-                    if(cpu->iq.issue_queue[i].src2_tag==cpu->branch_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src2_value=cpu->branch_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src2_valid=1;
-                    }
-                }
-            }
-        }
+            APEX_DEBUG("PRF updated for P[%d]\n",cpu->branch_writeback.phy_rd);
+
+        iq_wakeup(&cpu->iq, cpu->branch_writeback.phy_rd, cpu->branch_writeback.result_buffer);
+        cpu->stats.activity[ACT_IQ_WAKEUP]++;
 
 
 
         //update lsq instruction for which phys_rd is matched
-        for(int i=cpu->lsq.head;i!=cpu->lsq.tail;i=(i+1)%LSQ_SIZE){
-            //if instn is store
-            if(cpu->lsq.load_store_queue[i].OPCODE==OPCODE_STORE){
-                if(!cpu->lsq.load_store_queue[i].data_ready){
-                    if(cpu->lsq.load_store_queue[i].src1_store==cpu->branch_writeback.phy_rd){
-                        cpu->lsq.load_store_queue[i].data_ready=1;
-                        cpu->lsq.load_store_queue[i].value_to_be_stored=cpu->branch_writeback.result_buffer;
-                    }
-                }
-            }
-        }
+        lsq_store_data_wakeup(&t->lsq, cpu->branch_writeback.phy_rd, cpu->branch_writeback.result_buffer);
+        cpu->stats.activity[ACT_LSQ_SEARCH]++;
     }
-    cpu->rob.reorder_buffer_queue[cpu->branch_writeback.rob_index].status_bit=1;
+    t->rob.reorder_buffer_queue[cpu->branch_writeback.rob_index].status_bit=1;
+    cpu->stats.activity[ACT_ROB_WRITE]++;
+    TRACE_STAGE(cpu, &cpu->branch_writeback, TRACE_WRITEBACK);
     cpu->branch_writeback.has_insn=FALSE;
     if (ENABLE_DEBUG_MESSAGES)
         {
@@ -1075,10 +1815,17 @@ void APEX_branch_writeback(APEX_CPU *cpu){
 
 void APEX_int_fu(APEX_CPU *cpu){
     if(cpu->int_fu.has_insn){
+        cpu->stats.activity[ACT_INT_OP]++;
         switch (cpu->int_fu.opcode)
         {
         case OPCODE_ADD:
-            cpu->int_fu.result_buffer=cpu->int_fu.rs1_value+cpu->int_fu.rs2_value;
+            //a fused MOVC supplies the second operand as the immediate
+            if(cpu->int_fu.fusion==FUSE_MOVC_ADD){
+                cpu->int_fu.result_buffer=cpu->int_fu.rs1_value+cpu->int_fu.imm;
+            }
+            else{
+                cpu->int_fu.result_buffer=cpu->int_fu.rs1_value+cpu->int_fu.rs2_value;
+            }
             cpu->int_fu.positive_flag= (cpu->int_fu.result_buffer>0)?1:0;
             cpu->int_fu.zero_flag= (cpu->int_fu.result_buffer==0)?1:0;
             break;
@@ -1113,11 +1860,24 @@ void APEX_int_fu(APEX_CPU *cpu){
             cpu->int_fu.memory_address=cpu->int_fu.rs1_value+cpu->int_fu.imm;
             break;
         case OPCODE_STORE:
+        case OPCODE_VSTORE:
             cpu->int_fu.memory_address=cpu->int_fu.rs2_value+cpu->int_fu.imm;
             break;
+        case OPCODE_VLOAD:
+            cpu->int_fu.memory_address=cpu->int_fu.rs1_value+cpu->int_fu.imm;
+            break;
         default:
             break;
         }
+        //the trace supplies the address, the operands are not the program's
+        if(cpu->itrace_in && is_memory_instruction(cpu->int_fu.opcode)){
+            cpu->int_fu.memory_address=
+                cpu->thread[cpu->int_fu.thread].rob.reorder_buffer_queue[cpu->int_fu.rob_index].mem_address;
+        }
+        //memory instructions complete in the memory stage
+        if(!is_memory_instruction(cpu->int_fu.opcode)){
+            TRACE_STAGE(cpu, &cpu->int_fu, TRACE_COMPLETE);
+        }
         cpu->int_fwd=cpu->int_fu;
         cpu->int_fu.has_insn=FALSE;
         if (ENABLE_DEBUG_MESSAGES)
@@ -1130,16 +1890,18 @@ void APEX_int_fu(APEX_CPU *cpu){
 
 void APEX_int_fwd(APEX_CPU *cpu){
     if(cpu->int_fwd.has_insn){
+        APEX_Thread *t = &cpu->thread[cpu->int_fwd.thread];
 
 
-        if(cpu->int_fwd.opcode==OPCODE_STORE || cpu->int_fwd.opcode==OPCODE_LOAD){
-            cpu->lsq.load_store_queue[cpu->int_fwd.lsq_index].mem_address  = cpu->int_fwd.memory_address;
-            cpu->lsq.load_store_queue[cpu->int_fwd.lsq_index].address_valid = 1;
-            printf("LSQ I[%d] memory address calculated \n",(cpu->int_fwd.pc -4000)/4);
-            printf("calculated address is %d \n",cpu->lsq.load_store_queue[cpu->int_fwd.lsq_index].mem_address);
+        if(is_memory_instruction(cpu->int_fwd.opcode)){
+            t->lsq.load_store_queue[cpu->int_fwd.lsq_index].mem_address  = cpu->int_fwd.memory_address;
+            t->lsq.load_store_queue[cpu->int_fwd.lsq_index].address_valid = 1;
+            t->rob.reorder_buffer_queue[cpu->int_fwd.rob_index].mem_address = cpu->int_fwd.memory_address;
+            APEX_DEBUG("LSQ I[%d] memory address calculated \n",(cpu->int_fwd.pc -4000)/4);
+            APEX_DEBUG("calculated address is %d \n",t->lsq.load_store_queue[cpu->int_fwd.lsq_index].mem_address);
         }
 
-        if(cpu->int_fwd.opcode!=OPCODE_STORE && cpu->int_fwd.opcode!=OPCODE_LOAD){
+        if(!is_memory_instruction(cpu->int_fwd.opcode)){
             cpu->int_writeback=cpu->int_fwd;
         }
         cpu->int_fwd.has_insn=FALSE;
@@ -1152,8 +1914,29 @@ void APEX_int_fwd(APEX_CPU *cpu){
 
 }
 
+/* Lane i of a vector access lies inside data memory, lanes outside it are not accessed */
+static int vector_lane_in_memory(const CPU_Stage *stage, int lane){
+    return stage->memory_address+lane>=0 && stage->memory_address+lane<DATA_MEMORY_SIZE;
+}
+
+//writes a vector result and hands it to the IQ and to the stores waiting for it
+static void write_vector_result(APEX_CPU *cpu, APEX_Thread *t, const CPU_Stage *stage){
+    vector_register_content *reg=vector_register(cpu, stage->phy_rd);
+
+    memcpy(reg->lanes, stage->result_lanes, sizeof(reg->lanes));
+    reg->reg_valid=1;
+    cpu->stats.activity[ACT_PRF_WRITE]+=cpu->vector_length;
+    APEX_DEBUG("VRF updated for VP[%d]\n", stage->phy_rd-VECTOR_TAG_BASE);
+    iq_vector_wakeup(&cpu->iq, stage->phy_rd, stage->result_lanes);
+    cpu->stats.activity[ACT_IQ_WAKEUP]++;
+    lsq_vector_data_wakeup(&t->lsq, stage->phy_rd, stage->result_lanes);
+    cpu->stats.activity[ACT_LSQ_SEARCH]++;
+}
+
 void APEX_memory_fwd(APEX_CPU *cpu){
     if(cpu->memory_fwd.has_insn){
+        APEX_Thread *t = &cpu->thread[cpu->memory_fwd.thread];
+
         // for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
         //     if(cpu->iq.issue_queue[i].is_allocated==1){
         //         if(!cpu->iq.issue_queue[i].src1_valid){
@@ -1182,14 +1965,34 @@ void APEX_memory_fwd(APEX_CPU *cpu){
         //         }
         //     }
         // }
-        if(cpu->memory_fwd.opcode==OPCODE_STORE){
-            cpu->data_memory[cpu->memory_fwd.memory_address]=cpu->memory_fwd.result_buffer;
-            printf("data[%d]=%d\n", cpu->memory_fwd.memory_address,cpu->data_memory[cpu->memory_fwd.memory_address]);
-            cpu->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].status_bit=1;
-            printf("ROB I[%d] status bit updated\n",(cpu->memory_fwd.pc -4000)/4);
+        if(cpu->memory_fwd.opcode==OPCODE_VSTORE){
+            if(!cpu->shared_memory && !cpu->itrace_in){
+                for(int i=0;i<cpu->vector_length;i++){
+                    if(vector_lane_in_memory(&cpu->memory_fwd, i)){
+                        cpu->data_memory[cpu->memory_fwd.memory_address+i]=cpu->memory_fwd.rs1_lanes[i];
+                    }
+                }
+            }
+            memcpy(t->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].store_lanes, cpu->memory_fwd.rs1_lanes,
+                   sizeof(cpu->memory_fwd.rs1_lanes));
+        }
+        if(opcode_info_of(cpu->memory_fwd.opcode)->memory==STORE_INS){
+            //a trace's stores change nothing, its loads read 0
+            if(!cpu->shared_memory && !cpu->itrace_in && cpu->memory_fwd.opcode==OPCODE_STORE){
+                cpu->data_memory[cpu->memory_fwd.memory_address]=cpu->memory_fwd.result_buffer;
+                APEX_DEBUG("data[%d]=%d\n", cpu->memory_fwd.memory_address,cpu->data_memory[cpu->memory_fwd.memory_address]);
+            }
+            //address and data of the store, reported to the co-simulation checker at commit
+            t->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].result_value=cpu->memory_fwd.memory_address;
+            t->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].store_value=cpu->memory_fwd.result_buffer;
+            t->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].store_value_valid=1;
+            t->rob.reorder_buffer_queue[cpu->memory_fwd.rob_index].status_bit=1;
+            cpu->stats.activity[ACT_ROB_WRITE]++;
+            APEX_DEBUG("ROB I[%d] status bit updated\n",(cpu->memory_fwd.pc -4000)/4);
+            TRACE_STAGE(cpu, &cpu->memory_fwd, TRACE_WRITEBACK);
             //cpu->lsq.head=(cpu->lsq.head+1)%LSQ_SIZE;
         }
-        if(cpu->memory_fwd.opcode==OPCODE_LOAD){
+        if(opcode_info_of(cpu->memory_fwd.opcode)->memory==LOAD_INS){
             cpu->mem_writeback=cpu->memory_fwd;
         }
         cpu->memory_fwd.has_insn=FALSE;
@@ -1203,69 +2006,52 @@ void APEX_memory_fwd(APEX_CPU *cpu){
 
 static int APEX_int_writeback(APEX_CPU *cpu){
     if(cpu->int_writeback.has_insn){
+        APEX_Thread *t = &cpu->thread[cpu->int_writeback.thread];
 
         if(cpu->int_writeback.opcode==OPCODE_HALT){
-            cpu->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].status_bit=1;
-            printf("Halting the CPU\n");
+            t->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].status_bit=1;
+            cpu->stats.activity[ACT_ROB_WRITE]++;
+            APEX_DEBUG("Halting the CPU\n");
             goto last;
         }
 
-        if(cpu->int_writeback.opcode!=OPCODE_STORE && cpu->int_writeback.opcode!=OPCODE_LOAD){
+        if(!is_memory_instruction(cpu->int_writeback.opcode)){
             cpu->prf.physical_register[cpu->int_writeback.phy_rd].reg_value=cpu->int_writeback.result_buffer;
+            cpu->stats.activity[ACT_PRF_WRITE]++;
             cpu->prf.physical_register[cpu->int_writeback.phy_rd].positive_flag=cpu->int_writeback.positive_flag;
             cpu->prf.physical_register[cpu->int_writeback.phy_rd].zero_flag=cpu->int_writeback.zero_flag;
             cpu->prf.physical_register[cpu->int_writeback.phy_rd].reg_valid=1;
 
-            printf("PRF updated for P[%d]\n",cpu->int_writeback.phy_rd);
+            APEX_DEBUG("PRF updated for P[%d]\n",cpu->int_writeback.phy_rd);
         }
-        if(cpu->int_writeback.opcode==OPCODE_STORE || cpu->int_writeback.opcode==OPCODE_LOAD){
-            cpu->lsq.load_store_queue[cpu->int_writeback.lsq_index].mem_address=cpu->int_writeback.memory_address;
-            cpu->lsq.load_store_queue[cpu->int_writeback.lsq_index].address_valid=1;
+        if(is_memory_instruction(cpu->int_writeback.opcode)){
+            t->lsq.load_store_queue[cpu->int_writeback.lsq_index].mem_address=cpu->int_writeback.memory_address;
+            t->lsq.load_store_queue[cpu->int_writeback.lsq_index].address_valid=1;
+            cpu->stats.activity[ACT_LSQ_WRITE]++;
         }
         //if instn is add addl sub subl
         if(cpu->int_writeback.opcode==OPCODE_ADDL || cpu->int_writeback.opcode==OPCODE_SUBL || cpu->int_writeback.opcode==OPCODE_SUB || cpu->int_writeback.opcode==OPCODE_ADD){
-            printf("after the result zero flag is %d\n",cpu->prf.physical_register[cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register].positive_flag);
-            printf("after the result positive flag is %d\n",cpu->prf.physical_register[cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register].zero_flag);
+            APEX_DEBUG("after the result zero flag is %d\n",cpu->prf.physical_register[t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register].positive_flag);
+            APEX_DEBUG("after the result positive flag is %d\n",cpu->prf.physical_register[t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].mapped_to_physical_register].zero_flag);
         }
 
 
-        for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
-            if(cpu->iq.issue_queue[i].is_allocated==1){
-                if(!cpu->iq.issue_queue[i].src1_valid){
-                    if(cpu->iq.issue_queue[i].src1_tag==cpu->int_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src1_value=cpu->int_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src1_valid=1;
-                    }
-                }
-                if(!cpu->iq.issue_queue[i].src2_valid){
-                    if(cpu->iq.issue_queue[i].src2_tag==cpu->int_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src2_value=cpu->int_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src2_valid=1;
-                    }
-                }
-            }
-        }
+        iq_wakeup(&cpu->iq, cpu->int_writeback.phy_rd, cpu->int_writeback.result_buffer);
+        cpu->stats.activity[ACT_IQ_WAKEUP]++;
         //update lsq instruction for which phys_rd is matched
-        for(int i=cpu->lsq.head;i!=cpu->lsq.tail;i=(i+1)%LSQ_SIZE){
-            //if instn is store
-            if(cpu->lsq.load_store_queue[i].OPCODE==OPCODE_STORE){
-                if(!cpu->lsq.load_store_queue[i].data_ready){
-                    if(cpu->lsq.load_store_queue[i].src1_store==cpu->int_writeback.phy_rd){
-                        cpu->lsq.load_store_queue[i].data_ready=1;
-                        cpu->lsq.load_store_queue[i].value_to_be_stored=cpu->int_writeback.result_buffer;
-                    }
-                }
-            }
-        }
+        lsq_store_data_wakeup(&t->lsq, cpu->int_writeback.phy_rd, cpu->int_writeback.result_buffer);
+        cpu->stats.activity[ACT_LSQ_SEARCH]++;
     cpu->rob_commit=cpu->int_writeback;
-    if(cpu->int_writeback.opcode!=OPCODE_STORE && cpu->int_writeback.opcode!=OPCODE_LOAD){
-        cpu->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].status_bit=1;
-        cpu->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].result_value=cpu->int_writeback.result_buffer;
-        cpu->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].positive_flag=cpu->int_writeback.positive_flag;
-        cpu->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].zero_flag=cpu->int_writeback.zero_flag;
+    if(!is_memory_instruction(cpu->int_writeback.opcode)){
+        t->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].status_bit=1;
+        cpu->stats.activity[ACT_ROB_WRITE]++;
+        t->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].result_value=cpu->int_writeback.result_buffer;
+        t->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].positive_flag=cpu->int_writeback.positive_flag;
+        t->rob.reorder_buffer_queue[cpu->int_writeback.rob_index].zero_flag=cpu->int_writeback.zero_flag;
 
     }
 last:
+    TRACE_STAGE(cpu, &cpu->int_writeback, TRACE_WRITEBACK);
     cpu->int_writeback.has_insn=FALSE;
     if (ENABLE_DEBUG_MESSAGES)
         {
@@ -1275,82 +2061,97 @@ last:
     return 0;
 }
 
+//writes a multiplier or divider result to the PRF and ROB and wakes its consumers
+static void write_mul_result(APEX_CPU *cpu, CPU_Stage *stage){
+    APEX_Thread *t = &cpu->thread[stage->thread];
+
+    cpu->prf.physical_register[stage->phy_rd].reg_value=stage->result_buffer;
+    cpu->stats.activity[ACT_PRF_WRITE]++;
+    cpu->prf.physical_register[stage->phy_rd].positive_flag=stage->positive_flag;
+    cpu->prf.physical_register[stage->phy_rd].zero_flag=stage->zero_flag;
+    cpu->prf.physical_register[stage->phy_rd].reg_valid=1;
+    APEX_DEBUG("PRF updated for P[%d]\n",stage->phy_rd);
+
+
+    iq_wakeup(&cpu->iq, stage->phy_rd, stage->result_buffer);
+    cpu->stats.activity[ACT_IQ_WAKEUP]++;
+    //update lsq instruction for which phys_rd is matched
+    lsq_store_data_wakeup(&t->lsq, stage->phy_rd, stage->result_buffer);
+    cpu->stats.activity[ACT_LSQ_SEARCH]++;
+    t->rob.reorder_buffer_queue[stage->rob_index].status_bit=1;
+    cpu->stats.activity[ACT_ROB_WRITE]++;
+    t->rob.reorder_buffer_queue[stage->rob_index].result_value=stage->result_buffer;
+    t->rob.reorder_buffer_queue[stage->rob_index].positive_flag=stage->positive_flag;
+    t->rob.reorder_buffer_queue[stage->rob_index].zero_flag=stage->zero_flag;
+    TRACE_STAGE(cpu, stage, TRACE_WRITEBACK);
+    stage->has_insn=FALSE;
+}
+
 void APEX_mul_writeback(APEX_CPU *cpu){
     if(cpu->mul_writeback.has_insn){
-        cpu->prf.physical_register[cpu->mul_writeback.phy_rd].reg_value=cpu->mul_writeback.result_buffer;
-        cpu->prf.physical_register[cpu->mul_writeback.phy_rd].positive_flag=cpu->mul_writeback.positive_flag;
-        cpu->prf.physical_register[cpu->mul_writeback.phy_rd].zero_flag=cpu->mul_writeback.zero_flag;
-        cpu->prf.physical_register[cpu->mul_writeback.phy_rd].reg_valid=1;
-        printf("PRF updated for P[%d]\n",cpu->mul_writeback.phy_rd);
-
-
-        for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
-            if(cpu->iq.issue_queue[i].is_allocated==1){
-                if(!cpu->iq.issue_queue[i].src1_valid){
-                    if(cpu->iq.issue_queue[i].src1_tag==cpu->mul_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src1_value=cpu->mul_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src1_valid=1;
-                    }
-                }
-                if(!cpu->iq.issue_queue[i].src2_valid){
-                    if(cpu->iq.issue_queue[i].src2_tag==cpu->mul_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src2_value=cpu->mul_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src2_valid=1;
-                    }
-                }
-            }
+        write_mul_result(cpu, &cpu->mul_writeback);
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Multiplication WB", &cpu->mul_writeback);
         }
-        //update lsq instruction for which phys_rd is matched
-        for(int i=cpu->lsq.head;i!=cpu->lsq.tail;i=(i+1)%LSQ_SIZE){
-            //if instn is store
-            if(cpu->lsq.load_store_queue[i].OPCODE==OPCODE_STORE){
-                if(!cpu->lsq.load_store_queue[i].data_ready){
-                    if(cpu->lsq.load_store_queue[i].src1_store==cpu->mul_writeback.phy_rd){
-                        cpu->lsq.load_store_queue[i].data_ready=1;
-                        cpu->lsq.load_store_queue[i].value_to_be_stored=cpu->mul_writeback.result_buffer;
-                    }
-                }
-            }
+    }
+}
+
+void APEX_div_writeback(APEX_CPU *cpu){
+    if(cpu->div_writeback.has_insn){
+        write_mul_result(cpu, &cpu->div_writeback);
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Divider WB", &cpu->div_writeback);
         }
-    cpu->rob.reorder_buffer_queue[cpu->mul_writeback.rob_index].status_bit=1;
-    cpu->rob.reorder_buffer_queue[cpu->mul_writeback.rob_index].result_value=cpu->mul_writeback.result_buffer;
-    cpu->rob.reorder_buffer_queue[cpu->mul_writeback.rob_index].positive_flag=cpu->mul_writeback.positive_flag;
-    cpu->rob.reorder_buffer_queue[cpu->mul_writeback.rob_index].zero_flag=cpu->mul_writeback.zero_flag;
-    cpu->mul_writeback.has_insn=FALSE;
-    if (ENABLE_DEBUG_MESSAGES)
+    }
+}
+
+void APEX_vec_writeback(APEX_CPU *cpu){
+    if(cpu->vec_writeback.has_insn){
+        APEX_Thread *t = &cpu->thread[cpu->vec_writeback.thread];
+
+        write_vector_result(cpu, t, &cpu->vec_writeback);
+        t->rob.reorder_buffer_queue[cpu->vec_writeback.rob_index].status_bit=1;
+        cpu->stats.activity[ACT_ROB_WRITE]++;
+        TRACE_STAGE(cpu, &cpu->vec_writeback, TRACE_WRITEBACK);
+        cpu->vec_writeback.has_insn=FALSE;
+        if (ENABLE_DEBUG_MESSAGES)
         {
-            print_stage_content("Multiplication WB", &cpu->mul_writeback);
+            print_stage_content("Vector WB", &cpu->vec_writeback);
         }
     }
 }
 
+//writes a scalar load's data to the PRF and wakes its dependents
+static void write_load_result(APEX_CPU *cpu, const CPU_Stage *stage){
+    cpu->prf.physical_register[stage->phy_rd].reg_value=stage->result_buffer;
+    cpu->stats.activity[ACT_PRF_WRITE]++;
+    APEX_DEBUG("read from memory data[]= %d\n",stage->result_buffer);
+    cpu->prf.physical_register[stage->phy_rd].reg_valid=1;
+    APEX_DEBUG("PRF updated for P[%d]\n",stage->phy_rd);
+
+    iq_wakeup(&cpu->iq, stage->phy_rd, stage->result_buffer);
+    cpu->stats.activity[ACT_IQ_WAKEUP]++;
+}
+
 void APEX_mem_writeback(APEX_CPU *cpu){
     if(cpu->mem_writeback.has_insn){
-        cpu->prf.physical_register[cpu->mem_writeback.phy_rd].reg_value=cpu->mem_writeback.result_buffer;
-        printf("read from memory data[]= %d\n",cpu->mem_writeback.result_buffer);
-        cpu->prf.physical_register[cpu->mem_writeback.phy_rd].reg_valid=1;
-        printf("PRF updated for P[%d]\n",cpu->mem_writeback.phy_rd);
-
-
-        for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
-            if(cpu->iq.issue_queue[i].is_allocated==1){
-                if(!cpu->iq.issue_queue[i].src1_valid){
-                    if(cpu->iq.issue_queue[i].src1_tag==cpu->mem_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src1_value=cpu->mem_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src1_valid=1;
-                    }
-                }
-                if(!cpu->iq.issue_queue[i].src2_valid){
-                    if(cpu->iq.issue_queue[i].src2_tag==cpu->mem_writeback.phy_rd){
-                        cpu->iq.issue_queue[i].src2_value=cpu->mem_writeback.result_buffer;
-                        cpu->iq.issue_queue[i].src2_valid=1;
-                    }
-                }
-            }
+        APEX_Thread *t = &cpu->thread[cpu->mem_writeback.thread];
+
+        if(cpu->mem_writeback.opcode==OPCODE_VLOAD){
+            write_vector_result(cpu, t, &cpu->mem_writeback);
         }
-        cpu->rob.reorder_buffer_queue[cpu->mem_writeback.rob_index].status_bit=1;
-        cpu->rob.reorder_buffer_queue[cpu->mem_writeback.rob_index].result_value=cpu->mem_writeback.result_buffer;
+        //with load speculation the data was written when it arrived from memory
+        else if(!cpu->load_speculation){
+            write_load_result(cpu, &cpu->mem_writeback);
+        }
+        stats_record_load_latency(&cpu->stats, cpu->clock - cpu->mem_writeback.dispatch_cycle);
+        t->rob.reorder_buffer_queue[cpu->mem_writeback.rob_index].status_bit=1;
+        cpu->stats.activity[ACT_ROB_WRITE]++;
+        t->rob.reorder_buffer_queue[cpu->mem_writeback.rob_index].result_value=cpu->mem_writeback.result_buffer;
         //cpu->lsq.head=(cpu->lsq.head+1)%LSQ_SIZE;
+        TRACE_STAGE(cpu, &cpu->mem_writeback, TRACE_WRITEBACK);
         cpu->mem_writeback.has_insn=FALSE;
         if (ENABLE_DEBUG_MESSAGES)
         {
@@ -1396,16 +2197,11 @@ void APEX_mul_fu_3(APEX_CPU *cpu){
 
 void APEX_mul_fu_4(APEX_CPU *cpu){
     if(cpu->mul4_fu.has_insn){
-        if(cpu->mul4_fu.opcode==OPCODE_MUL){
-            cpu->mul4_fu.result_buffer=cpu->mul4_fu.rs1_value*cpu->mul4_fu.rs2_value;
-            cpu->mul4_fu.positive_flag=(cpu->mul4_fu.result_buffer>0)?1:0;
-            cpu->mul4_fu.zero_flag=(cpu->mul4_fu.result_buffer==0)?1:0;
-        }
-        else{
-            cpu->mul4_fu.result_buffer=cpu->mul4_fu.rs1_value/cpu->mul4_fu.rs2_value;
-            cpu->mul4_fu.positive_flag=(cpu->mul4_fu.result_buffer>0)?1:0;
-            cpu->mul4_fu.zero_flag=(cpu->mul4_fu.result_buffer==0)?1:0;
-        }
+        cpu->stats.activity[ACT_MUL_OP]++;
+        cpu->mul4_fu.result_buffer=cpu->mul4_fu.rs1_value*cpu->mul4_fu.rs2_value;
+        cpu->mul4_fu.positive_flag=(cpu->mul4_fu.result_buffer>0)?1:0;
+        cpu->mul4_fu.zero_flag=(cpu->mul4_fu.result_buffer==0)?1:0;
+        TRACE_STAGE(cpu, &cpu->mul4_fu, TRACE_COMPLETE);
         cpu->mul_fwd=cpu->mul4_fu;
         cpu->mul4_fu.has_insn=FALSE;
         if (ENABLE_DEBUG_MESSAGES)
@@ -1418,7 +2214,7 @@ void APEX_mul_fu_4(APEX_CPU *cpu){
 void APEX_mul_fwd(APEX_CPU *cpu){
     if(cpu->mul_fwd.has_insn){
 
-        if(cpu->mul_fwd.opcode!=OPCODE_STORE && cpu->mul_fwd.opcode!=OPCODE_LOAD){
+        if(!is_memory_instruction(cpu->mul_fwd.opcode)){
             cpu->mul_writeback=cpu->mul_fwd;
         }
         
@@ -1432,16 +2228,121 @@ void APEX_mul_fwd(APEX_CPU *cpu){
 }
 
 
+//bits needed to write the magnitude of value
+static int magnitude_bits(int value){
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+
+    return magnitude ? 32 - __builtin_clz(magnitude) : 0;
+}
+
+/*
+ * Cycles a divide takes: a radix-2 divider produces one quotient bit per
+ * cycle and skips the leading bits the quotient cannot have.
+ */
+static int divide_latency(int dividend, int divisor){
+    int quotient_bits = magnitude_bits(dividend) - magnitude_bits(divisor) + 1;
+
+    if(divisor==0 || quotient_bits<1){
+        return DIV_SETUP_CYCLES;
+    }
+    return DIV_SETUP_CYCLES + quotient_bits;
+}
+
+/*
+ * Divider: not pipelined, it holds a DIV until divide_latency has passed.
+ * Like the vector FU it runs before the IQ selects, and the IQ only
+ * issues a DIV to it while it is free. Dividing by 0 gives 0 and
+ * INT_MIN / -1 wraps to INT_MIN.
+ */
+void APEX_div_fu(APEX_CPU *cpu){
+    if(cpu->div_fu.has_insn){
+        cpu->div_fu.cycles++;
+        if(cpu->div_fu.cycles<divide_latency(cpu->div_fu.rs1_value, cpu->div_fu.rs2_value)){
+            APEX_DEBUG("Divide I[%d] in progress\n", (cpu->div_fu.pc-4000)/4);
+            return;
+        }
+        cpu->stats.activity[ACT_MUL_OP]++;
+        if(cpu->div_fu.rs2_value==0){
+            cpu->div_fu.result_buffer=0;
+        }
+        else if(cpu->div_fu.rs2_value==-1){
+            //negate in unsigned, INT_MIN / -1 would trap the host
+            cpu->div_fu.result_buffer=(int)(0u-(unsigned int)cpu->div_fu.rs1_value);
+        }
+        else{
+            cpu->div_fu.result_buffer=cpu->div_fu.rs1_value/cpu->div_fu.rs2_value;
+        }
+        cpu->div_fu.positive_flag=(cpu->div_fu.result_buffer>0)?1:0;
+        cpu->div_fu.zero_flag=(cpu->div_fu.result_buffer==0)?1:0;
+        TRACE_STAGE(cpu, &cpu->div_fu, TRACE_COMPLETE);
+        cpu->div_writeback=cpu->div_fu;
+        cpu->div_fu.has_insn=FALSE;
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Divider", &cpu->div_fu);
+        }
+    }
+}
+
+/*
+ * Vector FU: all lanes in parallel, the unit is busy for the opcode's
+ * latency. It runs before the IQ selects, so the next vector instruction
+ * can enter the cycle this one leaves.
+ */
+void APEX_vec_fu(APEX_CPU *cpu){
+    if(cpu->vec_fu.has_insn){
+        cpu->vec_fu.cycles++;
+        if(cpu->vec_fu.cycles<opcode_info_of(cpu->vec_fu.opcode)->latency){
+            APEX_DEBUG("Vector I[%d] in progress\n", (cpu->vec_fu.pc-4000)/4);
+            return;
+        }
+        cpu->stats.activity[ACT_VEC_OP]+=cpu->vector_length;
+        memset(cpu->vec_fu.result_lanes, 0, sizeof(cpu->vec_fu.result_lanes));
+        for(int i=0;i<cpu->vector_length;i++){
+            switch (cpu->vec_fu.opcode)
+            {
+            case OPCODE_VADD:
+                cpu->vec_fu.result_lanes[i]=cpu->vec_fu.rs1_lanes[i]+cpu->vec_fu.rs2_lanes[i];
+                break;
+            case OPCODE_VSUB:
+                cpu->vec_fu.result_lanes[i]=cpu->vec_fu.rs1_lanes[i]-cpu->vec_fu.rs2_lanes[i];
+                break;
+            case OPCODE_VMUL:
+                cpu->vec_fu.result_lanes[i]=cpu->vec_fu.rs1_lanes[i]*cpu->vec_fu.rs2_lanes[i];
+                break;
+            default:
+                break;
+            }
+        }
+        TRACE_STAGE(cpu, &cpu->vec_fu, TRACE_COMPLETE);
+        cpu->vec_writeback=cpu->vec_fu;
+        cpu->vec_fu.has_insn=FALSE;
+        if (ENABLE_DEBUG_MESSAGES)
+        {
+            print_stage_content("Vector FU", &cpu->vec_fu);
+        }
+    }
+}
+
 //identify iq index and push information 
 void APEX_process_iq(APEX_CPU *cpu){
     
         int int_iq_index=-1;
         int mul_iq_index=-1;
         int bu_iq_index=-1;
+        int vec_iq_index=-1;
+        int div_iq_index=-1;
         
         int_iq_index = get_iq_index_fu(&cpu->iq, 0);//0 for add
         mul_iq_index = get_iq_index_fu(&cpu->iq, 1);//1  for mul
         bu_iq_index  = get_iq_index_fu(&cpu->iq, 2);//2 for branch
+        //the vector FU and the divider are not pipelined, nothing issues to them while busy
+        if(!cpu->vec_fu.has_insn){
+            vec_iq_index = get_iq_index_fu(&cpu->iq, VEC_FU);
+        }
+        if(!cpu->div_fu.has_insn){
+            div_iq_index = get_iq_index_fu(&cpu->iq, DIV_FU);
+        }
             
         if(int_iq_index>=0){
             push_information_to_fu(cpu, int_iq_index, 0);
@@ -1452,6 +2353,12 @@ void APEX_process_iq(APEX_CPU *cpu){
         if(bu_iq_index>=0){
             push_information_to_fu(cpu, bu_iq_index, 2);
         }
+        if(vec_iq_index>=0){
+            push_information_to_fu(cpu, vec_iq_index, VEC_FU);
+        }
+        if(div_iq_index>=0){
+            push_information_to_fu(cpu, div_iq_index, DIV_FU);
+        }
 }
 
 
@@ -1460,19 +2367,69 @@ void APEX_process_iq(APEX_CPU *cpu){
 
 
 
+/*
+ * Cycles the scheduler expects a load to take: the fixed memory latency,
+ * or an L1 hit when the cores share a memory. On one core that guess is
+ * always right unless load_spec_latency sets a shorter one.
+ */
+static int assumed_load_latency(const APEX_CPU *cpu){
+    if(cpu->load_spec_latency>0){
+        return cpu->load_spec_latency;
+    }
+    return cpu->shared_memory ? cpu->shared_memory->hit_latency : cpu->memory_latency;
+}
+
 void  APEX_memory(APEX_CPU *cpu){
     if(cpu->memory.has_insn){
-        //for load operation
-        if(cpu->memory.cycles==0){
+        //memory access takes memory_access_latency cycles, the last one completes it
+        if(cpu->memory.cycles<cpu->memory_access_latency-1){
+            //a load that misses has woken its dependents when a hit would have completed
+            if(cpu->load_speculation && cpu->memory.opcode==OPCODE_LOAD &&
+               cpu->memory.cycles==assumed_load_latency(cpu)-1){
+                iq_speculative_wakeup(&cpu->iq, cpu->memory.phy_rd);
+                cpu->stats.activity[ACT_IQ_WAKEUP]++;
+                cpu->stats.load_misspeculations++;
+            }
 
             cpu->memory.cycles++;
             cpu->memory.is_stage_stalled=1;
-            printf("Memory I[%d] in progress\n", (cpu->memory.pc-4000)/4);
+            APEX_DEBUG("Memory I[%d] in progress\n", (cpu->memory.pc-4000)/4);
         }
-        else if(cpu->memory.cycles==1){
-            if(cpu->memory.opcode==OPCODE_LOAD)
+        else{
+            if(cpu->memory.opcode==OPCODE_VLOAD)
+            {
+                if(!cpu->shared_memory){
+                    memset(cpu->memory.result_lanes, 0, sizeof(cpu->memory.result_lanes));
+                    for(int i=0;i<cpu->vector_length;i++){
+                        if(!cpu->itrace_in && vector_lane_in_memory(&cpu->memory, i)){
+                            cpu->memory.result_lanes[i]=cpu->data_memory[cpu->memory.memory_address+i];
+                        }
+                    }
+                }
+                cpu->stats.activity[ACT_DMEM_READ]+=cpu->vector_length;
+                cpu->memory.cycles=0;
+                cpu->memory_fwd=cpu->memory;
+                cpu->memory.has_insn=FALSE;
+                cpu->memory.is_stage_stalled=0;
+            }
+            else if(cpu->memory.opcode==OPCODE_VSTORE)
+            {
+                cpu->stats.activity[ACT_DMEM_WRITE]+=cpu->vector_length;
+                cpu->memory.cycles=0;
+                cpu->memory_fwd=cpu->memory;
+                cpu->memory.has_insn=FALSE;
+                cpu->memory.is_stage_stalled=0;
+            }
+            else if(cpu->memory.opcode==OPCODE_LOAD)
             {
-                cpu->memory.result_buffer=cpu->data_memory[cpu->memory.memory_address];
+                //a shared memory access was done when it entered the memory unit
+                if(!cpu->shared_memory){
+                    cpu->memory.result_buffer=cpu->itrace_in ? 0 : cpu->data_memory[cpu->memory.memory_address];
+                }
+                cpu->stats.activity[ACT_DMEM_READ]++;
+                if(cpu->load_speculation){
+                    write_load_result(cpu, &cpu->memory);
+                }
                 cpu->memory.cycles=0;
                 cpu->memory_fwd=cpu->memory;
                 cpu->memory.has_insn=FALSE;
@@ -1480,11 +2437,12 @@ void  APEX_memory(APEX_CPU *cpu){
 
                 //update rob
                 // cpu->rob.reorder_buffer_queue[cpu->memory.rob_index].status_bit=1;
-                cpu->rob.reorder_buffer_queue[cpu->memory.rob_index].result_value=cpu->memory.result_buffer;
+                cpu->thread[cpu->memory.thread].rob.reorder_buffer_queue[cpu->memory.rob_index].result_value=cpu->memory.result_buffer;
             }
             else if(cpu->memory.opcode==OPCODE_STORE)
             {
                 cpu->memory.result_buffer=cpu->memory.rs1_value;
+                cpu->stats.activity[ACT_DMEM_WRITE]++;
                 cpu->memory.cycles=0;
                 cpu->memory_fwd=cpu->memory;
                 cpu->memory.has_insn=FALSE;
@@ -1492,7 +2450,8 @@ void  APEX_memory(APEX_CPU *cpu){
 
                 // cpu->rob.reorder_buffer_queue[cpu->memory.rob_index].status_bit=1;
             }
-            printf("Memory I[%d] completed\n", (cpu->memory.pc-4000)/4);
+            APEX_DEBUG("Memory I[%d] completed\n", (cpu->memory.pc-4000)/4);
+            TRACE_STAGE(cpu, &cpu->memory, TRACE_COMPLETE);
             cpu->memory.has_insn=FALSE;
         }
         if (ENABLE_DEBUG_MESSAGES)
@@ -1502,136 +2461,339 @@ void  APEX_memory(APEX_CPU *cpu){
     }
 }
 
-void push_lsq_instruction_to_memory_fu(APEX_CPU *cpu){
-    load_store_queue lsq=cpu->lsq;
-    if (lsq.load_store_queue[lsq.head].allocate==1 && lsq.load_store_queue[lsq.head].address_valid==1){
-        //if instruction is load =0
-        if(lsq.load_store_queue[lsq.head].instruction_type==0){
-            if(lsq.load_store_queue[lsq.head].address_valid==1){
-                //push instruction to memory function 
-                if(cpu->memory.is_stage_stalled==0){
-                    cpu->memory.has_insn=TRUE;
-                    cpu->memory.memory_address=lsq.load_store_queue[lsq.head].mem_address;
-                    cpu->memory.memory_instruction_type=0;
-                    cpu->memory.opcode=OPCODE_LOAD;
-                    cpu->memory.phy_rd=lsq.load_store_queue[lsq.head].phy_destination_address_for_load;
-                    cpu->memory.rd=lsq.load_store_queue[lsq.head].destination_address_for_load;
-                    cpu->memory.rob_index=lsq.load_store_queue[lsq.head].rob_index;
-                    printf("**************************************\n");
-                    printf("ROB index %d\n", cpu->memory.rob_index);
-                    printf("**************************************\n");
-                    cpu->lsq.load_store_queue[lsq.head].allocate=0;
-                    cpu->memory.pc=lsq.load_store_queue[lsq.head].pc_value;
-                    cpu->lsq.head=(cpu->lsq.head+1)%LSQ_SIZE;
-
-                }
-            }
-        }
-        //if instruction is store =1
-        if(lsq.load_store_queue[lsq.head].instruction_type==1){
-            if(lsq.load_store_queue[lsq.head].address_valid==1  &&
-                lsq.load_store_queue[lsq.head].data_ready ==1 &&
-                lsq.load_store_queue[lsq.head].rob_index == cpu->rob.head){
-                 if(cpu->memory.is_stage_stalled==0){
-                    cpu->memory.has_insn=TRUE;
-                    cpu->memory.memory_address=lsq.load_store_queue[lsq.head].mem_address;
-                    cpu->memory.memory_instruction_type=1;
-                    cpu->memory.opcode=OPCODE_STORE;
-                    //either need to read from physical or architectural register
-                    cpu->memory.phy_rs1=lsq.load_store_queue[lsq.head].src1_store;
-                    cpu->memory.rs1_value=lsq.load_store_queue[lsq.head].value_to_be_stored;
-                    cpu->memory.rob_index=lsq.load_store_queue[lsq.head].rob_index;
-                    printf("**************************************\n");
-                    printf("ROB index %d\n", cpu->memory.rob_index);
-                    printf("**************************************\n");
-                    cpu->lsq.load_store_queue[lsq.head].allocate=0;
-                    cpu->memory.pc=lsq.load_store_queue[lsq.head].pc_value;
-                    cpu->lsq.head=(cpu->lsq.head+1)%LSQ_SIZE;
+/*
+ * Sets how long the access entering the memory unit takes. With a shared
+ * memory the coherence transaction, and so the data access, happens now.
+ */
+static void
+start_memory_access(APEX_CPU *cpu)
+{
+    if(!cpu->shared_memory){
+        cpu->memory_access_latency=cpu->memory_latency;
+    }
+    else if(cpu->memory.opcode==OPCODE_VLOAD || cpu->memory.opcode==OPCODE_VSTORE){
+        //the lanes' transactions overlap, the slowest one sets the latency
+        memset(cpu->memory.result_lanes, 0, sizeof(cpu->memory.result_lanes));
+        cpu->memory_access_latency=1;
+        for(int i=0;i<cpu->vector_length;i++){
+            int latency;
+
+            if(!vector_lane_in_memory(&cpu->memory, i)){
+                continue;
+            }
+            if(cpu->memory.opcode==OPCODE_VLOAD){
+                latency=shared_memory_load(cpu->shared_memory, cpu->core_id, cpu->memory.memory_address+i,
+                                           &cpu->memory.result_lanes[i]);
+            }
+            else{
+                latency=shared_memory_store(cpu->shared_memory, cpu->core_id, cpu->memory.memory_address+i,
+                                            cpu->memory.rs1_lanes[i]);
+            }
+            if(latency>cpu->memory_access_latency){
+                cpu->memory_access_latency=latency;
+            }
+        }
+    }
+    else if(cpu->memory.opcode==OPCODE_LOAD){
+        cpu->memory_access_latency=shared_memory_load(cpu->shared_memory, cpu->core_id,
+                                                      cpu->memory.memory_address, &cpu->memory.result_buffer);
+    }
+    else{
+        cpu->memory_access_latency=shared_memory_store(cpu->shared_memory, cpu->core_id,
+                                                       cpu->memory.memory_address, cpu->memory.rs1_value);
+    }
+}
+
+//starts the access at the head of the thread's LSQ, TRUE if the memory unit took it
+static int push_thread_lsq_to_memory_fu(APEX_CPU *cpu, APEX_Thread *t){
+    load_store_queue_entry *head=&t->lsq.load_store_queue[t->lsq.head];
+
+    if (head->allocate==1 && head->address_valid==1){
+        //if instruction is load =0
+        if(head->instruction_type==0){
+            if(head->address_valid==1){
+                //push instruction to memory function 
+                if(cpu->memory.is_stage_stalled==0){
+                    cpu->memory.has_insn=TRUE;
+                    cpu->memory.memory_address=head->mem_address;
+                    cpu->memory.memory_instruction_type=0;
+                    cpu->memory.opcode=head->OPCODE;
+                    cpu->memory.phy_rd=head->phy_destination_address_for_load;
+                    cpu->memory.rd=head->destination_address_for_load;
+                    cpu->memory.rob_index=head->rob_index;
+                    APEX_DEBUG("**************************************\n");
+                    APEX_DEBUG("ROB index %d\n", cpu->memory.rob_index);
+                    APEX_DEBUG("**************************************\n");
+                    head->allocate=0;
+                    cpu->memory.pc=head->pc_value;
+                    cpu->memory.dispatch_cycle=head->dispatch_cycle;
+                    cpu->memory.seq=head->seq;
+                    t->lsq.head=(t->lsq.head+1)%LSQ_SIZE;
+                    t->lsq.is_full=0;
+                    cpu->memory.thread=t->id;
+                    start_memory_access(cpu);
+                    return TRUE;
+                }
+            }
+        }
+        //if instruction is store =1
+        if(head->instruction_type==1){
+            if(head->address_valid==1  &&
+                head->data_ready ==1 &&
+                head->rob_index == t->rob.head){
+                 if(cpu->memory.is_stage_stalled==0){
+                    cpu->memory.has_insn=TRUE;
+                    cpu->memory.memory_address=head->mem_address;
+                    cpu->memory.memory_instruction_type=1;
+                    cpu->memory.opcode=head->OPCODE;
+                    //either need to read from physical or architectural register
+                    cpu->memory.phy_rs1=head->src1_store;
+                    cpu->memory.rs1_value=head->value_to_be_stored;
+                    memcpy(cpu->memory.rs1_lanes, head->store_lanes, sizeof(head->store_lanes));
+                    cpu->memory.rob_index=head->rob_index;
+                    APEX_DEBUG("**************************************\n");
+                    APEX_DEBUG("ROB index %d\n", cpu->memory.rob_index);
+                    APEX_DEBUG("**************************************\n");
+                    head->allocate=0;
+                    cpu->memory.pc=head->pc_value;
+                    cpu->memory.dispatch_cycle=head->dispatch_cycle;
+                    cpu->memory.seq=head->seq;
+                    t->lsq.head=(t->lsq.head+1)%LSQ_SIZE;
+                    t->lsq.is_full=0;
+                    cpu->memory.thread=t->id;
+                    start_memory_access(cpu);
+                    return TRUE;
+                }
+            }
+        }
+    }
+    return FALSE;
+}
+
+//the memory unit serves the threads' LSQs in turn
+void push_lsq_instruction_to_memory_fu(APEX_CPU *cpu){
+    for(int n=0;n<cpu->num_threads;n++){
+        int i=(cpu->memory_next+n)%cpu->num_threads;
+
+        if(!cpu->thread[i].halted && push_thread_lsq_to_memory_fu(cpu, &cpu->thread[i])){
+            cpu->memory_next=(i+1)%cpu->num_threads;
+            return;
+        }
+    }
+}
+
+
+/* The first instruction of a fused pair retires together with the second */
+static void
+record_fused_commit(APEX_CPU *cpu, APEX_Thread *t, const reorder_buffer_entry *entry)
+{
+    int first_opcode = OPCODE_CMP;
+
+    if (entry->fusion == FUSE_NONE)
+    {
+        return;
+    }
+    if (entry->fusion == FUSE_MOVC_ADD)
+    {
+        first_opcode = OPCODE_MOVC;
+    }
+    else if (entry->fusion == FUSE_ADDL_LOAD)
+    {
+        first_opcode = OPCODE_ADDL;
+    }
+    t->insn_completed++;
+    cpu->insn_completed++;
+    cpu->stats.thread_committed[t->id]++;
+    stats_record_commit(&cpu->stats, first_opcode);
+    stats_record_fusion(&cpu->stats, entry->fusion);
+}
+
+/* Sends a committed instruction to the co-simulation checker */
+static void
+cosim_record_commit(APEX_CPU *cpu, const APEX_Thread *t, const reorder_buffer_entry *entry)
+{
+    cosim_record rec;
+
+    if (!cpu->cosim)
+    {
+        return;
+    }
+    rec.thread = t->id;
+    rec.cycle = cpu->clock + 1;
+    rec.pc = entry->pc_value;
+    rec.opcode = entry->opcode;
+    rec.fusion = entry->fusion;
+    rec.rd = entry->destination_address;
+    rec.value = 0;
+    //the register is freed only by this commit, so it still holds the result
+    if (has_vector_destination(entry->opcode))
+    {
+        memcpy(rec.lanes, vector_register(cpu, entry->physical_register)->lanes, sizeof(rec.lanes));
+    }
+    else if (entry->opcode == OPCODE_VSTORE)
+    {
+        memcpy(rec.lanes, entry->store_lanes, sizeof(rec.lanes));
+    }
+    else if (opcode_info_of(entry->opcode)->operands & OPERAND_RD)
+    {
+        rec.value = cpu->prf.physical_register[entry->physical_register].reg_value;
+    }
+    rec.mem_address = entry->result_value;
+    rec.store_data = entry->store_value;
+    cosim_commit(cpu->cosim, &rec);
+}
+
+/* Appends an instruction thread 0 committed to the recorded trace */
+static void
+itrace_record_instruction(APEX_CPU *cpu, const APEX_Thread *t, int pc, int mem_address)
+{
+    const APEX_Instruction *ins = &t->code_memory[get_code_memory_index_from_pc(pc)];
+    const opcode_info *info = opcode_info_of(ins->opcode);
+    apex_itrace_record rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.pc = pc;
+    rec.opcode = ins->opcode;
+    rec.rd = (info->operands & OPERAND_RD) ? ins->rd : 0;
+    rec.rs1 = (info->operands & OPERAND_RS1) ? ins->rs1 : 0;
+    rec.rs2 = (info->operands & OPERAND_RS2) ? ins->rs2 : 0;
+    rec.imm = (info->operands & OPERAND_IMM) ? ins->imm : 0;
+    rec.mem_address = is_memory_instruction(ins->opcode) ? mem_address : 0;
+    itrace_write(cpu->itrace_out, &rec);
+}
 
-                }
-            }
-        }
+/* Reports a commit to the co-simulation checker and the recorded trace */
+static void
+record_commit(APEX_CPU *cpu, const APEX_Thread *t, const reorder_buffer_entry *entry)
+{
+    cosim_record_commit(cpu, t, entry);
+    if (!cpu->itrace_out || t->id != 0)
+    {
+        return;
+    }
+    //a fused pair is recorded as the two instructions it was fetched as
+    if (entry->fusion != FUSE_NONE)
+    {
+        itrace_record_instruction(cpu, t, entry->pc_value - 4, 0);
     }
+    itrace_record_instruction(cpu, t, entry->pc_value, entry->mem_address);
 }
 
+/* Copies a committed vector register to the VARF and frees it */
+static void
+commit_vector_register(APEX_CPU *cpu, APEX_Thread *t, int vreg, int tag)
+{
+    cpu->stats.activity[ACT_PRF_READ] += cpu->vector_length;
+    memcpy(t->varf[vreg], vector_register(cpu, tag)->lanes, sizeof(t->varf[vreg]));
+    push_free_vector_register(&cpu->vrf, tag);
+    APEX_DEBUG("VARF updates for V[%d]\n", vreg);
+    if (t->vmri[vreg] == tag)
+    {
+        t->vrt[vreg].register_source = 0;
+        APEX_DEBUG("Updating VRT for V[%d]\n", vreg);
+    }
+}
 
-void APEX_rob_commit_writeback(APEX_CPU *cpu){
-    if(cpu->rob_commit_writeback.has_insn){
+void APEX_rob_commit_writeback(APEX_CPU *cpu, APEX_Thread *t){
+    if(t->rob_commit_writeback.has_insn){
+                    if(is_vector_tag(t->rob_commit_writeback.phy_rd)){
+                        commit_vector_register(cpu, t, t->rob_commit_writeback.rd, t->rob_commit_writeback.phy_rd);
+                        t->rob_commit_writeback.has_insn=FALSE;
+                        return;
+                    }
  
 
                     //wrrite the result into the destination  architecture register
-                    cpu->arf.architectural_register_file[cpu->rob_commit_writeback.rd].value=
-                    cpu->prf.physical_register[cpu->rob_commit_writeback.phy_rd].reg_value;
+                    cpu->stats.activity[ACT_PRF_READ]++;
+                    t->arf.architectural_register_file[t->rob_commit_writeback.rd].value=
+                    cpu->prf.physical_register[t->rob_commit_writeback.phy_rd].reg_value;
                     
-                    if( cpu->rob_commit_writeback.opcode==OPCODE_ADD  ||
-                        cpu->rob_commit_writeback.opcode==OPCODE_SUB  ||
-                        cpu->rob_commit_writeback.opcode==OPCODE_ADDL ||
-                        cpu->rob_commit_writeback.opcode==OPCODE_SUBL ||
-                        cpu->rob_commit_writeback.opcode==OPCODE_MUL  ||
-                        cpu->rob_commit_writeback.opcode==OPCODE_DIV){
+                    if(opcode_info_of(t->rob_commit_writeback.opcode)->sets_flags){
                         
-                        //positive flag
-                        cpu->arf.architectural_register_file[cpu->rob_commit_writeback.rd].positive_flag=
-                        cpu->prf.physical_register[cpu->rob_commit_writeback.phy_rd].positive_flag;
-                        //zero flag
-                        cpu->arf.architectural_register_file[cpu->rob_commit_writeback.rd].zero_flag=
-                        cpu->prf.physical_register[cpu->rob_commit_writeback.phy_rd].zero_flag;
+                        //flags follow the value, an eliminated move shares a register whose producer may not set them
+                        t->arf.architectural_register_file[t->rob_commit_writeback.rd].positive_flag=
+                        (t->arf.architectural_register_file[t->rob_commit_writeback.rd].value>0)?1:0;
+                        t->arf.architectural_register_file[t->rob_commit_writeback.rd].zero_flag=
+                        (t->arf.architectural_register_file[t->rob_commit_writeback.rd].value==0)?1:0;
                         //ccr
-                        cpu->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].value= cpu->rob_commit_writeback.rd;
-                        cpu->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].positive_flag=
-                        cpu->arf.architectural_register_file[cpu->rob_commit_writeback.rd].positive_flag;
-                        cpu->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].zero_flag=
-                        cpu->arf.architectural_register_file[cpu->rob_commit_writeback.rd].zero_flag;
+                        t->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].value= t->rob_commit_writeback.rd;
+                        t->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].positive_flag=
+                        t->arf.architectural_register_file[t->rob_commit_writeback.rd].positive_flag;
+                        t->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].zero_flag=
+                        t->arf.architectural_register_file[t->rob_commit_writeback.rd].zero_flag;
 
 
                         
-                        printf("MRA CCR=R[%d]\n",cpu->rob_commit_writeback.rd);
+                        APEX_DEBUG("MRA CCR=R[%d]\n",t->rob_commit_writeback.rd);
 
-                        if(cpu->mri[ARCHITECTURAL_REGISTERS_SIZE]==cpu->rob_commit_writeback.phy_rd ){
-                            cpu->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=0;
-                            printf("Updating RNT for CCR\n");
+                        if(t->mri[ARCHITECTURAL_REGISTERS_SIZE]==t->rob_commit_writeback.phy_rd ){
+                            t->rnt.rename_table[ARCHITECTURAL_REGISTERS_SIZE].register_source=0;
+                            APEX_DEBUG("Updating RNT for CCR\n");
                         }
                     }
+                    //the ADDL folded into a LOAD still names its register as the CCR, no branch reads it
+                    if(t->rob_commit_writeback.fusion==FUSE_ADDL_LOAD){
+                        t->arf.architectural_register_file[ARCHITECTURAL_REGISTERS_SIZE].value= t->rob_commit_writeback.rd;
+                    }
 
                         //free the physical register and add to prf free queue
-                        push_free_physical_registers(&cpu->free_prf_q,cpu->rob_commit_writeback.phy_rd);
+                        push_free_physical_registers(&cpu->free_prf_list,t->rob_commit_writeback.phy_rd);
 
-                        printf("ARF updates for R[%d]\n",cpu->rob_commit_writeback.rd);
+                        APEX_DEBUG("ARF updates for R[%d]\n",t->rob_commit_writeback.rd);
 
-                        if(cpu->mri[cpu->rob_commit_writeback.rd]==cpu->rob_commit_writeback.phy_rd){
-                            cpu->rnt.rename_table[cpu->rob_commit_writeback.rd].register_source=0;
-                            printf("Updating RNT for R[%d]\n",cpu->rob_commit_writeback.rd);
+                        if(t->mri[t->rob_commit_writeback.rd]==t->rob_commit_writeback.phy_rd){
+                            t->rnt.rename_table[t->rob_commit_writeback.rd].register_source=0;
+                            APEX_DEBUG("Updating RNT for R[%d]\n",t->rob_commit_writeback.rd);
                         }
-                        cpu->rob_commit_writeback.has_insn=FALSE;
+                        t->rob_commit_writeback.has_insn=FALSE;
     }
 
 }
 
-int  APEX_rob_commit(APEX_CPU *cpu){
+int  APEX_rob_commit(APEX_CPU *cpu, APEX_Thread *t){
 
-        APEX_rob_commit_writeback(cpu);
-        if(cpu->rob.reorder_buffer_queue[cpu->rob.head].is_allocated){
+        APEX_rob_commit_writeback(cpu, t);
+        if(t->rob.reorder_buffer_queue[t->rob.head].is_allocated){
             //check the instruction type if it is register to register
-            switch (cpu->rob.reorder_buffer_queue[cpu->rob.head].insn_type)
+            switch (t->rob.reorder_buffer_queue[t->rob.head].insn_type)
             {
             //if it is register to register
             case 1:
             case 0:
-                if(cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode==OPCODE_HALT){
+            case VEC_FU:
+            case DIV_FU:
+                if(t->rob.reorder_buffer_queue[t->rob.head].opcode==OPCODE_HALT){
+                    cpu->last_commit_pc=t->rob.reorder_buffer_queue[t->rob.head].pc_value;
+                    t->insn_completed++;
+                    cpu->insn_completed++;
+                    cpu->stats.thread_committed[t->id]++;
+                    stats_record_commit(&cpu->stats, OPCODE_HALT);
+                    TRACE_ROB(cpu, &t->rob.reorder_buffer_queue[t->rob.head], TRACE_COMMIT);
+                    cpu->stats.activity[ACT_ROB_READ]++;
+                    record_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
                     return TRUE;
                 }
-                else if(cpu->rob.reorder_buffer_queue[cpu->rob.head].status_bit){
+                else if(t->rob.reorder_buffer_queue[t->rob.head].status_bit){
 
                     //push the content to rob commt write back 
-                    cpu->rob_commit_writeback.rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address;
-                    cpu->rob_commit_writeback.phy_rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register;
-                    cpu->rob_commit_writeback.opcode=cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode;
-                    cpu->rob_commit_writeback.has_insn=TRUE;
-
-                    printf("ROB commit: I[%d]\n", (cpu->rob.reorder_buffer_queue[cpu->rob.head].pc_value-4000)/4);
+                    t->rob_commit_writeback.rd=t->rob.reorder_buffer_queue[t->rob.head].destination_address;
+                    t->rob_commit_writeback.phy_rd=t->rob.reorder_buffer_queue[t->rob.head].physical_register;
+                    t->rob_commit_writeback.opcode=t->rob.reorder_buffer_queue[t->rob.head].opcode;
+                    t->rob_commit_writeback.fusion=t->rob.reorder_buffer_queue[t->rob.head].fusion;
+                    t->rob_commit_writeback.has_insn=TRUE;
+
+                    APEX_DEBUG("ROB commit: I[%d]\n", (t->rob.reorder_buffer_queue[t->rob.head].pc_value-4000)/4);
+                    t->insn_completed++;
+                    cpu->insn_completed++;
+                    cpu->stats.thread_committed[t->id]++;
+                    stats_record_commit(&cpu->stats, t->rob.reorder_buffer_queue[t->rob.head].opcode);
+                    record_fused_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
+                    TRACE_ROB(cpu, &t->rob.reorder_buffer_queue[t->rob.head], TRACE_COMMIT);
+                    cpu->stats.activity[ACT_ROB_READ]++;
+                    record_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
                     //free the rob entry and change the head
-                    cpu->rob.reorder_buffer_queue[cpu->rob.head].is_allocated=0;
-                    cpu->rob.head=(cpu->rob.head+1)%ROB_SIZE;
+                    cpu->last_commit_pc=t->rob.reorder_buffer_queue[t->rob.head].pc_value;
+                    rob_retire_head(&t->rob);
                 }
                 break;
         
@@ -1689,134 +2851,870 @@ int  APEX_rob_commit(APEX_CPU *cpu){
                 // break;
             //branch insn
             case 2:
-                if(cpu->rob.reorder_buffer_queue[cpu->rob.head].status_bit ){
-                    if(cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode==OPCODE_JALR){
+                if(t->rob.reorder_buffer_queue[t->rob.head].status_bit ){
+                    if(t->rob.reorder_buffer_queue[t->rob.head].opcode==OPCODE_JALR){
+
+                        t->rob_commit_writeback.rd=t->rob.reorder_buffer_queue[t->rob.head].destination_address;
+                        t->rob_commit_writeback.phy_rd=t->rob.reorder_buffer_queue[t->rob.head].physical_register;
+                        t->rob_commit_writeback.opcode=t->rob.reorder_buffer_queue[t->rob.head].opcode;
+                        t->rob_commit_writeback.fusion=t->rob.reorder_buffer_queue[t->rob.head].fusion;
+                        t->rob_commit_writeback.has_insn=TRUE;
+                    }
+
+
+
+                        // //wrrite the result into the destination  architecture register
+                        // cpu->arf.architectural_register_file[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].value=
+                        // cpu->prf.physical_register[cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register].reg_value;
+                        // //free the physical register and add to prf free queue
+                        // push_free_physical_registers(&cpu->free_prf_q,cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register);
+                        // cpu->rnt.rename_table[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].register_source=0;
+
+
+                        //  //update the rename table if the architectural register's most recent value is the same as the physical register
+                        // if(cpu->mri[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address]==cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register){
+                        //     cpu->rnt.rename_table[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].register_source=0;
+                        // }
+                        APEX_DEBUG("ROB commit: I[%d]\n", (t->rob.reorder_buffer_queue[t->rob.head].pc_value-4000)/4);   
+                        t->insn_completed++;
+                        cpu->insn_completed++;
+                        cpu->stats.thread_committed[t->id]++;
+                        stats_record_commit(&cpu->stats, t->rob.reorder_buffer_queue[t->rob.head].opcode);
+                        record_fused_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
+                        TRACE_ROB(cpu, &t->rob.reorder_buffer_queue[t->rob.head], TRACE_COMMIT);
+                        cpu->stats.activity[ACT_ROB_READ]++;
+                        record_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
+                        //free the rob entry and change the head
+                        cpu->last_commit_pc=t->rob.reorder_buffer_queue[t->rob.head].pc_value;
+                        rob_retire_head(&t->rob);
+                }
+                break;
+            //memory insn
+            case 3:
+                if(t->rob.reorder_buffer_queue[t->rob.head].status_bit){
+                    //check if the memory insn is load or store
+                    if(opcode_info_of(t->rob.reorder_buffer_queue[t->rob.head].opcode)->memory==LOAD_INS){
 
-                        cpu->rob_commit_writeback.rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address;
-                        cpu->rob_commit_writeback.phy_rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register;
-                        cpu->rob_commit_writeback.opcode=cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode;
-                        cpu->rob_commit_writeback.has_insn=TRUE;
+                        t->rob_commit_writeback.rd=t->rob.reorder_buffer_queue[t->rob.head].destination_address;
+                        t->rob_commit_writeback.phy_rd=t->rob.reorder_buffer_queue[t->rob.head].physical_register;
+                        t->rob_commit_writeback.opcode=t->rob.reorder_buffer_queue[t->rob.head].opcode;
+                        t->rob_commit_writeback.fusion=t->rob.reorder_buffer_queue[t->rob.head].fusion;
+                        t->rob_commit_writeback.has_insn=TRUE;
+
+                        // cpu->arf.architectural_register_file[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].value=
+                        // cpu->prf.physical_register[cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register].reg_value;
+                        // cpu->free_prf_q.free_physical_registers[cpu->free_prf_q.tail]= cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register;
                     }
+                    APEX_DEBUG("ROB commit: I[%d]\n", (t->rob.reorder_buffer_queue[t->rob.head].pc_value-4000)/4);
+                    t->insn_completed++;
+                    cpu->insn_completed++;
+                    cpu->stats.thread_committed[t->id]++;
+                    stats_record_commit(&cpu->stats, t->rob.reorder_buffer_queue[t->rob.head].opcode);
+                    record_fused_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
+                    TRACE_ROB(cpu, &t->rob.reorder_buffer_queue[t->rob.head], TRACE_COMMIT);
+                    cpu->stats.activity[ACT_ROB_READ]++;
+                    record_commit(cpu, t, &t->rob.reorder_buffer_queue[t->rob.head]);
+                    cpu->last_commit_pc=t->rob.reorder_buffer_queue[t->rob.head].pc_value;
+                    rob_retire_head(&t->rob);
+                    }
+                break;
+            
+            default:
+                break;
+            }
+    }
+    return 0;
+}
+
+/* Puts a thread in its power-on state, keeping its program */
+static void
+reset_thread(APEX_Thread *t, int id)
+{
+    APEX_Instruction *code_memory = t->code_memory;
+    int code_memory_size = t->code_memory_size;
+
+    memset(t, 0, sizeof(APEX_Thread));
+    t->id = id;
+    t->code_memory = code_memory;
+    t->code_memory_size = code_memory_size;
+
+    /* Initialize PC, Registers and all pipeline stages */
+    t->pc = 4000;
+    t->bpu_pc = 4000;
+    for (int j = 0; j < ICACHE_LINES; j++)
+    {
+        t->icache_tag[j] = -1;
+    }
+
+    for (int j=0;j<ARCHITECTURAL_REGISTERS_SIZE+1;j++){
+        t->rnt.rename_table[j].mapped_to_physical_register=-1;
+        t->rnt.rename_table[j].register_source=0;
+    }
+    for (int j=0;j<VECTOR_REGISTERS_SIZE;j++){
+        t->vrt[j].mapped_to_physical_register=NO_PHYSICAL_REGISTER;
+        t->vrt[j].register_source=0;
+    }
+
+    /* To start fetch stage */
+    t->fetch.has_insn = TRUE;
+}
+
+/*
+ * Divides the issue queue as config says, see iq_configure. The queues must
+ * be empty, as they are before the first cycle.
+ */
+void
+APEX_cpu_set_issue_queues(APEX_CPU *cpu, const issue_queue_config *config)
+{
+    cpu->iq.config = *config;
+    cpu->stats.num_issue_queues = config->num_queues;
+    for (int q = 0; q < MAX_ISSUE_QUEUES; q++)
+    {
+        cpu->stats.iq_queue_classes[q] = 0;
+        cpu->stats.iq_queue_size[q] = q < config->num_queues ? config->size[q] : 0;
+    }
+    for (int fu = 0; fu < NUM_FU_CLASSES; fu++)
+    {
+        if (config->queue_of_fu[fu] >= 0)
+        {
+            cpu->stats.iq_queue_classes[config->queue_of_fu[fu]] |= 1ULL << fu;
+        }
+    }
+}
+
+/*
+ * Puts the CPU back in its power-on state: PC at 4000, empty pipeline and
+ * queues, cleared registers, data memory and counters. The programs, the
+ * hardware threads and the run options are kept.
+ */
+void
+APEX_cpu_reset(APEX_CPU *cpu)
+{
+    APEX_Instruction *code_memory[SMT_MAX_THREADS];
+    int code_memory_size[SMT_MAX_THREADS];
+    APEX_CPU *idle_snapshot = cpu->idle_snapshot;
+    apex_trace_writer *trace = cpu->trace;
+    const char *stats_file = cpu->stats_file;
+    int stats_format = cpu->stats_format;
+    apex_energy_model *energy = cpu->energy;
+    int single_step = cpu->single_step;
+    int memory_latency = cpu->memory_latency;
+    int idle_skip = cpu->idle_skip;
+    apex_shared_memory *shared_memory = cpu->shared_memory;
+    int core_id = cpu->core_id;
+    int num_threads = cpu->num_threads;
+    int fetch_policy = cpu->fetch_policy;
+    int rob_partition = cpu->rob_partition;
+    int lsq_partition = cpu->lsq_partition;
+    int fusion_pairs = cpu->fusion_pairs;
+    int rename_elimination = cpu->rename_elimination;
+    int load_speculation = cpu->load_speculation;
+    int load_spec_latency = cpu->load_spec_latency;
+    int uop_cache = cpu->uop_cache;
+    int decoupled_front_end = cpu->decoupled_front_end;
+    int icache_latency = cpu->icache_latency;
+    int print_cpi_stack = cpu->print_cpi_stack;
+    int vector_length = cpu->vector_length;
+    issue_queue_config iq_config = cpu->iq.config;
+    apex_itrace_reader *itrace_in = cpu->itrace_in;
+    const char *itrace_file = cpu->itrace_file;
+    apex_itrace_writer *itrace_out = cpu->itrace_out;
+
+    for (int i = 0; i < SMT_MAX_THREADS; i++)
+    {
+        code_memory[i] = cpu->thread[i].code_memory;
+        code_memory_size[i] = cpu->thread[i].code_memory_size;
+    }
+    //the checker's model would no longer match the program's start
+    cosim_destroy(cpu->cosim);
+    memset(cpu, 0, sizeof(APEX_CPU));
+    cpu->idle_snapshot = idle_snapshot;
+    cpu->trace = trace;
+    cpu->stats_file = stats_file;
+    cpu->stats_format = stats_format;
+    cpu->energy = energy;
+    cpu->single_step = single_step;
+    cpu->memory_latency = memory_latency;
+    cpu->idle_skip = idle_skip;
+    cpu->shared_memory = shared_memory;
+    cpu->core_id = core_id;
+    cpu->num_threads = num_threads ? num_threads : 1;
+    cpu->fetch_policy = fetch_policy;
+    cpu->rob_partition = rob_partition;
+    cpu->lsq_partition = lsq_partition;
+    cpu->fusion_pairs = fusion_pairs;
+    cpu->rename_elimination = rename_elimination;
+    cpu->load_speculation = load_speculation;
+    cpu->load_spec_latency = load_spec_latency;
+    cpu->uop_cache = uop_cache;
+    cpu->decoupled_front_end = decoupled_front_end;
+    cpu->icache_latency = icache_latency;
+    cpu->print_cpi_stack = print_cpi_stack;
+    cpu->vector_length = vector_length;
+    cpu->stats.num_threads = cpu->num_threads;
+    APEX_cpu_set_issue_queues(cpu, &iq_config);
+    //a trace is read from its start again
+    if (itrace_in)
+    {
+        itrace_close(itrace_in);
+        itrace_in = itrace_open(itrace_file);
+    }
+    cpu->itrace_in = itrace_in;
+    cpu->itrace_file = itrace_file;
+    cpu->itrace_out = itrace_out;
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        cpu->thread[i].code_memory = code_memory[i];
+        cpu->thread[i].code_memory_size = code_memory_size[i];
+        reset_thread(&cpu->thread[i], i);
+    }
+    cpu->last_commit_pc = -1;
+
+    //Initialization of free physiical registers
+    init_free_physical_registers(&cpu->free_prf_list);
+    init_vector_registers(&cpu->vrf);
+}
+
+/*
+ * Creates a CPU running the given program. The CPU takes ownership of
+ * code_memory, it is freed by APEX_cpu_stop or here on failure.
+ */
+APEX_CPU *APEX_cpu_init_from_code(APEX_Instruction *code_memory, int code_memory_size)
+{
+    int i;
+    APEX_CPU *cpu;
+    APEX_Thread *t;
+
+    if (!code_memory)
+    {
+        return NULL;
+    }
+
+    cpu = calloc(1, sizeof(APEX_CPU));
+    if (!cpu)
+    {
+        free(code_memory);
+        return NULL;
+    }
+    cpu->idle_snapshot = malloc(sizeof(APEX_CPU));
+    if (!cpu->idle_snapshot)
+    {
+        free(code_memory);
+        free(cpu);
+        return NULL;
+    }
+
+    t = &cpu->thread[0];
+    t->code_memory = code_memory;
+    t->code_memory_size = code_memory_size;
+    cpu->num_threads = 1;
+    cpu->single_step = ENABLE_SINGLE_STEP;
+    cpu->memory_latency = DATA_MEMORY_LATENCY;
+    cpu->idle_skip = ENABLE_IDLE_SKIP;
+    cpu->fusion_pairs = FUSION_PAIRS;
+    cpu->rename_elimination = ENABLE_RENAME_ELIMINATION;
+    cpu->load_speculation = ENABLE_LOAD_SPECULATION;
+    cpu->load_spec_latency = LOAD_SPEC_LATENCY;
+    cpu->uop_cache = ENABLE_UOP_CACHE;
+    cpu->decoupled_front_end = ENABLE_DECOUPLED_FRONT_END;
+    cpu->icache_latency = ICACHE_MISS_LATENCY;
+    cpu->vector_length = VECTOR_LENGTH;
+    //a build whose ISSUE_QUEUE_SIZE is too small for the topology falls back to one queue
+    if (iq_configure(&cpu->iq.config, ISSUE_QUEUE_TOPOLOGY) != 0)
+    {
+        iq_configure(&cpu->iq.config, "unified");
+    }
+    APEX_cpu_reset(cpu);
+
+    if (ENABLE_DEBUG_MESSAGES)
+    {
+        fprintf(stderr,
+                "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
+                t->code_memory_size);
+        fprintf(stderr, "APEX_CPU: PC initialized to %d\n", t->pc);
+        fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
+        printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
+               "imm");
+
+        for (i = 0; i < t->code_memory_size; ++i)
+        {
+            printf("%-9s %-9d %-9d %-9d %-9d\n", t->code_memory[i].opcode_str,
+                   t->code_memory[i].rd, t->code_memory[i].rs1,
+                   t->code_memory[i].rs2, t->code_memory[i].imm);
+        }
+    }
+    return cpu;
+}
+
+APEX_CPU *APEX_cpu_init(const char *filename)
+{
+    APEX_Instruction *code_memory;
+    int code_memory_size;
+
+    if (!filename)
+    {
+        return NULL;
+    }
+
+    /* Parse input file and create code memory */
+    code_memory = create_code_memory(filename, &code_memory_size);
+    return APEX_cpu_init_from_code(code_memory, code_memory_size);
+}
+
+/*
+ * Creates a CPU running the instruction trace in filename, see
+ * apex_itrace.h. Fetch streams the trace in place of code memory, which
+ * only holds the HALT ending the run. Returns NULL if the file is not an
+ * instruction trace.
+ */
+APEX_CPU *APEX_cpu_init_from_trace(const char *filename)
+{
+    APEX_Instruction *code_memory;
+    apex_itrace_reader *reader;
+    APEX_CPU *cpu;
+
+    reader = itrace_open(filename);
+    if (!reader)
+    {
+        return NULL;
+    }
+    code_memory = calloc(1, sizeof(APEX_Instruction));
+    if (!code_memory)
+    {
+        itrace_close(reader);
+        return NULL;
+    }
+    strcpy(code_memory->opcode_str, "HALT");
+    code_memory->opcode = OPCODE_HALT;
+    cpu = APEX_cpu_init_from_code(code_memory, 1);
+    if (!cpu)
+    {
+        itrace_close(reader);
+        return NULL;
+    }
+    cpu->itrace_in = reader;
+    cpu->itrace_file = filename;
+    return cpu;
+}
+
+/*
+ * Adds a hardware thread running the program in filename and resets the
+ * CPU. Returns the thread's index, or -1 if the program cannot be loaded or
+ * every thread is in use.
+ */
+int APEX_cpu_add_thread(APEX_CPU *cpu, const char *filename)
+{
+    APEX_Instruction *code_memory;
+    int code_memory_size;
+
+    if (!filename || cpu->num_threads >= SMT_MAX_THREADS)
+    {
+        return -1;
+    }
+    code_memory = create_code_memory(filename, &code_memory_size);
+    return APEX_cpu_add_thread_from_code(cpu, code_memory, code_memory_size);
+}
+
+/* As APEX_cpu_add_thread, the CPU owns code_memory from here on */
+int APEX_cpu_add_thread_from_code(APEX_CPU *cpu, APEX_Instruction *code_memory,
+                                  int code_memory_size)
+{
+    APEX_Thread *t;
+
+    if (!code_memory)
+    {
+        return -1;
+    }
+    if (cpu->num_threads >= SMT_MAX_THREADS)
+    {
+        free(code_memory);
+        return -1;
+    }
+    t = &cpu->thread[cpu->num_threads++];
+    t->code_memory = code_memory;
+    t->code_memory_size = code_memory_size;
+    APEX_cpu_reset(cpu);
+    return t->id;
+}
+
+/*
+ * Cycles the memory unit still has to spend on its access before the one
+ * that completes it. Only these can be skipped as idle.
+ */
+static int
+memory_cycles_pending(const APEX_CPU *cpu)
+{
+    if (!cpu->memory.has_insn)
+    {
+        return 0;
+    }
+    return cpu->memory_access_latency - 1 - cpu->memory.cycles;
+}
+
+/*
+ * Cycles that can repeat the current one: the memory access still pending,
+ * and none past a line fill, which changes what fetch sees when it completes
+ */
+static int
+idle_cycles_available(const APEX_CPU *cpu)
+{
+    int cycles = memory_cycles_pending(cpu);
+
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        for (int j = 0; j < ICACHE_LINES; j++)
+        {
+            int ready = cpu->thread[i].icache_ready[j];
+
+            if (ready > cpu->clock && ready - cpu->clock - 1 < cycles)
+            {
+                cycles = ready - cpu->clock - 1;
+            }
+        }
+    }
+    return cycles;
+}
+
+/* Nothing is in flight behind the memory unit, so a cycle may be idle */
+static int
+back_end_is_empty(const APEX_CPU *cpu)
+{
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        if (cpu->thread[i].rob_commit_writeback.has_insn)
+        {
+            return FALSE;
+        }
+    }
+    return !cpu->int_fu.has_insn && !cpu->mul1_fu.has_insn && !cpu->mul2_fu.has_insn &&
+           !cpu->mul3_fu.has_insn && !cpu->mul4_fu.has_insn && !cpu->bu_fu.has_insn &&
+           !cpu->int_fwd.has_insn && !cpu->mul_fwd.has_insn && !cpu->bu_fwd.has_insn &&
+           !cpu->memory_fwd.has_insn && !cpu->int_writeback.has_insn &&
+           !cpu->mul_writeback.has_insn && !cpu->mem_writeback.has_insn &&
+           !cpu->branch_writeback.has_insn && !cpu->vec_fu.has_insn && !cpu->vec_writeback.has_insn &&
+           !cpu->div_fu.has_insn && !cpu->div_writeback.has_insn;
+}
+
+/*
+ * Parts of the CPU a cycle can change while it waits on memory with one
+ * thread: not the data memory, only written when an access completes, nor
+ * the other threads. The micro-op cache is left out as well, every fill is
+ * counted in uop_cache_fills. The snapshot covers just these.
+ */
+#define THREAD0_UOP_CACHE offsetof(APEX_CPU, thread[0].uop_cache)
+
+static const struct
+{
+    size_t start;
+    size_t end;
+} idle_regions[] = {
+    {offsetof(APEX_CPU, clock), offsetof(APEX_CPU, data_memory)},
+    {offsetof(APEX_CPU, single_step), THREAD0_UOP_CACHE},
+    {THREAD0_UOP_CACHE + UOP_CACHE_SIZE * sizeof(uop_cache_entry), offsetof(APEX_CPU, thread) + sizeof(APEX_Thread)},
+    {offsetof(APEX_CPU, num_threads), sizeof(APEX_CPU)},
+};
+
+static void
+take_idle_snapshot(APEX_CPU *to, const APEX_CPU *from)
+{
+    for (size_t i = 0; i < sizeof(idle_regions) / sizeof(idle_regions[0]); i++)
+    {
+        memcpy((char *)to + idle_regions[i].start, (const char *)from + idle_regions[i].start,
+               idle_regions[i].end - idle_regions[i].start);
+    }
+}
+
+static int
+same_idle_state(const APEX_CPU *a, const APEX_CPU *b)
+{
+    for (size_t i = 0; i < sizeof(idle_regions) / sizeof(idle_regions[0]); i++)
+    {
+        if (memcmp((const char *)a + idle_regions[i].start, (const char *)b + idle_regions[i].start,
+                   idle_regions[i].end - idle_regions[i].start) != 0)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/*
+ * What a cycle that moves an instruction changes. A cycle that leaves it
+ * as it was is likely idle, and only then is the next one snapshotted.
+ */
+#define IDLE_SIGNATURE_SIZE 16
+
+static void
+idle_signature(const APEX_CPU *cpu, int *sig)
+{
+    const APEX_Thread *t = &cpu->thread[0];
+
+    sig[0] = t->pc;
+    sig[1] = t->fetch.has_insn;
+    sig[2] = t->fetch.pc;
+    sig[3] = t->decode_rename.has_insn;
+    sig[4] = t->decode_rename.pc;
+    sig[5] = t->rename_dispatch.has_insn;
+    sig[6] = t->rename_dispatch.pc;
+    sig[7] = t->queue_entry.has_insn;
+    sig[8] = t->queue_entry.pc;
+    sig[9] = t->rob.tail;
+    sig[10] = t->lsq.tail;
+    sig[11] = t->ftq_count;
+    sig[12] = t->bpu_pc;
+    sig[13] = (int)cpu->next_seq;
+    sig[14] = cpu->insn_completed;
+    sig[15] = back_end_is_empty(cpu);
+}
 
+/*
+ * A cycle is idle when the only state it changed is the memory unit's cycle
+ * count, the issue queue age counters and the performance counters. Every
+ * cycle after it repeats it until the memory access completes, so those
+ * cycles are accounted without simulating them.
+ */
+static void
+skip_idle_cycles(APEX_CPU *cpu, int max_skip)
+{
+    APEX_CPU *before = cpu->idle_snapshot;
+    int skip = idle_cycles_available(cpu);
+    apex_stats stats_before = before->stats;
+    int age[ISSUE_QUEUE_SIZE];
 
+    if (skip > max_skip)
+    {
+        skip = max_skip;
+    }
+    if (skip <= 0)
+    {
+        return;
+    }
+    before->memory.cycles = cpu->memory.cycles;
+    before->stats = cpu->stats;
+    for (int i = 0; i < ISSUE_QUEUE_SIZE; i++)
+    {
+        age[i] = cpu->iq.issue_queue[i].counter - before->iq.issue_queue[i].counter;
+        before->iq.issue_queue[i].counter = cpu->iq.issue_queue[i].counter;
+    }
+    if (cpu->stats.uop_cache_fills != stats_before.uop_cache_fills || !same_idle_state(before, cpu))
+    {
+        return;
+    }
 
-                        // //wrrite the result into the destination  architecture register
-                        // cpu->arf.architectural_register_file[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].value=
-                        // cpu->prf.physical_register[cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register].reg_value;
-                        // //free the physical register and add to prf free queue
-                        // push_free_physical_registers(&cpu->free_prf_q,cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register);
-                        // cpu->rnt.rename_table[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].register_source=0;
+    APEX_DEBUG("Pipeline idle, clock advanced by %d cycles\n", skip);
+    stats_repeat_cycle(&cpu->stats, &stats_before, skip);
+    cpu->stats.idle_cycles_skipped += skip;
+    for (int i = 0; i < ISSUE_QUEUE_SIZE; i++)
+    {
+        cpu->iq.issue_queue[i].counter += age[i] * skip;
+    }
+    cpu->memory.cycles += skip;
+    cpu->clock += skip;
+}
 
+/* Instructions a thread has between fetch and issue, its ICOUNT priority */
+static int
+thread_icount(APEX_CPU *cpu, const APEX_Thread *t)
+{
+    return t->decode_rename.has_insn + t->rename_dispatch.has_insn + t->queue_entry.has_insn +
+           iq_thread_occupancy(&cpu->iq, t->id);
+}
 
-                        //  //update the rename table if the architectural register's most recent value is the same as the physical register
-                        // if(cpu->mri[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address]==cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register){
-                        //     cpu->rnt.rename_table[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].register_source=0;
-                        // }
-                        printf("ROB commit: I[%d]\n", (cpu->rob.reorder_buffer_queue[cpu->rob.head].pc_value-4000)/4);   
-                        //free the rob entry and change the head
-                        cpu->rob.reorder_buffer_queue[cpu->rob.head].is_allocated=0;
-                        cpu->rob.head=(cpu->rob.head+1)%ROB_SIZE;
-                }
-                break;
-            //memory insn
-            case 3:
-                if(cpu->rob.reorder_buffer_queue[cpu->rob.head].status_bit){
-                    //check if the memory insn is load or store
-                    if(cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode==OPCODE_LOAD){
+/*
+ * Picks the thread that fetches this cycle. Threads whose decode stage can
+ * take an instruction come first: round-robin takes the next of them in
+ * turn, ICOUNT the one with the fewest instructions waiting to issue.
+ * Returns NULL when no thread is fetching.
+ */
+static APEX_Thread *
+select_fetch_thread(APEX_CPU *cpu)
+{
+    APEX_Thread *selected = NULL;
+    APEX_Thread *stalled = NULL;
+    int selected_count = INT_MAX;
 
-                        cpu->rob_commit_writeback.rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address;
-                        cpu->rob_commit_writeback.phy_rd=cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register;
-                        cpu->rob_commit_writeback.opcode=cpu->rob.reorder_buffer_queue[cpu->rob.head].opcode;
-                        cpu->rob_commit_writeback.has_insn=TRUE;
+    for (int n = 0; n < cpu->num_threads; n++)
+    {
+        APEX_Thread *t = &cpu->thread[(cpu->fetch_next + n) % cpu->num_threads];
+        int count;
 
-                        // cpu->arf.architectural_register_file[cpu->rob.reorder_buffer_queue[cpu->rob.head].destination_address].value=
-                        // cpu->prf.physical_register[cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register].reg_value;
-                        // cpu->free_prf_q.free_physical_registers[cpu->free_prf_q.tail]= cpu->rob.reorder_buffer_queue[cpu->rob.head].physical_register;
-                    }
-                    printf("ROB commit: I[%d]\n", (cpu->rob.reorder_buffer_queue[cpu->rob.head].pc_value-4000)/4);
-                    cpu->rob.reorder_buffer_queue[cpu->rob.head].is_allocated=0;
-                    cpu->rob.head=(cpu->rob.head+1)%ROB_SIZE;
-                    }
-                break;
-            
-            default:
-                break;
+        if (t->halted || !t->fetch.has_insn)
+        {
+            continue;
+        }
+        if (t->decode_rename.is_stage_stalled)
+        {
+            if (!stalled)
+            {
+                stalled = t;
             }
+            continue;
+        }
+        if (cpu->fetch_policy == FETCH_POLICY_ROUND_ROBIN)
+        {
+            selected = t;
+            break;
+        }
+        count = thread_icount(cpu, t);
+        if (count < selected_count)
+        {
+            selected = t;
+            selected_count = count;
+        }
     }
-    return 0;
+    /* a stalled thread still goes through fetch so the stall is counted */
+    if (!selected)
+    {
+        selected = stalled;
+    }
+    if (selected)
+    {
+        cpu->fetch_next = (selected->id + 1) % cpu->num_threads;
+    }
+    return selected;
 }
 
-APEX_CPU *APEX_cpu_init(const char *filename)
+/* TRUE while the thread's ROB head is still in the issue queue */
+static int
+head_in_issue_queue(const APEX_CPU *cpu, const APEX_Thread *t)
 {
-    int i;
-    APEX_CPU *cpu;
+    for (int i = 0; i < ISSUE_QUEUE_SIZE; i++)
+    {
+        const issue_queue_entry *entry = &cpu->iq.issue_queue[i];
 
-    if (!filename)
+        if (entry->is_allocated && entry->thread == t->id && entry->rob_index == t->rob.head)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/*
+ * Why a cycle committed nothing, judged from the ROB head of the first
+ * running thread: the head's producers are all older and have committed,
+ * so a head still in the IQ waits on an operand wakeup or a free FU.
+ */
+static int
+commit_stall_cause(const APEX_CPU *cpu)
+{
+    const APEX_Thread *t = &cpu->thread[0];
+    const reorder_buffer_entry *head;
+
+    for (int i = 0; i < cpu->num_threads; i++)
     {
-        return NULL;
+        if (!cpu->thread[i].halted)
+        {
+            t = &cpu->thread[i];
+            break;
+        }
+    }
+    head = &t->rob.reorder_buffer_queue[t->rob.head];
+    if (!head->is_allocated)
+    {
+        if (t->queue_entry.has_insn && t->queue_entry.opcode == OPCODE_RET)
+        {
+            return CPI_RET;
+        }
+        return t->refilling ? CPI_BRANCH_REFILL : CPI_FRONT_END;
+    }
+    if (head_in_issue_queue(cpu, t))
+    {
+        return CPI_OPERANDS;
     }
+    switch (head->insn_type)
+    {
+        case MEM_FU:
+            return CPI_MEMORY;
+        case MUL_FU:
+        case DIV_FU:
+            return CPI_MULTIPLY;
+        default:
+            return CPI_EXECUTE;
+    }
+}
 
-    cpu = calloc(1, sizeof(APEX_CPU));
+static int
+all_threads_halted(const APEX_CPU *cpu)
+{
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        if (!cpu->thread[i].halted)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
 
-    if (!cpu)
+/*
+ * Simulates one clock cycle. When every stage is waiting on the memory unit
+ * up to max_idle_skip further cycles may be accounted without simulating
+ * them. Returns TRUE once HALT has committed.
+ */
+int
+APEX_cpu_cycle(APEX_CPU *cpu, int max_idle_skip)
+{
+    int check_idle;
+    int rob_count = 0;
+    int lsq_count = 0;
+    int iq_count;
+    int iq_queue_counts[MAX_ISSUE_QUEUES];
+    int signature[IDLE_SIGNATURE_SIZE];
+    int committed;
+    APEX_Thread *fetch_thread;
+
+    if (cpu->halted)
     {
-        return NULL;
+        return TRUE;
     }
 
-    /* Initialize PC, Registers and all pipeline stages */
-    cpu->pc = 4000;
-    memset(cpu->arf.architectural_register_file,0,sizeof(architectural_register_content)*ARCHITECTURAL_REGISTERS_SIZE);
-    memset(cpu->prf.physical_register,0,sizeof(physical_register_content)*PHYSICAL_REGISTERS_SIZE);
+    /* with several threads the front end order rotates every cycle, so no cycle repeats */
+    check_idle = cpu->idle_skip && max_idle_skip > 0 && cpu->num_threads == 1 &&
+                 memory_cycles_pending(cpu) > 1 && back_end_is_empty(cpu) && idle_cycles_available(cpu) > 0;
+    if (!check_idle)
+    {
+        cpu->idle_candidate = FALSE;
+    }
+    else
+    {
+        if (cpu->idle_candidate)
+        {
+            take_idle_snapshot(cpu->idle_snapshot, cpu);
+        }
+        idle_signature(cpu, signature);
+    }
 
-    memset(cpu->data_memory, 0, sizeof(int) * DATA_MEMORY_SIZE);
-    memset(cpu->iq.issue_queue,0,sizeof(issue_queue_entry)*ISSUE_QUEUE_SIZE);
-    cpu->single_step = ENABLE_SINGLE_STEP;
-    
-    //Initialization of free physiical registers
-    for (int i=0;i<PHYSICAL_REGISTERS_SIZE;i++){
-        cpu->free_prf_q.free_physical_registers[i]=i;  
+    if (ENABLE_DEBUG_MESSAGES)
+    {
+        printf("--------------------------------------------\n");
+        printf("Clock Cycle #: %d\n", cpu->clock+1);
+        printf("--------------------------------------------\n");
     }
-    cpu->free_prf_q.head=0;
-    cpu->free_prf_q.tail=PHYSICAL_REGISTERS_SIZE-1;
 
-    for (int j=0;j<ARCHITECTURAL_REGISTERS_SIZE+1;j++){
-        cpu->rnt.rename_table[j].mapped_to_physical_register=-1;
-        cpu->rnt.rename_table[j].register_source=0;
+    APEX_branch_writeback(cpu);
+    APEX_int_writeback(cpu);  
+    APEX_mul_writeback(cpu);  
+    APEX_mem_writeback(cpu); 
+    APEX_vec_writeback(cpu);
+    APEX_div_writeback(cpu);
+    committed = cpu->insn_completed;
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        APEX_Thread *t = &cpu->thread[i];
+
+        if (!t->halted && APEX_rob_commit(cpu, t))
+        {
+            t->halted = TRUE;
+            cpu->stats.thread_halt_cycle[i] = cpu->clock + 1;
+        }
+    }
+    cpu->stats.cpi_stack[cpu->insn_completed != committed ? CPI_RETIRING : commit_stall_cause(cpu)]++;
+    merge_released_physical_registers(&cpu->free_prf_list);
+    merge_released_vector_registers(&cpu->vrf);
+    if (all_threads_halted(cpu))
+    {
+        /* Halt in writeback stage */
+        cpu->halted = TRUE;
+        cpu->clock++;
+        cpu->stats.cycles = cpu->clock;
+        return TRUE;
     }
 
-    for (int i=0;i<PHYSICAL_REGISTERS_SIZE;i++){
-        cpu->prf.physical_register[i].reg_valid=0;
-        cpu->prf.physical_register[i].reg_value=0;
+    APEX_bu_fwd(cpu);
+    APEX_memory_fwd(cpu);
+    APEX_int_fwd(cpu);
+    APEX_mul_fwd(cpu);
+    APEX_memory(cpu);
+    push_lsq_instruction_to_memory_fu(cpu);
+    APEX_vec_fu(cpu);
+    APEX_div_fu(cpu);
+    APEX_process_iq(cpu);
+    
+    APEX_bu_fu(cpu);
+    APEX_mul_fu_4(cpu);
+    APEX_mul_fu_3(cpu);
+    APEX_mul_fu_2(cpu);
+    APEX_mul_fu_1(cpu);
+    APEX_int_fu(cpu);
+    //need to add branch funcytion unit here
+    /* every thread has its own front end, the first to dispatch rotates */
+    for (int n = 0; n < cpu->num_threads; n++)
+    {
+        APEX_Thread *t = &cpu->thread[(cpu->clock + n) % cpu->num_threads];
+
+        if (t->halted)
+        {
+            continue;
+        }
+        APEX_queue_entry_addition(cpu, t);
+        APEX_rename_dispatch(cpu, t);
+        APEX_decode_rename(cpu, t);
+        APEX_predict(cpu, t);
     }
-    /* Parse input file and create code memory */
-    cpu->code_memory = create_code_memory(filename, &cpu->code_memory_size);
-    if (!cpu->code_memory)
+    fetch_thread = select_fetch_thread(cpu);
+    if (fetch_thread)
     {
-        free(cpu);
-        return NULL;
+        APEX_fetch(cpu, fetch_thread);
+    }
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        rob_count += rob_occupancy(&cpu->thread[i].rob);
+        lsq_count += lsq_occupancy(&cpu->thread[i].lsq);
+        cpu->stats.ftq_occupancy_sum += cpu->thread[i].ftq_count;
     }
+    iq_count = iq_queue_occupancy(&cpu->iq, iq_queue_counts);
+    stats_sample_occupancy(&cpu->stats, iq_count, rob_count, lsq_count);
+    stats_sample_issue_queues(&cpu->stats, iq_queue_counts);
+    if (check_idle)
+    {
+        int after[IDLE_SIGNATURE_SIZE];
 
+        if (cpu->idle_candidate)
+        {
+            skip_idle_cycles(cpu, max_idle_skip);
+        }
+        idle_signature(cpu, after);
+        cpu->idle_candidate = memcmp(signature, after, sizeof(after)) == 0;
+    }
     if (ENABLE_DEBUG_MESSAGES)
     {
-        fprintf(stderr,
-                "APEX_CPU: Initialized APEX CPU, loaded %d instructions\n",
-                cpu->code_memory_size);
-        fprintf(stderr, "APEX_CPU: PC initialized to %d\n", cpu->pc);
-        fprintf(stderr, "APEX_CPU: Printing Code Memory\n");
-        printf("%-9s %-9s %-9s %-9s %-9s\n", "opcode_str", "rd", "rs1", "rs2",
-               "imm");
+        for (int i = 0; i < cpu->num_threads; i++)
+        {
+            printf("cpu branch unresolved: %d\n", cpu->thread[i].is_branch_unresolved);
+        }
+        //print_lsq_entries(&cpu->lsq);
+        print_reg_file(cpu);
 
-        for (i = 0; i < cpu->code_memory_size; ++i)
+        for (int i = 0; i < cpu->num_threads; i++)
         {
-            printf("%-9s %-9d %-9d %-9d %-9d\n", cpu->code_memory[i].opcode_str,
-                   cpu->code_memory[i].rd, cpu->code_memory[i].rs1,
-                   cpu->code_memory[i].rs2, cpu->code_memory[i].imm);
+            APEX_Thread *t = &cpu->thread[i];
+
+            if(t->rob.reorder_buffer_queue[t->rob.head].is_allocated)
+                printf("ROB head= I[%d] ", (t->rob.reorder_buffer_queue[t->rob.head].pc_value-4000)/4);
+            int temp= (t->rob.tail-1+ROB_SIZE)%ROB_SIZE;
+            if(t->rob.reorder_buffer_queue[temp].is_allocated)
+                printf("ROB tail= I[%d] \n", (t->rob.reorder_buffer_queue[temp].pc_value-4000)/4);
         }
     }
 
-    /* To start fetch stage */
-    cpu->fetch.has_insn = TRUE;
-    return cpu;
+    cpu->clock++;
+    cpu->stats.cycles = cpu->clock;
+    return FALSE;
+}
+
+/* Waits for the co-simulation checker and prints what it found */
+static void
+report_cosim(APEX_CPU *cpu)
+{
+    if (cosim_finish(cpu->cosim))
+    {
+        printf("%s\n", cpu->cosim->report);
+    }
+    else
+    {
+        printf("APEX_Cosim: %llu instructions checked, no divergence\n", cpu->cosim->checked);
+    }
 }
 
 /*
@@ -1827,76 +3725,134 @@ APEX_CPU *APEX_cpu_init(const char *filename)
 void
 APEX_cpu_run(APEX_CPU *cpu)
 {
-    char user_prompt_val;
+    apex_debugger dbg;
 
+    debugger_init(&dbg, cpu->single_step);
+    if (dbg.armed && debugger_should_stop(&dbg, cpu) && debugger_prompt(&dbg, cpu) == DEBUG_QUIT)
+    {
+        printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+        return;
+    }
     while (TRUE)
     {
-        if (ENABLE_DEBUG_MESSAGES)
+        if (APEX_cpu_cycle(cpu, debugger_idle_limit(&dbg, cpu)))
         {
-            printf("--------------------------------------------\n");
-            printf("Clock Cycle #: %d\n", cpu->clock+1);
-            printf("--------------------------------------------\n");
-        }
+            printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+            if (cpu->num_threads > 1)
+            {
+                for (int i = 0; i < cpu->num_threads; i++)
+                {
+                    printf("APEX_CPU: Thread %d: instructions = %d halted at cycle %llu IPC = %.3f\n", i,
+                           cpu->thread[i].insn_completed, cpu->stats.thread_halt_cycle[i],
+                           stats_thread_ipc(&cpu->stats, i));
+                }
+                printf("APEX_CPU: %d threads, %s fetch, combined IPC = %.3f\n", cpu->num_threads,
+                       cpu->fetch_policy == FETCH_POLICY_ICOUNT ? "ICOUNT" : "round-robin",
+                       cpu->clock ? (double)cpu->insn_completed / cpu->clock : 0.0);
+            }
+            if (cpu->fusion_pairs)
+            {
+                printf("APEX_CPU: Fused pairs = %llu (%.1f%% of instructions), ROB/IQ entries saved = %llu\n",
+                       stats_fused_pairs(&cpu->stats), 100.0 * stats_fusion_rate(&cpu->stats),
+                       stats_fused_pairs(&cpu->stats));
+            }
+            if (cpu->rename_elimination)
+            {
+                printf("APEX_CPU: Completed at rename = %llu values, %llu moves\n",
+                       cpu->stats.rename_values, cpu->stats.rename_moves);
+            }
+            if (ftq_enabled(cpu) || cpu->icache_latency)
+            {
+                printf("APEX_CPU: FTQ blocks = %llu (%.2f queued on average), I-cache misses = %llu, "
+                       "prefetches = %llu\n", cpu->stats.ftq_blocks, stats_ftq_occupancy(&cpu->stats),
+                       cpu->stats.icache_misses, cpu->stats.icache_prefetches);
+            }
+            if (cpu->uop_cache)
+            {
+                printf("APEX_CPU: Micro-op cache coverage = %.1f%%, loops = %llu, bubbles removed = %llu\n",
+                       100.0 * stats_uop_cache_coverage(&cpu->stats), cpu->stats.uop_cache_loops,
+                       cpu->stats.uop_cache_bubbles);
+            }
+            if (cpu->energy)
+            {
+                apex_energy_report report;
 
-        APEX_branch_writeback(cpu);
-        APEX_int_writeback(cpu);  
-        APEX_mul_writeback(cpu);  
-        APEX_mem_writeback(cpu); 
-         if (APEX_rob_commit(cpu))
-         {
-             /* Halt in writeback stage */
-            printf("APEX_CPU: Simulation Complete, cycles = %d instructions = %d\n", cpu->clock+1, cpu->insn_completed);
+                energy_compute(cpu->energy, &cpu->stats, cpu->num_threads, &report);
+                energy_print(&report, stdout);
+            }
+            if (cpu->print_cpi_stack)
+            {
+                stats_print_cpi_stack(&cpu->stats, stdout);
+            }
+            if (cpu->cosim)
+            {
+                report_cosim(cpu);
+            }
+            print_reg_file(cpu);
+            print_vector_reg_file(cpu);
+            break;
+        }
+        if (cpu->cosim && cosim_diverged(cpu->cosim))
+        {
+            printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+            report_cosim(cpu);
             print_reg_file(cpu);
             break;
         }
 
-        APEX_bu_fwd(cpu);
-        APEX_memory_fwd(cpu);
-        APEX_int_fwd(cpu);
-        APEX_mul_fwd(cpu);
-        APEX_memory(cpu);
-        push_lsq_instruction_to_memory_fu(cpu);
-        APEX_process_iq(cpu);
-        
-        APEX_bu_fu(cpu);
-        APEX_mul_fu_4(cpu);
-        APEX_mul_fu_3(cpu);
-        APEX_mul_fu_2(cpu);
-        APEX_mul_fu_1(cpu);
-        APEX_int_fu(cpu);
-        //need to add branch funcytion unit here
-        APEX_queue_entry_addition(cpu);
-        APEX_rename_dispatch(cpu);
-        APEX_decode_rename(cpu);
-        APEX_fetch(cpu);
-        printf("cpu branch unresolved: %d\n", cpu->is_branch_unresolved);
-        //print_lsq_entries(&cpu->lsq);
-        print_reg_file(cpu);
-
-        if(cpu->rob.reorder_buffer_queue[cpu->rob.head].is_allocated)
-            printf("ROB head= I[%d] ", (cpu->rob.reorder_buffer_queue[cpu->rob.head].pc_value-4000)/4);
-        int temp= (cpu->rob.tail-1+ROB_SIZE)%ROB_SIZE;
-        if(cpu->rob.reorder_buffer_queue[temp].is_allocated)
-            printf("ROB tail= I[%d] \n", (cpu->rob.reorder_buffer_queue[temp].pc_value-4000)/4);
-
-        //lsq head
-
+        //between stops the only cost is checking the conditions
+        if (dbg.armed && debugger_should_stop(&dbg, cpu) && debugger_prompt(&dbg, cpu) == DEBUG_QUIT)
+        {
+            printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
+            break;
+        }
+    }
+}
 
-        
+/*
+ * Writes the architectural state as text, to compare runs with: the cycle
+ * and instruction counts, each thread's registers (vector registers that
+ * are not all zero) and the data memory words that are not zero.
+ */
+void
+APEX_cpu_dump_state(const APEX_CPU *cpu, FILE *fp)
+{
+    fprintf(fp, "cycles %d\n", cpu->clock);
+    fprintf(fp, "instructions %d\n", cpu->insn_completed);
+    for (int n = 0; n < cpu->num_threads; n++)
+    {
+        const APEX_Thread *t = &cpu->thread[n];
 
-        if (cpu->single_step)
+        for (int i = 0; i <= ARCHITECTURAL_REGISTERS_SIZE; i++)
         {
-            printf("Press any key to advance CPU Clock or <q> to quit:\n");
-            scanf("%c", &user_prompt_val);
+            fprintf(fp, "T%d R%d %d\n", n, i, t->arf.architectural_register_file[i].value);
+        }
+        for (int i = 0; i < VECTOR_REGISTERS_SIZE; i++)
+        {
+            int nonzero = FALSE;
 
-            if ((user_prompt_val == 'Q') || (user_prompt_val == 'q'))
+            for (int j = 0; j < cpu->vector_length; j++)
             {
-                printf("APEX_CPU: Simulation Stopped, cycles = %d instructions = %d\n", cpu->clock, cpu->insn_completed);
-                break;
+                nonzero |= t->varf[i][j] != 0;
+            }
+            if (!nonzero)
+            {
+                continue;
+            }
+            fprintf(fp, "T%d V%d", n, i);
+            for (int j = 0; j < cpu->vector_length; j++)
+            {
+                fprintf(fp, " %d", t->varf[i][j]);
             }
+            fprintf(fp, "\n");
+        }
+    }
+    for (int i = 0; i < DATA_MEMORY_SIZE; i++)
+    {
+        if (cpu->data_memory[i] != 0)
+        {
+            fprintf(fp, "M%d %d\n", i, cpu->data_memory[i]);
         }
-
-        cpu->clock++;
     }
 }
 
@@ -1908,121 +3864,166 @@ APEX_cpu_run(APEX_CPU *cpu)
 void
 APEX_cpu_stop(APEX_CPU *cpu)
 {
-    free(cpu->code_memory);
+    if (cpu->stats_file &&
+        stats_dump_to_file(&cpu->stats, cpu->stats_file, cpu->stats_format) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write stats to %s\n", cpu->stats_file);
+    }
+    trace_close(cpu->trace);
+    itrace_close(cpu->itrace_in);
+    if (itrace_finish(cpu->itrace_out) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to write instruction trace\n");
+    }
+    cosim_destroy(cpu->cosim);
+    free(cpu->energy);
+    for (int i = 0; i < cpu->num_threads; i++)
+    {
+        free(cpu->thread[i].code_memory);
+    }
+    free(cpu->idle_snapshot);
     free(cpu);
 }
 
 
 
 
+//count and trace the wrong path instructions in decode and rename before they are dropped
+void squash_front_end_latches(APEX_CPU *cpu, APEX_Thread *t){
+    if(t->decode_rename.has_insn){
+        cpu->stats.squashed_insns++;
+        TRACE_STAGE(cpu, &t->decode_rename, TRACE_SQUASH);
+    }
+    if(t->rename_dispatch.has_insn){
+        cpu->stats.squashed_insns++;
+        TRACE_STAGE(cpu, &t->rename_dispatch, TRACE_SQUASH);
+    }
+}
+
 //flush all instructions in the previous stages
 
-void flush_instructions(APEX_CPU *cpu, int rob_index){
+void flush_instructions(APEX_CPU *cpu, APEX_Thread *t, int rob_index){
 
-    printf("Flushing instructions\n");
-    printf("---------------------\n");
+    APEX_DEBUG("Flushing instructions\n");
+    APEX_DEBUG("---------------------\n");
+    cpu->stats.flushes++;
+    t->refilling=TRUE;
+    squash_front_end_latches(cpu, t);
+    if(t->queue_entry.has_insn){
+        cpu->stats.squashed_insns++;
+        TRACE_STAGE(cpu, &t->queue_entry, TRACE_SQUASH);
+    }
     //flush all previous stages instructions
 
     // //flush fetch stage
     // cpu->fetch.has_insn=FALSE;
     //flush decode stage
-    cpu->decode_rename.has_insn=FALSE;
-    cpu->decode_rename.is_stage_stalled=FALSE;
+    t->decode_rename.has_insn=FALSE;
+    t->decode_rename.is_stage_stalled=FALSE;
     //flush rename dispatch stage
-    cpu->rename_dispatch.has_insn=FALSE;
-    cpu->rename_dispatch.is_stage_stalled=FALSE;
+    t->rename_dispatch.has_insn=FALSE;
+    t->rename_dispatch.is_stage_stalled=FALSE;
     //flush queue ebtry addition stage
-    cpu->queue_entry.has_insn=FALSE;
-    cpu->queue_entry.is_stage_stalled=FALSE;
+    t->queue_entry.has_insn=FALSE;
+    t->queue_entry.is_stage_stalled=FALSE;
 
     
     //flush rob entries from given rob_index till tail of rob entries 
     //check the condition < rob_index < rob_tail
-    for (int i=rob_index+1;i!=cpu->rob.tail;i=(i+1)%ROB_SIZE){
+    for (int i=(rob_index+1)%ROB_SIZE;i!=t->rob.tail;i=(i+1)%ROB_SIZE){
 
         //btb revert if insn is branch
-        if(is_branch_instruction(cpu->rob.reorder_buffer_queue[i].opcode)){
-            revert_btb_from_backup(cpu,i);      
+        if(is_branch_instruction(t->rob.reorder_buffer_queue[i].opcode)){
+            revert_btb_from_backup(t,i);      
         }
 
         //issue queue entries invalidation");
        for (int j=0; j<ISSUE_QUEUE_SIZE;j++){
-           if(cpu->iq.issue_queue[j].is_allocated&& cpu->iq.issue_queue[j].rob_index==i ){
-               printf("IQ- I[%d] \n,", (cpu->iq.issue_queue[j].pc_value-4000)/4);
+           if(cpu->iq.issue_queue[j].is_allocated&& cpu->iq.issue_queue[j].thread==t->id &&
+              cpu->iq.issue_queue[j].rob_index==i ){
+               APEX_DEBUG("IQ- I[%d] \n,", (cpu->iq.issue_queue[j].pc_value-4000)/4);
                cpu->iq.issue_queue[j].is_allocated=0;
                break;
            }
        }
-        int temp_lsq_index=-1;
-       //delete lsq entry previous to given rob_index
-        for (int j=cpu->lsq.head; j<cpu->lsq.tail;j=(j+1)%LSQ_SIZE){
-            if(cpu->lsq.load_store_queue[j].rob_index==i){
-                temp_lsq_index=j;
-                break;
-            }
+       //delete lsq entry of this rob index and all younger ones
+        lsq_flush_from_rob_index(&t->lsq, i);
+        if(is_vector_tag(t->rob.reorder_buffer_queue[i].physical_register)){
+            rollback_free_vector_register(&cpu->vrf,t->rob.reorder_buffer_queue[i].physical_register);
+            APEX_DEBUG("Vector register %d freed\n", t->rob.reorder_buffer_queue[i].physical_register-VECTOR_TAG_BASE);
+            update_vector_rename_table_with_backup(cpu,t,t->rob.reorder_buffer_queue[i].physical_register);
         }
-        if(temp_lsq_index>0){
-            //mark all lsq entries after given temp_lsq_index as invalid
-            for (int j=temp_lsq_index; j<cpu->lsq.tail;j=(j+1)%LSQ_SIZE){
-                printf("LSQ- I[%d] \n,", (cpu->lsq.load_store_queue[j].pc_value-4000)/4);
-                cpu->lsq.load_store_queue[j].allocate=0;
+        else if(t->rob.reorder_buffer_queue[i].physical_register!=NO_PHYSICAL_REGISTER){
+            //add that physical register to free list head, the CCR register of a CMP is never on it
+            if(t->rob.reorder_buffer_queue[i].physical_register<PHYSICAL_REGISTERS_SIZE){
+                rollback_free_physical_register(&cpu->free_prf_list,t->rob.reorder_buffer_queue[i].physical_register);
             }
-            cpu->lsq.tail=temp_lsq_index;
-        }
-        if(cpu->rob.reorder_buffer_queue[i].physical_register!=100){
-            //add that physical register to free list head
-            cpu->free_prf_q.head=(cpu->free_prf_q.head-1+PHYSICAL_REGISTERS_SIZE)%PHYSICAL_REGISTERS_SIZE;
-            cpu->free_prf_q.free_physical_registers[cpu->free_prf_q.head]=cpu->rob.reorder_buffer_queue[i].physical_register;
 
-            printf("Physical register %d freed\n", cpu->rob.reorder_buffer_queue[i].physical_register);
-            update_rename_table_with_backup(cpu,cpu->rob.reorder_buffer_queue[i].physical_register);
-            set_mri_from_backup(cpu,cpu->rob.reorder_buffer_queue[i].physical_register);
+            APEX_DEBUG("Physical register %d freed\n", t->rob.reorder_buffer_queue[i].physical_register);
+            update_rename_table_with_backup(cpu,t,t->rob.reorder_buffer_queue[i].physical_register);
+            set_mri_from_backup(t,t->rob.reorder_buffer_queue[i].physical_register);
         }
 
         //check every fu entry to chekc whether its rob index is equal to given rob_index
 
-        if(cpu->int_fu.rob_index==i){
+        if(cpu->int_fu.thread==t->id && cpu->int_fu.rob_index==i){
             cpu->int_fu.has_insn=FALSE;
         }
-        if(cpu->mul1_fu.rob_index==i){
+        if(cpu->mul1_fu.thread==t->id && cpu->mul1_fu.rob_index==i){
             cpu->mul1_fu.has_insn=FALSE;
         }
-        if(cpu->mul2_fu.rob_index==i){
+        if(cpu->mul2_fu.thread==t->id && cpu->mul2_fu.rob_index==i){
             cpu->mul2_fu.has_insn=FALSE;
         }
-        if(cpu->mul3_fu.rob_index==i){
+        if(cpu->mul3_fu.thread==t->id && cpu->mul3_fu.rob_index==i){
             cpu->mul3_fu.has_insn=FALSE;
         }
-        if(cpu->mul4_fu.rob_index==i){
+        if(cpu->mul4_fu.thread==t->id && cpu->mul4_fu.rob_index==i){
             cpu->mul4_fu.has_insn=FALSE;
         }
-        if(cpu->memory.rob_index==i){
+        if(cpu->memory.thread==t->id && cpu->memory.rob_index==i){
             cpu->memory.has_insn=FALSE;
         }
         //fwd buses
-        if(cpu->int_fwd.rob_index==i){
+        if(cpu->int_fwd.thread==t->id && cpu->int_fwd.rob_index==i){
             cpu->int_fwd.has_insn=FALSE;
         }
-        if(cpu->mul_fwd.rob_index==i){
+        if(cpu->mul_fwd.thread==t->id && cpu->mul_fwd.rob_index==i){
             cpu->mul_fwd.has_insn=FALSE;
         }
-        if(cpu->memory_fwd.rob_index==i){
+        if(cpu->memory_fwd.thread==t->id && cpu->memory_fwd.rob_index==i){
             cpu->memory_fwd.has_insn=FALSE;
         }
-        if(cpu->int_writeback.rob_index==i){
+        if(cpu->int_writeback.thread==t->id && cpu->int_writeback.rob_index==i){
             cpu->int_writeback.has_insn=FALSE;
         }
-        if(cpu->mul_writeback.rob_index==i){
+        if(cpu->mul_writeback.thread==t->id && cpu->mul_writeback.rob_index==i){
             cpu->mul_writeback.has_insn=FALSE;
         }
-        if(cpu->mem_writeback.rob_index==i){
+        if(cpu->mem_writeback.thread==t->id && cpu->mem_writeback.rob_index==i){
             cpu->mem_writeback.has_insn=FALSE;
         }
+        if(cpu->vec_fu.thread==t->id && cpu->vec_fu.rob_index==i){
+            cpu->vec_fu.has_insn=FALSE;
+        }
+        if(cpu->vec_writeback.thread==t->id && cpu->vec_writeback.rob_index==i){
+            cpu->vec_writeback.has_insn=FALSE;
+        }
+        if(cpu->div_fu.thread==t->id && cpu->div_fu.rob_index==i){
+            cpu->div_fu.has_insn=FALSE;
+        }
+        if(cpu->div_writeback.thread==t->id && cpu->div_writeback.rob_index==i){
+            cpu->div_writeback.has_insn=FALSE;
+        }
         //flush rob entry
-        cpu->rob.reorder_buffer_queue[i].is_allocated=0;
+        if(t->rob.reorder_buffer_queue[i].is_allocated){
+            cpu->stats.squashed_insns++;
+            TRACE_ROB(cpu, &t->rob.reorder_buffer_queue[i], TRACE_SQUASH);
+        }
     }
-    cpu->rob.tail=(rob_index+1)% ROB_SIZE;
-    printf("---------------------\n");
+    //flush rob entries
+    rob_squash_after(&t->rob, rob_index);
+    APEX_DEBUG("---------------------\n");
 }
 
 
@@ -2031,84 +4032,98 @@ void flush_instructions(APEX_CPU *cpu, int rob_index){
 //JUMP and JALR is branch instruction irrespective of the instruction type
 //check if the given instruction is branch instruction
 int is_branch_instruction(int opcode){
-    if(opcode==OPCODE_BNP || opcode==OPCODE_BP || 
-       opcode==OPCODE_BNZ || opcode==OPCODE_BZ || opcode==OPCODE_JUMP || opcode==OPCODE_JALR || opcode==OPCODE_RET){
-        return TRUE;
-    }
-    return FALSE;
+    int control=opcode_info_of(opcode)->control;
+
+    return control==CONTROL_CONDITIONAL || control==CONTROL_UNCONDITIONAL;
 }
 
 
 
 //backup for rename table
-void create_rename_table_backup( APEX_CPU *cpu){
+void create_rename_table_backup(APEX_Thread *t){
     for (int i=0;i<ARCHITECTURAL_REGISTERS_SIZE+1;i++){
-        cpu->rnt_bkp.rename_table[i].mapped_to_physical_register=cpu->rnt.rename_table[i].mapped_to_physical_register;
-        cpu->rnt_bkp.rename_table[i].register_source=cpu->rnt.rename_table[i].register_source;
+        t->rnt_bkp.rename_table[i].mapped_to_physical_register=t->rnt.rename_table[i].mapped_to_physical_register;
+        t->rnt_bkp.rename_table[i].register_source=t->rnt.rename_table[i].register_source;
     }
+    memcpy(t->vrt_bkp, t->vrt, sizeof(t->vrt));
 }
 
 //backup for mri
-void create_mri_backup( APEX_CPU *cpu){
-    for (int i=0;i<ARCHITECTURAL_REGISTERS_SIZE;i++){    
-        cpu->mri_bkp[i]=cpu->mri[i];
+void create_mri_backup(APEX_Thread *t){
+    for (int i=0;i<=ARCHITECTURAL_REGISTERS_SIZE;i++){    
+        t->mri_bkp[i]=t->mri[i];
     }
+    memcpy(t->vmri_bkp, t->vmri, sizeof(t->vmri));
 }
 
 
-void create_btb_backup(APEX_CPU *cpu){
+void create_btb_backup(APEX_Thread *t){
     for (int i=0;i<200;i++){
-        cpu->btb_bkp[i].pc_value=cpu->btb[i].pc_value;
-        cpu->btb_bkp[i].target_address=cpu->btb[i].target_address;
-        cpu->btb_bkp[i].is_taken=cpu->btb[i].is_taken;
-        cpu->btb_bkp[i].is_valid=cpu->btb[i].is_valid;
-        cpu->btb_bkp[i].is_predicted=cpu->btb[i].is_predicted;
-        cpu->btb_bkp[i].predicted_pc=cpu->btb[i].predicted_pc;
+        t->btb_bkp[i].pc_value=t->btb[i].pc_value;
+        t->btb_bkp[i].target_address=t->btb[i].target_address;
+        t->btb_bkp[i].is_taken=t->btb[i].is_taken;
+        t->btb_bkp[i].is_valid=t->btb[i].is_valid;
+        t->btb_bkp[i].is_predicted=t->btb[i].is_predicted;
+        t->btb_bkp[i].predicted_pc=t->btb[i].predicted_pc;
     }
 }
 
-void revert_btb_from_backup(APEX_CPU *cpu, int index){
-    cpu->btb[index].pc_value=cpu->btb_bkp[index].pc_value;
-    cpu->btb[index].target_address=cpu->btb_bkp[index].target_address;
-    cpu->btb[index].is_taken=cpu->btb_bkp[index].is_taken;
-    cpu->btb[index].is_valid=cpu->btb_bkp[index].is_valid;
-    cpu->btb[index].is_predicted=cpu->btb_bkp[index].is_predicted;
-    cpu->btb[index].predicted_pc=cpu->btb_bkp[index].predicted_pc;
+void revert_btb_from_backup(APEX_Thread *t, int index){
+    t->btb[index].pc_value=t->btb_bkp[index].pc_value;
+    t->btb[index].target_address=t->btb_bkp[index].target_address;
+    t->btb[index].is_taken=t->btb_bkp[index].is_taken;
+    t->btb[index].is_valid=t->btb_bkp[index].is_valid;
+    t->btb[index].is_predicted=t->btb_bkp[index].is_predicted;
+    t->btb[index].predicted_pc=t->btb_bkp[index].predicted_pc;
 }
 
 
 //check rename table for physical register and update it with rename table backup
 
-void update_rename_table_with_backup( APEX_CPU *cpu, int physical_register_address){
+void update_rename_table_with_backup(APEX_CPU *cpu, APEX_Thread *t, int physical_register_address){
     for (int i=0;i<ARCHITECTURAL_REGISTERS_SIZE;i++){
-        if(cpu->rnt.rename_table[i].register_source==1){
-            if(cpu->rnt.rename_table[i].mapped_to_physical_register==physical_register_address){
-                cpu->rnt.rename_table[i].mapped_to_physical_register=cpu->rnt_bkp.rename_table[i].mapped_to_physical_register;
-                cpu->rnt.rename_table[i].register_source= 1;
-                if(check_free_physical_register(cpu,cpu->rnt.rename_table[i].mapped_to_physical_register)){
-                    cpu->rnt.rename_table[i].register_source= 0;
+        if(t->rnt.rename_table[i].register_source==1){
+            if(t->rnt.rename_table[i].mapped_to_physical_register==physical_register_address){
+                t->rnt.rename_table[i].mapped_to_physical_register=t->rnt_bkp.rename_table[i].mapped_to_physical_register;
+                t->rnt.rename_table[i].register_source= t->rnt_bkp.rename_table[i].register_source;
+                if(check_free_physical_register(cpu,t->rnt.rename_table[i].mapped_to_physical_register)){
+                    t->rnt.rename_table[i].register_source= 0;
                 }
                 
-                printf("Rename table updated with backup: R[%d]=P[%d]\n",i,cpu->rnt.rename_table[i].mapped_to_physical_register);
+                APEX_DEBUG("Rename table updated with backup: R[%d]=P[%d]\n",i,t->rnt.rename_table[i].mapped_to_physical_register);
             }
         }
     }
 }
 
 
-void set_mri_from_backup( APEX_CPU *cpu, int physical_register_address){
-    cpu->mri_bkp[physical_register_address]=cpu->mri[physical_register_address];
+//vector registers renamed onto a squashed register go back to their mapping at the branch
+void update_vector_rename_table_with_backup(APEX_CPU *cpu, APEX_Thread *t, int tag){
+    for (int i=0;i<VECTOR_REGISTERS_SIZE;i++){
+        if(t->vrt[i].register_source==1 && t->vrt[i].mapped_to_physical_register==tag){
+            t->vrt[i]=t->vrt_bkp[i];
+            if(is_free_vector_register(&cpu->vrf,t->vrt[i].mapped_to_physical_register)){
+                t->vrt[i].register_source=0;
+            }
+            APEX_DEBUG("Vector rename table updated with backup: V[%d]\n",i);
+        }
+        if(t->vmri[i]==tag){
+            t->vmri[i]=t->vmri_bkp[i];
+        }
+    }
+}
+
+//registers whose most recent instance was squashed go back to the one at the branch
+void set_mri_from_backup(APEX_Thread *t, int physical_register_address){
+    for (int i=0;i<=ARCHITECTURAL_REGISTERS_SIZE;i++){
+        if(t->mri[i]==physical_register_address){
+            t->mri[i]=t->mri_bkp[i];
+        }
+    }
 }
 
 
 
 int check_free_physical_register(APEX_CPU *cpu, int physical_register_address){
-
-    //check free physical register queue
-        for (int i=cpu->free_prf_q.head;i!=cpu->free_prf_q.tail;i=(i+1)%PHYSICAL_REGISTERS_SIZE){
-            if(cpu->free_prf_q.free_physical_registers[i]==physical_register_address){
-                return TRUE;
-            }
-        }
-        return FALSE;
+    return is_free_physical_register(&cpu->free_prf_list, physical_register_address);
 }
\ No newline at end of file
@@ -13,6 +13,10 @@
 #include "apex_macros.h"
 #endif
 
+#ifndef _XXYZ_APEX_OPCODES_
+#include "apex_opcodes.h"
+#endif
+
 #ifndef _XXYZ_ISSUE_QUEUE_
 #include "issue_queue.h"
 #endif
@@ -29,6 +33,26 @@
 #include "physical_register.h"
 #endif
 
+#ifndef _XXYZ_APEX_STATS_
+#include "apex_stats.h"
+#endif
+
+#ifndef _XXYZ_APEX_TRACE_
+#include "apex_trace.h"
+#endif
+#ifndef _XXYZ_APEX_COHERENCE_
+#include "apex_coherence.h"
+#endif
+#ifndef _XXYZ_APEX_COSIM_
+#include "apex_cosim.h"
+#endif
+#ifndef _XXYZ_APEX_ENERGY_
+#include "apex_energy.h"
+#endif
+#ifndef _XXYZ_APEX_ITRACE_
+#include "apex_itrace.h"
+#endif
+
 /* Format of an APEX instruction  */
 typedef struct APEX_Instruction
 {
@@ -55,7 +79,6 @@ typedef struct btb_entry{
 typedef struct CPU_Stage
 {
     int pc;
-    char opcode_str[128];
     int opcode;
     int rs1;
     int phy_rs1;
@@ -87,7 +110,18 @@ typedef struct CPU_Stage
     int need_to_flush;
     int insn_type;
     int pc_value_to_be_taken;
-
+    int dispatch_cycle;
+    unsigned int seq;               /* Fetch sequence number, keys the pipeline trace */
+    int thread;                     /* Hardware thread the instruction belongs to */
+    int fusion;                     /* FUSE_* pair folded into this micro-op, FUSE_NONE if single */
+    int vector_operands;            /* OPERAND_* bits naming vector registers */
+    int rs1_lanes[MAX_VECTOR_LENGTH];
+    int rs2_lanes[MAX_VECTOR_LENGTH];
+    int result_lanes[MAX_VECTOR_LENGTH];
+    int trace_next_pc;              /* Running a trace: the record's next_pc */
+    int trace_address;              /* Running a trace: the record's mem_address */
+    int trace_mispredicted;         /* Running a trace: decode predicted a PC other than trace_next_pc */
+    int predicted_pc;               /* Decoupled front end: the PC fetched after it */
 
     load_store_queue_entry temp_lsq_entry;
     reorder_buffer_entry temp_rob_entry;
@@ -95,6 +129,22 @@ typedef struct CPU_Stage
     
 } CPU_Stage;
 
+/* A fetch block the prediction unit queued: fetch takes pc to end, then goes on at next_pc */
+typedef struct ftq_entry
+{
+    int pc;                         /* Next instruction fetch takes from the block */
+    int end;                        /* PC of its last instruction */
+    int next_pc;                    /* Predicted successor of the block */
+} ftq_entry;
+
+/* A decoded instruction in the micro-op cache, see uop_cache_deliver */
+typedef struct uop_cache_entry
+{
+    int valid;
+    int pc;                         /* PC fetch reads it at, the first of a fused pair */
+    CPU_Stage uop;                  /* Decode's output */
+} uop_cache_entry;
+
 ////////ARCHECTURAL_REGISTER_FILE///////////////
 
 typedef struct  architectural_register_content{
@@ -110,28 +160,90 @@ typedef struct archictectural_register_file{
 
 
 
-/* Model of APEX CPU */
-typedef struct APEX_CPU
+/*
+ * State of one hardware thread: its program, front end, branch prediction,
+ * renaming, architectural registers, ROB and LSQ. The threads of a core
+ * share the issue queue, function units, physical registers and memory.
+ */
+typedef struct APEX_Thread
 {
+    int id;                        /* Index in APEX_CPU.thread */
     int pc;                        /* Current program counter */
-    int clock;                     /* Clock cycles elapsed */
-    int insn_completed;            /* Instructions retired */
+    int insn_completed;            /* Instructions retired by this thread */
     int code_memory_size;          /* Number of instruction in the input file */
     APEX_Instruction *code_memory; /* Code Memory */
-    int data_memory[DATA_MEMORY_SIZE]; /* Data Memory */
     int mri[ARCHITECTURAL_REGISTERS_SIZE+1];
     int mri_bkp[ARCHITECTURAL_REGISTERS_SIZE+1];
-    int single_step;               /* Wait for user input after every cycle */
-    int zero_flag;                 /* {TRUE, FALSE} Used by BZ and BNZ to branch */
-    int positive_flag;
     int fetch_from_next_cycle;
     int is_branch_unresolved;
+    int halted;                    /* HALT of this thread has committed */
+    int refilling;                 /* Nothing dispatched since a misprediction flush */
+    int trace_blocked;             /* Running a trace: fetch waits for a mispredicted branch */
+    int loop_start;                /* Loop the stream detector last found, decode caches it */
+    int loop_end;                  /* PC of its backward branch, 0 if none was found */
 
-    /* Pipeline stages */
+    /* Front end and commit stages */
     CPU_Stage fetch;
     CPU_Stage decode_rename;
     CPU_Stage rename_dispatch;
     CPU_Stage queue_entry;
+    CPU_Stage rob_commit_writeback;
+
+    btb_entry btb[200];
+    btb_entry btb_bkp[200];
+
+    archictectural_register_file arf;
+    rename_table_mapping rnt;
+    rename_table_mapping rnt_bkp;
+    load_store_queue lsq;
+    reorder_buffer rob;
+
+    /* Vector registers, renamed like the scalar ones onto APEX_CPU.vrf */
+    int varf[VECTOR_REGISTERS_SIZE][MAX_VECTOR_LENGTH];
+    rename_table_content vrt[VECTOR_REGISTERS_SIZE];
+    rename_table_content vrt_bkp[VECTOR_REGISTERS_SIZE];
+    int vmri[VECTOR_REGISTERS_SIZE];
+    int vmri_bkp[VECTOR_REGISTERS_SIZE];
+
+    uop_cache_entry uop_cache[UOP_CACHE_SIZE]; /* Direct mapped by PC */
+
+    /* Decoupled front end */
+    ftq_entry ftq[FTQ_SIZE];       /* Fetch target queue, oldest block at ftq_head */
+    int ftq_head;
+    int ftq_count;
+    int bpu_pc;                    /* Start of the block the prediction unit predicts next */
+    int icache_tag[ICACHE_LINES];  /* Line held, -1 if none */
+    int icache_ready[ICACHE_LINES];/* Clock its fill completes at */
+} APEX_Thread;
+
+/* Model of APEX CPU */
+typedef struct APEX_CPU
+{
+    int clock;                     /* Clock cycles elapsed */
+    int insn_completed;            /* Instructions retired by all threads */
+    int data_memory[DATA_MEMORY_SIZE]; /* Data Memory */
+    int single_step;               /* Start stopped in the debugger, see apex_debugger.c */
+    int zero_flag;                 /* {TRUE, FALSE} Used by BZ and BNZ to branch */
+    int positive_flag;
+
+    APEX_Thread thread[SMT_MAX_THREADS]; /* Hardware threads, only thread[0] unless SMT */
+    int num_threads;
+    int fetch_policy;               /* FETCH_POLICY_ROUND_ROBIN or FETCH_POLICY_ICOUNT */
+    int rob_partition;              /* PARTITION_STATIC or PARTITION_SHARED */
+    int lsq_partition;
+    int fetch_next;                 /* Thread round-robin fetch tries first */
+    int memory_next;                /* Thread whose LSQ the memory unit serves first */
+    int fusion_pairs;               /* FUSE_* mask of the pairs decode fuses */
+    int rename_elimination;         /* MOVC and register moves complete at rename */
+    int print_cpi_stack;            /* Print the CPI stack at the end of the run */
+    int vector_length;              /* Lanes a vector instruction operates on, at most MAX_VECTOR_LENGTH */
+    int load_speculation;           /* Loads wake their dependents early, see ENABLE_LOAD_SPECULATION */
+    int load_spec_latency;          /* Load latency the scheduler assumes, see LOAD_SPEC_LATENCY */
+    int uop_cache;                  /* Loop bodies skip fetch and decode, see ENABLE_UOP_CACHE */
+    int decoupled_front_end;        /* Prediction runs ahead of fetch, see ENABLE_DECOUPLED_FRONT_END */
+    int icache_latency;             /* Cycles of an instruction cache miss, 0 for no cache */
+
+    /* Pipeline stages */
     CPU_Stage bu_fu;
     CPU_Stage int_fu;
     CPU_Stage mul1_fu;
@@ -147,32 +259,57 @@ typedef struct APEX_CPU
     CPU_Stage int_fwd;
     CPU_Stage mul_fwd;
     CPU_Stage bu_fwd;
-    CPU_Stage rob_commit_writeback;
     CPU_Stage rob_commit;
     CPU_Stage memory_fwd;
     CPU_Stage writeback;
-
-    btb_entry btb[200];
-    btb_entry btb_bkp[200];
+    CPU_Stage vec_fu;
+    CPU_Stage vec_writeback;
+    CPU_Stage div_fu;
+    CPU_Stage div_writeback;
 
     physical_register_file prf;
-    archictectural_register_file arf;
-    free_physical_registers_queue free_prf_q;
-    rename_table_mapping rnt;
-    rename_table_mapping rnt_bkp;
+    free_physical_register_list free_prf_list;
+    vector_register_file vrf;
     issue_queue_buffer iq;
-    load_store_queue lsq;
-    reorder_buffer rob;
-
 
+    apex_stats stats;               /* Performance counters */
+    const char *stats_file;         /* Counters are dumped here on APEX_cpu_stop */
+    int stats_format;               /* STATS_FORMAT_JSON or STATS_FORMAT_CSV */
+    unsigned int next_seq;          /* Sequence number of the next fetched instruction */
+    apex_trace_writer *trace;       /* Pipeline trace, NULL when tracing is disabled */
+    int memory_latency;             /* Cycles taken by a data memory access */
+    int idle_skip;                  /* Jump the clock over idle cycles */
+    struct APEX_CPU *idle_snapshot; /* State before the cycle, used to detect an idle cycle */
+    int idle_candidate;             /* The last cycle moved nothing, snapshot the next one */
+    int memory_access_latency;      /* Cycles taken by the access in the memory unit */
+    apex_shared_memory *shared_memory; /* Coherent memory shared with other cores, NULL if single core */
+    int core_id;                    /* Index of this core in the shared memory */
+    int halted;                     /* HALT has committed in every thread */
+    int last_commit_pc;             /* PC of the most recently committed instruction, -1 if none */
+    apex_cosim *cosim;              /* Co-simulation checker fed every commit, NULL when disabled */
+    apex_energy_model *energy;      /* Energy reported at the end of the run, NULL when disabled */
+    apex_itrace_reader *itrace_in;  /* Instruction trace fetch reads instead of code memory, NULL if none */
+    const char *itrace_file;        /* Its file, reopened when the CPU is reset */
+    apex_itrace_writer *itrace_out; /* Thread 0's commits are recorded here, NULL when not recording */
 } APEX_CPU;
 
 APEX_Instruction *create_code_memory(const char *filename, int *size);
+APEX_Instruction *create_code_memory_from_buffer(const char *program, size_t length, int *size,
+                                                 int *error_line);
 APEX_CPU *APEX_cpu_init(const char *filename);
+APEX_CPU *APEX_cpu_init_from_code(APEX_Instruction *code_memory, int code_memory_size);
+APEX_CPU *APEX_cpu_init_from_trace(const char *filename);
+int APEX_cpu_add_thread(APEX_CPU *cpu, const char *filename);
+int APEX_cpu_add_thread_from_code(APEX_CPU *cpu, APEX_Instruction *code_memory,
+                                  int code_memory_size);
+void APEX_cpu_set_issue_queues(APEX_CPU *cpu, const issue_queue_config *config);
+void APEX_cpu_reset(APEX_CPU *cpu);
+int APEX_cpu_cycle(APEX_CPU *cpu, int max_idle_skip);
 void APEX_cpu_run(APEX_CPU *cpu);
+void APEX_cpu_dump_state(const APEX_CPU *cpu, FILE *fp);
 void APEX_cpu_stop(APEX_CPU *cpu);
 void push_information_to_fu(APEX_CPU *cpu, int index, int fu);
-int  APEX_rob_commit(APEX_CPU *cpu);
+int  APEX_rob_commit(APEX_CPU *cpu, APEX_Thread *t);
 
 
 void APEX_memory(APEX_CPU *cpu);
@@ -181,15 +318,19 @@ void APEX_mul_fu_1(APEX_CPU *cpu);
 void APEX_mul_fu_2(APEX_CPU *cpu);
 void APEX_mul_fu_3(APEX_CPU *cpu);
 void APEX_mul_fu_4(APEX_CPU *cpu);
+void APEX_vec_fu(APEX_CPU *cpu);
+void APEX_div_fu(APEX_CPU *cpu);
 void APEX_process_iq(APEX_CPU *cpu);
-void create_rename_table_backup( APEX_CPU *cpu);
-void create_mri_backup( APEX_CPU *cpu);
-void update_rename_table_with_backup( APEX_CPU *cpu, int physical_register_address);
-void set_mri_from_backup( APEX_CPU *cpu, int physical_register_address);
-void flush_instructions(APEX_CPU *cpu, int rob_index);
+void create_rename_table_backup(APEX_Thread *t);
+void create_mri_backup(APEX_Thread *t);
+void update_rename_table_with_backup(APEX_CPU *cpu, APEX_Thread *t, int physical_register_address);
+void set_mri_from_backup(APEX_Thread *t, int physical_register_address);
+void update_vector_rename_table_with_backup(APEX_CPU *cpu, APEX_Thread *t, int tag);
+void flush_instructions(APEX_CPU *cpu, APEX_Thread *t, int rob_index);
+void squash_front_end_latches(APEX_CPU *cpu, APEX_Thread *t);
 int is_branch_instruction(int opcode);
 int check_free_physical_register(APEX_CPU *cpu, int physical_register_address);
-void revert_btb_from_backup(APEX_CPU *cpu, int index);
-void create_btb_backup(APEX_CPU *cpu);
+void revert_btb_from_backup(APEX_Thread *t, int index);
+void create_btb_backup(APEX_Thread *t);
 #endif
 
@@ -0,0 +1,396 @@
+/*
+ * apex_debugger.c
+ * Contains the APEX debugger. The simulation runs at full speed and only
+ * checks the stop conditions after each cycle; commands are read from
+ * stdin once one triggers.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_cpu.h"
+#include "apex_debugger.h"
+
+static const char *const kind_names[] = {"pc", "cycle", "commit", "mem", "reg"};
+
+static void
+print_help(void)
+{
+    printf("  <enter>, step [n]      run 1 or n cycles\n");
+    printf("  run <n>                run n cycles\n");
+    printf("  continue, c            run until a breakpoint, watchpoint or HALT\n");
+    printf("  break pc <pc>          stop when the instruction at pc commits\n");
+    printf("  break cycle <n>        stop when the clock reaches cycle n\n");
+    printf("  break commit <n>       stop when n instructions have committed\n");
+    printf("  watch mem <address>    stop when a data memory word changes\n");
+    printf("  watch reg R<n> [t]     stop when a register of thread t (default 0) changes\n");
+    printf("  delete <id>            remove a breakpoint or watchpoint\n");
+    printf("  info                   list breakpoints and watchpoints\n");
+    printf("  regs                   print the architectural registers\n");
+    printf("  mem <address> [n]      print n data memory words\n");
+    printf("  quit, q                stop the simulation\n");
+}
+
+static int
+watched_value(const apex_breakpoint *bp, const APEX_CPU *cpu)
+{
+    if (bp->kind == WATCH_MEMORY)
+    {
+        return cpu->data_memory[bp->target];
+    }
+    return cpu->thread[bp->thread].arf.architectural_register_file[bp->target].value;
+}
+
+static void
+update_armed(apex_debugger *dbg)
+{
+    dbg->armed = dbg->count > 0 || dbg->stop_cycle >= 0;
+}
+
+static void
+print_registers(const APEX_CPU *cpu)
+{
+    for (int n = 0; n < cpu->num_threads; n++)
+    {
+        const APEX_Thread *t = &cpu->thread[n];
+
+        if (cpu->num_threads > 1)
+        {
+            printf("Thread %d\n", n);
+        }
+        for (int i = 0; i < ARCHITECTURAL_REGISTERS_SIZE; i++)
+        {
+            printf("R%-3d[%-3d] ", i, t->arf.architectural_register_file[i].value);
+            if (i == ARCHITECTURAL_REGISTERS_SIZE / 2 - 1)
+            {
+                printf("\n");
+            }
+        }
+        printf("\n");
+    }
+}
+
+static void
+print_memory(const APEX_CPU *cpu, int address, int n)
+{
+    for (int i = 0; i < n && address + i < DATA_MEMORY_SIZE; i++)
+    {
+        printf("MEM[%d] = %d\n", address + i, cpu->data_memory[address + i]);
+    }
+}
+
+static void
+print_breakpoints(const apex_debugger *dbg)
+{
+    if (dbg->count == 0)
+    {
+        printf("No breakpoints or watchpoints\n");
+    }
+    for (int i = 0; i < dbg->count; i++)
+    {
+        const apex_breakpoint *bp = &dbg->breakpoint[i];
+
+        if (bp->kind == WATCH_REGISTER)
+        {
+            printf("%d: watch reg R%d thread %d\n", bp->id, bp->target, bp->thread);
+        }
+        else
+        {
+            printf("%d: %s %s %d\n", bp->id, bp->kind >= WATCH_MEMORY ? "watch" : "break",
+                   kind_names[bp->kind], bp->target);
+        }
+    }
+}
+
+/* Adds a stop condition, -1 if the target is out of range or the table is full */
+static int
+add_breakpoint(apex_debugger *dbg, const APEX_CPU *cpu, int kind, int target, int thread)
+{
+    apex_breakpoint *bp;
+
+    if (dbg->count == MAX_BREAKPOINTS || target < 0 ||
+        (kind == WATCH_MEMORY && target >= DATA_MEMORY_SIZE) ||
+        (kind == WATCH_REGISTER && (target >= ARCHITECTURAL_REGISTERS_SIZE || thread < 0 ||
+                                    thread >= cpu->num_threads)))
+    {
+        return -1;
+    }
+    bp = &dbg->breakpoint[dbg->count++];
+    bp->id = dbg->next_id++;
+    bp->kind = kind;
+    bp->target = target;
+    bp->thread = thread;
+    if (kind >= WATCH_MEMORY)
+    {
+        bp->last_value = watched_value(bp, cpu);
+    }
+    return bp->id;
+}
+
+static void
+delete_breakpoint(apex_debugger *dbg, int id)
+{
+    for (int i = 0; i < dbg->count; i++)
+    {
+        if (dbg->breakpoint[i].id == id)
+        {
+            dbg->breakpoint[i] = dbg->breakpoint[--dbg->count];
+            return;
+        }
+    }
+    printf("No breakpoint %d\n", id);
+}
+
+/* Parses break/watch arguments, returns the new id or -1 */
+static int
+parse_breakpoint(apex_debugger *dbg, const APEX_CPU *cpu, const char *command, const char *args)
+{
+    char what[16];
+    int target, thread = 0, n;
+
+    n = sscanf(args, "%15s %*[Rr]%d %d", what, &target, &thread);
+    if (n < 2)
+    {
+        n = sscanf(args, "%15s %d %d", what, &target, &thread);
+    }
+    if (n < 2)
+    {
+        return -1;
+    }
+    if (strcmp(command, "break") == 0)
+    {
+        for (int kind = BREAK_PC; kind <= BREAK_COMMIT; kind++)
+        {
+            if (strcmp(what, kind_names[kind]) == 0)
+            {
+                return add_breakpoint(dbg, cpu, kind, target, 0);
+            }
+        }
+    }
+    else if (strcmp(what, "mem") == 0)
+    {
+        return add_breakpoint(dbg, cpu, WATCH_MEMORY, target, 0);
+    }
+    else if (strcmp(what, "reg") == 0)
+    {
+        return add_breakpoint(dbg, cpu, WATCH_REGISTER, target, thread);
+    }
+    return -1;
+}
+
+void
+debugger_init(apex_debugger *dbg, int stop_at_start)
+{
+    memset(dbg, 0, sizeof(apex_debugger));
+    dbg->next_id = 1;
+    dbg->stop_cycle = stop_at_start ? 0 : -1;
+    dbg->interactive = TRUE;
+    update_armed(dbg);
+}
+
+/* Idle cycles the core may skip without jumping over a cycle the debugger stops at */
+int
+debugger_idle_limit(const apex_debugger *dbg, const APEX_CPU *cpu)
+{
+    int limit = INT_MAX;
+
+    if (!dbg->armed)
+    {
+        return limit;
+    }
+    if (dbg->stop_cycle >= 0)
+    {
+        limit = dbg->stop_cycle - cpu->clock - 1;
+    }
+    for (int i = 0; i < dbg->count; i++)
+    {
+        const apex_breakpoint *bp = &dbg->breakpoint[i];
+
+        if (bp->kind == BREAK_CYCLE && bp->target > cpu->clock && bp->target - cpu->clock - 1 < limit)
+        {
+            limit = bp->target - cpu->clock - 1;
+        }
+    }
+    return limit > 0 ? limit : 0;
+}
+
+/*
+ * Checks the stop conditions after a cycle, printing every breakpoint or
+ * watchpoint that triggered and then the registers. Returns TRUE to stop.
+ */
+int
+debugger_should_stop(apex_debugger *dbg, const APEX_CPU *cpu)
+{
+    int committed = cpu->insn_completed != dbg->last_insn_completed;
+    int stop = FALSE;
+    int hit = FALSE;
+
+    if (dbg->stop_cycle >= 0 && cpu->clock >= dbg->stop_cycle)
+    {
+        dbg->stop_cycle = -1;
+        stop = TRUE;
+    }
+    for (int i = 0; i < dbg->count; i++)
+    {
+        apex_breakpoint *bp = &dbg->breakpoint[i];
+        int value;
+
+        switch (bp->kind)
+        {
+            case BREAK_PC:
+                if (committed && cpu->last_commit_pc == bp->target)
+                {
+                    printf("APEX_Debug: Breakpoint %d, I[%d] committed at cycle %d\n", bp->id,
+                           (bp->target - 4000) / 4, cpu->clock);
+                    hit = TRUE;
+                }
+                break;
+            case BREAK_CYCLE:
+                if (dbg->last_clock < bp->target && cpu->clock >= bp->target)
+                {
+                    printf("APEX_Debug: Breakpoint %d, cycle %d\n", bp->id, cpu->clock);
+                    hit = TRUE;
+                }
+                break;
+            case BREAK_COMMIT:
+                if (dbg->last_insn_completed < bp->target && cpu->insn_completed >= bp->target)
+                {
+                    printf("APEX_Debug: Breakpoint %d, %d instructions committed at cycle %d\n", bp->id,
+                           cpu->insn_completed, cpu->clock);
+                    hit = TRUE;
+                }
+                break;
+            default:
+                value = watched_value(bp, cpu);
+                if (value != bp->last_value)
+                {
+                    if (bp->kind == WATCH_MEMORY)
+                    {
+                        printf("APEX_Debug: Watchpoint %d, MEM[%d] %d -> %d at cycle %d\n", bp->id,
+                               bp->target, bp->last_value, value, cpu->clock);
+                    }
+                    else
+                    {
+                        printf("APEX_Debug: Watchpoint %d, thread %d R%d %d -> %d at cycle %d\n", bp->id,
+                               bp->thread, bp->target, bp->last_value, value, cpu->clock);
+                    }
+                    bp->last_value = value;
+                    hit = TRUE;
+                }
+                break;
+        }
+    }
+    dbg->last_clock = cpu->clock;
+    dbg->last_insn_completed = cpu->insn_completed;
+    update_armed(dbg);
+    if (hit)
+    {
+        printf("APEX_Debug: cycle %d, %d instructions committed, last committed PC %d\n", cpu->clock,
+               cpu->insn_completed, cpu->last_commit_pc);
+        print_registers(cpu);
+    }
+    return stop || hit;
+}
+
+/*
+ * Reads commands until one resumes the simulation. Once stdin ends the
+ * simulation continues to the end, still reporting breakpoints and
+ * watchpoints as they trigger.
+ */
+int
+debugger_prompt(apex_debugger *dbg, const APEX_CPU *cpu)
+{
+    char line[128];
+    char command[16];
+    int n, offset;
+
+    while (dbg->interactive)
+    {
+        printf("(apex cycle %d) ", cpu->clock);
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin))
+        {
+            printf("\n");
+            dbg->interactive = FALSE;
+            break;
+        }
+        if (sscanf(line, "%15s%n", command, &offset) != 1)
+        {
+            strcpy(command, "step");
+            offset = 0;
+        }
+        if (strcmp(command, "step") == 0 || strcmp(command, "s") == 0 || strcmp(command, "run") == 0)
+        {
+            if (sscanf(line + offset, "%d", &n) != 1)
+            {
+                n = 1;
+            }
+            if (n > 0)
+            {
+                dbg->stop_cycle = cpu->clock + n;
+                break;
+            }
+            printf("Cycles must be positive\n");
+        }
+        else if (strcmp(command, "continue") == 0 || strcmp(command, "c") == 0)
+        {
+            break;
+        }
+        else if (strcmp(command, "break") == 0 || strcmp(command, "watch") == 0)
+        {
+            int id = parse_breakpoint(dbg, cpu, command, line + offset);
+
+            if (id < 0)
+            {
+                printf("Invalid %s, type help\n", command);
+            }
+            else
+            {
+                printf("%s %d set\n", strcmp(command, "break") == 0 ? "Breakpoint" : "Watchpoint", id);
+            }
+        }
+        else if (strcmp(command, "delete") == 0 && sscanf(line + offset, "%d", &n) == 1)
+        {
+            delete_breakpoint(dbg, n);
+        }
+        else if (strcmp(command, "info") == 0)
+        {
+            print_breakpoints(dbg);
+        }
+        else if (strcmp(command, "regs") == 0)
+        {
+            print_registers(cpu);
+        }
+        else if (strcmp(command, "mem") == 0 && sscanf(line + offset, "%d", &n) == 1 && n >= 0 &&
+                 n < DATA_MEMORY_SIZE)
+        {
+            int count;
+
+            if (sscanf(line + offset, "%*d %d", &count) != 1)
+            {
+                count = 1;
+            }
+            print_memory(cpu, n, count);
+        }
+        else if (strcmp(command, "quit") == 0 || strcmp(command, "q") == 0 ||
+                 strcmp(command, "Q") == 0)
+        {
+            return DEBUG_QUIT;
+        }
+        else if (strcmp(command, "help") == 0)
+        {
+            print_help();
+        }
+        else
+        {
+            printf("Unknown command, type help\n");
+        }
+    }
+    dbg->last_clock = cpu->clock;
+    dbg->last_insn_completed = cpu->insn_completed;
+    update_armed(dbg);
+    return DEBUG_RUN;
+}
@@ -0,0 +1,58 @@
+/*
+ * apex_debugger.h
+ * Contains the APEX debugger declarations: breakpoints on commit PC, cycle
+ * and commit count, and watchpoints on data memory and registers
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_DEBUGGER_
+#define _XXYZ_APEX_DEBUGGER_
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////DEBUGGER//////////////////////////////////////////
+
+#define MAX_BREAKPOINTS 16
+
+/* Stop conditions */
+#define BREAK_PC 0                  /* Instruction at a PC commits */
+#define BREAK_CYCLE 1               /* Clock reaches a cycle */
+#define BREAK_COMMIT 2              /* Committed instructions reach a count */
+#define WATCH_MEMORY 3              /* Data memory word changes */
+#define WATCH_REGISTER 4            /* Architectural register changes */
+
+/* What the simulation loop does after the debugger returns */
+#define DEBUG_RUN 0
+#define DEBUG_QUIT 1
+
+struct APEX_CPU;
+
+typedef struct apex_breakpoint
+{
+    int id;
+    int kind;                       /* BREAK_* or WATCH_* */
+    int target;                     /* PC, cycle, count, address or register */
+    int thread;                     /* WATCH_REGISTER: thread whose register is watched */
+    int last_value;                 /* Watchpoints: value when last checked */
+}apex_breakpoint;
+
+typedef struct apex_debugger
+{
+    apex_breakpoint breakpoint[MAX_BREAKPOINTS];
+    int count;
+    int next_id;
+    int stop_cycle;                 /* run/step: stop at this cycle, -1 to run on */
+    int armed;                      /* Anything to check after a cycle */
+    int interactive;                /* Commands are read until stdin ends */
+    int last_clock;                 /* Clock when last checked */
+    int last_insn_completed;        /* Committed instructions when last checked */
+}apex_debugger;
+
+void debugger_init(apex_debugger *dbg, int stop_at_start);
+int debugger_idle_limit(const apex_debugger *dbg, const struct APEX_CPU *cpu);
+int debugger_should_stop(apex_debugger *dbg, const struct APEX_CPU *cpu);
+int debugger_prompt(apex_debugger *dbg, const struct APEX_CPU *cpu);
+#endif
@@ -0,0 +1,200 @@
+/*
+ * apex_energy.c
+ * Contains the activity-based energy model. The default energies are
+ * illustrative figures for a small 32-bit core; a parameter file measured
+ * for a real process replaces any of them.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_energy.h"
+
+const char *const structure_names[NUM_STRUCTURES] = {
+    "iq", "rob", "prf", "rename", "btb", "lsq", "fu", "dmem"
+};
+
+/* Structure each access is charged to */
+static const int activity_structure[NUM_ACTIVITIES] = {
+    STRUCT_IQ, STRUCT_IQ, STRUCT_IQ, STRUCT_ROB, STRUCT_ROB, STRUCT_PRF, STRUCT_PRF,
+    STRUCT_RENAME, STRUCT_RENAME, STRUCT_BTB, STRUCT_BTB, STRUCT_LSQ, STRUCT_LSQ,
+    STRUCT_FU, STRUCT_FU, STRUCT_FU, STRUCT_DMEM, STRUCT_DMEM, STRUCT_FU
+};
+
+/* pJ per access, in ACT_* order; CAM searches cost more than indexed reads */
+static const double default_access_pj[NUM_ACTIVITIES] = {
+    1.2, 0.8, 0.6, 1.0, 0.9, 0.7, 0.9,
+    0.3, 0.4, 0.5, 0.6, 0.9, 1.1,
+    2.0, 8.0, 1.5, 12.0, 14.0, 2.0
+};
+
+/* pJ per entry per cycle, in STRUCT_* order */
+static const double default_leakage_pj[NUM_STRUCTURES] = {
+    0.010, 0.008, 0.006, 0.002, 0.003, 0.010, 0.150, 0.0005
+};
+
+/* Sets one parameter by name, -1 if there is no such parameter */
+static int
+set_parameter(apex_energy_model *model, const char *name, double value)
+{
+    if (strcmp(name, "clock_ghz") == 0)
+    {
+        if (value <= 0.0)
+        {
+            return -1;
+        }
+        model->clock_ghz = value;
+        return 0;
+    }
+    if (strncmp(name, "leakage.", 8) == 0)
+    {
+        for (int i = 0; i < NUM_STRUCTURES; i++)
+        {
+            if (strcmp(name + 8, structure_names[i]) == 0)
+            {
+                model->leakage_pj[i] = value;
+                return 0;
+            }
+        }
+        return -1;
+    }
+    for (int i = 0; i < NUM_ACTIVITIES; i++)
+    {
+        if (strcmp(name, activity_names[i]) == 0)
+        {
+            model->access_pj[i] = value;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Returns the default model, with the "<name> <value>" lines of filename
+ * applied when it is not NULL. Names are the activity names of the stats
+ * dump (pJ per access), leakage.<structure> (pJ per entry per cycle) and
+ * clock_ghz; '#' starts a comment. Returns NULL if the file cannot be read
+ * or has a line that is not a known parameter.
+ */
+apex_energy_model *
+energy_model_load(const char *filename)
+{
+    apex_energy_model *model = malloc(sizeof(apex_energy_model));
+    char line[256];
+    int line_no = 0;
+    FILE *fp;
+
+    if (!model)
+    {
+        return NULL;
+    }
+    memcpy(model->access_pj, default_access_pj, sizeof(model->access_pj));
+    memcpy(model->leakage_pj, default_leakage_pj, sizeof(model->leakage_pj));
+    model->clock_ghz = ENERGY_CLOCK_GHZ;
+    if (!filename)
+    {
+        return model;
+    }
+
+    fp = fopen(filename, "r");
+    if (!fp)
+    {
+        fprintf(stderr, "APEX_Error: Unable to open energy parameters %s\n", filename);
+        free(model);
+        return NULL;
+    }
+    while (fgets(line, sizeof(line), fp))
+    {
+        char name[64];
+        char extra[2];
+        double value;
+        int n;
+
+        line_no++;
+        line[strcspn(line, "#\n")] = '\0';
+        n = sscanf(line, "%63s %lf %1s", name, &value, extra);
+        if (n <= 0)
+        {
+            continue;
+        }
+        if (n != 2 || value < 0.0 || set_parameter(model, name, value) != 0)
+        {
+            fprintf(stderr, "APEX_Error: %s:%d: invalid energy parameter\n", filename, line_no);
+            fclose(fp);
+            free(model);
+            return NULL;
+        }
+    }
+    fclose(fp);
+    return model;
+}
+
+/* Entries of each structure leaking every cycle */
+static void
+structure_entries(const apex_stats *stats, int num_threads, double entries[NUM_STRUCTURES])
+{
+    //only the entries the issue queue topology uses are built
+    entries[STRUCT_IQ] = 0;
+    for (int q = 0; q < (int)stats->num_issue_queues; q++)
+    {
+        entries[STRUCT_IQ] += stats->iq_queue_size[q];
+    }
+    //the ROB and LSQ budgets are shared by the threads, the tables are per thread
+    entries[STRUCT_ROB] = ROB_SIZE;
+    //a vector register leaks like one scalar register per lane
+    entries[STRUCT_PRF] = PHYSICAL_REGISTERS_SIZE + num_threads +
+                          VECTOR_PHYSICAL_REGISTERS_SIZE * MAX_VECTOR_LENGTH;
+    entries[STRUCT_RENAME] = (ARCHITECTURAL_REGISTERS_SIZE + 1) * num_threads;
+    entries[STRUCT_BTB] = BTB_SIZE * num_threads;
+    entries[STRUCT_LSQ] = LSQ_SIZE;
+    entries[STRUCT_FU] = 6;
+    entries[STRUCT_DMEM] = DATA_MEMORY_SIZE;
+}
+
+void
+energy_compute(const apex_energy_model *model, const apex_stats *stats, int num_threads,
+               apex_energy_report *report)
+{
+    double entries[NUM_STRUCTURES];
+
+    memset(report, 0, sizeof(apex_energy_report));
+    structure_entries(stats, num_threads, entries);
+    for (int i = 0; i < NUM_ACTIVITIES; i++)
+    {
+        report->dynamic_pj[activity_structure[i]] += model->access_pj[i] * stats->activity[i];
+    }
+    for (int i = 0; i < NUM_STRUCTURES; i++)
+    {
+        report->leakage_pj[i] = model->leakage_pj[i] * entries[i] * stats->cycles;
+        report->total_pj += report->dynamic_pj[i] + report->leakage_pj[i];
+    }
+    report->seconds = stats->cycles / (model->clock_ghz * 1e9);
+    if (report->seconds > 0.0)
+    {
+        report->power_mw = report->total_pj * 1e-9 / report->seconds;
+    }
+    report->edp = report->total_pj * 1e-12 * report->seconds;
+}
+
+void
+energy_print(const apex_energy_report *report, FILE *fp)
+{
+    double dynamic = 0.0, leakage = 0.0;
+
+    for (int i = 0; i < NUM_STRUCTURES; i++)
+    {
+        dynamic += report->dynamic_pj[i];
+        leakage += report->leakage_pj[i];
+    }
+    fprintf(fp, "APEX_Energy: Total = %.3f nJ (dynamic %.3f nJ, leakage %.3f nJ)\n",
+            report->total_pj / 1000.0, dynamic / 1000.0, leakage / 1000.0);
+    fprintf(fp, "APEX_Energy: Average power = %.3f mW, EDP = %.4g J*s\n", report->power_mw,
+            report->edp);
+    for (int i = 0; i < NUM_STRUCTURES; i++)
+    {
+        fprintf(fp, "APEX_Energy:   %-7s dynamic %10.3f nJ  leakage %10.3f nJ\n", structure_names[i],
+                report->dynamic_pj[i] / 1000.0, report->leakage_pj[i] / 1000.0);
+    }
+}
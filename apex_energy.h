@@ -0,0 +1,61 @@
+/*
+ * apex_energy.h
+ * Contains the activity-based energy model declarations: an energy per
+ * access of each structure and a leakage per entry, applied to the access
+ * counts in apex_stats
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_ENERGY_
+#define _XXYZ_APEX_ENERGY_
+
+#include <stdio.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+#include "apex_stats.h"
+
+////////////////////////ENERGY MODEL//////////////////////////////////////
+
+/* Structures energy is reported for, each leaks per entry every cycle */
+#define STRUCT_IQ 0
+#define STRUCT_ROB 1
+#define STRUCT_PRF 2
+#define STRUCT_RENAME 3
+#define STRUCT_BTB 4
+#define STRUCT_LSQ 5
+#define STRUCT_FU 6                 /* One entry per functional unit */
+#define STRUCT_DMEM 7               /* One entry per data memory word */
+#define NUM_STRUCTURES 8
+
+/* Clock the average power is reported at, in GHz */
+#ifndef ENERGY_CLOCK_GHZ
+#define ENERGY_CLOCK_GHZ 1.0
+#endif
+
+typedef struct apex_energy_model
+{
+    double access_pj[NUM_ACTIVITIES];           /* Energy of one ACT_* access */
+    double leakage_pj[NUM_STRUCTURES];          /* Leakage of one entry for one cycle */
+    double clock_ghz;
+}apex_energy_model;
+
+typedef struct apex_energy_report
+{
+    double dynamic_pj[NUM_STRUCTURES];
+    double leakage_pj[NUM_STRUCTURES];
+    double total_pj;
+    double seconds;                             /* Run time at the model's clock */
+    double power_mw;
+    double edp;                                 /* Energy-delay product, J*s */
+}apex_energy_report;
+
+extern const char *const structure_names[NUM_STRUCTURES];
+
+apex_energy_model *energy_model_load(const char *filename);
+void energy_compute(const apex_energy_model *model, const apex_stats *stats, int num_threads,
+                    apex_energy_report *report);
+void energy_print(const apex_energy_report *report, FILE *fp);
+#endif
@@ -0,0 +1,221 @@
+/*
+ * apex_itrace.c
+ * Contains the instruction trace reader and writer. The reader decompresses
+ * on its own thread, so the core only waits for the file when the
+ * simulation outruns decompression.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_itrace.h"
+
+/* Fills the buffers in turn until the end of the file or until stopped */
+static void *
+reader_thread(void *arg)
+{
+    apex_itrace_reader *reader = arg;
+
+    for (int b = 0;; b ^= 1)
+    {
+        apex_itrace_buffer *buffer = &reader->buffer[b];
+        int bytes, stop, status = Z_OK;
+
+        pthread_mutex_lock(&reader->lock);
+        while (buffer->ready && !reader->stop)
+        {
+            pthread_cond_wait(&reader->changed, &reader->lock);
+        }
+        stop = reader->stop;
+        pthread_mutex_unlock(&reader->lock);
+        if (stop)
+        {
+            break;
+        }
+
+        //the core does not touch a buffer until it is ready
+        bytes = gzread(reader->file, buffer->records, sizeof(buffer->records));
+        //a short read is the end of the file, unless the stream was cut off or corrupt
+        if (bytes >= 0 && bytes < (int)sizeof(buffer->records))
+        {
+            gzerror(reader->file, &status);
+        }
+
+        pthread_mutex_lock(&reader->lock);
+        buffer->count = bytes > 0 ? bytes / (int)sizeof(apex_itrace_record) : 0;
+        buffer->ready = TRUE;
+        if (bytes < 0 || status != Z_OK || bytes % (int)sizeof(apex_itrace_record) != 0)
+        {
+            reader->error = TRUE;
+        }
+        pthread_cond_broadcast(&reader->changed);
+        pthread_mutex_unlock(&reader->lock);
+        if (buffer->count < ITRACE_BUFFER_RECORDS)
+        {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * File layout: 8 byte magic, then apex_itrace_record entries, the whole
+ * file gzip compressed (an uncompressed file is read as well). Returns NULL
+ * if the file cannot be opened or is not an instruction trace.
+ */
+apex_itrace_reader *
+itrace_open(const char *filename)
+{
+    apex_itrace_reader *reader = calloc(1, sizeof(apex_itrace_reader));
+    char magic[sizeof(ITRACE_MAGIC) - 1];
+
+    if (!reader)
+    {
+        return NULL;
+    }
+    reader->file = gzopen(filename, "rb");
+    if (!reader->file)
+    {
+        free(reader);
+        return NULL;
+    }
+    //zlib only takes the buffer size before the first read
+    gzbuffer(reader->file, 1 << 17);
+    if (gzread(reader->file, magic, sizeof(magic)) != (int)sizeof(magic) ||
+        memcmp(magic, ITRACE_MAGIC, sizeof(magic)) != 0)
+    {
+        gzclose(reader->file);
+        free(reader);
+        return NULL;
+    }
+    pthread_mutex_init(&reader->lock, NULL);
+    pthread_cond_init(&reader->changed, NULL);
+    if (pthread_create(&reader->thread, NULL, reader_thread, reader) != 0)
+    {
+        pthread_mutex_destroy(&reader->lock);
+        pthread_cond_destroy(&reader->changed);
+        gzclose(reader->file);
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+/*
+ * Takes the next record. Returns FALSE at the end of the trace and -1 if
+ * the trace ended because the file is truncated or corrupt, and keeps
+ * returning that afterwards.
+ */
+int
+itrace_next(apex_itrace_reader *reader, apex_itrace_record *rec)
+{
+    apex_itrace_buffer *buffer = &reader->buffer[reader->current];
+
+    if (!reader->holding || reader->position == buffer->count)
+    {
+        if (reader->last)
+        {
+            return reader->failed ? -1 : FALSE;
+        }
+        pthread_mutex_lock(&reader->lock);
+        //hand the used up buffer back to be refilled
+        if (reader->holding)
+        {
+            buffer->ready = FALSE;
+            reader->current ^= 1;
+            buffer = &reader->buffer[reader->current];
+            pthread_cond_broadcast(&reader->changed);
+        }
+        while (!buffer->ready)
+        {
+            pthread_cond_wait(&reader->changed, &reader->lock);
+        }
+        reader->failed = reader->error;
+        pthread_mutex_unlock(&reader->lock);
+        reader->holding = TRUE;
+        reader->position = 0;
+        reader->last = buffer->count < ITRACE_BUFFER_RECORDS;
+        if (buffer->count == 0)
+        {
+            return reader->failed ? -1 : FALSE;
+        }
+    }
+    *rec = buffer->records[reader->position++];
+    reader->records++;
+    return TRUE;
+}
+
+void
+itrace_close(apex_itrace_reader *reader)
+{
+    if (!reader)
+    {
+        return;
+    }
+    pthread_mutex_lock(&reader->lock);
+    reader->stop = TRUE;
+    pthread_cond_broadcast(&reader->changed);
+    pthread_mutex_unlock(&reader->lock);
+    pthread_join(reader->thread, NULL);
+    pthread_mutex_destroy(&reader->lock);
+    pthread_cond_destroy(&reader->changed);
+    gzclose(reader->file);
+    free(reader);
+}
+
+apex_itrace_writer *
+itrace_create(const char *filename)
+{
+    apex_itrace_writer *writer = calloc(1, sizeof(apex_itrace_writer));
+
+    if (!writer)
+    {
+        return NULL;
+    }
+    writer->file = gzopen(filename, "wb");
+    if (!writer->file)
+    {
+        free(writer);
+        return NULL;
+    }
+    gzbuffer(writer->file, 1 << 17);
+    gzwrite(writer->file, ITRACE_MAGIC, strlen(ITRACE_MAGIC));
+    return writer;
+}
+
+/* Adds an executed instruction, its next_pc is taken from the one after it */
+void
+itrace_write(apex_itrace_writer *writer, const apex_itrace_record *rec)
+{
+    if (writer->has_pending)
+    {
+        writer->pending.next_pc = rec->pc;
+        gzwrite(writer->file, &writer->pending, sizeof(apex_itrace_record));
+        writer->records++;
+    }
+    writer->pending = *rec;
+    writer->has_pending = TRUE;
+}
+
+/* Writes the last record and closes the file, -1 if the file could not be written */
+int
+itrace_finish(apex_itrace_writer *writer)
+{
+    int status;
+
+    if (!writer)
+    {
+        return 0;
+    }
+    if (writer->has_pending)
+    {
+        writer->pending.next_pc = writer->pending.pc + 4;
+        gzwrite(writer->file, &writer->pending, sizeof(apex_itrace_record));
+        writer->records++;
+    }
+    status = gzclose(writer->file) == Z_OK ? 0 : -1;
+    free(writer);
+    return status;
+}
@@ -0,0 +1,94 @@
+/*
+ * apex_itrace.h
+ * Contains the instruction trace declarations. An instruction trace is the
+ * executed instruction stream of a program, gzip compressed, which apex_sim
+ * can run instead of a program (--itrace) or record (--record-itrace).
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_ITRACE_
+#define _XXYZ_APEX_ITRACE_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////INSTRUCTION TRACE/////////////////////////////////
+
+#define ITRACE_MAGIC "APEXITR1"
+
+/* Records in each of the reader's two buffers */
+#ifndef ITRACE_BUFFER_RECORDS
+#define ITRACE_BUFFER_RECORDS 16384
+#endif
+
+/*
+ * One executed instruction, in program order and host (little-endian) byte
+ * order. Registers are APEX register numbers, V registers for vector
+ * operands.
+ */
+typedef struct apex_itrace_record
+{
+    uint32_t pc;
+    uint32_t next_pc;           /* PC executed next, a branch's outcome */
+    uint32_t mem_address;       /* Loads and stores: data address of the first word */
+    int32_t imm;
+    uint8_t opcode;             /* OPCODE_* */
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+}apex_itrace_record;
+
+_Static_assert(sizeof(apex_itrace_record) == 20, "apex_itrace_record must not be padded");
+
+typedef struct apex_itrace_buffer
+{
+    apex_itrace_record records[ITRACE_BUFFER_RECORDS];
+    int count;                  /* Records read, fewer than the buffer holds at the end */
+    int ready;                  /* Filled and not yet used up by the core */
+}apex_itrace_buffer;
+
+/*
+ * Streams a trace with a constant amount of memory: a reader thread
+ * decompresses into one buffer while the core takes records from the other.
+ */
+typedef struct apex_itrace_reader
+{
+    gzFile file;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;     /* A buffer was filled or handed back */
+    int stop;                   /* The reader thread should exit */
+    int error;                  /* The file is truncated or could not be decompressed */
+    apex_itrace_buffer buffer[2];
+
+    /* Only touched by the core */
+    int current;                /* Buffer records are taken from */
+    int holding;                /* The core holds buffer[current] */
+    int position;               /* Next record in it */
+    int last;                   /* buffer[current] is the end of the trace */
+    int failed;                 /* The trace ended in a read error */
+    unsigned long long records; /* Records taken */
+}apex_itrace_reader;
+
+/* Records are written one behind, when the next one supplies next_pc */
+typedef struct apex_itrace_writer
+{
+    gzFile file;
+    apex_itrace_record pending;
+    int has_pending;
+    unsigned long long records;
+}apex_itrace_writer;
+
+apex_itrace_reader *itrace_open(const char *filename);
+int itrace_next(apex_itrace_reader *reader, apex_itrace_record *rec);
+void itrace_close(apex_itrace_reader *reader);
+apex_itrace_writer *itrace_create(const char *filename);
+void itrace_write(apex_itrace_writer *writer, const apex_itrace_record *rec);
+int itrace_finish(apex_itrace_writer *writer);
+#endif
@@ -14,12 +14,170 @@
 
 /* Integers */
 #define DATA_MEMORY_SIZE 4096
-#define PHYSICAL_REGISTERS_SIZE 20
 #define ARCHITECTURAL_REGISTERS_SIZE 16
+#define BTB_SIZE 200
+
+/* Structure sizes, can be overridden at compile time (e.g. -DROB_SIZE=64) */
+#ifndef PHYSICAL_REGISTERS_SIZE
+#define PHYSICAL_REGISTERS_SIZE 20
+#endif
+#ifndef ISSUE_QUEUE_SIZE
 #define ISSUE_QUEUE_SIZE 8
+#endif
+#ifndef LSQ_SIZE
 #define LSQ_SIZE 6
+#endif
+#ifndef ROB_SIZE
 #define ROB_SIZE 16
-#define BTB_SIZE 200
+#endif
+
+/* Cycles from a load/store entering the memory unit to its result */
+#ifndef DATA_MEMORY_LATENCY
+#define DATA_MEMORY_LATENCY 2
+#endif
+
+/* Divider: not pipelined, these cycles then one per quotient bit the dividend needs */
+#ifndef DIV_SETUP_CYCLES
+#define DIV_SETUP_CYCLES 2
+#endif
+
+/* Multicore: cores sharing the data memory and their coherent L1 caches (in words) */
+#ifndef MAX_CORES
+#define MAX_CORES 8
+#endif
+#ifndef L1_SIZE_WORDS
+#define L1_SIZE_WORDS 256
+#endif
+#ifndef L1_LINE_WORDS
+#define L1_LINE_WORDS 4
+#endif
+#ifndef L1_HIT_LATENCY
+#define L1_HIT_LATENCY 1
+#endif
+/* An L1 miss served by memory takes the data memory latency (--mem-latency) */
+#ifndef L1_MISS_LATENCY
+#define L1_MISS_LATENCY 20
+#endif
+/* Misses served by another core's modified copy, and S -> M upgrades */
+#ifndef COHERENCE_TRANSFER_LATENCY
+#define COHERENCE_TRANSFER_LATENCY 10
+#endif
+/* Cycles each core runs between synchronizations, 1 is lockstep */
+#ifndef DEFAULT_QUANTUM
+#define DEFAULT_QUANTUM 100
+#endif
+
+/* SMT: hardware threads per core sharing the issue queue, FUs, PRF and memory */
+#ifndef SMT_MAX_THREADS
+#define SMT_MAX_THREADS 4
+#endif
+/* Which thread fetches each cycle */
+#define FETCH_POLICY_ROUND_ROBIN 0
+#define FETCH_POLICY_ICOUNT 1       /* Fewest instructions between fetch and issue */
+/* How the ROB and LSQ are divided between threads */
+#define PARTITION_STATIC 0          /* Every thread gets an equal share */
+#define PARTITION_SHARED 1          /* Threads compete for all entries */
+
+/* Macro-op fusion: pairs decode folds into one micro-op, a mask of FUSE_* (--fusion) */
+#define FUSE_NONE 0x0
+#define FUSE_CMP_BRANCH 0x1         /* CMP followed by BZ, BNZ, BP or BNP */
+#define FUSE_MOVC_ADD 0x2           /* MOVC Rd then ADD Rd,Rd,Rs: Rd=Rs+#imm */
+#define FUSE_ADDL_LOAD 0x4          /* ADDL Rd then LOAD Rd,Rd: one LOAD with both offsets */
+#define FUSE_ALL 0x7
+#ifndef FUSION_PAIRS
+#define FUSION_PAIRS FUSE_NONE
+#endif
+
+/* Set this flag to 1 to complete MOVC and register moves at rename (--no-rename-elim) */
+#ifndef ENABLE_RENAME_ELIMINATION
+#define ENABLE_RENAME_ELIMINATION 1
+#endif
+/*
+ * Set this flag to 1 to wake a load's dependents when the data arrives from memory and to
+ * schedule them for a cache hit, replaying them if the load misses (--no-load-spec)
+ */
+#ifndef ENABLE_LOAD_SPECULATION
+#define ENABLE_LOAD_SPECULATION 1
+#endif
+/*
+ * Cycles the scheduler assumes a load takes (--load-spec-latency), 0 for the memory latency
+ * on one core and the L1 hit latency with several. One core has no cache and every load takes
+ * the memory latency, so only a shorter assumed latency makes loads miss there.
+ */
+#ifndef LOAD_SPEC_LATENCY
+#define LOAD_SPEC_LATENCY 0
+#endif
+/*
+ * Set this flag to 1 to keep decoded loop bodies in a micro-op cache that sends them straight to
+ * rename (--no-uop-cache). It holds UOP_CACHE_SIZE micro-ops, the longest loop it captures.
+ */
+#ifndef ENABLE_UOP_CACHE
+#define ENABLE_UOP_CACHE 1
+#endif
+#ifndef UOP_CACHE_SIZE
+#define UOP_CACHE_SIZE 32
+#endif
+/*
+ * Set this flag to 1 to decouple branch prediction from fetch (--no-ftq): a prediction unit runs
+ * ahead through the BTB and queues up to FTQ_SIZE fetch blocks, each ending at a predicted taken
+ * branch or at the end of an instruction cache line.
+ */
+#ifndef ENABLE_DECOUPLED_FRONT_END
+#define ENABLE_DECOUPLED_FRONT_END 1
+#endif
+#ifndef FTQ_SIZE
+#define FTQ_SIZE 8
+#endif
+/*
+ * Instruction cache: ICACHE_LINES lines of ICACHE_LINE_SIZE instructions, direct mapped. A miss
+ * takes ICACHE_MISS_LATENCY cycles (--icache-latency), 0 reads the code memory without delay.
+ */
+#ifndef ICACHE_LINES
+#define ICACHE_LINES 16
+#endif
+#ifndef ICACHE_LINE_SIZE
+#define ICACHE_LINE_SIZE 4
+#endif
+#ifndef ICACHE_MISS_LATENCY
+#define ICACHE_MISS_LATENCY 0
+#endif
+/*
+ * Issue queue organization (--iq): unified, split (a queue per FU class),
+ * cluster or an explicit list of queues, which share ISSUE_QUEUE_SIZE entries
+ */
+#ifndef ISSUE_QUEUE_TOPOLOGY
+#define ISSUE_QUEUE_TOPOLOGY "unified"
+#endif
+/* How rename handles an instruction */
+#define RENAME_EXECUTE 0            /* Through the IQ and a FU */
+#define RENAME_VALUE 1              /* Value known at rename, written into the PRF */
+#define RENAME_SHARE 2              /* Move, mapped onto its source's physical register */
+
+/*
+ * Vector extension: V0..V7, each holding up to MAX_VECTOR_LENGTH words. The
+ * vector length in use is set at run time (--vector-length), VECTOR_LENGTH
+ * by default.
+ */
+#define VECTOR_REGISTERS_SIZE 8
+#ifndef MAX_VECTOR_LENGTH
+#define MAX_VECTOR_LENGTH 8
+#endif
+#ifndef VECTOR_LENGTH
+#define VECTOR_LENGTH 4
+#endif
+#ifndef VECTOR_PHYSICAL_REGISTERS_SIZE
+#define VECTOR_PHYSICAL_REGISTERS_SIZE 16
+#endif
+/* Tags of vector physical registers, kept apart from scalar ones in the IQ, LSQ and ROB */
+#define VECTOR_TAG_BASE 1024
+
+/* Co-simulation: commit records buffered between the core and the checker thread, a power of two */
+#ifndef COSIM_QUEUE_SIZE
+#define COSIM_QUEUE_SIZE 4096
+#endif
+
+/* Destination tag of an instruction that writes no physical register */
+#define NO_PHYSICAL_REGISTER -1
 
 #define SOURCE_AR 0
 #define SOURCE_PR 1
@@ -31,6 +189,10 @@
 #define MUL_FU 1
 #define BRANCH_FU 2
 #define MEM_FU 3
+#define VEC_FU 4
+#define DIV_FU 5
+#define NUM_FU_CLASSES 6
+#define MAX_ISSUE_QUEUES 5          /* One per FU class, MEM_FU never issues from the IQ */
 
 
 /* Numeric OPCODE identifiers for instructions */
@@ -55,11 +217,37 @@
 #define OPCODE_BP 0xd
 #define OPCODE_BNP 0xe
 #define OPCODE_RET 0xf
+#define OPCODE_VADD 0x18
+#define OPCODE_VSUB 0x19
+#define OPCODE_VMUL 0x1a
+#define OPCODE_VLOAD 0x1b
+#define OPCODE_VSTORE 0x1c
+/* Opcodes are below 0x20, see opcode_table in apex_opcodes.c */
+#define NUM_OPCODES 32
 
-/* Set this flag to 1 to enable debug messages */
+/* Set this flag to 1 to enable debug messages (make DEBUG=0 to build without them) */
+#ifndef ENABLE_DEBUG_MESSAGES
 #define ENABLE_DEBUG_MESSAGES 1
+#endif
 
-/* Set this flag to 1 to enable cycle single-step mode */
+/* Set this flag to 1 to enable cycle single-step mode (make SINGLE_STEP=0) */
+#ifndef ENABLE_SINGLE_STEP
 #define ENABLE_SINGLE_STEP 1
+#endif
+
+/* Set this flag to 1 to jump the clock over cycles in which no stage can make progress */
+#ifndef ENABLE_IDLE_SKIP
+#define ENABLE_IDLE_SKIP 1
+#endif
+
+/* Per-cycle debug message, compiled out when ENABLE_DEBUG_MESSAGES is 0 */
+#define APEX_DEBUG(...)                 \
+    do                                  \
+    {                                   \
+        if (ENABLE_DEBUG_MESSAGES)      \
+        {                               \
+            printf(__VA_ARGS__);        \
+        }                               \
+    } while (0)
 
 #endif
@@ -0,0 +1,515 @@
+/*
+ * apex_microbench.c
+ * Times the issue queue, ROB, LSQ and free list operations in isolation.
+ * Structure sizes come from apex_macros.h and can be overridden with -D.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "issue_queue.h"
+#include "rob.h"
+#include "lsq.h"
+#include "physical_register.h"
+
+/*
+ * One benchmark works on a batch of independent instances of a structure.
+ * setup prepares an instance outside the timed region and returns the number
+ * of operations run will perform on it; run does those operations.
+ */
+typedef struct microbench
+{
+    const char *name;
+    size_t state_size;
+    int (*setup)(void *state, int instance);
+    void (*run)(void *state);
+}microbench;
+
+typedef struct microbench_result
+{
+    double median_ns;
+    double p99_ns;
+    double min_ns;
+    double mean_ns;
+}microbench_result;
+
+/* Keeps results observable so the timed loops are not optimized away */
+static volatile int sink;
+
+//////////////////////////// ISSUE QUEUE ////////////////////////////
+
+static void
+fill_iq_entry(issue_queue_entry *e, int i, int ready)
+{
+    memset(e, 0, sizeof(*e));
+    e->is_allocated = 1;
+    e->FU = i % (BRANCH_FU + 1);
+    e->src1_tag = i % PHYSICAL_REGISTERS_SIZE;
+    e->src2_tag = (i + 1) % PHYSICAL_REGISTERS_SIZE;
+    e->src1_valid = ready;
+    e->src2_valid = ready;
+    e->dest_tag = (i + 2) % PHYSICAL_REGISTERS_SIZE;
+    e->rob_index = i % ROB_SIZE;
+    e->counter = i;
+}
+
+static int
+iq_empty_setup(void *state, int instance)
+{
+    memset(state, 0, sizeof(issue_queue_buffer));
+    iq_configure(&((issue_queue_buffer *)state)->config, ISSUE_QUEUE_TOPOLOGY);
+    return ISSUE_QUEUE_SIZE;
+}
+
+static void
+iq_insert_run(void *state)
+{
+    issue_queue_buffer *iq = state;
+    issue_queue_entry e;
+    int index;
+
+    fill_iq_entry(&e, 0, 0);
+    while ((index = issue_buffer_index_available(iq, e.FU)) != -1)
+    {
+        e.rob_index = index;
+        iq_entry_addition(iq, &e, index);
+    }
+}
+
+static int
+iq_ready_setup(void *state, int instance)
+{
+    issue_queue_buffer *iq = state;
+
+    iq_configure(&iq->config, ISSUE_QUEUE_TOPOLOGY);
+    for (int i = 0; i < ISSUE_QUEUE_SIZE; i++)
+    {
+        fill_iq_entry(&iq->issue_queue[i], i + instance, 1);
+    }
+    return ISSUE_QUEUE_SIZE;
+}
+
+/* Selects and issues every entry, one select per issue as in APEX_process_iq */
+static void
+iq_select_run(void *state)
+{
+    issue_queue_buffer *iq = state;
+
+    for (int n = 0, fu = 0; n < ISSUE_QUEUE_SIZE; fu = (fu + 1) % (BRANCH_FU + 1))
+    {
+        int index = get_iq_index_fu(iq, fu);
+
+        if (index != -1)
+        {
+            iq->issue_queue[index].is_allocated = 0;
+            n++;
+        }
+    }
+}
+
+static int
+iq_waiting_setup(void *state, int instance)
+{
+    issue_queue_buffer *iq = state;
+
+    for (int i = 0; i < ISSUE_QUEUE_SIZE; i++)
+    {
+        fill_iq_entry(&iq->issue_queue[i], i + instance, 0);
+    }
+    return PHYSICAL_REGISTERS_SIZE;
+}
+
+/* Broadcasts every physical register once to a full queue of waiting entries */
+static void
+iq_wakeup_run(void *state)
+{
+    for (int tag = 0; tag < PHYSICAL_REGISTERS_SIZE; tag++)
+    {
+        iq_wakeup(state, tag, tag);
+    }
+}
+
+//////////////////////////// ROB ////////////////////////////
+
+static void
+fill_rob_entry(reorder_buffer_entry *e, int i)
+{
+    memset(e, 0, sizeof(*e));
+    e->pc_value = 4000 + 4 * i;
+    e->physical_register = i % PHYSICAL_REGISTERS_SIZE;
+    e->destination_address = i % ARCHITECTURAL_REGISTERS_SIZE;
+    e->opcode = OPCODE_ADD;
+    e->seq = i;
+}
+
+static int
+rob_empty_setup(void *state, int instance)
+{
+    reorder_buffer *rob = state;
+
+    memset(rob, 0, sizeof(*rob));
+    rob->head = rob->tail = instance % ROB_SIZE;
+    /* the ROB counts as full one entry short of ROB_SIZE */
+    return ROB_SIZE - 1;
+}
+
+static void
+rob_alloc_run(void *state)
+{
+    reorder_buffer *rob = state;
+    reorder_buffer_entry e;
+    int i = 0;
+
+    while (reorder_buffer_available(rob) != -1)
+    {
+        fill_rob_entry(&e, i++);
+        sink = reorder_buffer_entry_addition_to_queue(rob, &e);
+    }
+}
+
+static int
+rob_full_setup(void *state, int instance)
+{
+    reorder_buffer *rob = state;
+    reorder_buffer_entry e;
+
+    rob_empty_setup(state, instance);
+    for (int i = 0; reorder_buffer_available(rob) != -1; i++)
+    {
+        fill_rob_entry(&e, i);
+        reorder_buffer_entry_addition_to_queue(rob, &e);
+    }
+    return ROB_SIZE - 1;
+}
+
+static void
+rob_commit_run(void *state)
+{
+    reorder_buffer *rob = state;
+
+    while (rob->reorder_buffer_queue[rob->head].is_allocated)
+    {
+        rob_retire_head(rob);
+    }
+}
+
+static int
+rob_squash_setup(void *state, int instance)
+{
+    rob_full_setup(state, instance);
+    return 1;
+}
+
+/* Mispredicted branch at the oldest entry, everything behind it is squashed */
+static void
+rob_squash_run(void *state)
+{
+    reorder_buffer *rob = state;
+
+    rob_squash_after(rob, rob->head);
+}
+
+//////////////////////////// LSQ ////////////////////////////
+
+static void
+fill_lsq_entry(load_store_queue_entry *e, int i)
+{
+    memset(e, 0, sizeof(*e));
+    e->allocate = 1;
+    e->OPCODE = (i & 1) ? OPCODE_STORE : OPCODE_LOAD;
+    e->instruction_type = (i & 1) ? STORE_INS : LOAD_INS;
+    e->src1_store = i % PHYSICAL_REGISTERS_SIZE;
+    e->rob_index = i % ROB_SIZE;
+    e->pc_value = 4000 + 4 * i;
+}
+
+static int
+lsq_empty_setup(void *state, int instance)
+{
+    load_store_queue *lsq = state;
+
+    memset(lsq, 0, sizeof(*lsq));
+    lsq->head = lsq->tail = instance % LSQ_SIZE;
+    return LSQ_SIZE;
+}
+
+static void
+lsq_insert_run(void *state)
+{
+    load_store_queue *lsq = state;
+    load_store_queue_entry e;
+    int i = 0;
+
+    while (lsq_index_available(lsq) != -1)
+    {
+        fill_lsq_entry(&e, i++);
+        sink = lsq_entry_addition_to_queue(lsq, &e);
+    }
+}
+
+static int
+lsq_full_setup(void *state, int instance)
+{
+    load_store_queue *lsq = state;
+    load_store_queue_entry e;
+
+    lsq_empty_setup(state, instance);
+    for (int i = 0; lsq_index_available(lsq) != -1; i++)
+    {
+        fill_lsq_entry(&e, i);
+        lsq_entry_addition_to_queue(lsq, &e);
+    }
+    return PHYSICAL_REGISTERS_SIZE;
+}
+
+/* Associative search of the stores waiting for data, once per physical register */
+static void
+lsq_search_run(void *state)
+{
+    for (int tag = 0; tag < PHYSICAL_REGISTERS_SIZE; tag++)
+    {
+        lsq_store_data_wakeup(state, tag, tag);
+    }
+}
+
+//////////////////////////// FREE LIST ////////////////////////////
+
+static int
+freelist_full_setup(void *state, int instance)
+{
+    init_free_physical_registers(state);
+    return PHYSICAL_REGISTERS_SIZE;
+}
+
+static void
+freelist_pop_run(void *state)
+{
+    for (int i = 0; i < PHYSICAL_REGISTERS_SIZE; i++)
+    {
+        sink = pop_free_physical_registers(state);
+    }
+}
+
+static int
+freelist_empty_setup(void *state, int instance)
+{
+    free_physical_register_list *fpl = state;
+
+    freelist_full_setup(state, instance);
+    while (fpl->free_count > 0)
+    {
+        pop_free_physical_registers(fpl);
+    }
+    return PHYSICAL_REGISTERS_SIZE;
+}
+
+/* Registers freed at commit are released together at the end of the stage */
+static void
+freelist_push_run(void *state)
+{
+    for (int i = 0; i < PHYSICAL_REGISTERS_SIZE; i++)
+    {
+        push_free_physical_registers(state, i);
+    }
+    merge_released_physical_registers(state);
+}
+
+/* Registers of squashed instructions are free again at once, youngest first */
+static void
+freelist_rollback_run(void *state)
+{
+    for (int i = PHYSICAL_REGISTERS_SIZE - 1; i >= 0; i--)
+    {
+        rollback_free_physical_register(state, i);
+    }
+}
+
+/* The rename table restore after a squash asks about every register */
+static void
+freelist_query_run(void *state)
+{
+    for (int i = 0; i < PHYSICAL_REGISTERS_SIZE; i++)
+    {
+        sink += is_free_physical_register(state, i);
+    }
+}
+
+static const microbench benches[] = {
+    {"iq_insert", sizeof(issue_queue_buffer), iq_empty_setup, iq_insert_run},
+    {"iq_select", sizeof(issue_queue_buffer), iq_ready_setup, iq_select_run},
+    {"iq_wakeup", sizeof(issue_queue_buffer), iq_waiting_setup, iq_wakeup_run},
+    {"rob_alloc", sizeof(reorder_buffer), rob_empty_setup, rob_alloc_run},
+    {"rob_commit", sizeof(reorder_buffer), rob_full_setup, rob_commit_run},
+    {"rob_squash", sizeof(reorder_buffer), rob_squash_setup, rob_squash_run},
+    {"lsq_insert", sizeof(load_store_queue), lsq_empty_setup, lsq_insert_run},
+    {"lsq_search", sizeof(load_store_queue), lsq_full_setup, lsq_search_run},
+    {"freelist_pop", sizeof(free_physical_register_list), freelist_full_setup, freelist_pop_run},
+    {"freelist_push", sizeof(free_physical_register_list), freelist_empty_setup, freelist_push_run},
+    {"freelist_rollback", sizeof(free_physical_register_list), freelist_empty_setup, freelist_rollback_run},
+    {"freelist_query", sizeof(free_physical_register_list), freelist_empty_setup, freelist_query_run},
+};
+
+#define NUM_BENCHES (int)(sizeof(benches) / sizeof(benches[0]))
+
+static double
+now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int
+compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* Nanoseconds per operation of every repetition, warmup repetitions are discarded */
+static void
+run_bench(const microbench *b, int warmup, int reps, int batch, microbench_result *res)
+{
+    char *states = malloc(b->state_size * batch);
+    double *samples = malloc(sizeof(double) * reps);
+
+    if (!states || !samples)
+    {
+        fprintf(stderr, "APEX_Error: Out of memory\n");
+        exit(1);
+    }
+    for (int r = -warmup; r < reps; r++)
+    {
+        long ops = 0;
+
+        for (int i = 0; i < batch; i++)
+        {
+            ops += b->setup(states + i * b->state_size, i);
+        }
+        double start = now_ns();
+        for (int i = 0; i < batch; i++)
+        {
+            b->run(states + i * b->state_size);
+        }
+        double elapsed = now_ns() - start;
+        if (r >= 0)
+        {
+            samples[r] = elapsed / ops;
+        }
+    }
+
+    qsort(samples, reps, sizeof(double), compare_double);
+    res->min_ns = samples[0];
+    res->median_ns = samples[reps / 2];
+    res->p99_ns = samples[(int)((reps - 1) * 0.99)];
+    res->mean_ns = 0;
+    for (int r = 0; r < reps; r++)
+    {
+        res->mean_ns += samples[r] / reps;
+    }
+    free(samples);
+    free(states);
+}
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s [-w warmup_reps] [-r reps] [-b batch] [-o csv_file] [benchmark...]\n",
+            prog);
+    fprintf(stderr, "  benchmarks:");
+    for (int i = 0; i < NUM_BENCHES; i++)
+    {
+        fprintf(stderr, " %s", benches[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+int
+main(int argc, char *const argv[])
+{
+    int warmup = 100, reps = 1000, batch = 64;
+    const char *csv_file = NULL;
+    FILE *csv = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:r:b:o:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'w': warmup = atoi(optarg); break;
+            case 'r': reps = atoi(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            case 'o': csv_file = optarg; break;
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+    if (warmup < 0 || reps < 1 || batch < 1)
+    {
+        fprintf(stderr, "APEX_Error: Parameter out of range\n");
+        exit(1);
+    }
+    for (int i = optind; i < argc; i++)
+    {
+        int found = 0;
+
+        for (int j = 0; j < NUM_BENCHES; j++)
+        {
+            found |= strcmp(argv[i], benches[j].name) == 0;
+        }
+        if (!found)
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+    if (csv_file)
+    {
+        csv = fopen(csv_file, "w");
+        if (!csv)
+        {
+            fprintf(stderr, "APEX_Error: Unable to open %s\n", csv_file);
+            exit(1);
+        }
+        fprintf(csv, "benchmark,iq_size,rob_size,lsq_size,prf_size,reps,batch,median_ns,p99_ns,min_ns,mean_ns\n");
+    }
+
+    printf("IQ %d, ROB %d, LSQ %d, PRF %d; %d reps of %d instances after %d warmup reps\n",
+           ISSUE_QUEUE_SIZE, ROB_SIZE, LSQ_SIZE, PHYSICAL_REGISTERS_SIZE, reps, batch, warmup);
+    printf("%-18s %12s %12s %12s\n", "benchmark", "median_ns", "p99_ns", "min_ns");
+    for (int i = 0; i < NUM_BENCHES; i++)
+    {
+        microbench_result res;
+        int selected = optind == argc;
+
+        for (int j = optind; j < argc; j++)
+        {
+            selected |= strcmp(argv[j], benches[i].name) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+        run_bench(&benches[i], warmup, reps, batch, &res);
+        printf("%-18s %12.2f %12.2f %12.2f\n", benches[i].name, res.median_ns, res.p99_ns, res.min_ns);
+        if (csv)
+        {
+            fprintf(csv, "%s,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f\n", benches[i].name,
+                    ISSUE_QUEUE_SIZE, ROB_SIZE, LSQ_SIZE, PHYSICAL_REGISTERS_SIZE, reps, batch,
+                    res.median_ns, res.p99_ns, res.min_ns, res.mean_ns);
+        }
+    }
+    if (csv)
+    {
+        fclose(csv);
+    }
+    return 0;
+}
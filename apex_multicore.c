@@ -0,0 +1,194 @@
+/*
+ * apex_multicore.c
+ * Contains the multicore APEX system. Every core runs on its own host
+ * thread; all threads meet at a barrier every quantum cycles.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "apex_multicore.h"
+
+typedef struct core_thread_arg
+{
+    APEX_System *sys;
+    APEX_CPU *cpu;
+}core_thread_arg;
+
+APEX_System *APEX_system_create(int num_cores, const char *const *filenames, int quantum,
+                                int miss_latency){
+    APEX_System *sys;
+
+    if(num_cores<1 || num_cores>MAX_CORES || quantum<1){
+        return NULL;
+    }
+    sys=calloc(1, sizeof(APEX_System));
+    if(!sys){
+        return NULL;
+    }
+    sys->num_cores=num_cores;
+    sys->quantum=quantum;
+    sys->memory=shared_memory_create(num_cores, miss_latency);
+    if(!sys->memory){
+        free(sys);
+        return NULL;
+    }
+    for(int i=0;i<num_cores;i++){
+        sys->cores[i]=APEX_cpu_init(filenames[i]);
+        if(!sys->cores[i]){
+            APEX_system_destroy(sys);
+            return NULL;
+        }
+        sys->cores[i]->single_step=FALSE;
+        sys->cores[i]->shared_memory=sys->memory;
+        sys->cores[i]->core_id=i;
+    }
+    return sys;
+}
+
+/*
+ * Runs one core a quantum at a time. After each quantum the last thread to
+ * arrive decides whether every core has halted, and a second barrier
+ * publishes that decision before anyone starts the next quantum. No core
+ * starts before every thread exists, so a failed start can still send the
+ * threads already created home without leaving them stuck at the barrier.
+ */
+static void *
+core_thread(void *arg)
+{
+    APEX_System *sys=((core_thread_arg *)arg)->sys;
+    APEX_CPU *cpu=((core_thread_arg *)arg)->cpu;
+    long limit=sys->quantum;
+    int start;
+
+    pthread_mutex_lock(&sys->start_lock);
+    while(sys->start==0){
+        pthread_cond_wait(&sys->start_cond, &sys->start_lock);
+    }
+    start=sys->start;
+    pthread_mutex_unlock(&sys->start_lock);
+    if(start<0){
+        return NULL;
+    }
+    for(;;){
+        while(!cpu->halted && cpu->clock<limit){
+            APEX_cpu_cycle(cpu, (int)(limit-cpu->clock-1));
+        }
+        if(pthread_barrier_wait(&sys->barrier)==PTHREAD_BARRIER_SERIAL_THREAD){
+            int halted=TRUE;
+
+            for(int i=0;i<sys->num_cores;i++){
+                halted&=sys->cores[i]->halted;
+            }
+            sys->all_halted=halted;
+            sys->quanta++;
+        }
+        pthread_barrier_wait(&sys->barrier);
+        if(sys->all_halted){
+            return NULL;
+        }
+        limit+=sys->quantum;
+    }
+}
+
+//opens or aborts the start gate the core threads wait at
+static void release_cores(APEX_System *sys, int start){
+    pthread_mutex_lock(&sys->start_lock);
+    sys->start=start;
+    pthread_cond_broadcast(&sys->start_cond);
+    pthread_mutex_unlock(&sys->start_lock);
+}
+
+//returns 0 once every core has halted, -1 when the threads could not be started
+int APEX_system_run(APEX_System *sys){
+    pthread_t threads[MAX_CORES];
+    core_thread_arg args[MAX_CORES];
+    int started=0;
+
+    if(pthread_barrier_init(&sys->barrier, NULL, sys->num_cores)!=0){
+        return -1;
+    }
+    pthread_mutex_init(&sys->start_lock, NULL);
+    pthread_cond_init(&sys->start_cond, NULL);
+    sys->start=0;
+    while(started<sys->num_cores){
+        args[started].sys=sys;
+        args[started].cpu=sys->cores[started];
+        if(pthread_create(&threads[started], NULL, core_thread, &args[started])!=0){
+            break;
+        }
+        started++;
+    }
+    release_cores(sys, (started==sys->num_cores) ? 1 : -1);
+    for(int i=0;i<started;i++){
+        pthread_join(threads[i], NULL);
+    }
+    pthread_cond_destroy(&sys->start_cond);
+    pthread_mutex_destroy(&sys->start_lock);
+    pthread_barrier_destroy(&sys->barrier);
+    return (started==sys->num_cores) ? 0 : -1;
+}
+
+void APEX_system_print(const APEX_System *sys){
+    long cycles=0, insns=0;
+
+    for(int i=0;i<sys->num_cores;i++){
+        const APEX_CPU *cpu=sys->cores[i];
+        const coherence_stats *cs=&sys->memory->stats[i];
+
+        printf("APEX_CPU[%d]: Simulation Complete, cycles = %d instructions = %d\n", i,
+               cpu->clock, cpu->insn_completed);
+        printf("  L1 hits %llu misses %llu upgrades %llu cache-to-cache %llu writebacks %llu\n",
+               cs->l1_hits, cs->l1_misses, cs->upgrades, cs->cache_to_cache, cs->writebacks);
+        printf("  invalidations sent %llu received %llu, coherence messages %llu\n",
+               cs->invalidations_sent, cs->invalidations_received, cs->messages);
+        if(cpu->load_speculation){
+            printf("  load speculation misses %llu, replays %llu\n", cpu->stats.load_misspeculations,
+                   cpu->stats.load_replays);
+        }
+        if(cpu->uop_cache){
+            printf("  micro-op cache coverage %.1f%%, loops %llu, bubbles removed %llu\n",
+                   100.0*stats_uop_cache_coverage(&cpu->stats), cpu->stats.uop_cache_loops,
+                   cpu->stats.uop_cache_bubbles);
+        }
+        if(cpu->print_cpi_stack){
+            stats_print_cpi_stack(&cpu->stats, stdout);
+        }
+        if(cpu->clock>cycles){
+            cycles=cpu->clock;
+        }
+        insns+=cpu->insn_completed;
+    }
+    printf("APEX_System: %d cores, quantum %d, cycles = %ld instructions = %ld\n",
+           sys->num_cores, sys->quantum, cycles, insns);
+}
+
+void APEX_system_dump_json(const APEX_System *sys, FILE *fp){
+    fprintf(fp, "{\n\"quantum\": %d,\n\"cores\": [\n", sys->quantum);
+    for(int i=0;i<sys->num_cores;i++){
+        const coherence_stats *cs=&sys->memory->stats[i];
+
+        fprintf(fp, "{\"core\": %d,\n\"coherence\": {\"l1_hits\": %llu, \"l1_misses\": %llu, "
+                "\"upgrades\": %llu, \"cache_to_cache\": %llu, \"invalidations_sent\": %llu, "
+                "\"invalidations_received\": %llu, \"writebacks\": %llu, \"messages\": %llu},\n"
+                "\"stats\":\n", i, cs->l1_hits, cs->l1_misses, cs->upgrades, cs->cache_to_cache,
+                cs->invalidations_sent, cs->invalidations_received, cs->writebacks, cs->messages);
+        stats_dump_json(&sys->cores[i]->stats, fp);
+        fprintf(fp, "}%s\n", (i<sys->num_cores-1) ? "," : "");
+    }
+    fprintf(fp, "]\n}\n");
+}
+
+void APEX_system_destroy(APEX_System *sys){
+    if(!sys){
+        return;
+    }
+    for(int i=0;i<sys->num_cores;i++){
+        if(sys->cores[i]){
+            APEX_cpu_stop(sys->cores[i]);
+        }
+    }
+    shared_memory_destroy(sys->memory);
+    free(sys);
+}
@@ -0,0 +1,39 @@
+/*
+ * apex_multicore.h
+ * Contains the multicore APEX system: cores on host threads sharing a
+ * coherent data memory
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_MULTICORE_
+#define _XXYZ_APEX_MULTICORE_
+
+#include <pthread.h>
+#include <stdio.h>
+
+#ifndef _APEX_CPU_H_
+#include "apex_cpu.h"
+#endif
+
+typedef struct APEX_System
+{
+    int num_cores;
+    int quantum;                    /* Cycles between synchronizations, 1 is lockstep */
+    APEX_CPU *cores[MAX_CORES];
+    apex_shared_memory *memory;
+    pthread_barrier_t barrier;
+    pthread_mutex_t start_lock;
+    pthread_cond_t start_cond;
+    int start;                      /* 0 until every core thread exists, -1 aborts the run */
+    int all_halted;                 /* Decided at every synchronization */
+    long quanta;                    /* Synchronizations done */
+}APEX_System;
+
+APEX_System *APEX_system_create(int num_cores, const char *const *filenames, int quantum,
+                                int miss_latency);
+int APEX_system_run(APEX_System *sys);
+void APEX_system_print(const APEX_System *sys);
+void APEX_system_dump_json(const APEX_System *sys, FILE *fp);
+void APEX_system_destroy(APEX_System *sys);
+#endif
@@ -0,0 +1,149 @@
+/*
+ * apex_opcodes.c
+ * Contains the APEX opcode descriptor table and the perfect hash the
+ * parser looks mnemonics up in. Adding an instruction starts with a row here.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <pthread.h>
+#include <string.h>
+#include "apex_opcodes.h"
+
+#define ALU_LATENCY 1
+#define MUL_LATENCY 4               /* Four multiplier stages */
+#define DIV_LATENCY (DIV_SETUP_CYCLES + 32) /* Worst case, see divide_latency */
+#define BRANCH_LATENCY 1
+#define VECTOR_ALU_LATENCY 2
+#define VECTOR_MUL_LATENCY 4
+
+#define RRR (OPERAND_RD | OPERAND_RS1 | OPERAND_RS2)
+#define RRI (OPERAND_RD | OPERAND_RS1 | OPERAND_IMM)
+#define VVV RRR                     /* Vector operands */
+
+const opcode_info opcode_table[NUM_OPCODES] = {
+    /* mnemonic, operands, fu, latency, sets_flags, control, memory, vector */
+    [OPCODE_ADD] = {"ADD", RRR, INT_FU, ALU_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_SUB] = {"SUB", RRR, INT_FU, ALU_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_MUL] = {"MUL", RRR, MUL_FU, MUL_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_DIV] = {"DIV", RRR, DIV_FU, DIV_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_AND] = {"AND", RRR, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_OR] = {"OR", RRR, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_XOR] = {"EXOR", RRR, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_MOVC] = {"MOVC", OPERAND_RD | OPERAND_IMM, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE,
+                     MEMORY_NONE},
+    [OPCODE_LOAD] = {"LOAD", RRI, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE, LOAD_INS},
+    [OPCODE_STORE] = {"STORE", OPERAND_RS1 | OPERAND_RS2 | OPERAND_IMM, INT_FU, ALU_LATENCY, FALSE,
+                      CONTROL_NONE, STORE_INS},
+    [OPCODE_ADDL] = {"ADDL", RRI, INT_FU, ALU_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_SUBL] = {"SUBL", RRI, INT_FU, ALU_LATENCY, TRUE, CONTROL_NONE, MEMORY_NONE},
+    [OPCODE_CMP] = {"CMP", OPERAND_RS1 | OPERAND_RS2, BRANCH_FU, BRANCH_LATENCY, TRUE, CONTROL_NONE,
+                    MEMORY_NONE},
+    [OPCODE_BZ] = {"BZ", OPERAND_IMM, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_CONDITIONAL,
+                   MEMORY_NONE},
+    [OPCODE_BNZ] = {"BNZ", OPERAND_IMM, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_CONDITIONAL,
+                    MEMORY_NONE},
+    [OPCODE_BP] = {"BP", OPERAND_IMM, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_CONDITIONAL,
+                   MEMORY_NONE},
+    [OPCODE_BNP] = {"BNP", OPERAND_IMM, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_CONDITIONAL,
+                    MEMORY_NONE},
+    [OPCODE_JUMP] = {"JUMP", OPERAND_RS1 | OPERAND_IMM, BRANCH_FU, BRANCH_LATENCY, FALSE,
+                     CONTROL_UNCONDITIONAL, MEMORY_NONE},
+    [OPCODE_JALR] = {"JALR", RRI, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_UNCONDITIONAL,
+                     MEMORY_NONE},
+    [OPCODE_RET] = {"RET", OPERAND_RS1, BRANCH_FU, BRANCH_LATENCY, FALSE, CONTROL_UNCONDITIONAL,
+                    MEMORY_NONE},
+    [OPCODE_HALT] = {"HALT", 0, INT_FU, ALU_LATENCY, FALSE, CONTROL_HALT, MEMORY_NONE},
+    [OPCODE_VADD] = {"VADD", RRR, VEC_FU, VECTOR_ALU_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE, VVV},
+    [OPCODE_VSUB] = {"VSUB", RRR, VEC_FU, VECTOR_ALU_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE, VVV},
+    [OPCODE_VMUL] = {"VMUL", RRR, VEC_FU, VECTOR_MUL_LATENCY, FALSE, CONTROL_NONE, MEMORY_NONE, VVV},
+    //unit stride: lane i is the word at the address plus i
+    [OPCODE_VLOAD] = {"VLOAD", RRI, INT_FU, ALU_LATENCY, FALSE, CONTROL_NONE, LOAD_INS, OPERAND_RD},
+    [OPCODE_VSTORE] = {"VSTORE", OPERAND_RS1 | OPERAND_RS2 | OPERAND_IMM, INT_FU, ALU_LATENCY, FALSE,
+                       CONTROL_NONE, STORE_INS, OPERAND_RS1},
+};
+
+/*
+ * Mnemonic lookup. The first lookup searches for a seed under which the
+ * seeded FNV-1a hash sends every mnemonic in the table to its own slot;
+ * a lookup is then one hash and one string compare.
+ */
+#define MNEMONIC_HASH_SLOTS 64
+
+_Static_assert(NUM_OPCODES <= MNEMONIC_HASH_SLOTS / 2, "too few mnemonic hash slots");
+
+static unsigned int hash_seed;
+static signed char hash_slot[MNEMONIC_HASH_SLOTS];
+static pthread_once_t hash_once = PTHREAD_ONCE_INIT;
+
+static unsigned int
+mnemonic_hash(const char *mnemonic, unsigned int seed)
+{
+    unsigned int h = seed;
+
+    for (; *mnemonic; mnemonic++)
+    {
+        h = (h ^ (unsigned char)*mnemonic) * 16777619u;
+    }
+    return (h ^ (h >> 15)) & (MNEMONIC_HASH_SLOTS - 1);
+}
+
+static int
+try_seed(unsigned int seed)
+{
+    memset(hash_slot, -1, sizeof(hash_slot));
+    for (int op = 0; op < NUM_OPCODES; op++)
+    {
+        unsigned int slot;
+
+        if (!opcode_table[op].mnemonic)
+        {
+            continue;
+        }
+        slot = mnemonic_hash(opcode_table[op].mnemonic, seed);
+        if (hash_slot[slot] >= 0)
+        {
+            return FALSE;
+        }
+        hash_slot[slot] = op;
+    }
+    return TRUE;
+}
+
+static void
+build_mnemonic_hash(void)
+{
+    unsigned int seed = 2166136261u;
+
+    //with the table at most half full a seed turns up within a few dozen tries
+    while (!try_seed(seed))
+    {
+        seed++;
+    }
+    hash_seed = seed;
+}
+
+/* Returns the opcode with this mnemonic, -1 if there is none */
+int
+opcode_from_mnemonic(const char *mnemonic)
+{
+    int op;
+
+    pthread_once(&hash_once, build_mnemonic_hash);
+    op = hash_slot[mnemonic_hash(mnemonic, hash_seed)];
+    if (op < 0 || strcmp(opcode_table[op].mnemonic, mnemonic) != 0)
+    {
+        return -1;
+    }
+    return op;
+}
+
+/*
+ * This function returns the mnemonic of a numeric opcode, NULL if the opcode
+ * is unknown
+ */
+const char *
+get_opcode_str(int opcode)
+{
+    return opcode_info_of(opcode)->mnemonic;
+}
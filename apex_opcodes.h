@@ -0,0 +1,77 @@
+/*
+ * apex_opcodes.h
+ * Contains the APEX opcode descriptor table: what the parser and every
+ * pipeline stage need to know about an opcode
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_OPCODES_
+#define _XXYZ_APEX_OPCODES_
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////OPCODE DESCRIPTORS////////////////////////////////
+
+/* Operands an instruction names, always written in this order: Rd, Rs1, Rs2, #imm */
+#define OPERAND_RD 0x1
+#define OPERAND_RS1 0x2
+#define OPERAND_RS2 0x4
+#define OPERAND_IMM 0x8
+
+/* Control flow kind */
+#define CONTROL_NONE 0
+#define CONTROL_CONDITIONAL 1       /* BZ, BNZ, BP, BNP: read the CCR */
+#define CONTROL_UNCONDITIONAL 2     /* JUMP, JALR, RET: target from a register */
+#define CONTROL_HALT 3
+
+/* Not a memory instruction, otherwise LOAD_INS or STORE_INS */
+#define MEMORY_NONE -1
+
+typedef struct opcode_info
+{
+    const char *mnemonic;       /* NULL for an unused opcode */
+    int operands;               /* OPERAND_* bits */
+    int fu;                     /* INT_FU, MUL_FU, BRANCH_FU, VEC_FU or DIV_FU */
+    int latency;                /* Cycles in the FU */
+    int sets_flags;             /* Writes the CCR */
+    int control;                /* CONTROL_* */
+    int memory;                 /* MEMORY_NONE, LOAD_INS or STORE_INS */
+    int vector;                 /* OPERAND_* bits naming vector registers */
+}opcode_info;
+
+extern const opcode_info opcode_table[NUM_OPCODES];
+
+/* Descriptor of an opcode, an all-zero row for an unused one */
+static inline const opcode_info *
+opcode_info_of(int opcode)
+{
+    static const opcode_info unused;
+
+    return ((unsigned)opcode < NUM_OPCODES) ? &opcode_table[opcode] : &unused;
+}
+
+static inline int
+is_conditional_branch(int opcode)
+{
+    return opcode_info_of(opcode)->control == CONTROL_CONDITIONAL;
+}
+
+static inline int
+is_memory_instruction(int opcode)
+{
+    return opcode_info_of(opcode)->memory != MEMORY_NONE;
+}
+
+/* Writes a vector register */
+static inline int
+has_vector_destination(int opcode)
+{
+    return (opcode_info_of(opcode)->vector & OPERAND_RD) != 0;
+}
+
+int opcode_from_mnemonic(const char *mnemonic);
+const char *get_opcode_str(int opcode);
+#endif
@@ -0,0 +1,359 @@
+/*
+ * apex_stats.c
+ * Contains APEX cpu performance counters and their JSON/CSV dump
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include "apex_stats.h"
+#include "apex_cpu.h"
+
+static const char *stall_stage_names[NUM_STALL_STAGES] = {
+    "fetch", "decode_rename", "rename_dispatch", "queue_entry"
+};
+
+static const char *stall_reason_names[NUM_STALL_REASONS] = {
+    "rob_full", "iq_full", "lsq_full", "no_free_phy_reg", "ret_wait",
+    "branch_unresolved", "next_stage_stalled", "icache_miss"
+};
+
+const char *const activity_names[NUM_ACTIVITIES] = {
+    "iq_write", "iq_wakeup", "iq_select", "rob_write", "rob_read", "prf_read", "prf_write",
+    "rename_read", "rename_write", "btb_lookup", "btb_update", "lsq_write", "lsq_search",
+    "int_op", "mul_op", "branch_op", "dmem_read", "dmem_write", "vec_op"
+};
+
+const char *const cpi_cause_names[NUM_CPI_CAUSES] = {
+    "retiring", "memory", "multiply", "operands", "execute", "ret", "branch_refill", "front_end"
+};
+
+void stats_record_stall(apex_stats *stats, int stage, int reason){
+    stats->stall_cycles[stage][reason]++;
+}
+
+void stats_sample_occupancy(apex_stats *stats, int iq_count, int rob_count, int lsq_count){
+    stats->iq_occupancy[iq_count]++;
+    stats->rob_occupancy[rob_count]++;
+    stats->lsq_occupancy[lsq_count]++;
+}
+
+void stats_sample_issue_queues(apex_stats *stats, const int *counts){
+    for(int q=0;q<(int)stats->num_issue_queues;q++){
+        stats->iq_queue_occupancy[q]+=counts[q];
+    }
+}
+
+void stats_record_commit(apex_stats *stats, int opcode){
+    stats->insn_committed++;
+    if(opcode>=0 && opcode<NUM_OPCODES){
+        stats->committed_per_opcode[opcode]++;
+    }
+}
+
+void stats_record_load_latency(apex_stats *stats, int latency){
+    if(latency<0){
+        latency=0;
+    }
+    stats->loads_completed++;
+    stats->load_latency_total+=latency;
+    int bucket=0;
+    while(latency>0 && bucket<LOAD_LATENCY_BUCKETS-1){
+        latency>>=1;
+        bucket++;
+    }
+    stats->load_latency[bucket]++;
+}
+
+/* Range of a load latency bucket: "0", "1", "2-3", ... and "overflow" for the last */
+static void load_latency_label(int bucket, char *buf, size_t size){
+    if(bucket==LOAD_LATENCY_BUCKETS-1){
+        snprintf(buf, size, "overflow");
+    }
+    else if(bucket<=1){
+        snprintf(buf, size, "%d", bucket);
+    }
+    else{
+        snprintf(buf, size, "%ld-%ld", 1L<<(bucket-1), (1L<<bucket)-1);
+    }
+}
+
+void stats_record_fusion(apex_stats *stats, int fusion){
+    switch(fusion){
+        case FUSE_CMP_BRANCH:
+            stats->fused_cmp_branch++;
+            break;
+        case FUSE_MOVC_ADD:
+            stats->fused_movc_add++;
+            break;
+        case FUSE_ADDL_LOAD:
+            stats->fused_addl_load++;
+            break;
+    }
+}
+
+counter_t stats_fused_pairs(const apex_stats *stats){
+    return stats->fused_cmp_branch+stats->fused_movc_add+stats->fused_addl_load;
+}
+
+/* Share of the committed instructions that went through the window fused */
+double stats_fusion_rate(const apex_stats *stats){
+    return stats->insn_committed ? 2.0*stats_fused_pairs(stats)/stats->insn_committed : 0.0;
+}
+
+/* Share of the instructions the front end supplied that came from the micro-op cache */
+double stats_uop_cache_coverage(const apex_stats *stats){
+    counter_t fetched=0;
+
+    for(int t=0;t<SMT_MAX_THREADS;t++){
+        fetched+=stats->thread_fetched[t];
+    }
+    return fetched ? (double)stats->uop_cache_hits/fetched : 0.0;
+}
+
+/* Fetch blocks queued in an average cycle */
+double stats_ftq_occupancy(const apex_stats *stats){
+    return stats->cycles ? (double)stats->ftq_occupancy_sum/stats->cycles : 0.0;
+}
+
+/* Adds the counter changes made since before, times more, as if the cycle ran again */
+void stats_repeat_cycle(apex_stats *stats, const apex_stats *before, counter_t times){
+    counter_t *now=(counter_t *)stats;
+    const counter_t *prev=(const counter_t *)before;
+
+    for(size_t i=0;i<sizeof(apex_stats)/sizeof(counter_t);i++){
+        now[i]+=(now[i]-prev[i])*times;
+    }
+}
+
+/* Committed instructions per cycle of one thread, up to its HALT */
+double stats_thread_ipc(const apex_stats *stats, int thread){
+    counter_t cycles=stats->thread_halt_cycle[thread] ? stats->thread_halt_cycle[thread] : stats->cycles;
+
+    return cycles ? (double)stats->thread_committed[thread]/cycles : 0.0;
+}
+
+/* Prints the CPI as the sum of what each cause contributed */
+void stats_print_cpi_stack(const apex_stats *stats, FILE *fp){
+    double insns=stats->insn_committed ? (double)stats->insn_committed : 1.0;
+
+    fprintf(fp, "APEX_CPU: CPI stack, CPI = %.3f over %llu cycles\n", stats->cycles/insns, stats->cycles);
+    for(int i=0;i<NUM_CPI_CAUSES;i++){
+        fprintf(fp, "APEX_CPU:   %-14s %8.3f  %5.1f%%  %llu cycles\n", cpi_cause_names[i],
+                stats->cpi_stack[i]/insns, stats->cycles ? 100.0*stats->cpi_stack[i]/stats->cycles : 0.0,
+                stats->cpi_stack[i]);
+    }
+}
+
+/* FU classes steered to a queue, joined by '+' as in --iq */
+static void
+print_queue_classes(FILE *fp, counter_t classes)
+{
+    int first=1;
+
+    for(int fu=0;fu<NUM_FU_CLASSES;fu++){
+        if(classes & (1ULL<<fu)){
+            fprintf(fp, "%s%s", first ? "" : "+", iq_class_names[fu]);
+            first=0;
+        }
+    }
+}
+
+static void
+json_histogram(FILE *fp, const char *name, const counter_t *hist, int size)
+{
+    fprintf(fp, "  \"%s\": [", name);
+    for(int i=0;i<size;i++){
+        fprintf(fp, "%s%llu", i ? ", " : "", hist[i]);
+    }
+    fprintf(fp, "],\n");
+}
+
+void stats_dump_json(const apex_stats *stats, FILE *fp){
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"cycles\": %llu,\n", stats->cycles);
+    fprintf(fp, "  \"instructions_committed\": %llu,\n", stats->insn_committed);
+    fprintf(fp, "  \"ipc\": %.4f,\n",
+            stats->cycles ? (double)stats->insn_committed/stats->cycles : 0.0);
+
+    fprintf(fp, "  \"stall_cycles\": {\n");
+    for(int s=0;s<NUM_STALL_STAGES;s++){
+        fprintf(fp, "    \"%s\": {", stall_stage_names[s]);
+        for(int r=0;r<NUM_STALL_REASONS;r++){
+            fprintf(fp, "%s\"%s\": %llu", r ? ", " : "", stall_reason_names[r],
+                    stats->stall_cycles[s][r]);
+        }
+        fprintf(fp, "}%s\n", (s<NUM_STALL_STAGES-1) ? "," : "");
+    }
+    fprintf(fp, "  },\n");
+
+    json_histogram(fp, "iq_occupancy", stats->iq_occupancy, ISSUE_QUEUE_SIZE+1);
+    json_histogram(fp, "rob_occupancy", stats->rob_occupancy, ROB_SIZE+1);
+    json_histogram(fp, "lsq_occupancy", stats->lsq_occupancy, LSQ_SIZE+1);
+    fprintf(fp, "  \"issue_queues\": [\n");
+    for(int q=0;q<(int)stats->num_issue_queues;q++){
+        fprintf(fp, "    {\"classes\": \"");
+        print_queue_classes(fp, stats->iq_queue_classes[q]);
+        fprintf(fp, "\", \"size\": %llu, \"avg_occupancy\": %.4f, \"full_stalls\": %llu}%s\n",
+                stats->iq_queue_size[q],
+                stats->cycles ? (double)stats->iq_queue_occupancy[q]/stats->cycles : 0.0,
+                stats->iq_queue_full[q], (q<(int)stats->num_issue_queues-1) ? "," : "");
+    }
+    fprintf(fp, "  ],\n");
+
+    fprintf(fp, "  \"committed_per_opcode\": {");
+    int first=1;
+    for(int i=0;i<NUM_OPCODES;i++){
+        if(get_opcode_str(i)==NULL){
+            continue;
+        }
+        fprintf(fp, "%s\"%s\": %llu", first ? "" : ", ", get_opcode_str(i),
+                stats->committed_per_opcode[i]);
+        first=0;
+    }
+    fprintf(fp, "},\n");
+
+    fprintf(fp, "  \"branches_resolved\": %llu,\n", stats->branches_resolved);
+    fprintf(fp, "  \"branch_mispredictions\": %llu,\n", stats->branch_mispredictions);
+    fprintf(fp, "  \"flushes\": %llu,\n", stats->flushes);
+    fprintf(fp, "  \"squashed_instructions\": %llu,\n", stats->squashed_insns);
+    fprintf(fp, "  \"loads_completed\": %llu,\n", stats->loads_completed);
+    fprintf(fp, "  \"idle_cycles_skipped\": %llu,\n", stats->idle_cycles_skipped);
+    fprintf(fp, "  \"fusion\": {\"cmp_branch\": %llu, \"movc_add\": %llu, \"addl_load\": %llu, "
+            "\"rate\": %.4f, \"window_entries_saved\": %llu},\n", stats->fused_cmp_branch,
+            stats->fused_movc_add, stats->fused_addl_load, stats_fusion_rate(stats), stats_fused_pairs(stats));
+    fprintf(fp, "  \"rename_elimination\": {\"values\": %llu, \"moves\": %llu},\n", stats->rename_values,
+            stats->rename_moves);
+    fprintf(fp, "  \"load_speculation\": {\"misspeculations\": %llu, \"replays\": %llu},\n",
+            stats->load_misspeculations, stats->load_replays);
+    fprintf(fp, "  \"uop_cache\": {\"loops\": %llu, \"fills\": %llu, \"hits\": %llu, \"coverage\": %.4f, "
+            "\"bubbles_removed\": %llu},\n", stats->uop_cache_loops, stats->uop_cache_fills,
+            stats->uop_cache_hits, stats_uop_cache_coverage(stats), stats->uop_cache_bubbles);
+    fprintf(fp, "  \"front_end\": {\"ftq_blocks\": %llu, \"ftq_occupancy\": %.4f, \"icache_misses\": %llu, "
+            "\"icache_prefetches\": %llu},\n", stats->ftq_blocks, stats_ftq_occupancy(stats),
+            stats->icache_misses, stats->icache_prefetches);
+    fprintf(fp, "  \"cpi_stack\": {");
+    for(int i=0;i<NUM_CPI_CAUSES;i++){
+        fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", cpi_cause_names[i], stats->cpi_stack[i]);
+    }
+    fprintf(fp, "},\n");
+    fprintf(fp, "  \"activity\": {");
+    for(int i=0;i<NUM_ACTIVITIES;i++){
+        fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", activity_names[i], stats->activity[i]);
+    }
+    fprintf(fp, "},\n");
+    if(stats->num_threads>1){
+        fprintf(fp, "  \"threads\": [\n");
+        for(int t=0;t<(int)stats->num_threads;t++){
+            fprintf(fp, "    {\"fetched\": %llu, \"committed\": %llu, \"halt_cycle\": %llu, \"ipc\": %.4f}%s\n",
+                    stats->thread_fetched[t], stats->thread_committed[t], stats->thread_halt_cycle[t],
+                    stats_thread_ipc(stats, t), (t<(int)stats->num_threads-1) ? "," : "");
+        }
+        fprintf(fp, "  ],\n");
+    }
+    fprintf(fp, "  \"load_latency_avg\": %.4f,\n",
+            stats->loads_completed ? (double)stats->load_latency_total/stats->loads_completed : 0.0);
+    fprintf(fp, "  \"load_latency\": {");
+    for(int i=0;i<LOAD_LATENCY_BUCKETS;i++){
+        char label[32];
+        load_latency_label(i, label, sizeof(label));
+        fprintf(fp, "%s\"%s\": %llu", i ? ", " : "", label, stats->load_latency[i]);
+    }
+    fprintf(fp, "}\n");
+    fprintf(fp, "}\n");
+}
+
+/* One counter per row: name,index,value */
+static void
+csv_histogram(FILE *fp, const char *name, const counter_t *hist, int size)
+{
+    for(int i=0;i<size;i++){
+        fprintf(fp, "%s,%d,%llu\n", name, i, hist[i]);
+    }
+}
+
+void stats_dump_csv(const apex_stats *stats, FILE *fp){
+    fprintf(fp, "counter,index,value\n");
+    fprintf(fp, "cycles,,%llu\n", stats->cycles);
+    fprintf(fp, "instructions_committed,,%llu\n", stats->insn_committed);
+    for(int s=0;s<NUM_STALL_STAGES;s++){
+        for(int r=0;r<NUM_STALL_REASONS;r++){
+            fprintf(fp, "stall_cycles.%s,%s,%llu\n", stall_stage_names[s],
+                    stall_reason_names[r], stats->stall_cycles[s][r]);
+        }
+    }
+    csv_histogram(fp, "iq_occupancy", stats->iq_occupancy, ISSUE_QUEUE_SIZE+1);
+    csv_histogram(fp, "rob_occupancy", stats->rob_occupancy, ROB_SIZE+1);
+    csv_histogram(fp, "lsq_occupancy", stats->lsq_occupancy, LSQ_SIZE+1);
+    for(int q=0;q<(int)stats->num_issue_queues;q++){
+        fprintf(fp, "iq_queue_classes,%d,", q);
+        print_queue_classes(fp, stats->iq_queue_classes[q]);
+        fprintf(fp, "\n");
+    }
+    csv_histogram(fp, "iq_queue_size", stats->iq_queue_size, (int)stats->num_issue_queues);
+    csv_histogram(fp, "iq_queue_occupancy", stats->iq_queue_occupancy, (int)stats->num_issue_queues);
+    csv_histogram(fp, "iq_queue_full", stats->iq_queue_full, (int)stats->num_issue_queues);
+    for(int i=0;i<NUM_OPCODES;i++){
+        if(get_opcode_str(i)!=NULL){
+            fprintf(fp, "committed_per_opcode,%s,%llu\n", get_opcode_str(i),
+                    stats->committed_per_opcode[i]);
+        }
+    }
+    fprintf(fp, "branches_resolved,,%llu\n", stats->branches_resolved);
+    fprintf(fp, "branch_mispredictions,,%llu\n", stats->branch_mispredictions);
+    fprintf(fp, "flushes,,%llu\n", stats->flushes);
+    fprintf(fp, "squashed_instructions,,%llu\n", stats->squashed_insns);
+    fprintf(fp, "loads_completed,,%llu\n", stats->loads_completed);
+    fprintf(fp, "idle_cycles_skipped,,%llu\n", stats->idle_cycles_skipped);
+    fprintf(fp, "fused_pairs,cmp_branch,%llu\n", stats->fused_cmp_branch);
+    fprintf(fp, "fused_pairs,movc_add,%llu\n", stats->fused_movc_add);
+    fprintf(fp, "fused_pairs,addl_load,%llu\n", stats->fused_addl_load);
+    fprintf(fp, "rename_elimination,values,%llu\n", stats->rename_values);
+    fprintf(fp, "rename_elimination,moves,%llu\n", stats->rename_moves);
+    fprintf(fp, "load_speculation,misspeculations,%llu\n", stats->load_misspeculations);
+    fprintf(fp, "load_speculation,replays,%llu\n", stats->load_replays);
+    fprintf(fp, "uop_cache,loops,%llu\n", stats->uop_cache_loops);
+    fprintf(fp, "uop_cache,fills,%llu\n", stats->uop_cache_fills);
+    fprintf(fp, "uop_cache,hits,%llu\n", stats->uop_cache_hits);
+    fprintf(fp, "uop_cache,bubbles_removed,%llu\n", stats->uop_cache_bubbles);
+    fprintf(fp, "front_end,ftq_blocks,%llu\n", stats->ftq_blocks);
+    fprintf(fp, "front_end,ftq_occupancy_sum,%llu\n", stats->ftq_occupancy_sum);
+    fprintf(fp, "front_end,icache_misses,%llu\n", stats->icache_misses);
+    fprintf(fp, "front_end,icache_prefetches,%llu\n", stats->icache_prefetches);
+    for(int i=0;i<NUM_CPI_CAUSES;i++){
+        fprintf(fp, "cpi_stack,%s,%llu\n", cpi_cause_names[i], stats->cpi_stack[i]);
+    }
+    for(int i=0;i<NUM_ACTIVITIES;i++){
+        fprintf(fp, "activity,%s,%llu\n", activity_names[i], stats->activity[i]);
+    }
+    if(stats->num_threads>1){
+        csv_histogram(fp, "thread_fetched", stats->thread_fetched, (int)stats->num_threads);
+        csv_histogram(fp, "thread_committed", stats->thread_committed, (int)stats->num_threads);
+        csv_histogram(fp, "thread_halt_cycle", stats->thread_halt_cycle, (int)stats->num_threads);
+    }
+    for(int i=0;i<LOAD_LATENCY_BUCKETS;i++){
+        char label[32];
+        load_latency_label(i, label, sizeof(label));
+        fprintf(fp, "load_latency,%s,%llu\n", label, stats->load_latency[i]);
+    }
+}
+
+int stats_dump_to_file(const apex_stats *stats, const char *filename, int format){
+    FILE *fp;
+
+    if(format==STATS_FORMAT_NONE){
+        return 0;
+    }
+    fp=fopen(filename, "w");
+    if(!fp){
+        return -1;
+    }
+    if(format==STATS_FORMAT_JSON){
+        stats_dump_json(stats, fp);
+    }
+    else{
+        stats_dump_csv(stats, fp);
+    }
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * apex_stats.h
+ * Contains APEX cpu performance counter declarations
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_STATS_
+#define _XXYZ_APEX_STATS_
+
+#include <stdio.h>
+
+#ifndef _MACROS_H_
+#include "apex_macros.h"
+#endif
+
+////////////////////////PERFORMANCE COUNTERS////////////////////////////////////
+
+/* Stages which can be stalled */
+#define STALL_STAGE_FETCH 0
+#define STALL_STAGE_DECODE_RENAME 1
+#define STALL_STAGE_RENAME_DISPATCH 2
+#define STALL_STAGE_QUEUE_ENTRY 3
+#define NUM_STALL_STAGES 4
+
+/* Reasons for a stage to be stalled */
+#define STALL_ROB_FULL 0
+#define STALL_IQ_FULL 1
+#define STALL_LSQ_FULL 2
+#define STALL_NO_FREE_PHY_REG 3
+#define STALL_RET_WAIT 4
+#define STALL_BRANCH_UNRESOLVED 5
+#define STALL_NEXT_STAGE_STALLED 6
+#define STALL_ICACHE_MISS 7
+#define NUM_STALL_REASONS 8
+
+/* Load latencies are bucketed by powers of two: bucket 0 is latency 0, bucket b
+ * covers [2^(b-1), 2^b) and the last bucket counts everything above, the overflow */
+#ifndef LOAD_LATENCY_BUCKETS
+#define LOAD_LATENCY_BUCKETS 20
+#endif
+
+/* Structure accesses counted for the energy model, see apex_energy.c */
+#define ACT_IQ_WRITE 0              /* Dispatch into the IQ */
+#define ACT_IQ_WAKEUP 1             /* Result tag broadcast to the IQ */
+#define ACT_IQ_SELECT 2             /* Entry selected and read out for issue */
+#define ACT_ROB_WRITE 3             /* Allocation or completion */
+#define ACT_ROB_READ 4              /* Commit */
+#define ACT_PRF_READ 5
+#define ACT_PRF_WRITE 6
+#define ACT_RENAME_READ 7           /* Source or CCR lookup */
+#define ACT_RENAME_WRITE 8          /* Destination mapping */
+#define ACT_BTB_LOOKUP 9
+#define ACT_BTB_UPDATE 10
+#define ACT_LSQ_WRITE 11            /* Dispatch or address */
+#define ACT_LSQ_SEARCH 12           /* Store data tag search */
+#define ACT_INT_OP 13
+#define ACT_MUL_OP 14
+#define ACT_BRANCH_OP 15
+#define ACT_DMEM_READ 16
+#define ACT_DMEM_WRITE 17
+#define ACT_VEC_OP 18               /* One vector lane */
+#define NUM_ACTIVITIES 19
+
+/* What each cycle went to, judged at commit; the counts sum to the cycles */
+#define CPI_RETIRING 0              /* At least one instruction committed */
+#define CPI_MEMORY 1                /* ROB head is a load or store in the LSQ or memory unit */
+#define CPI_MULTIPLY 2              /* ROB head is a MUL in the multiplier or a DIV in the divider */
+#define CPI_OPERANDS 3              /* ROB head is waiting in the IQ for operands or a FU */
+#define CPI_EXECUTE 4               /* ROB head is in the integer, branch or vector FU */
+#define CPI_RET 5                   /* ROB empty behind a RET waiting for its target */
+#define CPI_BRANCH_REFILL 6         /* ROB empty after a misprediction flush */
+#define CPI_FRONT_END 7             /* ROB empty, fetch and decode have not delivered */
+#define NUM_CPI_CAUSES 8
+
+#define STATS_FORMAT_NONE 0
+#define STATS_FORMAT_JSON 1
+#define STATS_FORMAT_CSV 2
+
+typedef unsigned long long counter_t;
+
+typedef struct apex_stats
+{
+    counter_t cycles;
+    counter_t insn_committed;
+    counter_t stall_cycles[NUM_STALL_STAGES][NUM_STALL_REASONS];
+    counter_t iq_occupancy[ISSUE_QUEUE_SIZE+1];
+    counter_t rob_occupancy[ROB_SIZE+1];
+    counter_t lsq_occupancy[LSQ_SIZE+1];
+    counter_t committed_per_opcode[NUM_OPCODES];
+    counter_t branches_resolved;
+    counter_t branch_mispredictions;
+    counter_t flushes;
+    counter_t squashed_insns;
+    counter_t loads_completed;
+    counter_t load_latency_total;
+    counter_t load_latency[LOAD_LATENCY_BUCKETS];
+    counter_t idle_cycles_skipped;
+    counter_t num_threads;                          /* Hardware threads, per-thread counters follow */
+    counter_t thread_fetched[SMT_MAX_THREADS];
+    counter_t thread_committed[SMT_MAX_THREADS];
+    counter_t thread_halt_cycle[SMT_MAX_THREADS];   /* 0 while the thread runs */
+    counter_t fused_cmp_branch;                     /* Fused pairs committed, each saved a ROB and IQ entry */
+    counter_t fused_movc_add;
+    counter_t fused_addl_load;
+    counter_t rename_values;                        /* MOVC and moves from committed registers written at rename */
+    counter_t rename_moves;                         /* Moves that share their source's physical register */
+    counter_t load_misspeculations;                 /* Loads that missed after waking their dependents */
+    counter_t load_replays;                         /* Dependents issued too early and replayed */
+    counter_t uop_cache_loops;                      /* Loops the stream detector found */
+    counter_t uop_cache_fills;                      /* Micro-ops decode wrote into the micro-op cache */
+    counter_t uop_cache_hits;                       /* Instructions sent to rename from it, not fetched */
+    counter_t uop_cache_bubbles;                    /* Refill cycles saved: a hit into an empty front end */
+    counter_t ftq_blocks;                           /* Fetch blocks the prediction unit queued */
+    counter_t ftq_occupancy_sum;                    /* Queued blocks, summed over every cycle */
+    counter_t icache_misses;                        /* Lines fetch found missing and filled itself */
+    counter_t icache_prefetches;                    /* Lines the prediction unit fetched ahead */
+    counter_t num_issue_queues;                     /* IQ topology, per-queue counters follow */
+    counter_t iq_queue_classes[MAX_ISSUE_QUEUES];   /* Bit (1 << FU class) per class steered to the queue */
+    counter_t iq_queue_size[MAX_ISSUE_QUEUES];
+    counter_t iq_queue_occupancy[MAX_ISSUE_QUEUES]; /* Entries held, summed over the cycles */
+    counter_t iq_queue_full[MAX_ISSUE_QUEUES];      /* Dispatch stalls on the queue being full */
+    counter_t activity[NUM_ACTIVITIES];             /* Structure accesses, ACT_* */
+    counter_t cpi_stack[NUM_CPI_CAUSES];            /* Cycles per CPI_* cause */
+}apex_stats;
+
+extern const char *const activity_names[NUM_ACTIVITIES];
+extern const char *const cpi_cause_names[NUM_CPI_CAUSES];
+
+void stats_record_stall(apex_stats *stats, int stage, int reason);
+void stats_sample_occupancy(apex_stats *stats, int iq_count, int rob_count, int lsq_count);
+void stats_sample_issue_queues(apex_stats *stats, const int *counts);
+void stats_record_commit(apex_stats *stats, int opcode);
+void stats_record_load_latency(apex_stats *stats, int latency);
+void stats_record_fusion(apex_stats *stats, int fusion);
+counter_t stats_fused_pairs(const apex_stats *stats);
+double stats_fusion_rate(const apex_stats *stats);
+double stats_uop_cache_coverage(const apex_stats *stats);
+double stats_ftq_occupancy(const apex_stats *stats);
+void stats_repeat_cycle(apex_stats *stats, const apex_stats *before, counter_t times);
+double stats_thread_ipc(const apex_stats *stats, int thread);
+void stats_print_cpi_stack(const apex_stats *stats, FILE *fp);
+void stats_dump_json(const apex_stats *stats, FILE *fp);
+void stats_dump_csv(const apex_stats *stats, FILE *fp);
+int stats_dump_to_file(const apex_stats *stats, const char *filename, int format);
+#endif
@@ -0,0 +1,47 @@
+/*
+ * apex_trace.c
+ * Contains the buffered binary writer for APEX pipeline traces
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_trace.h"
+
+/*
+ * File layout: 8 byte magic, then apex_trace_record entries in the order the
+ * events happened. Use apex_trace_convert to get O3PipeView text for Konata.
+ */
+apex_trace_writer *trace_open(const char *filename){
+    apex_trace_writer *tw;
+
+    tw=calloc(1, sizeof(apex_trace_writer));
+    if(!tw){
+        return NULL;
+    }
+    tw->fp=fopen(filename, "wb");
+    if(!tw->fp){
+        free(tw);
+        return NULL;
+    }
+    fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), tw->fp);
+    return tw;
+}
+
+void trace_flush(apex_trace_writer *tw){
+    if(tw->count){
+        fwrite(tw->buffer, sizeof(apex_trace_record), tw->count, tw->fp);
+        tw->count=0;
+    }
+}
+
+void trace_close(apex_trace_writer *tw){
+    if(!tw){
+        return;
+    }
+    trace_flush(tw);
+    fclose(tw->fp);
+    free(tw);
+}
@@ -0,0 +1,69 @@
+/*
+ * apex_trace.h
+ * Contains APEX pipeline trace declarations
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_APEX_TRACE_
+#define _XXYZ_APEX_TRACE_
+
+#include <stdio.h>
+#include <stdint.h>
+
+////////////////////////PIPELINE TRACE////////////////////////////////////
+
+/* Lifecycle events of an instruction, in pipeline order */
+#define TRACE_FETCH 0
+#define TRACE_DECODE 1
+#define TRACE_RENAME 2
+#define TRACE_DISPATCH 3
+#define TRACE_ISSUE 4
+#define TRACE_COMPLETE 5
+#define TRACE_WRITEBACK 6
+#define TRACE_COMMIT 7
+#define TRACE_SQUASH 8
+#define NUM_TRACE_EVENTS 9
+
+#define TRACE_MAGIC "APEXTRC1"
+#define TRACE_BUFFER_RECORDS 4096
+
+/* One event of one instruction, instructions are keyed by fetch sequence number */
+typedef struct apex_trace_record
+{
+    uint32_t seq;
+    uint32_t cycle;
+    uint32_t pc;
+    uint8_t event;
+    uint8_t opcode;
+    uint16_t reserved;
+}apex_trace_record;
+
+typedef struct apex_trace_writer
+{
+    FILE *fp;
+    int count;
+    apex_trace_record buffer[TRACE_BUFFER_RECORDS];
+}apex_trace_writer;
+
+apex_trace_writer *trace_open(const char *filename);
+void trace_flush(apex_trace_writer *tw);
+void trace_close(apex_trace_writer *tw);
+
+static inline void
+trace_event(apex_trace_writer *tw, unsigned int seq, int cycle, int pc, int event, int opcode)
+{
+    apex_trace_record *rec = &tw->buffer[tw->count];
+
+    rec->seq = seq;
+    rec->cycle = cycle;
+    rec->pc = pc;
+    rec->event = event;
+    rec->opcode = opcode;
+    rec->reserved = 0;
+    if (++tw->count == TRACE_BUFFER_RECORDS)
+    {
+        trace_flush(tw);
+    }
+}
+#endif
@@ -0,0 +1,164 @@
+/*
+ * apex_trace_convert.c
+ * Converts a binary APEX pipeline trace into O3PipeView text, which can be
+ * loaded into the Konata pipeline viewer
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "apex_cpu.h"
+
+/* O3PipeView times are in ticks, one cycle is shown as 1000 ticks */
+#define TICKS_PER_CYCLE 1000
+
+/* Cycle of every event of one instruction, -1 if the event did not happen */
+typedef struct trace_insn
+{
+    int cycle[NUM_TRACE_EVENTS];
+    uint32_t pc;
+    int opcode;
+}trace_insn;
+
+static trace_insn *insns;
+static size_t insns_size;
+
+static trace_insn *
+get_insn(uint32_t seq)
+{
+    if (seq >= insns_size)
+    {
+        size_t new_size = insns_size ? insns_size : 1024;
+
+        while (new_size <= seq)
+        {
+            new_size *= 2;
+        }
+        insns = realloc(insns, new_size * sizeof(trace_insn));
+        if (!insns)
+        {
+            fprintf(stderr, "APEX_Error: Out of memory\n");
+            exit(1);
+        }
+        memset(&insns[insns_size], 0xff, (new_size - insns_size) * sizeof(trace_insn));
+        insns_size = new_size;
+    }
+    return &insns[seq];
+}
+
+static long
+ticks(int cycle)
+{
+    return (long)(cycle + 1) * TICKS_PER_CYCLE;
+}
+
+/* A stage the instruction never reached is left out */
+static void
+print_stage(FILE *out, const char *stage, int cycle)
+{
+    if (cycle >= 0)
+    {
+        fprintf(out, "O3PipeView:%s:%ld\n", stage, ticks(cycle));
+    }
+}
+
+static void
+print_o3pipeview(FILE *out, uint32_t seq, const trace_insn *insn)
+{
+    const char *mnemonic = get_opcode_str(insn->opcode);
+    int retire = insn->cycle[TRACE_COMMIT];
+
+    fprintf(out, "O3PipeView:fetch:%ld:0x%08x:0:%u:%s\n", ticks(insn->cycle[TRACE_FETCH]),
+            insn->pc, seq, mnemonic ? mnemonic : "???");
+    print_stage(out, "decode", insn->cycle[TRACE_DECODE]);
+    print_stage(out, "rename", insn->cycle[TRACE_RENAME]);
+    print_stage(out, "dispatch", insn->cycle[TRACE_DISPATCH]);
+    print_stage(out, "issue", insn->cycle[TRACE_ISSUE]);
+    /* the result is complete once it is written back, MOVCs done at rename have none */
+    print_stage(out, "complete", insn->cycle[TRACE_WRITEBACK]);
+    /* As in gem5, a squashed instruction retires at tick 0, which marks it squashed */
+    fprintf(out, "O3PipeView:retire:%ld:store:0\n",
+            (retire >= 0 && insn->cycle[TRACE_SQUASH] < 0) ? ticks(retire) : 0);
+}
+
+int
+main(int argc, char const *argv[])
+{
+    FILE *in, *out = stdout;
+    char magic[8];
+    apex_trace_record rec[TRACE_BUFFER_RECORDS];
+    size_t nread;
+    uint32_t max_seq = 0;
+    int have_records = 0;
+
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, "APEX_Help: Usage %s <trace_file> [output_file]\n", argv[0]);
+        exit(1);
+    }
+
+    in = fopen(argv[1], "rb");
+    if (!in || fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "APEX_Error: %s is not an APEX trace\n", argv[1]);
+        exit(1);
+    }
+
+    if (argc == 3)
+    {
+        out = fopen(argv[2], "w");
+        if (!out)
+        {
+            fprintf(stderr, "APEX_Error: Unable to open %s\n", argv[2]);
+            exit(1);
+        }
+    }
+
+    while ((nread = fread(rec, sizeof(apex_trace_record), TRACE_BUFFER_RECORDS, in)) > 0)
+    {
+        for (size_t i = 0; i < nread; ++i)
+        {
+            trace_insn *insn = get_insn(rec[i].seq);
+
+            if (rec[i].event >= NUM_TRACE_EVENTS)
+            {
+                continue;
+            }
+            /* Keep the first occurrence of an event */
+            if (insn->cycle[rec[i].event] < 0)
+            {
+                insn->cycle[rec[i].event] = rec[i].cycle;
+            }
+            if (rec[i].event == TRACE_FETCH)
+            {
+                insn->pc = rec[i].pc;
+                insn->opcode = rec[i].opcode;
+            }
+            if (rec[i].seq > max_seq)
+            {
+                max_seq = rec[i].seq;
+            }
+            have_records = 1;
+        }
+    }
+    fclose(in);
+
+    for (uint32_t seq = 0; have_records && seq <= max_seq; ++seq)
+    {
+        if (insns[seq].cycle[TRACE_FETCH] >= 0)
+        {
+            print_o3pipeview(out, seq, &insns[seq]);
+        }
+    }
+
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    free(insns);
+    return 0;
+}
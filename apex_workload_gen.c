@@ -0,0 +1,421 @@
+/*
+ * apex_workload_gen.c
+ * Generates parameterized synthetic APEX assembly programs for benchmarking
+ * the simulator
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "apex_macros.h"
+
+/* Programs are assembled in memory first so branch offsets can be computed */
+#define MAX_PROGRAM_SIZE 4096
+#define MAX_LINE 64
+
+/* Register holding 0, used as the base of absolute JUMP/JALR targets */
+#define ZERO_REG 15
+
+/* Call tree link registers are R9..R14, one per level */
+#define FIRST_LINK_REG 9
+#define MAX_CALL_DEPTH 5
+
+typedef struct workload_params
+{
+    int iterations; /* -n: times the main loop body runs */
+    int width;      /* -w: instructions in the loop body / work per leaf */
+    int streams;    /* -k: independent register streams in the alu workload, lanes in vadd */
+    int stride;     /* -s: distance in words between array elements */
+    int depth;      /* -d: call tree depth */
+    int nodes;      /* -p: pointer chase list length */
+    unsigned seed;  /* -r: seed for the pointer chase permutation */
+}workload_params;
+
+static char program[MAX_PROGRAM_SIZE][MAX_LINE];
+static int program_size;
+
+static int
+emit(const char *fmt, ...)
+{
+    va_list args;
+
+    if (program_size == MAX_PROGRAM_SIZE)
+    {
+        fprintf(stderr, "APEX_Error: Program exceeds %d instructions\n", MAX_PROGRAM_SIZE);
+        exit(1);
+    }
+    va_start(args, fmt);
+    vsnprintf(program[program_size], MAX_LINE, fmt, args);
+    va_end(args);
+    return program_size++;
+}
+
+/* PC of the instruction at index, code memory starts at 4000 */
+static int
+pc_of(int index)
+{
+    return 4000 + 4 * index;
+}
+
+/* Relative branch from the next emitted instruction back to index */
+static void
+emit_branch_back(const char *opcode, int index)
+{
+    emit("%s #%d", opcode, 4 * (index - program_size));
+}
+
+/* Decrements the counter in R0 and loops back to index until it is zero */
+static void
+emit_loop_end(int index)
+{
+    emit("SUBL R0,R0,#1");
+    emit_branch_back("BNZ", index);
+}
+
+/* A single chain of dependent additions, one instruction per cycle at best */
+static void
+gen_chain(const workload_params *p)
+{
+    emit("MOVC R0,#%d", p->iterations);
+    emit("MOVC R1,#0");
+    int loop = program_size;
+    for (int i = 0; i < p->width; i++)
+    {
+        emit("ADDL R1,R1,#1");
+    }
+    emit_loop_end(loop);
+    emit("HALT");
+}
+
+/* Independent additions spread round robin over several registers */
+static void
+gen_alu(const workload_params *p)
+{
+    emit("MOVC R0,#%d", p->iterations);
+    for (int k = 1; k <= p->streams; k++)
+    {
+        emit("MOVC R%d,#%d", k, k);
+    }
+    int loop = program_size;
+    for (int i = 0; i < p->width; i++)
+    {
+        int k = 1 + i % p->streams;
+        emit("ADDL R%d,R%d,#%d", k, k, 1 + i % 3);
+    }
+    emit_loop_end(loop);
+    emit("HALT");
+}
+
+/*
+ * Nested counted loops: the inner loop closes with BNZ, the outer loop
+ * leaves through a forward BZ and otherwise jumps back with JUMP
+ */
+static void
+gen_loop(const workload_params *p)
+{
+    emit("MOVC R%d,#0", ZERO_REG);
+    emit("MOVC R0,#%d", p->iterations);
+    emit("MOVC R2,#0");
+    int outer = program_size;
+    emit("MOVC R1,#%d", p->width);
+    int inner = program_size;
+    emit("ADDL R2,R2,#1");
+    emit("SUBL R1,R1,#1");
+    emit_branch_back("BNZ", inner);
+    emit("SUBL R0,R0,#1");
+    emit("BZ #8");
+    emit("JUMP R%d,#%d", ZERO_REG, pc_of(outer));
+    emit("HALT");
+}
+
+/*
+ * Builds a linked list through data memory in a random order, then walks
+ * it with back to back dependent loads
+ */
+static void
+gen_pointer(const workload_params *p)
+{
+    int *order = malloc(p->nodes * sizeof(int));
+
+    srand(p->seed);
+    for (int i = 0; i < p->nodes; i++)
+    {
+        order[i] = i;
+    }
+    for (int i = p->nodes - 1; i > 0; i--)
+    {
+        int j = rand() % (i + 1);
+        int t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+    for (int i = 0; i < p->nodes; i++)
+    {
+        int node = order[i] * p->stride;
+        int next = order[(i + 1) % p->nodes] * p->stride;
+
+        emit("MOVC R1,#%d", next);
+        emit("MOVC R2,#%d", node);
+        emit("STORE R1,R2,#0");
+    }
+    emit("MOVC R0,#%d", p->iterations);
+    emit("MOVC R3,#%d", order[0] * p->stride);
+    int loop = program_size;
+    for (int i = 0; i < p->width; i++)
+    {
+        emit("LOAD R3,R3,#0");
+    }
+    emit_loop_end(loop);
+    emit("HALT");
+    free(order);
+}
+
+/* Fills an array with strided stores, then sums it with strided loads */
+static void
+gen_stride(const workload_params *p)
+{
+    emit("MOVC R%d,#0", ZERO_REG);
+    emit("MOVC R0,#%d", p->iterations);
+    emit("MOVC R6,#0");
+    int outer = program_size;
+    emit("MOVC R1,#0");
+    emit("MOVC R4,#%d", p->width);
+    int store = program_size;
+    emit("STORE R4,R1,#0");
+    emit("ADDL R1,R1,#%d", p->stride);
+    emit("SUBL R4,R4,#1");
+    emit_branch_back("BNZ", store);
+    emit("MOVC R1,#0");
+    emit("MOVC R4,#%d", p->width);
+    int load = program_size;
+    emit("LOAD R5,R1,#0");
+    emit("ADD R6,R6,R5");
+    emit("ADDL R1,R1,#%d", p->stride);
+    emit("SUBL R4,R4,#1");
+    emit_branch_back("BNZ", load);
+    emit("SUBL R0,R0,#1");
+    emit("BZ #8");
+    emit("JUMP R%d,#%d", ZERO_REG, pc_of(outer));
+    emit("HALT");
+}
+
+/*
+ * c[i] = a[i] + b[i] over arrays of -w words at 0, w and 2w. vadd handles
+ * -k elements per VLOAD/VADD/VSTORE and is run with --vector-length=k;
+ * sadd is the same loop one element at a time.
+ */
+static void
+gen_array_add(const workload_params *p, int vector)
+{
+    int lanes = vector ? p->streams : 1;
+
+    emit("MOVC R%d,#0", ZERO_REG);
+    emit("MOVC R0,#%d", p->iterations);
+    int outer = program_size;
+    emit("MOVC R1,#0");
+    emit("MOVC R4,#%d", p->width / lanes);
+    int inner = program_size;
+    if (vector)
+    {
+        emit("VLOAD V0,R1,#0");
+        emit("VLOAD V1,R1,#%d", p->width);
+        emit("VADD V2,V0,V1");
+        emit("VSTORE V2,R1,#%d", 2 * p->width);
+    }
+    else
+    {
+        emit("LOAD R5,R1,#0");
+        emit("LOAD R6,R1,#%d", p->width);
+        emit("ADD R7,R5,R6");
+        emit("STORE R7,R1,#%d", 2 * p->width);
+    }
+    emit("ADDL R1,R1,#%d", lanes);
+    emit("SUBL R4,R4,#1");
+    emit_branch_back("BNZ", inner);
+    emit("SUBL R0,R0,#1");
+    emit("BZ #8");
+    emit("JUMP R%d,#%d", ZERO_REG, pc_of(outer));
+    emit("HALT");
+}
+
+static void
+gen_vadd(const workload_params *p)
+{
+    gen_array_add(p, TRUE);
+}
+
+static void
+gen_sadd(const workload_params *p)
+{
+    gen_array_add(p, FALSE);
+}
+
+/*
+ * A binary call tree of JALR/RET. Level k returns through link register
+ * R9+k and calls level k+1 twice; the leaves do width additions.
+ */
+static void
+gen_call(const workload_params *p)
+{
+    int entry[MAX_CALL_DEPTH + 1];
+    int main_size = 7;
+    int addr = main_size;
+
+    /* Levels are laid out after main, a call site needs the callee's address */
+    for (int k = 0; k <= p->depth; k++)
+    {
+        entry[k] = addr;
+        addr += (k < p->depth) ? 4 : p->width + 1;
+    }
+
+    emit("MOVC R%d,#0", ZERO_REG);
+    emit("MOVC R0,#%d", p->iterations);
+    emit("MOVC R1,#0");
+    int loop = program_size;
+    emit("JALR R%d,R%d,#%d", FIRST_LINK_REG, ZERO_REG, pc_of(entry[0]));
+    emit_loop_end(loop);
+    emit("HALT");
+
+    for (int k = 0; k <= p->depth; k++)
+    {
+        if (k < p->depth)
+        {
+            emit("ADDL R1,R1,#1");
+            emit("JALR R%d,R%d,#%d", FIRST_LINK_REG + k + 1, ZERO_REG, pc_of(entry[k + 1]));
+            emit("JALR R%d,R%d,#%d", FIRST_LINK_REG + k + 1, ZERO_REG, pc_of(entry[k + 1]));
+        }
+        else
+        {
+            for (int i = 0; i < p->width; i++)
+            {
+                emit("ADDL R%d,R%d,#1", 2 + i % 6, 2 + i % 6);
+            }
+        }
+        emit("RET R%d", FIRST_LINK_REG + k);
+    }
+}
+
+typedef struct workload
+{
+    const char *name;
+    const char *help;
+    void (*generate)(const workload_params *p);
+}workload;
+
+static const workload workloads[] = {
+    {"chain", "dependent ADDL chain of -w instructions per iteration", gen_chain},
+    {"alu", "-w independent ADDLs over -k register streams", gen_alu},
+    {"loop", "nested loops, -w inner iterations, BNZ/BZ/JUMP", gen_loop},
+    {"pointer", "random linked list of -p nodes walked by dependent LOADs", gen_pointer},
+    {"stride", "-w strided STOREs then -w strided LOADs, stride -s", gen_stride},
+    {"call", "JALR/RET binary call tree of depth -d, -w ADDLs per leaf", gen_call},
+    {"vadd", "-w element array add, -k lanes per vector instruction", gen_vadd},
+    {"sadd", "-w element array add with scalar LOAD/ADD/STORE", gen_sadd},
+};
+
+#define NUM_WORKLOADS (int)(sizeof(workloads) / sizeof(workloads[0]))
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s <workload> [-n iterations] [-w width] [-k streams]\n"
+                    "           [-s stride] [-d depth] [-p nodes] [-r seed] [-o output_file]\n", prog);
+    for (int i = 0; i < NUM_WORKLOADS; i++)
+    {
+        fprintf(stderr, "  %-8s %s\n", workloads[i].name, workloads[i].help);
+    }
+}
+
+int
+main(int argc, char *const argv[])
+{
+    workload_params p = {1000, 8, 4, 1, 3, 64, 1};
+    const workload *w = NULL;
+    const char *output_file = NULL;
+    FILE *out = stdout;
+    int opt;
+
+    if (argc < 2)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    for (int i = 0; i < NUM_WORKLOADS; i++)
+    {
+        if (strcmp(argv[1], workloads[i].name) == 0)
+        {
+            w = &workloads[i];
+        }
+    }
+    if (!w)
+    {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    optind = 2;
+    while ((opt = getopt(argc, argv, "n:w:k:s:d:p:r:o:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n': p.iterations = atoi(optarg); break;
+            case 'w': p.width = atoi(optarg); break;
+            case 'k': p.streams = atoi(optarg); break;
+            case 's': p.stride = atoi(optarg); break;
+            case 'd': p.depth = atoi(optarg); break;
+            case 'p': p.nodes = atoi(optarg); break;
+            case 'r': p.seed = atoi(optarg); break;
+            case 'o': output_file = optarg; break;
+            default:
+                print_usage(argv[0]);
+                exit(1);
+        }
+    }
+
+    if (p.iterations < 1 || p.width < 1 || p.streams < 1 || p.streams > 8 || p.stride < 1 ||
+        p.depth < 0 || p.depth > MAX_CALL_DEPTH || p.nodes < 1)
+    {
+        fprintf(stderr, "APEX_Error: Parameter out of range\n");
+        exit(1);
+    }
+    if (w->generate == gen_vadd && (p.streams > MAX_VECTOR_LENGTH || p.width % p.streams != 0))
+    {
+        fprintf(stderr, "APEX_Error: vadd needs at most %d lanes dividing the array size\n",
+                MAX_VECTOR_LENGTH);
+        exit(1);
+    }
+    if ((w->generate == gen_stride && p.width * p.stride > DATA_MEMORY_SIZE) ||
+        (w->generate == gen_pointer && p.nodes * p.stride > DATA_MEMORY_SIZE) ||
+        ((w->generate == gen_vadd || w->generate == gen_sadd) && 3 * p.width > DATA_MEMORY_SIZE))
+    {
+        fprintf(stderr, "APEX_Error: Array does not fit in %d words of data memory\n",
+                DATA_MEMORY_SIZE);
+        exit(1);
+    }
+
+    w->generate(&p);
+
+    if (output_file)
+    {
+        out = fopen(output_file, "w");
+        if (!out)
+        {
+            fprintf(stderr, "APEX_Error: Unable to open %s\n", output_file);
+            exit(1);
+        }
+    }
+    for (int i = 0; i < program_size; i++)
+    {
+        fprintf(out, "%s\n", program[i]);
+    }
+    if (out != stdout)
+    {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,16 @@
+MOVC R1,#-2147483648 INT_MIN
+MOVC R2,#-1 -1
+DIV R3,R1,R2 INT_MIN, wraps
+MOVC R4,#-32768 -32768
+MOVC R5,#65536 65536
+MUL R6,R4,R5 INT_MIN
+DIV R7,R6,R2 INT_MIN, wraps
+MOVC R8,#-7 -7
+DIV R9,R8,R2 7
+MOVC R10,#2 2
+DIV R11,R8,R10 -3
+MOVC R12,#0 0
+DIV R13,R1,R12 0
+DIV R14,R1,R4 65536
+ADD R15,R3,R7 0
+HALT
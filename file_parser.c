@@ -1,13 +1,12 @@
 /*
  * file_parser.c
- * Contains functions to parse input file and create code memory, you can edit
- * this file to add new instructions
+ * Contains functions to parse input file and create code memory, new
+ * instructions are added to opcode_table in apex_opcodes.c
  *
  * Author:
  * Copyright (c) 2020, Gaurav Kothari (gkothar1@binghamton.edu)
  * State University of New York at Binghamton
  */
-#include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,259 +35,175 @@ get_num_from_string(const char *buffer)
     return atoi(str);
 }
 
-/*
- * This function sets the numeric opcode to an instruction based on string value
- *
- * Note : you can edit this function to add new instructions
- */
+/* A vector operand is V0..V7, a scalar register operand must not name one */
 static int
-set_opcode_str(const char *opcode_str)
+register_operand_valid(const char *token, int vector)
 {
-    if (strcmp(opcode_str, "ADD") == 0)
-    {
-        return OPCODE_ADD;
-    }
-
-    if (strcmp(opcode_str, "SUB") == 0)
-    {
-        return OPCODE_SUB;
-    }
-    if (strcmp(opcode_str, "ADDL") == 0)
-    {
-        return OPCODE_ADDL;
-    }
-
-    if (strcmp(opcode_str, "SUBL") == 0)
-    {
-        return OPCODE_SUBL;
-    }
-
-    if (strcmp(opcode_str, "MUL") == 0)
-    {
-        return OPCODE_MUL;
-    }
-
-    if (strcmp(opcode_str, "DIV") == 0)
-    {
-        return OPCODE_DIV;
-    }
-
-    if (strcmp(opcode_str, "AND") == 0)
-    {
-        return OPCODE_AND;
-    }
-
-    if (strcmp(opcode_str, "OR") == 0)
-    {
-        return OPCODE_OR;
-    }
-
-    if (strcmp(opcode_str, "EXOR") == 0)
-    {
-        return OPCODE_XOR;
-    }
-
-    if (strcmp(opcode_str, "MOVC") == 0)
-    {
-        return OPCODE_MOVC;
-    }
-
-    if (strcmp(opcode_str, "LOAD") == 0)
+    if (!vector)
     {
-        return OPCODE_LOAD;
+        return token[0] != 'V';
     }
-
-    if (strcmp(opcode_str, "STORE") == 0)
-    {
-        return OPCODE_STORE;
-    }
-
-    if (strcmp(opcode_str, "BZ") == 0)
-    {
-        return OPCODE_BZ;
-    }
-
-    if (strcmp(opcode_str, "BNZ") == 0)
-    {
-        return OPCODE_BNZ;
-    }
-
-    if (strcmp(opcode_str, "HALT") == 0)
-    {
-        return OPCODE_HALT;
-    }
-    //JALR
-    if (strcmp(opcode_str, "JALR") == 0)
-    {
-        return OPCODE_JALR;
-    }
-    //JUMP  
-    if (strcmp(opcode_str, "JUMP") == 0)
-    {
-        return OPCODE_JUMP;
-    }
-    //RET
-    if (strcmp(opcode_str, "RET") == 0)
-    {
-        return OPCODE_RET;
-    }
-    // CMP
-
-    if(strcmp(opcode_str, "CMP") == 0)
-    {
-        return OPCODE_CMP;
-    }
-    printf("%s\n", opcode_str);
-    assert(0 && "Invalid opcode");
-    return 0;
+    return token[0] == 'V' && get_num_from_string(token) >= 0 &&
+           get_num_from_string(token) < VECTOR_REGISTERS_SIZE;
 }
 
 static void
 split_opcode_from_insn_string(char *buffer, char tokens[2][128])
 {
     int token_num = 0;
+    char *save;
 
-    char *token = strtok(buffer, " ");
+    char *token = strtok_r(buffer, " ", &save);
 
-    while (token != NULL)
+    while (token != NULL && token_num < 2)
     {
-        strcpy(tokens[token_num], token);
+        snprintf(tokens[token_num], 128, "%s", token);
         token_num++;
-        token = strtok(NULL, " ");
+        token = strtok_r(NULL, " ", &save);
     }
 }
 
 /*
  * This function is related to parsing input file
  *
- * Note : you can edit this function to add new instructions
+ * Note : the operands an instruction takes come from opcode_table
  */
-static void
+static int
 create_APEX_instruction(APEX_Instruction *ins, char *buffer)
 {
-    int i, token_num = 0;
+    int i, token_num = 0, operands, vector;
     char tokens[6][128];
     char top_level_tokens[2][128];
+    char *save;
 
     for (i = 0; i < 2; ++i)
     {
         strcpy(top_level_tokens[i], "");
     }
+    for (i = 0; i < 6; ++i)
+    {
+        strcpy(tokens[i], "");
+    }
 
     split_opcode_from_insn_string(buffer, top_level_tokens);
 
-    char *token = strtok(top_level_tokens[1], ",");
+    char *token = strtok_r(top_level_tokens[1], ",", &save);
 
-    while (token != NULL)
+    while (token != NULL && token_num < 6)
     {
         strcpy(tokens[token_num], token);
         token_num++;
-        token = strtok(NULL, ",");
+        token = strtok_r(NULL, ",", &save);
     }
 
     strcpy(ins->opcode_str, top_level_tokens[0]);
     //remove trailing and end newline
     ins->opcode_str[strcspn(ins->opcode_str, "\r\n")] = 0;
-    ins->opcode = set_opcode_str(ins->opcode_str);
+    ins->opcode = opcode_from_mnemonic(ins->opcode_str);
+    if (ins->opcode < 0)
+    {
+        return -1;
+    }
 
-    switch (ins->opcode)
+    //the operands come in the order Rd, Rs1, Rs2, #imm, each one only if the opcode has it
+    operands = opcode_info_of(ins->opcode)->operands;
+    vector = opcode_info_of(ins->opcode)->vector;
+    i = 0;
+    for (int operand = OPERAND_RD; operand <= OPERAND_RS2; operand <<= 1)
     {
-        case OPCODE_ADD:
-        case OPCODE_SUB:
-        case OPCODE_MUL:
-        case OPCODE_DIV:
-        case OPCODE_AND:
-        case OPCODE_OR:
-        case OPCODE_XOR:
-        {
-            ins->rd = get_num_from_string(tokens[0]);
-            ins->rs1 = get_num_from_string(tokens[1]);
-            ins->rs2 = get_num_from_string(tokens[2]);
-            break;
-        }
-        case OPCODE_ADDL:
-        case OPCODE_SUBL:
+        if ((operands & operand) && !register_operand_valid(tokens[i++], vector & operand))
         {
-            ins->rd = get_num_from_string(tokens[0]);
-            ins->rs1 = get_num_from_string(tokens[1]);
-            ins->imm = get_num_from_string(tokens[2]);
-            break;
+            return -1;
         }
+    }
+    i = 0;
+    if (operands & OPERAND_RD)
+    {
+        ins->rd = get_num_from_string(tokens[i++]);
+    }
+    if (operands & OPERAND_RS1)
+    {
+        ins->rs1 = get_num_from_string(tokens[i++]);
+    }
+    if (operands & OPERAND_RS2)
+    {
+        ins->rs2 = get_num_from_string(tokens[i++]);
+    }
+    if (operands & OPERAND_IMM)
+    {
+        ins->imm = get_num_from_string(tokens[i++]);
+    }
+    return 0;
+}
 
-        case OPCODE_MOVC:
-        {
-            ins->rd = get_num_from_string(tokens[0]);
-            ins->imm = get_num_from_string(tokens[1]);
-            break;
-        }
+/*
+ * Parses a program held in memory, one instruction per line. Returns NULL if
+ * the program is empty or cannot be parsed; *error_line is then the 1-based
+ * line at fault, 0 for an empty program or allocation failure.
+ */
+APEX_Instruction *
+create_code_memory_from_buffer(const char *program, size_t length, int *size, int *error_line)
+{
+    int code_memory_size = 0;
+    APEX_Instruction *code_memory;
+    const char *end = program + length;
+    const char *line = program;
+    char buffer[256];
 
-        case OPCODE_LOAD:
+    *size = 0;
+    *error_line = 0;
+    for (const char *c = program; c < end; ++c)
+    {
+        if (*c == '\n' || c == end - 1)
         {
-            ins->rd = get_num_from_string(tokens[0]);
-            ins->rs1 = get_num_from_string(tokens[1]);
-            ins->imm = get_num_from_string(tokens[2]);
-            break;
+            code_memory_size++;
         }
+    }
+    if (!code_memory_size)
+    {
+        return NULL;
+    }
 
-        case OPCODE_STORE:
-        {
-            ins->rs1 = get_num_from_string(tokens[0]);
-            ins->rs2 = get_num_from_string(tokens[1]);
-            ins->imm = get_num_from_string(tokens[2]);
-            break;
-        }
+    code_memory = calloc(code_memory_size, sizeof(APEX_Instruction));
+    if (!code_memory)
+    {
+        return NULL;
+    }
 
-        case OPCODE_BZ:
-        case OPCODE_BNZ:
-        case OPCODE_BP:
-        case OPCODE_BNP:
-        {
-            ins->imm = get_num_from_string(tokens[0]);
-            break;
-        }
-        case OPCODE_JUMP:
-        {
-            ins->rs1 = get_num_from_string(tokens[0]);
-            ins->imm = get_num_from_string(tokens[1]);
-            break;
-        }
-        case OPCODE_JALR:
-        {
-            ins->rd = get_num_from_string(tokens[0]);
-            ins->rs1 = get_num_from_string(tokens[1]);
-            ins->imm = get_num_from_string(tokens[2]);
-            break;
-        }
-        case OPCODE_RET:
+    for (int i = 0; i < code_memory_size; ++i)
+    {
+        const char *eol = memchr(line, '\n', end - line);
+        size_t len = (eol ? eol : end) - line;
+
+        if (len >= sizeof(buffer))
         {
-            ins->rs1 = get_num_from_string(tokens[0]);
-            break;
+            len = sizeof(buffer) - 1;
         }
-
-        case OPCODE_CMP:
+        memcpy(buffer, line, len);
+        buffer[len] = '\0';
+        if (create_APEX_instruction(&code_memory[i], buffer) != 0)
         {
-            ins->rs1 = get_num_from_string(tokens[0]);
-            ins->rs2 = get_num_from_string(tokens[1]);
-            break;
+            *error_line = i + 1;
+            free(code_memory);
+            return NULL;
         }
+        line = eol ? eol + 1 : end;
     }
-    /* Fill in rest of the instructions accordingly */
+
+    *size = code_memory_size;
+    return code_memory;
 }
 
 /*
  * This function is related to parsing input file
- *
- * Note : You are not supposed to edit this function
  */
 APEX_Instruction *
 create_code_memory(const char *filename, int *size)
 {
     FILE *fp;
-    ssize_t nread;
-    size_t len = 0;
-    char *line = NULL;
-    int code_memory_size = 0;
-    int current_instruction = 0;
+    long length;
+    char *program;
+    int error_line;
     APEX_Instruction *code_memory;
 
     if (!filename)
@@ -302,32 +217,23 @@ create_code_memory(const char *filename, int *size)
         return NULL;
     }
 
-    while ((nread = getline(&line, &len, fp)) != -1)
-    {
-        code_memory_size++;
-    }
-    *size = code_memory_size;
-    if (!code_memory_size)
-    {
-        fclose(fp);
-        return NULL;
-    }
-
-    code_memory = calloc(code_memory_size, sizeof(APEX_Instruction));
-    if (!code_memory)
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    rewind(fp);
+    program = malloc(length + 1);
+    if (!program || fread(program, 1, length, fp) != (size_t)length)
     {
+        free(program);
         fclose(fp);
         return NULL;
     }
+    fclose(fp);
 
-    rewind(fp);
-    while ((nread = getline(&line, &len, fp)) != -1)
+    code_memory = create_code_memory_from_buffer(program, length, size, &error_line);
+    if (!code_memory && error_line)
     {
-        create_APEX_instruction(&code_memory[current_instruction], line);
-        current_instruction++;
+        fprintf(stderr, "APEX_Error: Invalid instruction on line %d of %s\n", error_line, filename);
     }
-
-    free(line);
-    fclose(fp);
+    free(program);
     return code_memory;
-}
\ No newline at end of file
+}
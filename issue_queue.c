@@ -7,18 +7,152 @@
  * State University of New York at Binghamton
  */
 #include <stdio.h>
+#include <string.h>
 ////////////////////////ISSUE_QUEUE////////////////////////////////////
 #include  "issue_queue.h"
 
-int issue_buffer_index_available(issue_queue_buffer *iq){
-     for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
-        if(iq->issue_queue[i].is_allocated==0){
-            return i;
+const char *const iq_class_names[NUM_FU_CLASSES]={"int", "mul", "branch", NULL, "vec", "div"};
+
+//FU class named by the len characters at name, -1 if there is none
+static int iq_class_of_name(const char *name, size_t len){
+    for(int fu=0;fu<NUM_FU_CLASSES;fu++){
+        if(iq_class_names[fu] && strlen(iq_class_names[fu])==len && strncmp(name, iq_class_names[fu], len)==0){
+            return fu;
         }
     }
     return -1;
 }
 
+/*
+ * Writes the queue list a named topology stands for into out, with an
+ * optional :oldest or :position applied to every queue. Returns -1 if
+ * spec is not a named topology.
+ */
+static int iq_expand_topology(const char *spec, char *out, size_t n){
+    size_t len=strcspn(spec, ":");
+    const char *select=spec+len;
+    int mul=ISSUE_QUEUE_SIZE/8 ? ISSUE_QUEUE_SIZE/8 : 1;
+    int branch=ISSUE_QUEUE_SIZE/4 ? ISSUE_QUEUE_SIZE/4 : 1;
+    int long_latency=ISSUE_QUEUE_SIZE*3/8 ? ISSUE_QUEUE_SIZE*3/8 : 1;
+
+    if(len==7 && strncmp(spec, "unified", 7)==0){
+        snprintf(out, n, "int+mul+branch+vec+div:%d%s", ISSUE_QUEUE_SIZE, select);
+    }
+    else if(len==5 && strncmp(spec, "split", 5)==0){
+        //vector operations and divides are rare, one entry each
+        snprintf(out, n, "int:%d%s,mul:%d%s,branch:%d%s,vec:1%s,div:1%s",
+                 ISSUE_QUEUE_SIZE-mul-branch-2, select, mul, select, branch, select, select, select);
+    }
+    else if(len==7 && strncmp(spec, "cluster", 7)==0){
+        snprintf(out, n, "int+branch:%d%s,mul+div+vec:%d%s", ISSUE_QUEUE_SIZE-long_latency, select,
+                 long_latency, select);
+    }
+    else{
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Sets config from a topology: unified, split or cluster, or a comma
+ * separated list of queues "<class>[+<class>...]:<size>[:oldest|:position]"
+ * where the classes are int, mul, branch, vec and div. Every class must be
+ * in one queue and the sizes may add up to at most ISSUE_QUEUE_SIZE.
+ * Returns -1, leaving config as it was, if spec is not a valid topology.
+ */
+int iq_configure(issue_queue_config *config, const char *spec){
+    issue_queue_config c;
+    char expanded[256];
+    const char *p;
+    int total=0;
+
+    memset(&c, 0, sizeof(c));
+    for(int fu=0;fu<NUM_FU_CLASSES;fu++){
+        c.queue_of_fu[fu]=-1;
+    }
+    if(iq_expand_topology(spec, expanded, sizeof(expanded))==0){
+        spec=expanded;
+    }
+    p=spec;
+    while(*p){
+        int q=c.num_queues;
+        int size, used;
+
+        if(q==MAX_ISSUE_QUEUES){
+            return -1;
+        }
+        //the classes steered to this queue
+        while(1){
+            size_t len=strcspn(p, "+:,");
+            int fu=iq_class_of_name(p, len);
+
+            if(fu<0 || c.queue_of_fu[fu]>=0){
+                return -1;
+            }
+            c.queue_of_fu[fu]=q;
+            p+=len;
+            if(*p!='+'){
+                break;
+            }
+            p++;
+        }
+        if(*p!=':' || sscanf(p+1, "%d%n", &size, &used)!=1 || size<=0){
+            return -1;
+        }
+        p+=1+used;
+        c.size[q]=size;
+        c.select[q]=IQ_SELECT_OLDEST;
+        if(*p==':'){
+            size_t len=strcspn(p+1, ",");
+
+            if(len==8 && strncmp(p+1, "position", 8)==0){
+                c.select[q]=IQ_SELECT_POSITION;
+            }
+            else if(len!=6 || strncmp(p+1, "oldest", 6)!=0){
+                return -1;
+            }
+            p+=1+len;
+        }
+        if(*p==','){
+            p++;
+        }
+        else if(*p){
+            return -1;
+        }
+        total+=size;
+        c.num_queues++;
+    }
+    for(int fu=0;fu<NUM_FU_CLASSES;fu++){
+        if(iq_class_names[fu] && c.queue_of_fu[fu]<0){
+            return -1;
+        }
+    }
+    if(total>ISSUE_QUEUE_SIZE){
+        return -1;
+    }
+    *config=c;
+    return 0;
+}
+
+//steers an instruction of FU class fu: a free entry if its queue has room, else -1
+int issue_buffer_index_available(issue_queue_buffer *iq, int fu){
+    int queue=iq->config.queue_of_fu[fu];
+    int free_index=-1;
+    int count=0;
+
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated==0){
+            if(free_index==-1){
+                free_index=i;
+            }
+        }
+        else if(iq->config.queue_of_fu[iq->issue_queue[i].FU]==queue){
+            count++;
+        }
+    }
+    return count<iq->config.size[queue] ? free_index : -1;
+}
+
 void iq_entry_addition(issue_queue_buffer *iq,issue_queue_entry *iq_entry,int iq_index){
     iq->issue_queue[iq_index].is_allocated=1;
     iq->issue_queue[iq_index].dest_tag=iq_entry->dest_tag;
@@ -35,6 +169,13 @@ void iq_entry_addition(issue_queue_buffer *iq,issue_queue_entry *iq_entry,int iq
     iq->issue_queue[iq_index].pc_value=iq_entry->pc_value;
     iq->issue_queue[iq_index].counter=iq_entry->counter;
     iq->issue_queue[iq_index].opcode=iq_entry->opcode;
+    iq->issue_queue[iq_index].seq=iq_entry->seq;
+    iq->issue_queue[iq_index].thread=iq_entry->thread;
+    iq->issue_queue[iq_index].fusion=iq_entry->fusion;
+    memcpy(iq->issue_queue[iq_index].src1_lanes, iq_entry->src1_lanes, sizeof(iq_entry->src1_lanes));
+    memcpy(iq->issue_queue[iq_index].src2_lanes, iq_entry->src2_lanes, sizeof(iq_entry->src2_lanes));
+    iq->issue_queue[iq_index].src1_speculative=0;
+    iq->issue_queue[iq_index].src2_speculative=0;
 }
 
 
@@ -86,12 +227,13 @@ void print_iq_entries(issue_queue_buffer *iq){
 int get_iq_index_fu(issue_queue_buffer *iq, int fu){
     int temp_index=-1;
     int counter=-1;
+    int oldest=iq->config.select[iq->config.queue_of_fu[fu]]==IQ_SELECT_OLDEST;
     for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
         if(iq->issue_queue[i].is_allocated ==1 && iq->issue_queue[i].FU==fu){
             iq->issue_queue[i].counter++;
             if (iq->issue_queue[i].src2_valid ==1 && iq->issue_queue[i].src1_valid==1)
             {   
-                if(iq->issue_queue[i].counter>counter){
+                if(temp_index==-1 || (oldest && iq->issue_queue[i].counter>counter)){
                     temp_index=i;
                     counter=iq->issue_queue[i].counter;
                 }
@@ -101,3 +243,111 @@ int get_iq_index_fu(issue_queue_buffer *iq, int fu){
     return temp_index;
 }
 
+//broadcast a produced physical register to every waiting source operand
+void iq_wakeup(issue_queue_buffer *iq, int tag, int value){
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated==1){
+            if((!iq->issue_queue[i].src1_valid || iq->issue_queue[i].src1_speculative) &&
+               iq->issue_queue[i].src1_tag==tag){
+                iq->issue_queue[i].src1_value=value;
+                iq->issue_queue[i].src1_valid=1;
+                iq->issue_queue[i].src1_speculative=0;
+            }
+            if((!iq->issue_queue[i].src2_valid || iq->issue_queue[i].src2_speculative) &&
+               iq->issue_queue[i].src2_tag==tag){
+                iq->issue_queue[i].src2_value=value;
+                iq->issue_queue[i].src2_valid=1;
+                iq->issue_queue[i].src2_speculative=0;
+            }
+        }
+    }
+}
+
+//marks the sources waiting on tag ready before its value is known
+void iq_speculative_wakeup(issue_queue_buffer *iq, int tag){
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated==1){
+            if(!iq->issue_queue[i].src1_valid && iq->issue_queue[i].src1_tag==tag){
+                iq->issue_queue[i].src1_valid=1;
+                iq->issue_queue[i].src1_speculative=1;
+            }
+            if(!iq->issue_queue[i].src2_valid && iq->issue_queue[i].src2_tag==tag){
+                iq->issue_queue[i].src2_valid=1;
+                iq->issue_queue[i].src2_speculative=1;
+            }
+        }
+    }
+}
+
+/*
+ * Called for a selected entry. If a source was woken speculatively the
+ * entry stays in the IQ waiting for it again and TRUE is returned.
+ */
+int iq_replay_speculative(issue_queue_buffer *iq, int index){
+    issue_queue_entry *e=&iq->issue_queue[index];
+
+    if(!e->src1_speculative && !e->src2_speculative){
+        return 0;
+    }
+    if(e->src1_speculative){
+        e->src1_valid=0;
+        e->src1_speculative=0;
+    }
+    if(e->src2_speculative){
+        e->src2_valid=0;
+        e->src2_speculative=0;
+    }
+    return 1;
+}
+
+//broadcast a produced vector register, its tags never match a scalar source
+void iq_vector_wakeup(issue_queue_buffer *iq, int tag, const int *lanes){
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated==1){
+            if(!iq->issue_queue[i].src1_valid && iq->issue_queue[i].src1_tag==tag){
+                memcpy(iq->issue_queue[i].src1_lanes, lanes, sizeof(iq->issue_queue[i].src1_lanes));
+                iq->issue_queue[i].src1_valid=1;
+            }
+            if(!iq->issue_queue[i].src2_valid && iq->issue_queue[i].src2_tag==tag){
+                memcpy(iq->issue_queue[i].src2_lanes, lanes, sizeof(iq->issue_queue[i].src2_lanes));
+                iq->issue_queue[i].src2_valid=1;
+            }
+        }
+    }
+}
+
+int iq_occupancy(issue_queue_buffer *iq){
+    int count=0;
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated){
+            count++;
+        }
+    }
+    return count;
+}
+
+//entries held in each queue of the topology, returns the total
+int iq_queue_occupancy(issue_queue_buffer *iq, int *counts){
+    int count=0;
+    for(int q=0;q<iq->config.num_queues;q++){
+        counts[q]=0;
+    }
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated){
+            counts[iq->config.queue_of_fu[iq->issue_queue[i].FU]]++;
+            count++;
+        }
+    }
+    return count;
+}
+
+//entries held by one hardware thread, ICOUNT fetch policy
+int iq_thread_occupancy(issue_queue_buffer *iq, int thread){
+    int count=0;
+    for(int i=0;i<ISSUE_QUEUE_SIZE;i++){
+        if(iq->issue_queue[i].is_allocated && iq->issue_queue[i].thread==thread){
+            count++;
+        }
+    }
+    return count;
+}
@@ -35,16 +35,50 @@ typedef struct issue_queue_entry
     int counter;
     int opcode;
     int pc_value;
+    unsigned int seq;
+    int thread;
+    int fusion;         /* FUSE_* pair this micro-op was decoded from */
+    int src1_lanes[MAX_VECTOR_LENGTH];  /* Vector sources, captured like the scalar values */
+    int src2_lanes[MAX_VECTOR_LENGTH];
+    int src1_speculative;   /* Woken for a load assumed to hit, the value is not there yet */
+    int src2_speculative;
 }issue_queue_entry;
 
+/* How a queue picks among its ready entries */
+#define IQ_SELECT_OLDEST 0          /* Highest age counter */
+#define IQ_SELECT_POSITION 1        /* Lowest entry number, a fixed-priority picker */
+
+/*
+ * Queues the entries are divided into. Each FU class is steered to one
+ * queue, which holds at most size entries of the shared storage.
+ */
+typedef struct issue_queue_config
+{
+    int num_queues;
+    int queue_of_fu[NUM_FU_CLASSES];    /* -1 for MEM_FU */
+    int size[MAX_ISSUE_QUEUES];
+    int select[MAX_ISSUE_QUEUES];       /* IQ_SELECT_* */
+}issue_queue_config;
+
 typedef struct issue_queue_buffer
 {
     issue_queue_entry issue_queue[ISSUE_QUEUE_SIZE];
+    issue_queue_config config;
 }issue_queue_buffer;
 
+extern const char *const iq_class_names[NUM_FU_CLASSES];
+
+int iq_configure(issue_queue_config *config, const char *spec);
 void iq_entry_addition(issue_queue_buffer *iq,issue_queue_entry *iq_entry,int iq_index);
-int issue_buffer_index_available(issue_queue_buffer *iq);
+int issue_buffer_index_available(issue_queue_buffer *iq, int fu);
 void print_iq_indexes(issue_queue_buffer *iq);
 void print_iq_entries(issue_queue_buffer *iq);
 int get_iq_index_fu(issue_queue_buffer *iq, int fu);
+void iq_wakeup(issue_queue_buffer *iq, int tag, int value);
+void iq_vector_wakeup(issue_queue_buffer *iq, int tag, const int *lanes);
+void iq_speculative_wakeup(issue_queue_buffer *iq, int tag);
+int iq_replay_speculative(issue_queue_buffer *iq, int index);
+int iq_occupancy(issue_queue_buffer *iq);
+int iq_queue_occupancy(issue_queue_buffer *iq, int *counts);
+int iq_thread_occupancy(issue_queue_buffer *iq, int thread);
 #endif
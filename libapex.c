@@ -0,0 +1,275 @@
+/*
+ * libapex.c
+ * Contains the embedding API of the APEX simulator
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "apex_cpu.h"
+#include "libapex.h"
+
+void APEX_config_default(APEX_Config *config){
+    memset(config, 0, sizeof(APEX_Config));
+    config->memory_latency=DATA_MEMORY_LATENCY;
+    config->idle_skip=ENABLE_IDLE_SKIP;
+    config->trace_file=NULL;
+}
+
+//an APEX_ON / APEX_OFF switch, 0 keeps the build's default
+static int
+switch_value(int option, int fallback)
+{
+    if(option==0){
+        return fallback;
+    }
+    return option>0;
+}
+
+/* Applies the fields past trace_file, returns -1 if one is out of range */
+static int
+apply_options(APEX_CPU *cpu, const APEX_Config *config)
+{
+    if(config->fusion>0 && (config->fusion & ~FUSE_ALL)){
+        return -1;
+    }
+    if(config->fusion){
+        cpu->fusion_pairs=config->fusion<0 ? FUSE_NONE : config->fusion;
+    }
+    if(config->issue_queues){
+        issue_queue_config iq_config;
+
+        if(iq_configure(&iq_config, config->issue_queues)!=0){
+            return -1;
+        }
+        APEX_cpu_set_issue_queues(cpu, &iq_config);
+    }
+    if(config->vector_length<0 || config->vector_length>MAX_VECTOR_LENGTH){
+        return -1;
+    }
+    if(config->vector_length){
+        cpu->vector_length=config->vector_length;
+    }
+    if(config->fetch_policy<0 || config->fetch_policy>FETCH_POLICY_ICOUNT ||
+       config->rob_partition<0 || config->rob_partition>PARTITION_SHARED ||
+       config->lsq_partition<0 || config->lsq_partition>PARTITION_SHARED){
+        return -1;
+    }
+    cpu->fetch_policy=config->fetch_policy;
+    cpu->rob_partition=config->rob_partition;
+    cpu->lsq_partition=config->lsq_partition;
+    cpu->rename_elimination=switch_value(config->rename_elimination, ENABLE_RENAME_ELIMINATION);
+    cpu->load_speculation=switch_value(config->load_speculation, ENABLE_LOAD_SPECULATION);
+    if(config->load_spec_latency<0){
+        return -1;
+    }
+    if(config->load_spec_latency){
+        cpu->load_spec_latency=config->load_spec_latency;
+    }
+    cpu->uop_cache=switch_value(config->uop_cache, ENABLE_UOP_CACHE);
+    cpu->decoupled_front_end=switch_value(config->decoupled_front_end, ENABLE_DECOUPLED_FRONT_END);
+    if(config->icache_latency){
+        cpu->icache_latency=config->icache_latency<0 ? 0 : config->icache_latency;
+    }
+    if(config->smt_threads<0 || config->smt_threads>=SMT_MAX_THREADS){
+        return -1;
+    }
+    for(int i=0;i<config->smt_threads;i++){
+        const char *program=config->smt_programs[i];
+        APEX_Instruction *code_memory;
+        int size=0, line;
+
+        if(!program){
+            return -1;
+        }
+        code_memory=create_code_memory_from_buffer(program, strlen(program), &size, &line);
+        if(APEX_cpu_add_thread_from_code(cpu, code_memory, size)<0){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+APEX_CPU *APEX_create(const APEX_Config *config, const char *program, size_t length,
+                      int *error_line){
+    APEX_Config defaults;
+    APEX_Instruction *code_memory;
+    APEX_CPU *cpu;
+    int code_memory_size, line;
+
+    if(!config){
+        APEX_config_default(&defaults);
+        config=&defaults;
+    }
+    code_memory=create_code_memory_from_buffer(program, length, &code_memory_size, &line);
+    if(error_line){
+        *error_line=line;
+    }
+    cpu=APEX_cpu_init_from_code(code_memory, code_memory_size);
+    if(!cpu){
+        return NULL;
+    }
+    cpu->single_step=FALSE;
+    cpu->memory_latency=config->memory_latency>0 ? config->memory_latency : DATA_MEMORY_LATENCY;
+    cpu->idle_skip=config->idle_skip;
+    if(apply_options(cpu, config)!=0){
+        APEX_cpu_stop(cpu);
+        return NULL;
+    }
+    if(config->trace_file){
+        cpu->trace=trace_open(config->trace_file);
+        if(!cpu->trace){
+            APEX_cpu_stop(cpu);
+            return NULL;
+        }
+    }
+    return cpu;
+}
+
+void APEX_destroy(APEX_CPU *cpu){
+    if(cpu){
+        APEX_cpu_stop(cpu);
+    }
+}
+
+void APEX_reset(APEX_CPU *cpu){
+    APEX_cpu_reset(cpu);
+}
+
+/* Simulates one cycle plus any idle cycles that fit in budget, returns the cycles taken */
+static long
+cycle_within(APEX_CPU *cpu, long budget)
+{
+    int before=cpu->clock;
+    long spare=budget-1;
+
+    APEX_cpu_cycle(cpu, spare>INT_MAX ? INT_MAX : (int)spare);
+    return cpu->clock-before;
+}
+
+long APEX_step(APEX_CPU *cpu, long cycles){
+    long done=0;
+
+    while(done<cycles && !cpu->halted){
+        done+=cycle_within(cpu, cycles-done);
+    }
+    return done;
+}
+
+/*
+ * Checks the condition after every simulated cycle. Skipped idle cycles
+ * commit nothing, so they cannot step over the cycle the condition is met.
+ */
+static int
+run_until(APEX_CPU *cpu, long insns, int pc, long max_cycles)
+{
+    for(long done=0;;){
+        if(insns>=0 && cpu->insn_completed>=insns){
+            return APEX_RUN_REACHED;
+        }
+        if(pc>=0 && cpu->last_commit_pc==pc){
+            return APEX_RUN_REACHED;
+        }
+        if(cpu->halted){
+            return APEX_RUN_HALTED;
+        }
+        if(done>=max_cycles){
+            return APEX_RUN_LIMIT;
+        }
+        done+=cycle_within(cpu, max_cycles-done);
+    }
+}
+
+int APEX_run_until_insns(APEX_CPU *cpu, long insns, long max_cycles){
+    return run_until(cpu, insns, -1, max_cycles);
+}
+
+int APEX_run_until_pc(APEX_CPU *cpu, int pc, long max_cycles){
+    /* a commit of pc from before the call does not count */
+    cpu->last_commit_pc=-1;
+    return run_until(cpu, -1, pc, max_cycles);
+}
+
+int APEX_is_halted(const APEX_CPU *cpu){
+    return cpu->halted;
+}
+
+long APEX_get_cycles(const APEX_CPU *cpu){
+    return cpu->clock;
+}
+
+long APEX_get_insns(const APEX_CPU *cpu){
+    return cpu->insn_completed;
+}
+
+int APEX_get_fetch_pc(const APEX_CPU *cpu){
+    return cpu->thread[0].pc;
+}
+
+int APEX_get_commit_pc(const APEX_CPU *cpu){
+    return cpu->last_commit_pc;
+}
+
+const apex_stats *APEX_get_stats(const APEX_CPU *cpu){
+    return &cpu->stats;
+}
+
+/*
+ * A committed result reaches the ARF through the commit writeback latch one
+ * cycle after commit, report it as soon as it has committed
+ */
+static const CPU_Stage *
+pending_commit_write(const APEX_CPU *cpu, int reg)
+{
+    const CPU_Stage *wb=&cpu->thread[0].rob_commit_writeback;
+
+    //a vector result goes to the vector registers, rd is not an ARF register
+    if(!wb->has_insn || has_vector_destination(wb->opcode)){
+        return NULL;
+    }
+    if(wb->rd==reg || (reg==ARCHITECTURAL_REGISTERS_SIZE && opcode_info_of(wb->opcode)->sets_flags)){
+        return wb;
+    }
+    return NULL;
+}
+
+int APEX_get_register(const APEX_CPU *cpu, int reg){
+    const CPU_Stage *wb;
+
+    if(reg<0 || reg>ARCHITECTURAL_REGISTERS_SIZE){
+        return 0;
+    }
+    wb=pending_commit_write(cpu, reg);
+    if(wb){
+        //the condition code register holds the number of the last flag producer
+        return reg==ARCHITECTURAL_REGISTERS_SIZE ? wb->rd : cpu->prf.physical_register[wb->phy_rd].reg_value;
+    }
+    return cpu->thread[0].arf.architectural_register_file[reg].value;
+}
+
+int APEX_get_flags(const APEX_CPU *cpu, int reg, int *zero_flag, int *positive_flag){
+    const CPU_Stage *wb;
+
+    if(reg<0 || reg>ARCHITECTURAL_REGISTERS_SIZE){
+        return -1;
+    }
+    wb=pending_commit_write(cpu, reg);
+    if(wb && opcode_info_of(wb->opcode)->sets_flags){
+        *zero_flag=cpu->prf.physical_register[wb->phy_rd].zero_flag;
+        *positive_flag=cpu->prf.physical_register[wb->phy_rd].positive_flag;
+        return 0;
+    }
+    *zero_flag=cpu->thread[0].arf.architectural_register_file[reg].zero_flag;
+    *positive_flag=cpu->thread[0].arf.architectural_register_file[reg].positive_flag;
+    return 0;
+}
+
+int APEX_get_memory(const APEX_CPU *cpu, int address){
+    if(address<0 || address>=DATA_MEMORY_SIZE){
+        return 0;
+    }
+    return cpu->data_memory[address];
+}
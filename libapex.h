@@ -0,0 +1,92 @@
+/*
+ * libapex.h
+ * Contains the embedding API of the APEX simulator (libapex.a / libapex.so)
+ *
+ * Every call works on the APEX_CPU it is given; there is no global state and
+ * nothing is printed, so any number of CPUs can run in one process, each
+ * driven by one thread at a time.
+ *
+ * Author:
+ * State University of New York at Binghamton
+ */
+#ifndef _XXYZ_LIBAPEX_
+#define _XXYZ_LIBAPEX_
+
+#include <stddef.h>
+
+#ifndef _XXYZ_APEX_STATS_
+#include "apex_stats.h"
+#endif
+
+typedef struct APEX_CPU APEX_CPU;
+
+/*
+ * Every field past trace_file takes 0 for the build's default, so a config
+ * from APEX_config_default or one zeroed keeps it. The switches take
+ * APEX_ON or APEX_OFF.
+ */
+#define APEX_ON 1
+#define APEX_OFF -1
+
+typedef struct APEX_Config
+{
+    int memory_latency;     /* Cycles taken by a data memory access */
+    int idle_skip;          /* Jump the clock over cycles spent waiting on memory */
+    const char *trace_file; /* Binary pipeline trace, NULL for none */
+    int fusion;             /* FUSE_* mask of the pairs decode fuses, APEX_OFF for none */
+    const char *issue_queues; /* Issue queue topology as for --iq */
+    int vector_length;      /* Words per vector, up to MAX_VECTOR_LENGTH */
+    const char *const *smt_programs; /* Programs of the other hardware threads */
+    int smt_threads;        /* Entries in smt_programs, up to SMT_MAX_THREADS-1 */
+    int fetch_policy;       /* FETCH_POLICY_ICOUNT, round robin by default */
+    int rob_partition;      /* PARTITION_SHARED, static by default */
+    int lsq_partition;      /* PARTITION_SHARED, static by default */
+    int rename_elimination; /* Switch: MOVC and moves complete at rename */
+    int load_speculation;   /* Switch: dependents scheduled for a load hit */
+    int load_spec_latency;  /* Load latency speculation assumes */
+    int uop_cache;          /* Switch: micro-op cache */
+    int decoupled_front_end; /* Switch: fetch target queue */
+    int icache_latency;     /* Instruction cache miss cycles, APEX_OFF for none */
+}APEX_Config;
+
+/* Result of the run functions */
+#define APEX_RUN_LIMIT 0    /* The cycle budget ran out */
+#define APEX_RUN_REACHED 1  /* The requested instruction count or PC was reached */
+#define APEX_RUN_HALTED 2   /* HALT committed first */
+
+void APEX_config_default(APEX_Config *config);
+
+/*
+ * Creates a CPU from APEX assembly text, one instruction per line. config
+ * may be NULL for the defaults. Returns NULL if the program does not parse,
+ * *error_line (if given) is then the line at fault or 0. A config value out
+ * of range or a thread program that does not parse also returns NULL.
+ */
+APEX_CPU *APEX_create(const APEX_Config *config, const char *program, size_t length,
+                      int *error_line);
+void APEX_destroy(APEX_CPU *cpu);
+
+/* Back to the state right after APEX_create, the program is kept */
+void APEX_reset(APEX_CPU *cpu);
+
+/* Simulates up to cycles clock cycles, returns the number simulated */
+long APEX_step(APEX_CPU *cpu, long cycles);
+
+/* Run until that many instructions have committed in total */
+int APEX_run_until_insns(APEX_CPU *cpu, long insns, long max_cycles);
+
+/* Run until the instruction at pc commits */
+int APEX_run_until_pc(APEX_CPU *cpu, int pc, long max_cycles);
+
+int APEX_is_halted(const APEX_CPU *cpu);
+long APEX_get_cycles(const APEX_CPU *cpu);
+long APEX_get_insns(const APEX_CPU *cpu);
+int APEX_get_fetch_pc(const APEX_CPU *cpu);
+int APEX_get_commit_pc(const APEX_CPU *cpu);
+const apex_stats *APEX_get_stats(const APEX_CPU *cpu);
+
+/* Committed architectural state; reg 16 is the condition code register */
+int APEX_get_register(const APEX_CPU *cpu, int reg);
+int APEX_get_flags(const APEX_CPU *cpu, int reg, int *zero_flag, int *positive_flag);
+int APEX_get_memory(const APEX_CPU *cpu, int address);
+#endif
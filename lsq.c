@@ -1,5 +1,6 @@
 #include "lsq.h"
 #include  <stdio.h>
+#include <string.h>
 
 int lsq_index_available(load_store_queue *lsq){
     if(lsq->is_full)
@@ -22,9 +23,12 @@ int  lsq_entry_addition_to_queue(load_store_queue *lsq, load_store_queue_entry *
     lsq->load_store_queue[lsq->tail].pc_value= lsq_entry->pc_value;  
     lsq->load_store_queue[lsq->tail].OPCODE= lsq_entry->OPCODE;
     lsq->load_store_queue[lsq->tail].rob_index= lsq_entry->rob_index;
+    lsq->load_store_queue[lsq->tail].dispatch_cycle= lsq_entry->dispatch_cycle;
+    lsq->load_store_queue[lsq->tail].seq= lsq_entry->seq;
+    memcpy(lsq->load_store_queue[lsq->tail].store_lanes, lsq_entry->store_lanes, sizeof(lsq_entry->store_lanes));
     lsq_index=lsq->tail;
-    printf("LSQ tail= I[%d] ", (lsq->load_store_queue[lsq->tail].pc_value-4000)/4);
-    printf("LSQ head= I[%d] \n", (lsq->load_store_queue[lsq->head].pc_value-4000)/4);
+    APEX_DEBUG("LSQ tail= I[%d] ", (lsq->load_store_queue[lsq->tail].pc_value-4000)/4);
+    APEX_DEBUG("LSQ head= I[%d] \n", (lsq->load_store_queue[lsq->head].pc_value-4000)/4);
     lsq->tail = (lsq->tail + 1) % LSQ_SIZE;
     if(lsq->tail == lsq->head)
         lsq->is_full = 1;
@@ -51,4 +55,53 @@ void print_lsq_entries(load_store_queue *lsq){
     }
 }
 
+int lsq_occupancy(load_store_queue *lsq){
+    if(lsq->is_full)
+        return LSQ_SIZE;
+    return (lsq->tail - lsq->head + LSQ_SIZE) % LSQ_SIZE;
+}
+
+//hand a produced physical register to every store waiting for its data
+void lsq_store_data_wakeup(load_store_queue *lsq, int tag, int value){
+    int count=lsq_occupancy(lsq);
+
+    //walk by occupancy, head==tail also when the queue is full
+    for(int n=0,i=lsq->head;n<count;n++,i=(i+1)%LSQ_SIZE){
+        if(lsq->load_store_queue[i].OPCODE==OPCODE_STORE && !lsq->load_store_queue[i].data_ready &&
+           lsq->load_store_queue[i].src1_store==tag){
+            lsq->load_store_queue[i].data_ready=1;
+            lsq->load_store_queue[i].value_to_be_stored=value;
+        }
+    }
+}
+
+//hand a produced vector register to every VSTORE waiting for its data
+void lsq_vector_data_wakeup(load_store_queue *lsq, int tag, const int *lanes){
+    int count=lsq_occupancy(lsq);
 
+    for(int n=0,i=lsq->head;n<count;n++,i=(i+1)%LSQ_SIZE){
+        if(lsq->load_store_queue[i].OPCODE==OPCODE_VSTORE && !lsq->load_store_queue[i].data_ready &&
+           lsq->load_store_queue[i].src1_store==tag){
+            lsq->load_store_queue[i].data_ready=1;
+            memcpy(lsq->load_store_queue[i].store_lanes, lanes, sizeof(lsq->load_store_queue[i].store_lanes));
+        }
+    }
+}
+
+//squash the entry of the given rob index and every younger entry behind it
+void lsq_flush_from_rob_index(load_store_queue *lsq, int rob_index){
+    int count=lsq_occupancy(lsq);
+    int j=lsq->head;
+
+    for(int n=0;n<count;n++,j=(j+1)%LSQ_SIZE){
+        if(lsq->load_store_queue[j].allocate && lsq->load_store_queue[j].rob_index==rob_index){
+            lsq->tail=j;
+            lsq->is_full=0;
+            for(;n<count;n++,j=(j+1)%LSQ_SIZE){
+                APEX_DEBUG("LSQ- I[%d] \n,", (lsq->load_store_queue[j].pc_value-4000)/4);
+                lsq->load_store_queue[j].allocate=0;
+            }
+            return;
+        }
+    }
+}
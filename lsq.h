@@ -29,6 +29,9 @@ typedef struct load_store_queue_entry
     int rob_index;
     int OPCODE;
     int pc_value;
+    int dispatch_cycle;
+    unsigned int seq;
+    int store_lanes[MAX_VECTOR_LENGTH];     /* VSTORE: data, valid with data_ready */
 }load_store_queue_entry;
 
 typedef struct load_store_queue
@@ -42,4 +45,8 @@ typedef struct load_store_queue
 int lsq_index_available(load_store_queue *lsq);
 int lsq_entry_addition_to_queue(load_store_queue *lsq, load_store_queue_entry * lsq_entry);
 void print_lsq_entries(load_store_queue *lsq);
+int lsq_occupancy(load_store_queue *lsq);
+void lsq_store_data_wakeup(load_store_queue *lsq, int tag, int value);
+void lsq_vector_data_wakeup(load_store_queue *lsq, int tag, const int *lanes);
+void lsq_flush_from_rob_index(load_store_queue *lsq, int rob_index);
 #endif
@@ -7,30 +7,592 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
+#include "apex_batch.h"
 #include "apex_cpu.h"
+#include "apex_multicore.h"
+
+static void
+print_usage(const char *prog)
+{
+    fprintf(stderr, "APEX_Help: Usage %s <input_file> [options]\n", prog);
+    fprintf(stderr, "  --itrace              <input_file> is an instruction trace to run (see --record-itrace)\n");
+    fprintf(stderr, "  --record-itrace=<file> write the instructions committed to a gzip instruction trace\n");
+    fprintf(stderr, "  --stats-json=<file>   dump performance counters as JSON\n");
+    fprintf(stderr, "  --stats-csv=<file>    dump performance counters as CSV\n");
+    fprintf(stderr, "  --dump-state=<file>   write the final registers and data memory, see apex_check.sh\n");
+    fprintf(stderr, "  --trace=<file>        write a binary pipeline trace (see apex_trace_convert)\n");
+    fprintf(stderr, "  --mem-latency=<n>     cycles taken by a data memory access (default %d)\n",
+            DATA_MEMORY_LATENCY);
+    fprintf(stderr, "  --no-idle-skip        simulate idle cycles one by one\n");
+    fprintf(stderr, "  --core=<file>         add a core running <file>, cores share a coherent data memory\n");
+    fprintf(stderr, "  --quantum=<n>         multicore: cycles between core synchronizations, 1 is lockstep (default %d)\n",
+            DEFAULT_QUANTUM);
+    fprintf(stderr, "  --smt=<file>          add a hardware thread running <file>, threads share the back end\n");
+    fprintf(stderr, "  --fetch-policy=<p>    SMT: rr or icount (default rr)\n");
+    fprintf(stderr, "  --rob-partition=<p>   SMT: static or shared ROB entries (default static)\n");
+    fprintf(stderr, "  --lsq-partition=<p>   SMT: static or shared LSQ entries (default static)\n");
+    fprintf(stderr, "  --fusion=<pairs>      fuse cmp-branch,movc-add,addl-load pairs in decode, or all/none\n");
+    fprintf(stderr, "  --no-rename-elim      send MOVC and register moves through the IQ and a FU\n");
+    fprintf(stderr, "  --no-load-spec        wake a load's dependents at writeback, without hit speculation\n");
+    fprintf(stderr, "  --load-spec-latency=<n> load latency the scheduler assumes (default: a hit)\n");
+    fprintf(stderr, "  --no-uop-cache        fetch and decode loop bodies again, without the micro-op cache\n");
+    fprintf(stderr, "  --no-ftq              predict branches in decode, without the fetch target queue\n");
+    fprintf(stderr, "  --icache-latency=<n>  cycles of an instruction cache miss (default %d, no cache)\n",
+            ICACHE_MISS_LATENCY);
+    fprintf(stderr, "  --iq=<topology>       unified, split, cluster or queues like int+branch:5,mul+div+vec:3[:position]\n");
+    fprintf(stderr, "  --vector-length=<n>  lanes of a vector operation, 1 to %d (default %d)\n",
+            MAX_VECTOR_LENGTH, VECTOR_LENGTH);
+    fprintf(stderr, "  --batch=<file>        run the program once for each data set in <file>, many at a time,\n"
+                    "                        on a functional model with in-order timing\n");
+    fprintf(stderr, "  --batch-out=<file>    write the final state of every instance as CSV\n");
+    fprintf(stderr, "  --cosim               check every commit against a functional model on another thread\n");
+    fprintf(stderr, "  --cpi-stack           print the cycles lost at commit to each cause\n");
+    fprintf(stderr, "  --energy[=<file>]     report energy and power, with per-access energies from <file>\n");
+    fprintf(stderr, "  --debug               start stopped in the debugger (default in SINGLE_STEP builds)\n");
+}
+
+/* Returns the FUSE_* mask of a comma separated list of pairs, or -1 */
+static int
+parse_fusion(const char *arg)
+{
+    static const struct
+    {
+        const char *name;
+        int mask;
+    } pairs[] = {
+        {"cmp-branch", FUSE_CMP_BRANCH},
+        {"movc-add", FUSE_MOVC_ADD},
+        {"addl-load", FUSE_ADDL_LOAD},
+        {"all", FUSE_ALL},
+        {"none", FUSE_NONE},
+    };
+    int mask = FUSE_NONE;
+
+    while (*arg)
+    {
+        size_t len = strcspn(arg, ",");
+        size_t i;
+
+        for (i = 0; i < sizeof(pairs) / sizeof(pairs[0]); i++)
+        {
+            if (strlen(pairs[i].name) == len && strncmp(arg, pairs[i].name, len) == 0)
+            {
+                mask |= pairs[i].mask;
+                break;
+            }
+        }
+        if (i == sizeof(pairs) / sizeof(pairs[0]))
+        {
+            return -1;
+        }
+        arg += len;
+        if (*arg == ',')
+        {
+            arg++;
+        }
+    }
+    return mask;
+}
+
+/* Returns the partitioning named by arg, or -1 */
+static int
+parse_partition(const char *arg)
+{
+    if (strcmp(arg, "static") == 0)
+    {
+        return PARTITION_STATIC;
+    }
+    if (strcmp(arg, "shared") == 0)
+    {
+        return PARTITION_SHARED;
+    }
+    return -1;
+}
+
+/* Every core runs on its own host thread, stats are JSON only */
+static int
+run_multicore(const char *const *filenames, int num_cores, int quantum, int memory_latency,
+              int fusion_pairs, int rename_elimination, int load_speculation, int load_spec_latency,
+              int uop_cache, int decoupled_front_end, int icache_latency, int vector_length,
+              const issue_queue_config *iq_config, int idle_skip, int cpi_stack,
+              const char *stats_file, int stats_format)
+{
+    APEX_System *sys;
+
+    if (stats_format == STATS_FORMAT_CSV)
+    {
+        fprintf(stderr, "APEX_Error: Multicore stats are only available as JSON\n");
+        return 1;
+    }
+    sys = APEX_system_create(num_cores, filenames, quantum, memory_latency);
+    if (!sys)
+    {
+        fprintf(stderr, "APEX_Error: Unable to initialize %d cores\n", num_cores);
+        return 1;
+    }
+    for (int i = 0; i < num_cores; i++)
+    {
+        sys->cores[i]->fusion_pairs = fusion_pairs;
+        sys->cores[i]->rename_elimination = rename_elimination;
+        sys->cores[i]->load_speculation = load_speculation;
+        sys->cores[i]->load_spec_latency = load_spec_latency;
+        sys->cores[i]->uop_cache = uop_cache;
+        sys->cores[i]->decoupled_front_end = decoupled_front_end;
+        sys->cores[i]->icache_latency = icache_latency;
+        sys->cores[i]->vector_length = vector_length;
+        sys->cores[i]->idle_skip = idle_skip;
+        sys->cores[i]->print_cpi_stack = cpi_stack;
+        APEX_cpu_set_issue_queues(sys->cores[i], iq_config);
+    }
+    if (APEX_system_run(sys) != 0)
+    {
+        fprintf(stderr, "APEX_Error: Unable to start the threads of %d cores\n", num_cores);
+        APEX_system_destroy(sys);
+        return 1;
+    }
+    APEX_system_print(sys);
+    if (stats_file)
+    {
+        FILE *fp = fopen(stats_file, "w");
+
+        if (!fp)
+        {
+            fprintf(stderr, "APEX_Error: Unable to write stats to %s\n", stats_file);
+        }
+        else
+        {
+            APEX_system_dump_json(sys, fp);
+            fclose(fp);
+        }
+    }
+    APEX_system_destroy(sys);
+    return 0;
+}
+
+/* Runs the functional model for every data set, the pipeline is not simulated */
+static int
+run_batch(const APEX_CPU *cpu, const char *data_file, const char *results_file)
+{
+    apex_batch *batch = batch_create(cpu, data_file);
+    struct timespec start, end;
+    int status = 0;
+
+    if (!batch)
+    {
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    batch_run(batch);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    batch_print(batch, (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9, stdout);
+    if (results_file)
+    {
+        FILE *fp = fopen(results_file, "w");
+
+        if (!fp)
+        {
+            fprintf(stderr, "APEX_Error: Unable to write batch results to %s\n", results_file);
+            status = 1;
+        }
+        else
+        {
+            batch_write_results(batch, fp);
+            fclose(fp);
+        }
+    }
+    batch_destroy(batch);
+    return status;
+}
 
 int
 main(int argc, char const *argv[])
 {
     APEX_CPU *cpu;
+    const char *stats_file = NULL;
+    const char *state_file = NULL;
+    int stats_format = STATS_FORMAT_NONE;
+    const char *trace_file = NULL;
+    int memory_latency = DATA_MEMORY_LATENCY;
+    int idle_skip = ENABLE_IDLE_SKIP;
+    const char *core_files[MAX_CORES];
+    int num_cores = 1;
+    int quantum = DEFAULT_QUANTUM;
+    int latency_set = FALSE;
+    const char *smt_files[SMT_MAX_THREADS];
+    int num_smt = 0;
+    int fetch_policy = FETCH_POLICY_ROUND_ROBIN;
+    int rob_partition = PARTITION_STATIC;
+    int lsq_partition = PARTITION_STATIC;
+    int fusion_pairs = FUSION_PAIRS;
+    int rename_elimination = ENABLE_RENAME_ELIMINATION;
+    int load_speculation = ENABLE_LOAD_SPECULATION;
+    int load_spec_latency = LOAD_SPEC_LATENCY;
+    int uop_cache = ENABLE_UOP_CACHE;
+    int decoupled_front_end = ENABLE_DECOUPLED_FRONT_END;
+    int icache_latency = ICACHE_MISS_LATENCY;
+    int vector_length = VECTOR_LENGTH;
+    issue_queue_config iq_config;
+    int cosim = FALSE;
+    int energy = FALSE;
+    int cpi_stack = FALSE;
+    const char *energy_file = NULL;
+    int debug = ENABLE_SINGLE_STEP;
+    int debug_set = FALSE;
+    int itrace = FALSE;
+    const char *record_itrace_file = NULL;
+    const char *batch_file = NULL;
+    const char *batch_out_file = NULL;
+    int status = 0;
 
     fprintf(stderr, "APEX CPU Pipeline Simulator v%0.1lf\n", VERSION);
+    if (iq_configure(&iq_config, ISSUE_QUEUE_TOPOLOGY) != 0)
+    {
+        iq_configure(&iq_config, "unified");
+    }
 
-    if (argc != 2)
+    if (argc < 2)
     {
-        fprintf(stderr, "APEX_Help: Usage %s <input_file>\n", argv[0]);
+        print_usage(argv[0]);
         exit(1);
     }
 
-    cpu = APEX_cpu_init(argv[1]);
-    if (!cpu)
+    for (int i = 2; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--stats-json=", 13) == 0)
+        {
+            stats_file = argv[i] + 13;
+            stats_format = STATS_FORMAT_JSON;
+        }
+        else if (strncmp(argv[i], "--stats-csv=", 12) == 0)
+        {
+            stats_file = argv[i] + 12;
+            stats_format = STATS_FORMAT_CSV;
+        }
+        else if (strncmp(argv[i], "--dump-state=", 13) == 0)
+        {
+            state_file = argv[i] + 13;
+        }
+        else if (strncmp(argv[i], "--trace=", 8) == 0)
+        {
+            trace_file = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--mem-latency=", 14) == 0 && atoi(argv[i] + 14) > 0)
+        {
+            memory_latency = atoi(argv[i] + 14);
+            latency_set = TRUE;
+        }
+        else if (strcmp(argv[i], "--no-idle-skip") == 0)
+        {
+            idle_skip = FALSE;
+        }
+        else if (strncmp(argv[i], "--core=", 7) == 0 && num_cores < MAX_CORES)
+        {
+            core_files[num_cores++] = argv[i] + 7;
+        }
+        else if (strncmp(argv[i], "--quantum=", 10) == 0 && atoi(argv[i] + 10) > 0)
+        {
+            quantum = atoi(argv[i] + 10);
+        }
+        else if (strncmp(argv[i], "--smt=", 6) == 0 && num_smt < SMT_MAX_THREADS - 1)
+        {
+            smt_files[num_smt++] = argv[i] + 6;
+        }
+        else if (strcmp(argv[i], "--fetch-policy=rr") == 0)
+        {
+            fetch_policy = FETCH_POLICY_ROUND_ROBIN;
+        }
+        else if (strcmp(argv[i], "--fetch-policy=icount") == 0)
+        {
+            fetch_policy = FETCH_POLICY_ICOUNT;
+        }
+        else if (strncmp(argv[i], "--rob-partition=", 16) == 0 && parse_partition(argv[i] + 16) >= 0)
+        {
+            rob_partition = parse_partition(argv[i] + 16);
+        }
+        else if (strncmp(argv[i], "--lsq-partition=", 16) == 0 && parse_partition(argv[i] + 16) >= 0)
+        {
+            lsq_partition = parse_partition(argv[i] + 16);
+        }
+        else if (strncmp(argv[i], "--fusion=", 9) == 0 && parse_fusion(argv[i] + 9) >= 0)
+        {
+            fusion_pairs = parse_fusion(argv[i] + 9);
+        }
+        else if (strcmp(argv[i], "--no-rename-elim") == 0)
+        {
+            rename_elimination = FALSE;
+        }
+        else if (strcmp(argv[i], "--no-load-spec") == 0)
+        {
+            load_speculation = FALSE;
+        }
+        else if (strncmp(argv[i], "--load-spec-latency=", 20) == 0 && atoi(argv[i] + 20) > 0)
+        {
+            load_spec_latency = atoi(argv[i] + 20);
+        }
+        else if (strcmp(argv[i], "--no-uop-cache") == 0)
+        {
+            uop_cache = FALSE;
+        }
+        else if (strcmp(argv[i], "--no-ftq") == 0)
+        {
+            decoupled_front_end = FALSE;
+        }
+        else if (strncmp(argv[i], "--icache-latency=", 17) == 0 && atoi(argv[i] + 17) >= 0)
+        {
+            icache_latency = atoi(argv[i] + 17);
+        }
+        else if (strncmp(argv[i], "--vector-length=", 16) == 0 && atoi(argv[i] + 16) > 0 &&
+                 atoi(argv[i] + 16) <= MAX_VECTOR_LENGTH)
+        {
+            vector_length = atoi(argv[i] + 16);
+        }
+        else if (strncmp(argv[i], "--iq=", 5) == 0)
+        {
+            if (iq_configure(&iq_config, argv[i] + 5) != 0)
+            {
+                fprintf(stderr, "APEX_Error: Invalid issue queue topology %s\n", argv[i] + 5);
+                exit(1);
+            }
+        }
+        else if (strncmp(argv[i], "--batch=", 8) == 0)
+        {
+            batch_file = argv[i] + 8;
+        }
+        else if (strncmp(argv[i], "--batch-out=", 12) == 0)
+        {
+            batch_out_file = argv[i] + 12;
+        }
+        else if (strcmp(argv[i], "--cosim") == 0)
+        {
+            cosim = TRUE;
+        }
+        else if (strcmp(argv[i], "--cpi-stack") == 0)
+        {
+            cpi_stack = TRUE;
+        }
+        else if (strcmp(argv[i], "--energy") == 0)
+        {
+            energy = TRUE;
+        }
+        else if (strncmp(argv[i], "--energy=", 9) == 0)
+        {
+            energy = TRUE;
+            energy_file = argv[i] + 9;
+        }
+        else if (strcmp(argv[i], "--debug") == 0)
+        {
+            debug = TRUE;
+            debug_set = TRUE;
+        }
+        else if (strcmp(argv[i], "--itrace") == 0)
+        {
+            itrace = TRUE;
+        }
+        else if (strncmp(argv[i], "--record-itrace=", 16) == 0)
+        {
+            record_itrace_file = argv[i] + 16;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+    }
+
+    if (batch_out_file && !batch_file)
+    {
+        fprintf(stderr, "APEX_Error: --batch-out needs --batch\n");
+        exit(1);
+    }
+    /* the batch engine has no pipeline, caches, other threads or cores */
+    if (batch_file && (num_cores > 1 || num_smt > 0 || itrace || record_itrace_file || trace_file ||
+                       cosim || energy || cpi_stack || stats_file || state_file))
     {
-        fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+        fprintf(stderr, "APEX_Error: --batch only takes --batch-out, --mem-latency and --vector-length\n");
         exit(1);
     }
+    if (itrace && record_itrace_file)
+    {
+        fprintf(stderr, "APEX_Error: An instruction trace cannot be recorded from one\n");
+        exit(1);
+    }
+    if (itrace && num_smt > 0)
+    {
+        fprintf(stderr, "APEX_Error: SMT threads are not available with an instruction trace\n");
+        exit(1);
+    }
+    if (itrace && cosim)
+    {
+        fprintf(stderr, "APEX_Error: Co-simulation is not available with an instruction trace\n");
+        exit(1);
+    }
+
+    if (num_cores > 1)
+    {
+        if (itrace || record_itrace_file)
+        {
+            fprintf(stderr, "APEX_Error: Instruction traces are not available with multiple cores\n");
+            exit(1);
+        }
+        if (trace_file)
+        {
+            fprintf(stderr, "APEX_Error: Tracing is not available with multiple cores\n");
+            exit(1);
+        }
+        if (num_smt > 0)
+        {
+            fprintf(stderr, "APEX_Error: SMT threads are not available with multiple cores\n");
+            exit(1);
+        }
+        if (cosim)
+        {
+            fprintf(stderr, "APEX_Error: Co-simulation is not available with multiple cores\n");
+            exit(1);
+        }
+        if (energy)
+        {
+            fprintf(stderr, "APEX_Error: The energy model is not available with multiple cores\n");
+            exit(1);
+        }
+        if (state_file)
+        {
+            fprintf(stderr, "APEX_Error: --dump-state is not available with multiple cores\n");
+            exit(1);
+        }
+        if (debug_set)
+        {
+            fprintf(stderr, "APEX_Error: The debugger is not available with multiple cores\n");
+            exit(1);
+        }
+        core_files[0] = argv[1];
+        /* in a multicore system the memory latency is that of an L1 miss */
+        return run_multicore(core_files, num_cores, quantum,
+                             latency_set ? memory_latency : L1_MISS_LATENCY, fusion_pairs,
+                             rename_elimination, load_speculation, load_spec_latency, uop_cache,
+                             decoupled_front_end, icache_latency, vector_length, &iq_config,
+                             idle_skip, cpi_stack, stats_file, stats_format);
+    }
+
+    if (itrace)
+    {
+        cpu = APEX_cpu_init_from_trace(argv[1]);
+        if (!cpu)
+        {
+            fprintf(stderr, "APEX_Error: Unable to read instruction trace %s\n", argv[1]);
+            exit(1);
+        }
+    }
+    else
+    {
+        cpu = APEX_cpu_init(argv[1]);
+        if (!cpu)
+        {
+            fprintf(stderr, "APEX_Error: Unable to initialize CPU\n");
+            exit(1);
+        }
+    }
+    if (batch_file)
+    {
+        cpu->memory_latency = memory_latency;
+        cpu->vector_length = vector_length;
+        status = run_batch(cpu, batch_file, batch_out_file);
+        APEX_cpu_stop(cpu);
+        return status;
+    }
+    cpu->single_step = debug;
+    cpu->stats_file = stats_file;
+    cpu->stats_format = stats_format;
+    cpu->memory_latency = memory_latency;
+    cpu->idle_skip = idle_skip;
+    cpu->fetch_policy = fetch_policy;
+    cpu->rob_partition = rob_partition;
+    cpu->lsq_partition = lsq_partition;
+    cpu->fusion_pairs = fusion_pairs;
+    cpu->rename_elimination = rename_elimination;
+    cpu->load_speculation = load_speculation;
+    cpu->load_spec_latency = load_spec_latency;
+    cpu->uop_cache = uop_cache;
+    cpu->decoupled_front_end = decoupled_front_end;
+    cpu->icache_latency = icache_latency;
+    cpu->vector_length = vector_length;
+    APEX_cpu_set_issue_queues(cpu, &iq_config);
+    cpu->print_cpi_stack = cpi_stack;
+    for (int i = 0; i < num_smt; i++)
+    {
+        if (APEX_cpu_add_thread(cpu, smt_files[i]) < 0)
+        {
+            fprintf(stderr, "APEX_Error: Unable to add a thread running %s\n", smt_files[i]);
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+    }
+    if (trace_file)
+    {
+        cpu->trace = trace_open(trace_file);
+        if (!cpu->trace)
+        {
+            fprintf(stderr, "APEX_Error: Unable to open trace file %s\n", trace_file);
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+    }
+
+    if (record_itrace_file)
+    {
+        cpu->itrace_out = itrace_create(record_itrace_file);
+        if (!cpu->itrace_out)
+        {
+            fprintf(stderr, "APEX_Error: Unable to open instruction trace %s\n", record_itrace_file);
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+    }
+
+    if (energy)
+    {
+        cpu->energy = energy_model_load(energy_file);
+        if (!cpu->energy)
+        {
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+    }
+
+    if (cosim)
+    {
+        cpu->cosim = cosim_start(cpu);
+        if (!cpu->cosim)
+        {
+            fprintf(stderr, "APEX_Error: Unable to start the co-simulation checker\n");
+            APEX_cpu_stop(cpu);
+            exit(1);
+        }
+    }
 
     APEX_cpu_run(cpu);
+    if (state_file)
+    {
+        FILE *fp = fopen(state_file, "w");
+
+        if (!fp)
+        {
+            fprintf(stderr, "APEX_Error: Unable to write state to %s\n", state_file);
+            status = 1;
+        }
+        else
+        {
+            APEX_cpu_dump_state(cpu, fp);
+            fclose(fp);
+        }
+    }
+    /* a divergence fails the run */
+    if (cpu->cosim && cosim_diverged(cpu->cosim))
+    {
+        status = 2;
+    }
     APEX_cpu_stop(cpu);
-    return 0;
-}
\ No newline at end of file
+    return status;
+}
@@ -9,35 +9,153 @@
 
 #include "physical_register.h"
 #include<stdio.h>
+#include<string.h>
 
 
-void print_prf_q(free_physical_registers_queue *a){
-    int temp_head=a->head;
-    int temp_tail=a->tail;
-    int i=temp_head;
-    while(i!=temp_tail){
-        printf("%d\t,",a->free_physical_registers[i]);
-        i=(i+1)%PHYSICAL_REGISTERS_SIZE;
+#define WORD_OF(p) ((p) / FREE_LIST_WORD_BITS)
+#define BIT_OF(p) ((uint64_t)1 << ((p) % FREE_LIST_WORD_BITS))
+
+void print_prf_q(const free_physical_register_list *fpl){
+    for(int p=0;p<PHYSICAL_REGISTERS_SIZE;p++){
+        if(is_free_physical_register(fpl, p)){
+            printf("%d\t,",p);
+        }
+    }
+    printf("\n");
+}
+
+void init_free_physical_registers(free_physical_register_list *fpl){
+    memset(fpl, 0, sizeof(*fpl));
+    for(int p=0;p<PHYSICAL_REGISTERS_SIZE;p++){
+        fpl->free_mask[WORD_OF(p)]|=BIT_OF(p);
     }
-    printf("%d\n",a->free_physical_registers[temp_tail]);
+    fpl->free_count=PHYSICAL_REGISTERS_SIZE;
 }
 
-int pop_free_physical_registers(free_physical_registers_queue *fpq){
-    if(fpq->is_empty){
+//the lowest numbered free register, found a word at a time
+int pop_free_physical_registers(free_physical_register_list *fpl){
+    if(fpl->free_count==0){
         return -1;
     }
-    else{
-        int temp= fpq->head;
-        if (fpq->head==fpq->tail)
-            fpq->is_empty=1;
-        fpq->head=(fpq->head+1)%PHYSICAL_REGISTERS_SIZE;
-        return temp;
+    while(fpl->free_mask[fpl->first_word]==0){
+        fpl->first_word++;
+    }
+    uint64_t word=fpl->free_mask[fpl->first_word];
+    int physical_register=fpl->first_word*FREE_LIST_WORD_BITS+__builtin_ctzll(word);
+
+    fpl->free_mask[fpl->first_word]=word&(word-1);
+    fpl->free_count--;
+    return physical_register;
+}
+
+static void set_free(free_physical_register_list *fpl, int physical_register){
+    int w=WORD_OF(physical_register);
+
+    fpl->free_mask[w]|=BIT_OF(physical_register);
+    fpl->free_count++;
+    if(w<fpl->first_word){
+        fpl->first_word=w;
+    }
+}
+
+//a shared register is only freed by the last instruction that maps it
+static int release_shared(free_physical_register_list *fpl, int physical_register){
+    if(physical_register<PHYSICAL_REGISTERS_SIZE && fpl->shared_count[physical_register]>0){
+        fpl->shared_count[physical_register]--;
+        return 1;
+    }
+    return 0;
+}
+
+//registers freed at commit wait in the released mask until the commit stage is done
+void push_free_physical_registers(free_physical_register_list *fpl, int physical_register){
+    if(release_shared(fpl, physical_register)){
+        return;
+    }
+    APEX_DEBUG("PRF reg Freed: P[%d]\n",physical_register);
+    fpl->released_mask[WORD_OF(physical_register)]|=BIT_OF(physical_register);
+    fpl->released_count++;
+}
+
+void merge_released_physical_registers(free_physical_register_list *fpl){
+    if(fpl->released_count==0){
+        return;
+    }
+    for(int w=0;w<FREE_LIST_WORDS;w++){
+        if(fpl->released_mask[w]){
+            fpl->free_mask[w]|=fpl->released_mask[w];
+            fpl->released_mask[w]=0;
+            if(w<fpl->first_word){
+                fpl->first_word=w;
+            }
+        }
+    }
+    fpl->free_count+=fpl->released_count;
+    fpl->released_count=0;
+}
+
+//a squashed destination is free again right away
+void rollback_free_physical_register(free_physical_register_list *fpl, int physical_register){
+    if(release_shared(fpl, physical_register)){
+        return;
     }
+    set_free(fpl, physical_register);
 }
 
-void push_free_physical_registers(free_physical_registers_queue *fpq, int physical_register){
-    printf("PRF reg Freed: P[%d]\n",physical_register);
-    fpq->tail=(fpq->tail+1)%PHYSICAL_REGISTERS_SIZE;
-    fpq->free_physical_registers[fpq->tail]=physical_register;
-    return;
-}
\ No newline at end of file
+//a move renamed onto its source register keeps it allocated until both commit
+void share_physical_register(free_physical_register_list *fpl, int physical_register){
+    fpl->shared_count[physical_register]++;
+}
+
+int is_free_physical_register(const free_physical_register_list *fpl, int physical_register){
+    if(physical_register<0 || physical_register>=PHYSICAL_REGISTERS_SIZE){
+        return FALSE;
+    }
+    return ((fpl->free_mask[WORD_OF(physical_register)] | fpl->released_mask[WORD_OF(physical_register)]) &
+            BIT_OF(physical_register)) != 0;
+}
+
+void init_vector_registers(vector_register_file *vrf){
+    memset(vrf, 0, sizeof(*vrf));
+    vrf->free_mask=(VECTOR_PHYSICAL_REGISTERS_SIZE==FREE_LIST_WORD_BITS) ? ~(uint64_t)0 :
+                   ((uint64_t)1<<VECTOR_PHYSICAL_REGISTERS_SIZE)-1;
+    vrf->free_count=VECTOR_PHYSICAL_REGISTERS_SIZE;
+}
+
+//returns the tag of the lowest numbered free vector register, -1 if there is none
+int pop_free_vector_register(vector_register_file *vrf){
+    int v;
+
+    if(vrf->free_count==0){
+        return -1;
+    }
+    v=__builtin_ctzll(vrf->free_mask);
+    vrf->free_mask&=vrf->free_mask-1;
+    vrf->free_count--;
+    return VECTOR_TAG_BASE+v;
+}
+
+void push_free_vector_register(vector_register_file *vrf, int tag){
+    APEX_DEBUG("VRF reg Freed: VP[%d]\n",tag-VECTOR_TAG_BASE);
+    vrf->released_mask|=(uint64_t)1<<(tag-VECTOR_TAG_BASE);
+}
+
+void merge_released_vector_registers(vector_register_file *vrf){
+    if(vrf->released_mask){
+        vrf->free_mask|=vrf->released_mask;
+        vrf->free_count+=__builtin_popcountll(vrf->released_mask);
+        vrf->released_mask=0;
+    }
+}
+
+void rollback_free_vector_register(vector_register_file *vrf, int tag){
+    vrf->free_mask|=(uint64_t)1<<(tag-VECTOR_TAG_BASE);
+    vrf->free_count++;
+}
+
+int is_free_vector_register(const vector_register_file *vrf, int tag){
+    if(!is_vector_tag(tag)){
+        return FALSE;
+    }
+    return ((vrf->free_mask|vrf->released_mask)>>(tag-VECTOR_TAG_BASE))&1;
+}
@@ -9,6 +9,8 @@
 #ifndef _XXYZ_PHY_REG_
 #define _XXYZ_PHY_REG_
 
+#include <stdint.h>
+
 #ifndef _MACROS_H_
 #include "apex_macros.h"
 #endif
@@ -26,16 +28,51 @@ typedef struct physical_register_content
 
 typedef struct  physical_register_file
 {
-    physical_register_content physical_register[PHYSICAL_REGISTERS_SIZE+1];
+    //one extra register per thread holds the CCR written by CMP
+    physical_register_content physical_register[PHYSICAL_REGISTERS_SIZE+SMT_MAX_THREADS];
 }physical_register_file;
 
-typedef struct free_physical_registers_queue
+#define FREE_LIST_WORD_BITS 64
+#define FREE_LIST_WORDS ((PHYSICAL_REGISTERS_SIZE + FREE_LIST_WORD_BITS - 1) / FREE_LIST_WORD_BITS)
+
+//bit p of a mask stands for physical register p
+typedef struct free_physical_register_list
+{
+    uint64_t free_mask[FREE_LIST_WORDS];
+    //freed at commit this cycle, made available by merge_released_physical_registers
+    uint64_t released_mask[FREE_LIST_WORDS];
+    int free_count;
+    int released_count;
+    //no word below this one has a free register
+    int first_word;
+    //extra rename table mappings of a register shared by eliminated moves
+    int shared_count[PHYSICAL_REGISTERS_SIZE];
+}free_physical_register_list;
+
+
+/////////////////// VECTOR REGISTERS /////////////////////////////////
+_Static_assert(VECTOR_PHYSICAL_REGISTERS_SIZE <= FREE_LIST_WORD_BITS, "one free mask word per vector register file");
+
+typedef struct vector_register_content
+{
+    int reg_valid;
+    int lanes[MAX_VECTOR_LENGTH];
+}vector_register_content;
+
+//physical vector registers hold results until they commit to the thread's VARF
+typedef struct vector_register_file
+{
+    vector_register_content vector_register[VECTOR_PHYSICAL_REGISTERS_SIZE];
+    uint64_t free_mask;
+    uint64_t released_mask;     //freed at commit this cycle, see merge_released_vector_registers
+    int free_count;
+}vector_register_file;
+
+static inline int
+is_vector_tag(int tag)
 {
-    int head;
-    int tail;
-    int free_physical_registers[PHYSICAL_REGISTERS_SIZE];
-    int is_empty;
-}free_physical_registers_queue;
+    return tag >= VECTOR_TAG_BASE && tag < VECTOR_TAG_BASE + VECTOR_PHYSICAL_REGISTERS_SIZE;
+}
 
 
 /////////////////// REGISTER RENAME /////////////////////////////////
@@ -50,7 +87,18 @@ typedef struct rename_table_mapping
     rename_table_content rename_table[ARCHITECTURAL_REGISTERS_SIZE+1];
 }rename_table_mapping;
 
-void print_prf_q(free_physical_registers_queue *a);
-int pop_free_physical_registers(free_physical_registers_queue *fpq);
-void push_free_physical_registers(free_physical_registers_queue *fpq, int physical_register);
+void print_prf_q(const free_physical_register_list *fpl);
+void init_free_physical_registers(free_physical_register_list *fpl);
+int pop_free_physical_registers(free_physical_register_list *fpl);
+void push_free_physical_registers(free_physical_register_list *fpl, int physical_register);
+void merge_released_physical_registers(free_physical_register_list *fpl);
+void rollback_free_physical_register(free_physical_register_list *fpl, int physical_register);
+void share_physical_register(free_physical_register_list *fpl, int physical_register);
+int is_free_physical_register(const free_physical_register_list *fpl, int physical_register);
+void init_vector_registers(vector_register_file *vrf);
+int pop_free_vector_register(vector_register_file *vrf);
+void push_free_vector_register(vector_register_file *vrf, int tag);
+void merge_released_vector_registers(vector_register_file *vrf);
+void rollback_free_vector_register(vector_register_file *vrf, int tag);
+int is_free_vector_register(const vector_register_file *vrf, int tag);
 #endif
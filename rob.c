@@ -20,13 +20,18 @@ int reorder_buffer_available(reorder_buffer *rob){
     }
 }
 
-int is_rob_full(reorder_buffer *rob){
+int rob_occupancy(reorder_buffer *rob){
     int count=0;
     for(int i=0;i<ROB_SIZE;i++){
         if(rob->reorder_buffer_queue[i].is_allocated==1){
             count++;
         }
     }
+    return count;
+}
+
+int is_rob_full(reorder_buffer *rob){
+    int count=rob_occupancy(rob);
     if(count<ROB_SIZE-1){
         return 0;
     }
@@ -38,7 +43,7 @@ int is_rob_full(reorder_buffer *rob){
 
 
 int reorder_buffer_entry_addition_to_queue(reorder_buffer *rob, reorder_buffer_entry * rob_entry){
-    printf("ROB tail= %d \n", rob->tail);
+    APEX_DEBUG("ROB tail= %d \n", rob->tail);
     rob->reorder_buffer_queue[rob->tail].pc_value=rob_entry->pc_value;
     rob->reorder_buffer_queue[rob->tail].destination_address=rob_entry->destination_address;
     rob->reorder_buffer_queue[rob->tail].physical_register=rob_entry->physical_register;
@@ -49,16 +54,37 @@ int reorder_buffer_entry_addition_to_queue(reorder_buffer *rob, reorder_buffer_e
     rob->reorder_buffer_queue[rob->tail].insn_type=rob_entry->insn_type;
     rob->reorder_buffer_queue[rob->tail].pc_value=rob_entry->pc_value;
     rob->reorder_buffer_queue[rob->tail].opcode=rob_entry->opcode;
+    rob->reorder_buffer_queue[rob->tail].seq=rob_entry->seq;
+    rob->reorder_buffer_queue[rob->tail].fusion=rob_entry->fusion;
+    rob->reorder_buffer_queue[rob->tail].mem_address=rob_entry->mem_address;
+    rob->reorder_buffer_queue[rob->tail].trace_next_pc=rob_entry->trace_next_pc;
+    rob->reorder_buffer_queue[rob->tail].trace_mispredicted=rob_entry->trace_mispredicted;
+    rob->reorder_buffer_queue[rob->tail].predicted_pc=rob_entry->predicted_pc;
     rob->reorder_buffer_queue[rob->tail].is_allocated=1;
     int rob_index=rob->tail;
-    printf("ROB entry created for I[%d] \n", (rob->reorder_buffer_queue[rob->tail].pc_value-4000)/4);
+    APEX_DEBUG("ROB entry created for I[%d] \n", (rob->reorder_buffer_queue[rob->tail].pc_value-4000)/4);
 
     rob->tail=(rob->tail+1)%ROB_SIZE;
-    printf("ROB tail updated to %d \n", rob->tail);
+    APEX_DEBUG("ROB tail updated to %d \n", rob->tail);
     rob->is_full=is_rob_full(rob);
     return rob_index;
 }
 
+//free the oldest entry once it has committed
+void rob_retire_head(reorder_buffer *rob){
+    rob->reorder_buffer_queue[rob->head].is_allocated=0;
+    rob->head=(rob->head+1)%ROB_SIZE;
+    rob->is_full=0;
+}
+
+//free every entry younger than rob_index, rob_index becomes the youngest
+void rob_squash_after(reorder_buffer *rob, int rob_index){
+    for(int i=(rob_index+1)%ROB_SIZE;i!=rob->tail;i=(i+1)%ROB_SIZE){
+        rob->reorder_buffer_queue[i].is_allocated=0;
+    }
+    rob->tail=(rob_index+1)%ROB_SIZE;
+    rob->is_full=0;
+}
 
 void print_rob_entries(reorder_buffer *rob){
     int i;
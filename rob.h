@@ -37,6 +37,18 @@ int opcode;
 //branch 3
 int positive_flag;
 int zero_flag;
+unsigned int seq;
+//FUSE_* pair, commits as two instructions
+int fusion;
+//lanes a VSTORE wrote, reported at commit like store_value
+int store_lanes[MAX_VECTOR_LENGTH];
+//data address of a load or store, from the trace when running one
+int mem_address;
+//running a trace: the PC executed next and whether decode predicted it wrong
+int trace_next_pc;
+int trace_mispredicted;
+//decoupled front end: the PC fetched after it, a branch mispredicted if it resolves elsewhere
+int predicted_pc;
 }reorder_buffer_entry;
 
 typedef struct reorder_buffer
@@ -51,4 +63,7 @@ int reorder_buffer_available(reorder_buffer *rob);
 int reorder_buffer_entry_addition_to_queue(reorder_buffer *rob, reorder_buffer_entry * rob_entry);
 void print_rob_entries(reorder_buffer *rob);
 int is_rob_full(reorder_buffer *rob);
+int rob_occupancy(reorder_buffer *rob);
+void rob_retire_head(reorder_buffer *rob);
+void rob_squash_after(reorder_buffer *rob, int rob_index);
 #endif